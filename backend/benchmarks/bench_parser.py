@@ -0,0 +1,82 @@
+"""
+解析器基准测试 - 对比词法分析路径与逐行正则路径的解析耗时，以及原生扫描核心与正则分词的耗时
+
+注意词法路径同时计算了各检测模块共享的每行预匹配结果（line_facts），
+而正则路径中这部分工作仍由各模块在 analyze() 中自行完成。
+
+用法（在 backend 目录下）：
+    python -m benchmarks.bench_parser [--lines 50000] [--repeat 3] [file.c ...]
+"""
+import argparse
+import os
+import sys
+import time
+from typing import Callable, Dict, List
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from benchmarks.corpus import generate_source
+from utils.c_lexer import NATIVE_AVAILABLE, CLexer
+from utils.code_parser import CCodeParser
+
+
+def time_parse(parse: Callable[[str], Dict[str, List]], content: str, repeat: int) -> float:
+    """返回多次解析中的最短耗时（秒）"""
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        parse(content)
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def bucket_sizes(parsed_data: Dict[str, List]) -> Dict[str, int]:
+    """统计各结果分类的条目数"""
+    return {key: len(value) for key, value in parsed_data.items() if key not in ('lines', 'tokens', 'line_facts')}
+
+
+def run(name: str, content: str, repeat: int):
+    """对一段代码运行两种解析路径并打印对比结果"""
+    lexer_parser = CCodeParser(use_lexer=True)
+    regex_parser = CCodeParser(use_lexer=False)
+    line_count = content.count('\n') + 1
+
+    regex_time = time_parse(regex_parser.parse_content, content, repeat)
+    lexer_time = time_parse(lexer_parser.parse_content, content, repeat)
+
+    print(f"{name}: {line_count} 行")
+    print(f"  正则路径:   {regex_time * 1000:9.1f} ms  ({line_count / regex_time:,.0f} 行/秒)")
+    print(f"  词法路径:   {lexer_time * 1000:9.1f} ms  ({line_count / lexer_time:,.0f} 行/秒)")
+    print(f"  加速比:     {regex_time / lexer_time:9.2f}x")
+
+    if NATIVE_AVAILABLE:
+        regex_tokenize = time_parse(CLexer(native=False).tokenize, content, repeat)
+        native_tokenize = time_parse(CLexer(native=True).tokenize, content, repeat)
+        print(f"  正则分词:   {regex_tokenize * 1000:9.1f} ms  ({line_count / regex_tokenize:,.0f} 行/秒)")
+        print(f"  原生分词:   {native_tokenize * 1000:9.1f} ms  ({line_count / native_tokenize:,.0f} 行/秒)")
+    else:
+        print("  原生扫描核心未构建（python setup.py build_ext --inplace），跳过分词对比")
+
+    regex_sizes = bucket_sizes(regex_parser.parse_content(content))
+    lexer_sizes = bucket_sizes(lexer_parser.parse_content(content))
+    for key in regex_sizes:
+        marker = '' if regex_sizes[key] == lexer_sizes.get(key) else '  *'
+        print(f"    {key:22s} 正则 {regex_sizes[key]:8d}  词法 {lexer_sizes.get(key, 0):8d}{marker}")
+
+
+def main():
+    """主函数"""
+    parser = argparse.ArgumentParser(description='CCodeParser 解析路径基准测试')
+    parser.add_argument('files', nargs='*', help='额外参与测试的C文件')
+    parser.add_argument('--lines', type=int, default=50000, help='合成代码的目标行数')
+    parser.add_argument('--repeat', type=int, default=3, help='每种路径的重复次数（取最短）')
+    args = parser.parse_args()
+
+    run('合成代码', generate_source(args.lines), args.repeat)
+    for file_path in args.files:
+        with open(file_path, 'r', encoding='utf-8') as f:
+            run(file_path, f.read(), args.repeat)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,147 @@
+"""
+检测流水线基准测试 - 在合成语料和病态输入上测量解码、分词、解析、上下文构建和各检测模块的吞吐量
+
+各阶段的耗时来自检测器自身记录的分阶段统计（AnalysisStats），与 --stats 输出一致。
+
+每份语料在单独的子进程中测量，峰值常驻内存（RSS）只包含该语料本身的分析。
+结果以 JSON 写出（--output），可以用 --baseline 与之前的结果比较，出现回退时以状态码 1 退出，
+供 CI 标记性能回退。
+
+用法（在 backend 目录下）：
+    python -m benchmarks.bench_pipeline [--repeat 3] [--output results.json] [--baseline old.json] [语料 ...]
+"""
+import argparse
+import json
+import multiprocessing
+import os
+import platform
+import sys
+from typing import Dict, List, Optional
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from benchmarks.compare import compare_results, print_regressions
+from benchmarks.corpus import CORPORA, DEFAULT_CORPORA, build_corpus
+from main import DETECTOR_VERSION, CBugDetector
+from utils.c_lexer import NATIVE_AVAILABLE
+from utils.instrumentation import AnalysisStats
+
+# 结果文件格式的版本，字段含义变化时需要更新
+RESULT_SCHEMA = 1
+
+
+def peak_rss_kb() -> Optional[int]:
+    """当前进程的峰值常驻内存（KB），平台不支持时返回 None"""
+    try:
+        import resource
+    except ImportError:
+        return None
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # macOS 以字节为单位，Linux 以 KB 为单位
+    return peak // 1024 if sys.platform == 'darwin' else peak
+
+
+def measure_corpus(name: str, corpus_dir: Optional[str], repeat: int, disabled: List[str]) -> Dict:
+    """在当前进程中测量一份语料，各阶段取多次运行中的最短耗时"""
+    if corpus_dir:
+        with open(os.path.join(corpus_dir, f'{name}.c'), 'r', encoding='utf-8') as f:
+            content = f.read()
+    else:
+        content = build_corpus(name)
+    raw_content = content.encode('utf-8')
+    line_count = content.count('\n') + 1
+    byte_count = len(raw_content)
+    del content
+
+    detector = CBugDetector(verbose=False)
+    for module_name in disabled:
+        detector.module_enabled[module_name] = False
+
+    seconds: Dict[str, float] = {}
+    report_count = 0
+    for _ in range(repeat):
+        stats = AnalysisStats()
+        report_count = len(detector.analyze_content(raw_content, name, stats))
+        for phase, (elapsed, _blocks) in stats.phases.items():
+            seconds[phase] = min(seconds.get(phase, elapsed), elapsed)
+
+    seconds['total'] = sum(seconds.values())
+    return {
+        'corpus': name,
+        'lines': line_count,
+        'bytes': byte_count,
+        'reports': report_count,
+        'peak_rss_kb': peak_rss_kb(),
+        'seconds': {phase: round(value, 6) for phase, value in seconds.items()},
+        'lines_per_second': {phase: round(line_count / value) if value > 0 else None
+                             for phase, value in seconds.items()},
+    }
+
+
+def run_isolated(name: str, corpus_dir: Optional[str], repeat: int, disabled: List[str]) -> Dict:
+    """在新启动的子进程中测量一份语料（spawn 方式，不继承父进程的内存）"""
+    context = multiprocessing.get_context('spawn')
+    with context.Pool(1) as pool:
+        return pool.apply(measure_corpus, (name, corpus_dir, repeat, disabled))
+
+
+def print_result(result: Dict):
+    """打印一份语料的测量结果"""
+    rss = f"{result['peak_rss_kb'] / 1024:,.1f} MB" if result['peak_rss_kb'] else '未知'
+    print(f"{result['corpus']}: {result['lines']} 行，{result['reports']} 个问题，峰值内存 {rss}")
+    for phase, value in result['seconds'].items():
+        lines_per_second = result['lines_per_second'][phase]
+        rate = f"{lines_per_second:,d} 行/秒" if lines_per_second else '-'
+        print(f"  {phase:22s} {value * 1000:10.1f} ms  {rate:>18s}")
+
+
+def main():
+    """主函数"""
+    parser = argparse.ArgumentParser(description='检测流水线基准测试')
+    parser.add_argument('corpora', nargs='*', help=f"语料名称（默认全部：{', '.join(DEFAULT_CORPORA)}）")
+    parser.add_argument('--corpus-dir', help='使用 corpus.py 预先生成的语料目录，而不是在进程内生成')
+    parser.add_argument('--repeat', type=int, default=3, help='每份语料的重复次数（各阶段取最短）')
+    parser.add_argument('--disable', nargs='+', default=[], help='不参与测量的模块')
+    parser.add_argument('--output', help='把结果写为JSON文件')
+    parser.add_argument('--baseline', help='与之前的结果文件比较，出现回退时以状态码1退出')
+    parser.add_argument('--max-slowdown', type=float, default=0.25, help='允许的吞吐量下降比例')
+    parser.add_argument('--max-rss-growth', type=float, default=0.25, help='允许的峰值内存增长比例')
+    args = parser.parse_args()
+
+    names = args.corpora or DEFAULT_CORPORA
+    for name in names:
+        if name not in CORPORA:
+            parser.error(f"未知的语料: {name}（可用: {', '.join(CORPORA)}）")
+
+    results = []
+    for name in names:
+        result = run_isolated(name, args.corpus_dir, max(1, args.repeat), args.disable)
+        print_result(result)
+        results.append(result)
+
+    data = {
+        'schema': RESULT_SCHEMA,
+        'implementation': 'python',
+        'detector_version': DETECTOR_VERSION,
+        'python': platform.python_version(),
+        'native_lexer': NATIVE_AVAILABLE,
+        'platform': platform.platform(),
+        'repeat': args.repeat,
+        'results': results,
+    }
+    if args.output:
+        with open(args.output, 'w', encoding='utf-8') as f:
+            json.dump(data, f, indent=2, ensure_ascii=False)
+        print(f"结果已保存到: {args.output}")
+
+    if args.baseline:
+        with open(args.baseline, 'r', encoding='utf-8') as f:
+            baseline = json.load(f)
+        regressions = compare_results(baseline, data, args.max_slowdown, args.max_rss_growth)
+        print_regressions(regressions)
+        if regressions:
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,68 @@
+"""
+基准测试结果比较 - 找出吞吐量下降或峰值内存增长超过阈值的语料和阶段
+
+Python 流水线（bench_pipeline.py）和 TS 检测器（npm run benchmark）的结果使用同一格式，
+都可以用本脚本与基线比较。
+
+用法（在 backend 目录下）：
+    python -m benchmarks.compare baseline.json current.json [--max-slowdown 0.25] [--max-rss-growth 0.25]
+"""
+import argparse
+import json
+import sys
+from typing import Dict, List
+
+
+def compare_results(baseline: Dict, current: Dict, max_slowdown: float, max_rss_growth: float) -> List[str]:
+    """返回回退的描述列表；只比较两份结果中都存在的语料和阶段"""
+    baseline_results = {result['corpus']: result for result in baseline.get('results', [])}
+    regressions = []
+    for result in current.get('results', []):
+        name = result['corpus']
+        old = baseline_results.get(name)
+        if old is None:
+            continue
+
+        for phase, rate in result['lines_per_second'].items():
+            old_rate = old['lines_per_second'].get(phase)
+            if rate and old_rate and rate < old_rate * (1 - max_slowdown):
+                regressions.append(f"{name} {phase}: {old_rate:,d} -> {rate:,d} 行/秒 "
+                                   f"({(rate / old_rate - 1) * 100:+.1f}%)")
+
+        rss, old_rss = result.get('peak_rss_kb'), old.get('peak_rss_kb')
+        if rss and old_rss and rss > old_rss * (1 + max_rss_growth):
+            regressions.append(f"{name} 峰值内存: {old_rss:,d} -> {rss:,d} KB "
+                               f"({(rss / old_rss - 1) * 100:+.1f}%)")
+    return regressions
+
+
+def print_regressions(regressions: List[str]):
+    """打印比较结果"""
+    if not regressions:
+        print("✅ 与基线相比没有性能回退")
+        return
+    print(f"❌ 发现 {len(regressions)} 处性能回退:")
+    for regression in regressions:
+        print(f"  {regression}")
+
+
+def main():
+    """主函数"""
+    parser = argparse.ArgumentParser(description='比较两份基准测试结果')
+    parser.add_argument('baseline', help='基线结果文件')
+    parser.add_argument('current', help='当前结果文件')
+    parser.add_argument('--max-slowdown', type=float, default=0.25, help='允许的吞吐量下降比例')
+    parser.add_argument('--max-rss-growth', type=float, default=0.25, help='允许的峰值内存增长比例')
+    args = parser.parse_args()
+
+    with open(args.baseline, 'r', encoding='utf-8') as f:
+        baseline = json.load(f)
+    with open(args.current, 'r', encoding='utf-8') as f:
+        current = json.load(f)
+    regressions = compare_results(baseline, current, args.max_slowdown, args.max_rss_growth)
+    print_regressions(regressions)
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == '__main__':
+    main()
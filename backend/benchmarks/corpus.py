@@ -0,0 +1,148 @@
+"""
+基准测试语料 - 按目标行数生成的合成C代码和几类病态输入
+
+语料完全由名称确定（同一名称总是生成相同的内容），Python 和 TS 两侧的基准测试
+可以各自生成，也可以用 --output 写到一个目录中共享。
+
+用法（在仓库根目录或 backend 目录下）：
+    python backend/benchmarks/corpus.py --output bench-corpus [名称 ...]
+"""
+import argparse
+import json
+import os
+from typing import Callable, Dict, List
+
+
+# 合成代码的函数模板：涵盖声明、调用、赋值、解引用、malloc/free、输入输出、循环和注释
+_FUNCTION_TEMPLATE = '''/* 生成函数 {index} */
+int compute_{index}(int a, int b) {{
+    int result;
+    int count = 0;
+    int *buffer = malloc(sizeof(int) * 16);
+    char *name = "item_{index} // literal";
+    if (buffer != NULL) {{
+        *buffer = a + b;
+    }}
+    for (count = 0; count < b; count++) {{
+        result = result + count * 2; // 累加
+    }}
+    while (count > 0) {{
+        count--;
+    }}
+    scanf("%d", &count);
+    printf("%d %s\\n", result, name);
+    free(buffer);
+    return result;
+}}
+
+'''
+
+_HEADER = '#include <stdio.h>\n#include <stdlib.h>\n\n'
+
+
+def generate_source(target_lines: int) -> str:
+    """生成至少 target_lines 行的合成C代码"""
+    per_function = _FUNCTION_TEMPLATE.count('\n')
+    functions = max(1, target_lines // per_function)
+    body = ''.join(_FUNCTION_TEMPLATE.format(index=i) for i in range(functions))
+    return _HEADER + body
+
+
+def generate_long_lines(line_count: int = 200, width: int = 20000) -> str:
+    """每行一条很长的表达式语句（压缩或生成的代码）"""
+    terms = max(1, width // 12)
+    lines = [_HEADER, 'int long_lines(int a, int b) {\n', '    int total = 0;\n']
+    for i in range(line_count):
+        expression = ' + '.join(f'(a * {j} - b)' for j in range(i, i + terms))
+        lines.append(f'    total = total + {expression};\n')
+    lines.append('    printf("%d\\n", total);\n    return total;\n}\n')
+    return ''.join(lines)
+
+
+def generate_deep_nesting(depth: int = 400, functions: int = 20) -> str:
+    """深度嵌套的 if/for/while 块"""
+    keywords = ('if (a > {i})', 'for (i{i} = 0; i{i} < b; i{i}++)', 'while (b > {i})')
+    parts = [_HEADER]
+    for index in range(functions):
+        parts.append(f'int nested_{index}(int a, int b) {{\n')
+        parts.append(''.join(f'    int i{i} = 0;\n' for i in range(depth)))
+        for i in range(depth):
+            parts.append('    ' * (i % 32 + 1) + keywords[i % 3].format(i=i) + ' {\n')
+        parts.append('    ' * 33 + 'a = a + b;\n')
+        for i in reversed(range(depth)):
+            parts.append('    ' * (i % 32 + 1) + '}\n')
+        parts.append('    return a;\n}\n\n')
+    return ''.join(parts)
+
+
+def generate_malloc_free_pairs(pairs: int = 5000) -> str:
+    """一个函数中成千上万对 malloc/free，其中一部分有泄漏、重复释放和缺少空指针检查"""
+    parts = [_HEADER, 'int allocations(int n) {\n']
+    for i in range(pairs):
+        parts.append(f'    int *p{i} = malloc(sizeof(int) * n);\n')
+        if i % 7:
+            parts.append(f'    if (p{i} == NULL) {{\n        return -1;\n    }}\n')
+        parts.append(f'    *p{i} = {i};\n')
+        if i % 11:
+            parts.append(f'    free(p{i});\n')
+        if i % 13 == 0:
+            parts.append(f'    free(p{i});\n')
+    parts.append('    return 0;\n}\n')
+    return ''.join(parts)
+
+
+# 语料名称 -> 生成函数；按名称在进程内重新生成，避免在进程之间传递大段文本
+CORPORA: Dict[str, Callable[[], str]] = {
+    'lines-1k': lambda: generate_source(1000),
+    'lines-10k': lambda: generate_source(10000),
+    'lines-100k': lambda: generate_source(100000),
+    'lines-1m': lambda: generate_source(1000000),
+    'long-lines': generate_long_lines,
+    'deep-nesting': generate_deep_nesting,
+    'malloc-free-pairs': generate_malloc_free_pairs,
+}
+
+# 未指定语料时使用的默认集合
+DEFAULT_CORPORA = list(CORPORA)
+
+
+def build_corpus(name: str) -> str:
+    """按名称生成一份语料"""
+    if name not in CORPORA:
+        raise KeyError(f"未知的语料: {name}（可用: {', '.join(CORPORA)}）")
+    return CORPORA[name]()
+
+
+def write_corpus(directory: str, names: List[str]) -> Dict[str, Dict]:
+    """把语料写为 directory/<名称>.c，并写入记录行数和字节数的 manifest.json"""
+    os.makedirs(directory, exist_ok=True)
+    manifest = {}
+    for name in names:
+        content = build_corpus(name)
+        file_name = f'{name}.c'
+        with open(os.path.join(directory, file_name), 'w', encoding='utf-8', newline='\n') as f:
+            f.write(content)
+        manifest[name] = {
+            'file': file_name,
+            'lines': content.count('\n') + 1,
+            'bytes': len(content.encode('utf-8')),
+        }
+    with open(os.path.join(directory, 'manifest.json'), 'w', encoding='utf-8') as f:
+        json.dump(manifest, f, indent=2, ensure_ascii=False)
+    return manifest
+
+
+def main():
+    """主函数"""
+    parser = argparse.ArgumentParser(description='生成基准测试语料')
+    parser.add_argument('names', nargs='*', help=f"语料名称（默认全部：{', '.join(DEFAULT_CORPORA)}）")
+    parser.add_argument('--output', required=True, help='语料输出目录')
+    args = parser.parse_args()
+
+    manifest = write_corpus(args.output, args.names or DEFAULT_CORPORA)
+    for name, entry in manifest.items():
+        print(f"{name:20s} {entry['lines']:9d} 行  {entry['bytes']:11,d} 字节")
+
+
+if __name__ == '__main__':
+    main()
@@ -2,10 +2,12 @@
 C语言Bug检测器主程序
 整合所有检测模块，提供统一的检测接口
 """
+import io
 import os
 import sys
 import argparse
-from typing import List, Dict, Any
+from concurrent.futures import ProcessPoolExecutor
+from typing import Callable, List, Dict, Any, Optional, Sequence
 from colorama import init, Fore, Style
 
 # 初始化colorama
@@ -20,21 +22,70 @@ from modules.numeric_control_flow import NumericControlFlowModule
 # 导入工具类
 from utils.error_reporter import ErrorReporter, BugReport
 from utils.code_parser import CCodeParser
+from utils.analysis_context import AnalysisContext
+from utils.result_cache import ResultCache
+from utils.analysis_daemon import run_daemon
+from utils.source_lines import open_source_buffer
+from utils.library_table import library_table_paths, load_library_table
+from utils.instrumentation import AnalysisStats, timed
+from utils.time_budget import BudgetExceeded, TimeBudget
+from utils.compact_reports import CompactStreamWriter, compact_document
+from utils.include_graph import IncludeGraph, scan_includes
+from utils.function_summaries import SummaryIndex, content_stamp, summarize_functions
+from utils.changed_files import Baseline, ChangeSet, baseline_key
+from utils.report_stream import DEFAULT_TOP_FILES, ReportSummary, StreamingReporter, open_report_stream
+
+
+# 检测器版本，检测逻辑变化时需要更新，以使旧的缓存结果失效
+DETECTOR_VERSION = '1.4.0'
+
+# 默认结果缓存目录
+DEFAULT_CACHE_DIR = os.path.join(os.path.expanduser('~'), '.cache', 'c-bug-detector')
+
+# 超过该大小的文件使用内存映射流式解析
+STREAM_THRESHOLD_BYTES = 32 * 1024 * 1024
+
+# 供程序读取的紧凑输出格式：compact 为单个不缩进的JSON文档，ndjson 为逐文件一行的报告流
+COMPACT_FORMATS = ('compact', 'ndjson')
+
+# 供程序读取的输出格式：标准输出只用于报告，进度信息输出到标准错误
+MACHINE_FORMATS = (*COMPACT_FORMATS, 'sarif')
 
 
 class CBugDetector:
     """C语言Bug检测器主类"""
     
-    def __init__(self):
+    def __init__(self, verbose: bool = True, cache_dir: Optional[str] = None, stream: bool = False,
+                 library_tables: Sequence[str] = (), time_budget: Optional[float] = None,
+                 include_dirs: Sequence[str] = ()):
+        # verbose=False 时不输出逐文件、逐模块的进度信息（并行工作进程使用）
+        self.verbose = verbose
+        # stream=True 时所有文件都使用流式解析，否则只有超过 STREAM_THRESHOLD_BYTES 的文件使用
+        self.stream = stream
+        # 每个文件的分析时间上限（秒），None 表示不限制；超时后跳过尚未完成的模块
+        self.time_budget = time_budget
+        # 标准库查找表：内置表加上 library_tables 中的额外表，编译结果在进程内共享
+        self.library_tables = library_table_paths(library_tables)
+        self.library_table = load_library_table(self.library_tables)
+        # 指定 cache_dir 时启用按内容哈希的结果缓存；查找表的内容参与缓存版本，修改表后旧结果失效
+        self.cache = ResultCache(cache_dir, f"{DETECTOR_VERSION}+{self.library_table.digest}") if cache_dir else None
+        # 工作区头文件的包含关系图：头文件摘要只解析一次，由所有包含它的文件共享
+        self.include_dirs = list(include_dirs)
+        self.include_graph = IncludeGraph(self.include_dirs)
+        # 工作区函数的摘要（分配、释放参数）：每个函数只计算一次，由所有调用它的文件共享
+        self.function_summaries = SummaryIndex()
         self.parser = CCodeParser()
         self.error_reporter = ErrorReporter()
+        # 最近一次分析的分阶段统计，以及目录分析中每个文件的统计
+        self.last_stats: Optional[AnalysisStats] = None
+        self.file_stats: Dict[str, AnalysisStats] = {}
         
-        # 初始化所有检测模块
+        # 初始化所有检测模块（共享同一个错误报告器）
         self.modules = {
-            'memory_safety': MemorySafetyModule(),
-            'variable_state': VariableStateModule(),
-            'standard_library': StandardLibraryModule(),
-            'numeric_control_flow': NumericControlFlowModule(),
+            'memory_safety': MemorySafetyModule(self.error_reporter),
+            'variable_state': VariableStateModule(self.error_reporter),
+            'standard_library': StandardLibraryModule(self.error_reporter, self.library_table),
+            'numeric_control_flow': NumericControlFlowModule(self.error_reporter),
         }
         
         # 模块启用状态
@@ -46,8 +97,11 @@ class CBugDetector:
         }
     
     def analyze_file(self, file_path: str) -> List[BugReport]:
-        """分析单个C文件"""
-        print(f"{Fore.CYAN}🔍 正在分析文件: {file_path}{Style.RESET_ALL}")
+        """分析单个C文件，各阶段的统计记录在 last_stats 中"""
+        stats = self.last_stats = AnalysisStats()
+        budget = TimeBudget(self.time_budget)
+        if self.verbose:
+            print(f"{Fore.CYAN}🔍 正在分析文件: {file_path}{Style.RESET_ALL}")
         
         # 检查文件是否存在
         if not os.path.exists(file_path):
@@ -55,57 +109,231 @@ class CBugDetector:
             return []
         
         # 检查文件扩展名
-        if not file_path.endswith('.c'):
+        if not file_path.endswith('.c') and self.verbose:
             print(f"{Fore.YELLOW}⚠️  警告: 文件 {file_path} 不是C文件(.c){Style.RESET_ALL}")
         
         try:
-            # 解析C代码
-            parsed_data = self.parser.parse_file(file_path)
-            if not parsed_data:
-                print(f"{Fore.RED}❌ 错误: 无法解析文件 {file_path}{Style.RESET_ALL}")
+            if self.stream or os.path.getsize(file_path) >= STREAM_THRESHOLD_BYTES:
+                return self._analyze_mapped_file(file_path, stats, budget)
+            with stats.phase('read'):
+                with open(file_path, 'rb') as f:
+                    raw_content = f.read()
+        except OSError as e:
+            print(f"{Fore.RED}❌ 错误: 无法读取文件 {file_path}: {e}{Style.RESET_ALL}")
+            return []
+        
+        return self.analyze_content(raw_content, file_path, stats, budget)
+    
+    def _analyze_mapped_file(self, file_path: str, stats: AnalysisStats, budget: TimeBudget) -> List[BugReport]:
+        """内存映射文件后流式解析，不在内存中保留整份文本和每行的文本"""
+        with stats.phase('read'):
+            buffer = open_source_buffer(file_path)
+        try:
+            cache_key = None
+            if self.cache:
+                cached_reports, cache_key = self._lookup_cache(buffer, file_path, stats)
+                if cached_reports is not None:
+                    return cached_reports
+            
+            try:
+                parsed_data = self.parser.parse_buffer(buffer, stats)
+            except UnicodeDecodeError as e:
+                print(f"{Fore.RED}❌ 错误: 无法解析文件 {file_path}: {e}{Style.RESET_ALL}")
                 return []
             
+            return self._run_modules(parsed_data, file_path, cache_key, stats, budget)
+        finally:
+            if hasattr(buffer, 'close'):
+                buffer.close()
+    
+    def _lookup_cache(self, content, file_path: str, stats: AnalysisStats):
+        """按内容和所包含的工作区头文件的摘要查找缓存结果，返回 (缓存的报告或 None, 缓存键)"""
+        with stats.phase('cache'):
+            dependencies = self.include_graph.file_closure(file_path, scan_includes(content)).digest
+            if isinstance(content, bytes):
+                # 结果还取决于所调用的其他文件中函数的摘要，先建立本文件的局部摘要（内容未变时不重新计算）
+                self.function_summaries.index_content(file_path, content)
+                dependencies += self.function_summaries.dependency_digest(file_path)
+            cache_key = self.cache.make_key(content, self.get_enabled_modules(), dependencies)
+            cached_reports = self.cache.get(cache_key)
+        if cached_reports is not None:
+            stats.cached = True
+            if self.verbose:
+                print(f"{Fore.GREEN}♻️  使用缓存结果: {file_path}{Style.RESET_ALL}")
+        return cached_reports, cache_key
+    
+    def analyze_content(self, raw_content: bytes, file_path: str = '',
+                        stats: Optional[AnalysisStats] = None,
+                        budget: Optional[TimeBudget] = None) -> List[BugReport]:
+        """分析一段C代码内容（文件内容或编辑器中尚未保存的内容）"""
+        if stats is None:
+            stats = self.last_stats = AnalysisStats()
+        if budget is None:
+            budget = TimeBudget(self.time_budget)
+        
+        # 内容、模块集合和检测器版本都未变化时直接复用缓存结果
+        cache_key = None
+        if self.cache:
+            cached_reports, cache_key = self._lookup_cache(raw_content, file_path, stats)
+            if cached_reports is not None:
+                return cached_reports
+        
+        try:
+            with stats.phase('decode'):
+                content = CCodeParser.decode_source(raw_content)
+        except UnicodeDecodeError as e:
+            print(f"{Fore.RED}❌ 错误: 无法解析文件 {file_path}: {e}{Style.RESET_ALL}")
+            return []
+        
+        try:
+            # 解析C代码（每个文件只解析一次，所有模块共享同一个上下文）
+            parsed_data = self.parser.parse_content(content, stats)
+        except Exception as e:
+            print(f"{Fore.RED}❌ 分析文件时出错: {e}{Style.RESET_ALL}")
+            return []
+        
+        return self._run_modules(parsed_data, file_path, cache_key, stats, budget, content_stamp(raw_content))
+    
+    def _run_modules(self, parsed_data: Dict[str, List], file_path: str, cache_key: Optional[str],
+                     stats: AnalysisStats, budget: TimeBudget,
+                     summary_stamp: Optional[tuple] = None) -> List[BugReport]:
+        """在解析结果上运行所有启用的模块，所有模块都完整运行时写入结果缓存
+
+        超过时间预算时，正在运行的模块保留已产生的报告并标记为部分结果，之后的模块不再运行；
+        这些模块记录在 stats.incomplete_modules 中。
+        summary_stamp 为内容标记，给出时由解析得到的记号更新本文件的函数摘要（流式解析不保留记号，不使用摘要）。
+        """
+        try:
+            with stats.phase('includes'):
+                include_closure = self.include_graph.file_closure(
+                    file_path, [include['header'] for include in parsed_data['includes']])
+            function_summaries = None
+            if summary_stamp is not None and parsed_data['tokens']:
+                with stats.phase('summaries'):
+                    if not self.function_summaries.has_file(file_path, summary_stamp):
+                        self.function_summaries.update_file(file_path, summary_stamp,
+                                                            summarize_functions(parsed_data['tokens']))
+                function_summaries = self.function_summaries
+            with stats.phase('context'):
+                context = AnalysisContext.from_parsed_data(parsed_data, file_path, budget, include_closure,
+                                                           function_summaries)
+            
             # 清空之前的报告
             self.error_reporter.clear_reports()
             
-            # 运行所有启用的模块
+            # 运行所有启用的模块，报告直接写入共享的错误报告器
+            module_failed = False
             for module_name, module in self.modules.items():
                 if self.module_enabled[module_name]:
-                    print(f"{Fore.GREEN}📋 运行模块: {module.get_module_name()}{Style.RESET_ALL}")
+                    if budget.expired():
+                        stats.incomplete_modules.append(module_name)
+                        continue
+                    if self.verbose:
+                        print(f"{Fore.GREEN}📋 运行模块: {module.get_module_name()}{Style.RESET_ALL}")
+                    report_count = len(self.error_reporter.reports)
                     try:
-                        reports = module.analyze(parsed_data)
-                        for report in reports:
-                            self.error_reporter.add_report(report)
+                        with stats.phase(module_name):
+                            module.analyze(context)
+                    except BudgetExceeded:
+                        self.error_reporter.mark_partial(report_count)
+                        stats.incomplete_modules.append(module_name)
                     except Exception as e:
+                        # 丢弃出错模块的部分结果
+                        self.error_reporter.truncate(report_count)
+                        module_failed = True
                         print(f"{Fore.RED}❌ 模块 {module_name} 运行出错: {e}{Style.RESET_ALL}")
             
-            return self.error_reporter.get_reports()
+            if stats.incomplete_modules:
+                names = ', '.join(self.modules[name].get_module_name() for name in stats.incomplete_modules)
+                print(f"{Fore.YELLOW}⏱️  {file_path or '输入内容'} 超过时间预算（{budget.seconds} 秒），"
+                      f"未完成的模块: {names}{Style.RESET_ALL}")
+            
+            reports = list(self.error_reporter.get_reports())
+            if cache_key and not module_failed and not stats.incomplete_modules:
+                with stats.phase('cache'):
+                    self.cache.put(cache_key, reports)
+            return reports
             
         except Exception as e:
             print(f"{Fore.RED}❌ 分析文件时出错: {e}{Style.RESET_ALL}")
             return []
     
-    def analyze_directory(self, directory_path: str) -> Dict[str, List[BugReport]]:
-        """分析目录中的所有C文件"""
+    def analyze_directory(self, directory_path: str, jobs: int = 1,
+                          on_result: Optional[Callable[[str, List[BugReport], AnalysisStats], None]] = None,
+                          keep_results: bool = True) -> Dict[str, List[BugReport]]:
+        """分析目录中的所有C文件
+
+        jobs > 1 时使用多进程并行分析，每个工作进程持有自己的检测器和模块实例；
+        无论是否并行，结果都按排序后的文件路径顺序合并。
+        指定 on_result 时每个文件（包括没有问题的文件）一完成就按同样的顺序回调，用于流式输出；
+        keep_results=False 时不保留报告和逐文件统计（返回空字典），报告只经 on_result 传出，内存占用与文件数无关。
+        """
         print(f"{Fore.CYAN}🔍 正在分析目录: {directory_path}{Style.RESET_ALL}")
         
         if not os.path.exists(directory_path):
             print(f"{Fore.RED}❌ 错误: 目录 {directory_path} 不存在{Style.RESET_ALL}")
             return {}
         
+        return self.analyze_files(self.collect_c_files(directory_path), jobs, on_result, keep_results=keep_results)
+    
+    def analyze_files(self, file_paths: Sequence[str], jobs: int = 1,
+                      on_result: Optional[Callable[[str, List[BugReport], AnalysisStats], None]] = None,
+                      index_paths: Optional[Sequence[str]] = None,
+                      keep_results: bool = True) -> Dict[str, List[BugReport]]:
+        """分析一组C文件，参数和结果与 analyze_directory 相同
+
+        分析之前先建立 index_paths（默认为 file_paths）中所有文件的函数摘要；
+        只分析目录中的部分文件时应传入目录中的所有文件，使跨文件的摘要与完整分析相同。
+        """
         results = {}
+        self.file_stats = {}
         
-        # 遍历目录中的所有C文件
-        for root, dirs, files in os.walk(directory_path):
-            for file in files:
-                if file.endswith('.c'):
-                    file_path = os.path.join(root, file)
-                    reports = self.analyze_file(file_path)
+        # 先建立所有文件的函数摘要，分析每个文件时都能使用其他文件中的包装函数的摘要
+        self.function_summaries.index_files(file_paths if index_paths is None else index_paths)
+        
+        if jobs > 1 and len(file_paths) > 1:
+            print(f"{Fore.CYAN}⚙️  使用 {jobs} 个进程并行分析 {len(file_paths)} 个文件{Style.RESET_ALL}")
+            chunksize = max(1, len(file_paths) // (jobs * 8))
+            cache_dir = self.cache.cache_dir if self.cache else None
+            with ProcessPoolExecutor(max_workers=jobs, initializer=_init_worker,
+                                     initargs=(dict(self.module_enabled), cache_dir, self.stream,
+                                               self.library_tables, self.time_budget,
+                                               self.include_dirs, self.function_summaries.export())) as executor:
+                # executor.map 按提交顺序返回结果，保证合并顺序固定
+                for file_path, reports, stats in executor.map(_analyze_in_worker, file_paths, chunksize=chunksize):
+                    if on_result:
+                        on_result(file_path, reports, stats)
+                    if keep_results:
+                        self.file_stats[file_path] = stats
+                        if reports:
+                            results[file_path] = reports
+        else:
+            for file_path in file_paths:
+                reports = self.analyze_file(file_path)
+                if on_result:
+                    on_result(file_path, reports, self.last_stats)
+                if keep_results:
+                    self.file_stats[file_path] = self.last_stats
                     if reports:
                         results[file_path] = reports
         
         return results
     
+    @staticmethod
+    def collect_c_files(directory_path: str) -> List[str]:
+        """按固定顺序收集目录中的所有C文件"""
+        file_paths = []
+        for root, dirs, files in os.walk(directory_path):
+            dirs.sort()
+            for file in sorted(files):
+                if file.endswith('.c'):
+                    file_paths.append(os.path.join(root, file))
+        return file_paths
+    
+    def get_enabled_modules(self) -> List[str]:
+        """获取已启用的模块名列表"""
+        return [name for name, enabled in self.module_enabled.items() if enabled]
+    
     def enable_module(self, module_name: str):
         """启用指定模块"""
         if module_name in self.modules:
@@ -132,30 +360,47 @@ class CBugDetector:
             print(f"  描述: {module.get_description()}")
             print()
     
-    def generate_report(self, reports: List[BugReport], output_format: str = 'text') -> str:
-        """生成检测报告"""
+    def generate_report(self, reports: List[BugReport], output_format: str = 'text',
+                        stats: Optional[AnalysisStats] = None, file_path: str = '') -> str:
+        """生成检测报告
+
+        指定 stats 时把报告格式化的耗时记为 format 阶段，并附带统计：
+        json 格式输出 {"reports": [...], "stats": {...}}，text 格式在报告后附加耗时表，
+        紧凑格式（compact、ndjson）在文件记录中附带 stats。
+        """
+        if stats is not None:
+            # 同一份报告可能格式化多次（输出到终端和保存到文件），只保留最近一次的耗时
+            stats.phases.pop('format', None)
         if output_format == 'text':
-            return self.error_reporter.format_all_reports()
+            with timed(stats, 'format'):
+                content = self.error_reporter.format_all_reports(reports)
+            if stats is None:
+                return content
+            module_names = {name: module.get_module_name() for name, module in self.modules.items()}
+            return content + '\n' + stats.format_text(module_names)
         elif output_format == 'json':
             import json
-            report_data = []
-            for report in reports:
-                report_data.append({
-                    'line_number': report.line_number,
-                    'error_type': report.error_type.value,
-                    'severity': report.severity.value,
-                    'message': report.message,
-                    'suggestion': report.suggestion,
-                    'code_snippet': report.code_snippet,
-                    'module_name': report.module_name
-                })
-            return json.dumps(report_data, indent=2, ensure_ascii=False)
+            if stats is None:
+                report_data = [report.to_dict() for report in reports]
+                return json.dumps(report_data, indent=2, ensure_ascii=False)
+            with stats.phase('format'):
+                report_data = [report.to_dict() for report in reports]
+            return json.dumps({'reports': report_data, 'stats': stats.to_dict()}, indent=2, ensure_ascii=False)
+        elif output_format == 'compact':
+            return compact_document(DETECTOR_VERSION, [(file_path, reports, stats)])
+        elif output_format == 'ndjson':
+            output = io.StringIO()
+            writer = CompactStreamWriter(output, DETECTOR_VERSION)
+            writer.write_file(file_path, reports, stats)
+            writer.close()
+            return output.getvalue().rstrip('\n')
         else:
             return "不支持的输出格式"
     
-    def save_report(self, reports: List[BugReport], output_file: str, output_format: str = 'text'):
+    def save_report(self, reports: List[BugReport], output_file: str, output_format: str = 'text',
+                    stats: Optional[AnalysisStats] = None):
         """保存检测报告到文件"""
-        report_content = self.generate_report(reports, output_format)
+        report_content = self.generate_report(reports, output_format, stats)
         try:
             with open(output_file, 'w', encoding='utf-8') as f:
                 f.write(report_content)
@@ -164,21 +409,211 @@ class CBugDetector:
             print(f"{Fore.RED}❌ 保存报告时出错: {e}{Style.RESET_ALL}")
 
 
+# 工作进程内的检测器实例，由 _init_worker 在每个进程中各创建一次
+_worker_detector: Optional[CBugDetector] = None
+
+
+def _init_worker(module_enabled: Dict[str, bool], cache_dir: Optional[str], stream: bool,
+                 library_tables: Sequence[str], time_budget: Optional[float], include_dirs: Sequence[str],
+                 function_summaries: Dict):
+    """工作进程初始化：创建进程私有的检测器和模块实例（每个进程有自己的头文件摘要缓存）
+
+    function_summaries 为主进程预先建立的各文件的局部函数摘要，工作进程只按需计算完整摘要。
+    """
+    global _worker_detector
+    _worker_detector = CBugDetector(verbose=False, cache_dir=cache_dir, stream=stream,
+                                    library_tables=library_tables, time_budget=time_budget,
+                                    include_dirs=include_dirs)
+    _worker_detector.module_enabled.update(module_enabled)
+    _worker_detector.function_summaries.load(function_summaries)
+
+
+def _analyze_in_worker(file_path: str):
+    """在工作进程中分析单个文件，连同分阶段统计一起返回"""
+    reports = _worker_detector.analyze_file(file_path)
+    return file_path, reports, _worker_detector.last_stats
+
+
+def resolve_jobs(jobs: int) -> int:
+    """解析 --jobs 参数，0 表示使用全部CPU核心"""
+    if jobs <= 0:
+        return os.cpu_count() or 1
+    return jobs
+
+
+def stream_results(detector: CBugDetector, input_path: str, reporter: StreamingReporter,
+                   with_stats: bool, jobs: int):
+    """分析文件或目录，每个文件一完成就把报告交给 reporter；目录分析不在内存中保留报告"""
+    def file_stats(stats: Optional[AnalysisStats]) -> Optional[AnalysisStats]:
+        return stats if with_stats else None
+    
+    if os.path.isfile(input_path):
+        reports = detector.analyze_file(input_path)
+        reporter.write_file(input_path, reports, file_stats(detector.last_stats))
+    else:
+        detector.analyze_directory(input_path, jobs, keep_results=False, on_result=lambda file_path, reports, stats:
+                                   reporter.write_file(file_path, reports, file_stats(stats)))
+
+
+def write_machine_results(detector: CBugDetector, input_path: str, output_format: str, output,
+                          with_stats: bool, jobs: int, top_files: int) -> Optional[ReportSummary]:
+    """以供程序读取的格式输出文件或目录的检测结果
+
+    ndjson 和 sarif 格式下每个文件一完成就写出（包括没有问题的文件），内存中只保留摘要，返回该摘要；
+    compact 格式在所有文件完成后输出一个文档。
+    """
+    if output_format != 'compact':
+        reporter = open_report_stream(output_format, output, DETECTOR_VERSION, top_files)
+        stream_results(detector, input_path, reporter, with_stats, jobs)
+        return reporter.close()
+    
+    def file_stats(stats: Optional[AnalysisStats]) -> Optional[AnalysisStats]:
+        return stats if with_stats else None
+    
+    files = []
+    if os.path.isfile(input_path):
+        files.append((input_path, detector.analyze_file(input_path), file_stats(detector.last_stats)))
+    else:
+        detector.analyze_directory(input_path, jobs, on_result=lambda file_path, reports, stats:
+                                   files.append((file_path, reports, file_stats(stats))))
+    output.write(compact_document(DETECTOR_VERSION, files) + '\n')
+    return None
+
+
+def run_change_check(detector: CBugDetector, args, output) -> int:
+    """变更检查：只分析变化的文件及受其影响的文件，与基线比较时只输出新增和已修复的问题
+
+    变化的文件来自 --changed-since（git 版本）或 --changed-files（文件列表），都未指定时分析目录中的所有文件。
+    未重新分析的文件沿用基线中的结果，结果缓存照常使用。
+    返回退出码：有新增问题时为 1，出错时为 2，否则为 0。
+    """
+    import json
+    directory = args.input
+    if not os.path.isdir(directory):
+        print(f"{Fore.RED}❌ 错误: 变更检查需要输入目录{Style.RESET_ALL}")
+        return 2
+    try:
+        changes = None
+        if args.changed_since:
+            changes = ChangeSet.from_git(directory, args.changed_since)
+        elif args.changed_files:
+            changes = ChangeSet.from_list(args.changed_files)
+        baseline = Baseline.load(args.baseline, directory) if args.baseline else None
+    except (OSError, ValueError) as e:
+        print(f"{Fore.RED}❌ 错误: {e}{Style.RESET_ALL}")
+        return 2
+    if args.write_baseline and changes is not None and baseline is None:
+        print(f"{Fore.RED}❌ 错误: 只分析变化的文件时，--write-baseline 需要同时指定 --baseline 以合并结果{Style.RESET_ALL}")
+        return 2
+    if baseline is not None and (baseline.version != DETECTOR_VERSION
+                                 or baseline.modules != detector.get_enabled_modules()):
+        print(f"{Fore.YELLOW}⚠️  基线由检测器 {baseline.version or '未知版本'}、模块 {', '.join(baseline.modules)} 生成，"
+              f"与当前设置不同，比较结果可能包含无关的变化{Style.RESET_ALL}")
+    
+    file_paths = detector.collect_c_files(directory)
+    # 所有文件的函数摘要用于找出受影响的文件，也使被分析文件的跨文件摘要与完整分析相同
+    detector.function_summaries.index_files(file_paths)
+    targets = file_paths
+    if changes is not None:
+        targets = changes.affected_files(file_paths, detector.include_graph, detector.function_summaries)
+        print(f"{Fore.CYAN}🔍 {len(changes.paths)} 个文件有变化，分析其中及受其影响的 {len(targets)} 个文件"
+              f"（共 {len(file_paths)} 个C文件）{Style.RESET_ALL}")
+    
+    results: Dict[str, List[BugReport]] = {}
+    detector.analyze_files(targets, resolve_jobs(args.jobs), index_paths=(), keep_results=False,
+                           on_result=lambda file_path, reports, stats: results.__setitem__(file_path, reports))
+    removed = baseline.missing_files(file_paths) if baseline is not None else []
+    
+    def entry(key: str, report: Dict) -> Dict:
+        return {'file': key, **report}
+    
+    data: Dict[str, Any] = {'analyzed_files': [baseline_key(directory, file_path) for file_path in targets]}
+    exit_code = 0
+    if baseline is not None:
+        new, fixed = baseline.compare(results, removed)
+        data['removed_files'] = removed
+        data['new'] = [entry(key, report) for key, report in new]
+        data['fixed'] = [entry(key, report) for key, report in fixed]
+        exit_code = 1 if new else 0
+        print(f"{Fore.YELLOW}📊 与基线相比：新增 {len(new)} 个问题，修复 {len(fixed)} 个问题{Style.RESET_ALL}")
+    else:
+        data['reports'] = [entry(baseline_key(directory, file_path), report.to_dict())
+                           for file_path, reports in results.items() for report in reports]
+        print(f"{Fore.YELLOW}📊 变更检查完成，共发现 {len(data['reports'])} 个问题{Style.RESET_ALL}")
+    
+    if args.format == 'json':
+        content = json.dumps(data, indent=2, ensure_ascii=False)
+    else:
+        lines = []
+        for title, marker in (('new', '➕'), ('fixed', '➖'), ('reports', '•')):
+            for report in data.get(title, ()):
+                lines.append(f"{marker} {report['file']}:{report['line_number']} [{report['severity']}] "
+                             f"{report['module_name']}: {report['message']}")
+        content = '\n'.join(lines)
+    if args.output:
+        with open(args.output, 'w', encoding='utf-8') as f:
+            f.write(content + '\n')
+        print(f"{Fore.GREEN}✅ 报告已保存到: {args.output}{Style.RESET_ALL}")
+    elif content:
+        output.write(content + '\n')
+    
+    if args.write_baseline:
+        updated = baseline if baseline is not None else Baseline(directory)
+        updated.update(results, removed)
+        updated.save(args.write_baseline, DETECTOR_VERSION, detector.get_enabled_modules())
+        print(f"{Fore.GREEN}✅ 基线已保存到: {args.write_baseline}{Style.RESET_ALL}")
+    return exit_code
+
+
 def main():
     """主函数"""
     parser = argparse.ArgumentParser(description='C语言Bug检测器')
     parser.add_argument('input', nargs='?', help='输入文件或目录路径')
     parser.add_argument('-o', '--output', help='输出报告文件路径')
-    parser.add_argument('-f', '--format', choices=['text', 'json'], default='text', help='输出格式')
+    parser.add_argument('-f', '--format', choices=['text', 'json', *MACHINE_FORMATS], default='text',
+                        help='输出格式（compact 和 ndjson 为供程序读取的紧凑格式，sarif 为 SARIF 2.1.0，'
+                             '这三种格式的进度信息输出到标准错误）')
     parser.add_argument('--disable', nargs='+', help='禁用的模块列表')
     parser.add_argument('--enable', nargs='+', help='启用的模块列表')
     parser.add_argument('--list-modules', action='store_true', help='列出所有可用模块')
     parser.add_argument('--batch', action='store_true', help='批量处理模式')
+    parser.add_argument('--cache-dir', default=DEFAULT_CACHE_DIR, help='批量模式下结果缓存的目录')
+    parser.add_argument('--no-cache', action='store_true', help='批量模式下不使用结果缓存')
+    parser.add_argument('-j', '--jobs', type=int, default=1, help='目录分析时的并行进程数（0 表示使用全部CPU核心）')
+    parser.add_argument('--serve', action='store_true', help='守护进程模式：通过标准输入输出以逐行JSON接收分析请求')
+    parser.add_argument('--stream', action='store_true', help='对所有文件使用内存映射流式解析（大文件默认启用）')
+    parser.add_argument('--library-table', action='append', metavar='PATH',
+                        help='额外的标准库查找表（JSON），可多次指定')
+    parser.add_argument('--stats', action='store_true',
+                        help='在报告中附带各阶段（读取、分词、各模块、格式化）的耗时和内存分配统计')
+    parser.add_argument('--time-budget', type=float, metavar='SECONDS',
+                        help='每个文件的分析时间上限（秒），超时后跳过未完成的模块，已有的报告标记为部分结果')
+    parser.add_argument('-I', '--include-dir', action='append', metavar='DIR',
+                        help='查找工作区头文件的目录（先查找包含它的文件所在目录），可多次指定')
+    parser.add_argument('--changed-since', metavar='REV',
+                        help='变更检查：只分析相对 git 版本 REV 变化的文件，以及包含变化的头文件或调用了变化的函数的文件')
+    parser.add_argument('--changed-files', metavar='PATH',
+                        help='变更检查：变化的文件列表（每行一个路径，- 表示标准输入），用法同 --changed-since')
+    parser.add_argument('--baseline', metavar='PATH',
+                        help='与基线文件比较，只输出新增和已修复的问题；有新增问题时退出码为 1')
+    parser.add_argument('--write-baseline', metavar='PATH',
+                        help='把结果（指定 --baseline 时为合并后的结果）写为基线文件')
+    parser.add_argument('--top-files', type=int, default=DEFAULT_TOP_FILES, metavar='N',
+                        help=f'目录分析的摘要中列出问题最多的 N 个文件（默认 {DEFAULT_TOP_FILES}）')
     
     args = parser.parse_args()
+    change_check = bool(args.changed_since or args.changed_files or args.baseline or args.write_baseline)
+    
+    # 守护进程模式、紧凑格式和变更检查的JSON输出中标准输出只用于协议消息或报告，其他输出改写到标准错误
+    protocol_output = sys.stdout
+    if args.serve or args.format in MACHINE_FORMATS or (change_check and args.format == 'json'):
+        sys.stdout = sys.stderr
     
-    # 创建检测器实例
-    detector = CBugDetector()
+    # 创建检测器实例（批量模式、守护进程模式和变更检查默认启用结果缓存）
+    cache_dir = args.cache_dir if (args.batch or args.serve or change_check) and not args.no_cache else None
+    detector = CBugDetector(verbose=not args.serve, cache_dir=cache_dir, stream=args.stream,
+                            library_tables=args.library_table or (), time_budget=args.time_budget,
+                            include_dirs=args.include_dir or ())
     
     # 处理模块启用/禁用
     if args.disable:
@@ -189,6 +624,10 @@ def main():
         for module in args.enable:
             detector.enable_module(module)
     
+    # 守护进程模式：检测器只创建一次，持续处理请求
+    if args.serve:
+        sys.exit(run_daemon(detector, DETECTOR_VERSION, protocol_output))
+    
     # 列出模块
     if args.list_modules:
         detector.list_modules()
@@ -199,38 +638,71 @@ def main():
         print(f"{Fore.RED}❌ 错误: 路径 {args.input} 不存在{Style.RESET_ALL}")
         return
     
+    # 变更检查：报告写到标准输出或 -o 指定的文件，退出码表示是否有新增问题
+    if args.input and change_check:
+        if args.format in MACHINE_FORMATS:
+            print(f"{Fore.RED}❌ 错误: 变更检查只支持 text 和 json 格式{Style.RESET_ALL}")
+            sys.exit(2)
+        sys.exit(run_change_check(detector, args, protocol_output))
+    
+    # 供程序读取的格式：报告写到标准输出或 -o 指定的文件，摘要输出到标准错误
+    if args.input and args.format in MACHINE_FORMATS:
+        output = open(args.output, 'w', encoding='utf-8') if args.output else protocol_output
+        try:
+            summary = write_machine_results(detector, args.input, args.format, output, args.stats,
+                                            resolve_jobs(args.jobs), args.top_files)
+        finally:
+            if args.output:
+                output.close()
+                print(f"{Fore.GREEN}✅ 报告已保存到: {args.output}{Style.RESET_ALL}")
+        if summary is not None and os.path.isdir(args.input):
+            print(f"{Fore.YELLOW}{summary.format_text()}{Style.RESET_ALL}")
+        return
+    
     # 分析文件或目录
     if args.input and os.path.isfile(args.input):
         # 单文件分析
         reports = detector.analyze_file(args.input)
+        stats = detector.last_stats if args.stats else None
         
         if reports:
             print(f"\n{Fore.YELLOW}📊 检测完成，共发现 {len(reports)} 个问题{Style.RESET_ALL}")
-            print(detector.generate_report(reports, args.format))
+            print(detector.generate_report(reports, args.format, stats))
             
             if args.output:
-                detector.save_report(reports, args.output, args.format)
+                detector.save_report(reports, args.output, args.format, stats)
         else:
             print(f"{Fore.GREEN}✅ 恭喜！没有发现任何问题。{Style.RESET_ALL}")
+            if stats is not None:
+                print(detector.generate_report(reports, args.format, stats))
     
     elif args.input and os.path.isdir(args.input):
-        # 目录分析
-        results = detector.analyze_directory(args.input)
+        # 目录分析：每个文件一完成就输出，内存中只保留计数和问题最多的文件
+        if args.output:
+            # 合并的报告直接写到文件，终端只显示摘要
+            try:
+                with open(args.output, 'w', encoding='utf-8') as f:
+                    reporter = open_report_stream(args.format, f, DETECTOR_VERSION, args.top_files)
+                    stream_results(detector, args.input, reporter, False, resolve_jobs(args.jobs))
+                    summary = reporter.close()
+            except OSError as e:
+                print(f"{Fore.RED}❌ 保存报告时出错: {e}{Style.RESET_ALL}")
+                return
+            print(f"\n{Fore.YELLOW}{summary.format_text()}{Style.RESET_ALL}")
+            print(f"{Fore.GREEN}✅ 报告已保存到: {args.output}{Style.RESET_ALL}")
+            return
         
-        if results:
-            total_issues = sum(len(reports) for reports in results.values())
-            print(f"\n{Fore.YELLOW}📊 批量检测完成，共分析 {len(results)} 个文件，发现 {total_issues} 个问题{Style.RESET_ALL}")
-            
-            for file_path, reports in results.items():
+        summary = ReportSummary(args.top_files)
+        
+        def print_file(file_path: str, reports: List[BugReport], stats: Optional[AnalysisStats]):
+            summary.add(file_path, reports)
+            if reports:
                 print(f"\n{Fore.CYAN}📁 文件: {file_path}{Style.RESET_ALL}")
-                print(detector.generate_report(reports, args.format))
-            
-            if args.output:
-                # 合并所有报告
-                all_reports = []
-                for reports in results.values():
-                    all_reports.extend(reports)
-                detector.save_report(all_reports, args.output, args.format)
+                print(detector.generate_report(reports, args.format, stats if args.stats else None))
+        
+        detector.analyze_directory(args.input, jobs=resolve_jobs(args.jobs), on_result=print_file, keep_results=False)
+        if summary.reports:
+            print(f"\n{Fore.YELLOW}{summary.format_text()}{Style.RESET_ALL}")
         else:
             print(f"{Fore.GREEN}✅ 恭喜！所有文件都没有发现任何问题。{Style.RESET_ALL}")
 
@@ -1,164 +1,212 @@
 """
 内存安全卫士模块 - 检测内存泄漏、野指针、空指针解引用
 """
-import re
-from typing import Dict, List, Set
+from bisect import bisect_right
+from typing import Dict, List, Optional, Set, Tuple
 from utils.error_reporter import ErrorReporter
-from utils.code_parser import CCodeParser, VariableInfo
+from utils.analysis_context import AnalysisContext
+from utils.dataflow import BitVectorProblem, solve
+from utils.function_summaries import statement_calls
+from utils.symbol_table import Symbol
 
 
 class MemorySafetyModule:
     """内存安全卫士模块"""
     
-    def __init__(self):
-        self.error_reporter = ErrorReporter()
-        self.parser = CCodeParser()
-        
-        # 维护变量状态哈希表
-        self.variable_states: Dict[str, Dict] = {}
-        self.malloced_variables: Set[str] = set()
-        self.freed_variables: Set[str] = set()
-        
-        # 编译正则表达式模式
-        self.patterns = {
-            'malloc': re.compile(r'\b(\w+)\s*=\s*malloc\s*\([^)]+\)', re.MULTILINE),
-            'free': re.compile(r'\bfree\s*\([^)]*(\w+)[^)]*\)', re.MULTILINE),
-            'pointer_use': re.compile(r'\*(\w+)', re.MULTILINE),
-            'null_check': re.compile(r'\b(\w+)\s*==\s*NULL\b|\b(\w+)\s*!=\s*NULL\b', re.MULTILINE),
-            'return_local_pointer': re.compile(r'\breturn\s+[^;]*\*[^;]*;', re.MULTILINE),
-        }
+    def __init__(self, error_reporter: Optional[ErrorReporter] = None):
+        self.error_reporter = error_reporter or ErrorReporter()
     
-    def analyze(self, parsed_data: Dict[str, List]) -> List:
-        """分析内存安全问题"""
-        self.error_reporter.clear_reports()
-        
-        # 重置状态
-        self.variable_states.clear()
-        self.malloced_variables.clear()
-        self.freed_variables.clear()
+    def analyze(self, context: AnalysisContext) -> List:
+        """分析内存安全问题，返回本模块新增的报告"""
+        start = len(self.error_reporter.reports)
         
+        # 模块不保存跨文件状态，所有变量状态都来自上下文中的符号表
         # 分析各种内存安全问题
-        self._detect_memory_leaks(parsed_data)
-        self._detect_wild_pointers(parsed_data)
-        self._detect_null_pointer_dereference(parsed_data)
-        self._detect_return_local_pointer(parsed_data)
+        self._detect_memory_leaks(context)
+        self._detect_wild_pointers(context)
+        self._detect_null_pointer_dereference(context)
+        self._detect_return_local_pointer(context)
         
-        return self.error_reporter.get_reports()
+        return self.error_reporter.get_reports()[start:]
     
-    def _detect_memory_leaks(self, parsed_data: Dict[str, List]):
+    def _detect_memory_leaks(self, context: AnalysisContext):
         """检测内存泄漏"""
         # 记录所有malloc的变量
-        for malloc_call in parsed_data['malloc_calls']:
+        for malloc_call in context.malloc_calls:
             var_name = malloc_call['variable']
             line_num = malloc_call['line']
-            self.malloced_variables.add(var_name)
             
             # 检查变量是否被正确初始化
-            var_info = self.parser.get_variable_by_name(var_name, parsed_data)
-            if var_info and not var_info.is_initialized:
-                self.error_reporter.add_memory_error(
+            symbol = context.resolve_symbol(var_name, line_num)
+            if symbol and not symbol.info.is_initialized:
+                self.error_reporter.add_template_report(
+                    'malloc_unchecked',
                     line_num,
-                    f"变量 '{var_name}' 通过malloc分配内存后未检查返回值",
-                    "建议添加NULL检查：if (var_name == NULL) { /* 处理错误 */ }",
-                    malloc_call['line_content']
+                    (var_name,),
+                    context.get_snippet(malloc_call['line'])
                 )
         
-        # 检查每个malloc的变量是否都有对应的free
-        for var_name in self.malloced_variables:
-            if var_name not in self.freed_variables:
-                # 查找变量声明的位置
-                var_info = self.parser.get_variable_by_name(var_name, parsed_data)
-                if var_info:
-                    self.error_reporter.add_memory_error(
-                        var_info.line_number,
-                        f"变量 '{var_name}' 分配了内存但未释放，可能导致内存泄漏",
-                        "建议在适当位置添加 free(var_name); 语句",
-                        ""
-                    )
+        # 检查每个malloc的变量是否都有对应的free（同一作用域内的同一个声明）；
+        # 经由函数摘要，分配包括返回所有权的包装函数，释放包括释放该参数的函数，返回给调用者的不算泄漏
+        allocated, freed, returned = self._ownership_transfers(context)
+        for symbol in context.symbols:
+            if ((symbol.malloc_lines or symbol.index in allocated)
+                    and not (symbol.free_lines or symbol.index in freed) and symbol.index not in returned):
+                self.error_reporter.add_template_report(
+                    'memory_leak',
+                    symbol.info.line_number,
+                    (symbol.name,),
+                    ""
+                )
     
-    def _detect_wild_pointers(self, parsed_data: Dict[str, List]):
-        """检测野指针"""
-        # 记录所有free的变量
-        for free_call in parsed_data['free_calls']:
-            line_content = free_call['line_content']
-            line_num = free_call['line']
-            
-            # 提取free中的变量名
-            free_match = self.patterns['free'].search(line_content)
-            if free_match:
-                var_name = free_match.group(1)
-                self.freed_variables.add(var_name)
+    def _ownership_transfers(self, context: AnalysisContext) -> Tuple[Set[int], Set[int], Set[int]]:
+        """按函数摘要得到 (由调用获得分配的符号, 由调用释放的符号, 作为返回值交给调用者的符号) 的编号"""
+        allocated: Set[int] = set()
+        freed: Set[int] = set()
+        returned: Set[int] = set()
+        summaries = context.function_summaries
+        if summaries is None or not context.tokens:
+            return allocated, freed, returned
         
-        # 检查free后是否还有使用
-        for deref in parsed_data['pointer_dereferences']:
-            ptr_name = deref['pointer']
-            line_num = deref['line']
-            
-            if ptr_name in self.freed_variables:
-                self.error_reporter.add_memory_error(
-                    line_num,
-                    f"指针 '{ptr_name}' 已被释放，但仍在被使用（野指针）",
-                    "建议在free后设置指针为NULL：free(ptr); ptr = NULL;",
-                    deref['line_content']
-                )
+        for line_num in sorted({call['line'] for call in context.function_calls}):
+            for callee, arguments, assigned, _direct in statement_calls(context.tokens[line_num - 1]):
+                summary = summaries.resolve(callee)
+                if assigned is not None and summary.allocates:
+                    symbol = context.resolve_symbol(assigned, line_num)
+                    if symbol:
+                        allocated.add(symbol.index)
+                for position in summary.frees_params:
+                    if position < len(arguments) and arguments[position]:
+                        symbol = context.resolve_symbol(arguments[position], line_num)
+                        if symbol:
+                            freed.add(symbol.index)
         
-        # 检查未初始化的指针使用
-        for var in parsed_data['variables']:
+        # return 变量; 把所有权交给调用者（调用者的泄漏由它所得到的摘要检查）
+        for line_num in sorted(context.exit_lines):
+            tokens = context.tokens[line_num - 1]
+            for i in range(len(tokens) - 2):
+                if tokens[i] == 'return' and tokens[i + 2] == ';':
+                    symbol = context.resolve_symbol(tokens[i + 1], line_num)
+                    if symbol:
+                        returned.add(symbol.index)
+        return allocated, freed, returned
+    
+    def _detect_wild_pointers(self, context: AnalysisContext):
+        """检测野指针：在每个函数的控制流图上求解"可能已释放"和"可能未赋值"的指针"""
+        derefs_by_line: Dict[int, List[Dict]] = {}
+        for deref in context.pointer_dereferences:
+            derefs_by_line.setdefault(deref['line'], []).append(deref)
+        frees_by_line: Dict[int, List[str]] = {}
+        for free_call in context.free_calls:
+            if free_call['variable']:
+                frees_by_line.setdefault(free_call['line'], []).append(free_call['variable'])
+        
+        # 按函数收集需要跟踪的声明：在函数内被释放的指针，以及函数内声明的未初始化指针
+        tracked: Dict[int, List[Symbol]] = {}
+        for symbol in context.symbols:
+            starts = set()
+            for line_num in symbol.free_lines:
+                cfg = context.function_at(line_num)
+                if cfg:
+                    starts.add(cfg.start_line)
+            var = symbol.info
             if var.is_pointer and not var.is_initialized:
-                # 查找该指针的使用
-                for deref in parsed_data['pointer_dereferences']:
-                    if deref['pointer'] == var.name and deref['line'] > var.line_number:
-                        self.error_reporter.add_memory_error(
-                            deref['line'],
-                            f"指针 '{var.name}' 未初始化就被解引用",
-                            "建议在使用前初始化指针：ptr = NULL; 或 ptr = malloc(size);",
-                            deref['line_content']
+                cfg = context.function_at(var.line_number)
+                if cfg:
+                    starts.add(cfg.start_line)
+            for start in starts:
+                tracked.setdefault(start, []).append(symbol)
+        
+        for cfg in context.control_flow:
+            context.check_budget()
+            symbols = tracked.get(cfg.start_line)
+            if not symbols:
+                continue
+            
+            problem = _PointerStates(context, symbols, frees_by_line)
+            for line_num, state in solve(cfg, problem).line_states():
+                if not state:
+                    continue
+                for deref in derefs_by_line.get(line_num, ()):
+                    ptr_name = deref['pointer']
+                    freed, unassigned = problem.bits_of(ptr_name, line_num)
+                    # 检查free后是否还有解引用
+                    if state & freed:
+                        self.error_reporter.add_template_report(
+                            'use_after_free',
+                            line_num,
+                            (ptr_name,),
+                            context.get_snippet(line_num)
+                        )
+                    # 检查未初始化的指针在赋值前被解引用
+                    if state & unassigned:
+                        self.error_reporter.add_template_report(
+                            'uninitialized_pointer_deref',
+                            line_num,
+                            (ptr_name,),
+                            context.get_snippet(line_num)
                         )
     
-    def _detect_null_pointer_dereference(self, parsed_data: Dict[str, List]):
-        """检测空指针解引用"""
-        # 检查指针解引用前是否有NULL检查
-        for deref in parsed_data['pointer_dereferences']:
+    def _detect_null_pointer_dereference(self, context: AnalysisContext):
+        """检测空指针解引用：解引用处应在所有路径上都已对该指针做过NULL检查"""
+        # 按函数收集被解引用的指针名，以及每行解引用的指针
+        names_by_function: Dict[int, Set[str]] = {}
+        derefs_by_line: Dict[int, List[str]] = {}
+        for deref in context.pointer_dereferences:
+            cfg = context.function_at(deref['line'])
+            if cfg:
+                names_by_function.setdefault(cfg.start_line, set()).add(deref['pointer'])
+                derefs_by_line.setdefault(deref['line'], []).append(deref['pointer'])
+        
+        checked: Set[Tuple[int, str]] = set()
+        for cfg in context.control_flow:
+            context.check_budget()
+            names = names_by_function.get(cfg.start_line)
+            if not names:
+                continue
+            
+            problem = _NullChecked(context, sorted(names))
+            result = solve(cfg, problem)
+            bits = problem.bits
+            # 只检查有解引用的行，与函数中的行数和指针数的乘积无关
+            for line_num, state in result.line_states():
+                line_derefs = derefs_by_line.get(line_num)
+                if not line_derefs:
+                    continue
+                # 同一行中的NULL检查（如 if (p != NULL) *p = 1;）同样有效
+                state |= result.effect(line_num)[0]
+                for name in line_derefs:
+                    if state & bits[name]:
+                        checked.add((line_num, name))
+        
+        for deref in context.pointer_dereferences:
             ptr_name = deref['pointer']
             line_num = deref['line']
-            
-            # 检查前面几行是否有NULL检查
-            has_null_check = False
-            for i in range(max(0, line_num - 5), line_num):
-                if i < len(parsed_data['lines']):
-                    line_content = parsed_data['lines'][i]
-                    if self.patterns['null_check'].search(line_content):
-                        has_null_check = True
-                        break
-            
-            if not has_null_check:
-                self.error_reporter.add_memory_error(
-                    line_num,
-                    f"解引用指针 '{ptr_name}' 前未进行NULL检查",
-                    "建议添加NULL检查：if (ptr != NULL) { /* 使用ptr */ }",
-                    deref['line_content']
-                )
+            facts = context.line_facts[line_num - 1]
+            if (line_num, ptr_name) in checked or (facts and ptr_name in facts.null_checks):
+                continue
+            self.error_reporter.add_template_report(
+                'unchecked_deref',
+                line_num,
+                (ptr_name,),
+                context.get_snippet(deref['line'])
+            )
     
-    def _detect_return_local_pointer(self, parsed_data: Dict[str, List]):
+    def _detect_return_local_pointer(self, context: AnalysisContext):
         """检测函数返回局部指针"""
-        for func in parsed_data['functions']:
+        pointer_return_lines = context.pointer_return_lines
+        for func in context.functions:
             if func.return_type and '*' in func.return_type:
-                # 这是一个返回指针的函数
-                func_start_line = func.line_number
-                
-                # 查找函数内的return语句
-                for i in range(func_start_line, len(parsed_data['lines'])):
-                    line_content = parsed_data['lines'][i]
-                    if 'return' in line_content and '*' in line_content:
-                        # 检查是否返回局部变量
-                        if self.patterns['return_local_pointer'].search(line_content):
-                            self.error_reporter.add_memory_error(
-                                i + 1,
-                                f"函数 '{func.name}' 返回局部指针，这是危险的",
-                                "建议返回动态分配的内存或静态变量",
-                                line_content
-                            )
-                        break
+                # 这是一个返回指针的函数，查找函数定义之后第一条返回指针的return语句
+                index = bisect_right(pointer_return_lines, func.line_number)
+                if index < len(pointer_return_lines):
+                    return_line = pointer_return_lines[index]
+                    self.error_reporter.add_template_report(
+                        'return_local_pointer',
+                        return_line,
+                        (func.name,),
+                        context.get_line(return_line)
+                    )
     
     def get_module_name(self) -> str:
         """获取模块名称"""
@@ -167,3 +215,68 @@ class MemorySafetyModule:
     def get_description(self) -> str:
         """获取模块描述"""
         return "检测内存泄漏、野指针、空指针解引用等内存安全问题"
+
+
+class _PointerStates(BitVectorProblem):
+    """指针状态格：每个指针两位，分别表示某条路径上"已释放"和"未赋值"（并集）
+
+    free(p) 置位"已释放"，未初始化的声明置位"未赋值"，对 p 本身赋值同时清除两位。
+    """
+    
+    def __init__(self, context: AnalysisContext, symbols: List[Symbol], frees_by_line: Dict[int, List[str]]):
+        super().__init__(2 * len(symbols), may=True)
+        self.context = context
+        self.bits = {symbol.index: (1 << (2 * local_id), 1 << (2 * local_id + 1))
+                     for local_id, symbol in enumerate(symbols)}
+        self.names = frozenset(symbol.name for symbol in symbols)
+        self.symbols_by_line: Dict[int, List[Symbol]] = {}
+        for symbol in symbols:
+            self.symbols_by_line.setdefault(symbol.info.line_number, []).append(symbol)
+        self.frees_by_line = frees_by_line
+    
+    def bits_of(self, name: str, line_num: int) -> Tuple[int, int]:
+        """返回指定行可见的同名声明的 (已释放位, 未赋值位)"""
+        if name not in self.names:
+            return 0, 0
+        symbol = self.context.resolve_symbol(name, line_num)
+        return self.bits.get(symbol.index, (0, 0)) if symbol else (0, 0)
+    
+    def line_effect(self, line_num: int) -> Tuple[int, int]:
+        gen = kill = assigned = 0
+        for symbol in self.symbols_by_line.get(line_num, ()):
+            freed, unassigned = self.bits[symbol.index]
+            kill |= freed | unassigned
+            if symbol.info.is_pointer and not symbol.info.is_initialized:
+                gen |= unassigned
+        for name in self.frees_by_line.get(line_num, ()):
+            gen |= self.bits_of(name, line_num)[0]
+        # 同一行中的赋值视为在 free 之后（free(p); p = NULL;）
+        for assignment in self.context.assignments_by_line.get(line_num, ()):
+            if not assignment.get('through_pointer'):
+                freed, unassigned = self.bits_of(assignment['variable'], line_num)
+                assigned |= freed | unassigned
+        return gen & ~assigned, kill | assigned
+
+
+class _NullChecked(BitVectorProblem):
+    """NULL检查格：每个被解引用的指针名一位，所有路径上都检查过才置位（交集）
+
+    name == NULL / name != NULL 置位，对该指针重新赋值时清除。
+    """
+    
+    def __init__(self, context: AnalysisContext, names: List[str]):
+        super().__init__(len(names), may=False)
+        self.context = context
+        self.bits = {name: 1 << index for index, name in enumerate(names)}
+    
+    def line_effect(self, line_num: int) -> Tuple[int, int]:
+        gen = kill = 0
+        for assignment in self.context.assignments_by_line.get(line_num, ()):
+            if not assignment.get('through_pointer'):
+                kill |= self.bits.get(assignment['variable'], 0)
+        facts = self.context.line_facts[line_num - 1]
+        if facts is not None:
+            for name in facts.null_checks:
+                gen |= self.bits.get(name, 0)
+        # 同一行中的检查视为在赋值之后（p = malloc(n); if (p == NULL) ...）
+        return gen, kill
@@ -1,194 +1,155 @@
 """
 变量状态监察官模块 - 检测变量未初始化即使用和变量作用域问题
 """
-import re
-from typing import Dict, List, Set
+from typing import Dict, List, Optional, Tuple
 from utils.error_reporter import ErrorReporter
-from utils.code_parser import CCodeParser, VariableInfo
+from utils.analysis_context import AnalysisContext
+from utils.control_flow import ControlFlowGraph
+from utils.dataflow import BitVectorProblem, solve
+from utils.symbol_table import Symbol
+
+
+# 检查函数调用参数时跳过的函数
+_UNCHECKED_CALLS = frozenset(['printf', 'scanf', 'malloc', 'free', 'strlen', 'strcpy', 'strcmp'])
 
 
 class VariableStateModule:
     """变量状态监察官模块"""
     
-    def __init__(self):
-        self.error_reporter = ErrorReporter()
-        self.parser = CCodeParser()
-        
-        # 维护变量状态哈希表
-        self.variable_states: Dict[str, Dict] = {}
-        self.scope_stack: List[int] = [0]  # 作用域栈
-        self.current_scope: int = 0
-        
-        # 编译正则表达式模式
-        self.patterns = {
-            'variable_use': re.compile(r'\b(\w+)\b', re.MULTILINE),
-            'assignment': re.compile(r'\b(\w+)\s*=\s*([^;]+);', re.MULTILINE),
-            'function_call': re.compile(r'\b(\w+)\s*\([^)]*\)', re.MULTILINE),
-            'array_access': re.compile(r'\b(\w+)\s*\[[^\]]+\]', re.MULTILINE),
-            'pointer_arithmetic': re.compile(r'\b(\w+)\s*[+\-]\s*\d+', re.MULTILINE),
-            'comparison': re.compile(r'\b(\w+)\s*[<>=!]+\s*[^;]+', re.MULTILINE),
-            'arithmetic': re.compile(r'\b(\w+)\s*[+\-*/]\s*[^;]+', re.MULTILINE),
-        }
+    def __init__(self, error_reporter: Optional[ErrorReporter] = None):
+        self.error_reporter = error_reporter or ErrorReporter()
     
-    def analyze(self, parsed_data: Dict[str, List]) -> List:
-        """分析变量状态问题"""
-        self.error_reporter.clear_reports()
-        
-        # 重置状态
-        self.variable_states.clear()
-        self.scope_stack = [0]
-        self.current_scope = 0
+    def analyze(self, context: AnalysisContext) -> List:
+        """分析变量状态问题，返回本模块新增的报告"""
+        start = len(self.error_reporter.reports)
         
+        # 变量状态以位集合的形式只在本次分析内有效，不会带到下一个文件
         # 分析各种变量状态问题
-        self._detect_uninitialized_variables(parsed_data)
-        self._detect_scope_issues(parsed_data)
+        self._detect_uninitialized_variables(context)
+        self._detect_scope_issues(context)
         
-        return self.error_reporter.get_reports()
+        return self.error_reporter.get_reports()[start:]
     
-    def _detect_uninitialized_variables(self, parsed_data: Dict[str, List]):
-        """检测未初始化变量使用"""
-        # 首先记录所有变量声明
-        for var in parsed_data['variables']:
-            self.variable_states[var.name] = {
-                'declared_line': var.line_number,
-                'is_initialized': var.is_initialized,
-                'type': var.type,
-                'scope': self.current_scope,
-                'last_assigned_line': var.line_number if var.is_initialized else None
-            }
+    def _detect_uninitialized_variables(self, context: AnalysisContext):
+        """检测未初始化变量使用：在每个函数的控制流图上求解"可能未初始化"的局部变量"""
+        declarations: Dict[int, List[Symbol]] = {}
+        for symbol in context.symbols:
+            declarations.setdefault(symbol.info.line_number, []).append(symbol)
+        scanf_targets: Dict[int, List[str]] = {}
+        for scanf_call in context.scanf_calls:
+            scanf_targets.setdefault(scanf_call['line'], []).extend(
+                name for name, has_address in scanf_call['arguments'] if has_address)
         
-        # 检查变量使用
-        for line_num, line_content in enumerate(parsed_data['lines'], 1):
-            self._check_variable_usage_in_line(line_content, line_num, parsed_data)
+        # 全局变量默认初始化为0，只跟踪函数内声明的变量
+        for cfg in context.control_flow:
+            context.check_budget()
+            local_symbols = [symbol for line_num in range(cfg.start_line, cfg.end_line + 1)
+                             for symbol in declarations.get(line_num, ())]
+            if not local_symbols:
+                continue
+            
+            problem = _MaybeUninitialized(context, cfg, local_symbols, declarations, scanf_targets)
+            result = solve(cfg, problem)
+            uses = problem.uses
+            for line_num, state in result.line_states():
+                # 赋值的右侧先于写入求值，使用按该行执行之前的状态检查；只有右侧不含被赋值变量本身的赋值
+                # （如 for (i = 0; i < n; ...) 中的 i = 0）和 scanf 的写入视为先于同一行中的其余使用生效。
+                # 只有使用了可能未初始化变量的行才逐个检查
+                used = uses.get(line_num)
+                if used:
+                    state &= ~problem.prior_kills.get(line_num, 0)
+                    if state & used:
+                        facts = context.line_facts[line_num - 1]
+                        self._check_variable_usage_in_line(facts, line_num, context, problem, state)
     
-    def _check_variable_usage_in_line(self, line_content: str, line_num: int, parsed_data: Dict[str, List]):
-        """检查单行中的变量使用"""
-        # 跳过注释和空行
-        if line_content.strip().startswith('//') or line_content.strip().startswith('/*') or not line_content.strip():
-            return
-        
-        # 跳过变量声明行
-        if ';' in line_content and ('int ' in line_content or 'char ' in line_content or 
-                                   'float ' in line_content or 'double ' in line_content):
-            return
-        
-        # 检查赋值语句
-        assignment_matches = self.patterns['assignment'].findall(line_content)
-        for var_name, value in assignment_matches:
-            if var_name in self.variable_states:
-                # 更新变量状态
-                self.variable_states[var_name]['is_initialized'] = True
-                self.variable_states[var_name]['last_assigned_line'] = line_num
-                
-                # 检查赋值右侧的变量是否已初始化
-                self._check_expression_variables(value, line_num)
+    def _check_variable_usage_in_line(self, facts, line_num: int, context: AnalysisContext,
+                                      problem: '_MaybeUninitialized', state: int):
+        """检查单行中的变量使用，state 为使用时可能未初始化的变量
+
+        同一行中的同一变量只报告一次（按下面的检查顺序取第一种用法）。
+        """
+        reported = set()
+        # 检查赋值右侧的变量是否已初始化
+        for assignment in context.assignments_by_line.get(line_num, ()):
+            self._check_expression_variables(assignment['identifiers'], line_num, problem, state, reported)
         
         # 检查函数调用中的参数
-        func_call_matches = self.patterns['function_call'].findall(line_content)
-        for func_name in func_call_matches:
-            if func_name not in ['printf', 'scanf', 'malloc', 'free', 'strlen', 'strcpy', 'strcmp']:
-                # 提取函数参数
-                func_match = re.search(rf'\b{func_name}\s*\(([^)]+)\)', line_content)
-                if func_match:
-                    params = func_match.group(1)
-                    self._check_expression_variables(params, line_num)
+        for func_name, arguments in facts.call_arguments:
+            if func_name not in _UNCHECKED_CALLS:
+                self._check_expression_variables(arguments, line_num, problem, state, reported)
         
         # 检查其他变量使用
-        self._check_general_variable_usage(line_content, line_num)
+        self._check_general_variable_usage(facts, context, line_num, problem, state, reported)
+    
+    @staticmethod
+    def _first_report(var_name: str, line_num: int, problem: '_MaybeUninitialized', state: int,
+                      reported: set) -> bool:
+        """变量在该行可能未初始化、且本行尚未报告过时返回 True"""
+        if var_name in reported or not problem.is_uninitialized(var_name, line_num, state):
+            return False
+        reported.add(var_name)
+        return True
     
-    def _check_expression_variables(self, expression: str, line_num: int):
+    def _check_expression_variables(self, identifiers: List[str], line_num: int,
+                                    problem: '_MaybeUninitialized', state: int, reported: set):
         """检查表达式中的变量"""
-        # 提取表达式中的变量名
-        var_matches = re.findall(r'\b([a-zA-Z_][a-zA-Z0-9_]*)\b', expression)
-        for var_name in var_matches:
-            if var_name in self.variable_states:
-                var_state = self.variable_states[var_name]
-                if not var_state['is_initialized']:
-                    self.error_reporter.add_variable_error(
-                        line_num,
-                        f"变量 '{var_name}' 在初始化前被使用",
-                        f"建议在使用前初始化变量：{var_name} = 初始值;",
-                        ""
-                    )
+        for var_name in identifiers:
+            if self._first_report(var_name, line_num, problem, state, reported):
+                self.error_reporter.add_template_report(
+                    'uninitialized_use',
+                    line_num,
+                    (var_name,),
+                    ""
+                )
     
-    def _check_general_variable_usage(self, line_content: str, line_num: int):
-        """检查一般变量使用"""
+    def _check_general_variable_usage(self, facts, context: AnalysisContext, line_num: int,
+                                      problem: '_MaybeUninitialized', state: int, reported: set):
+        """检查一般变量使用（行文本只在产生报告时才取出）"""
         # 检查数组访问
-        array_matches = self.patterns['array_access'].findall(line_content)
-        for var_name in array_matches:
-            if var_name in self.variable_states:
-                var_state = self.variable_states[var_name]
-                if not var_state['is_initialized']:
-                    self.error_reporter.add_variable_error(
-                        line_num,
-                        f"数组 '{var_name}' 在初始化前被访问",
-                        f"建议在使用前初始化数组：{var_name}[0] = 初始值;",
-                        line_content
-                    )
+        for var_name in facts.array_accesses:
+            if self._first_report(var_name, line_num, problem, state, reported):
+                self.error_reporter.add_template_report(
+                    'uninitialized_array',
+                    line_num,
+                    (var_name,),
+                    context.get_line(line_num)
+                )
         
         # 检查指针运算
-        ptr_matches = self.patterns['pointer_arithmetic'].findall(line_content)
-        for var_name in ptr_matches:
-            if var_name in self.variable_states:
-                var_state = self.variable_states[var_name]
-                if not var_state['is_initialized']:
-                    self.error_reporter.add_variable_error(
-                        line_num,
-                        f"指针 '{var_name}' 在初始化前进行运算",
-                        f"建议在使用前初始化指针：{var_name} = NULL; 或 {var_name} = malloc(size);",
-                        line_content
-                    )
+        for var_name in facts.pointer_arithmetic:
+            if self._first_report(var_name, line_num, problem, state, reported):
+                self.error_reporter.add_template_report(
+                    'uninitialized_pointer_arithmetic',
+                    line_num,
+                    (var_name,),
+                    context.get_line(line_num)
+                )
         
         # 检查比较操作
-        comparison_matches = self.patterns['comparison'].findall(line_content)
-        for var_name in comparison_matches:
-            if var_name in self.variable_states:
-                var_state = self.variable_states[var_name]
-                if not var_state['is_initialized']:
-                    self.error_reporter.add_variable_error(
-                        line_num,
-                        f"变量 '{var_name}' 在初始化前进行比较",
-                        f"建议在使用前初始化变量：{var_name} = 初始值;",
-                        line_content
-                    )
+        for var_name in facts.comparisons:
+            if self._first_report(var_name, line_num, problem, state, reported):
+                self.error_reporter.add_template_report(
+                    'uninitialized_comparison',
+                    line_num,
+                    (var_name,),
+                    context.get_line(line_num)
+                )
         
         # 检查算术运算
-        arithmetic_matches = self.patterns['arithmetic'].findall(line_content)
-        for var_name in arithmetic_matches:
-            if var_name in self.variable_states:
-                var_state = self.variable_states[var_name]
-                if not var_state['is_initialized']:
-                    self.error_reporter.add_variable_error(
-                        line_num,
-                        f"变量 '{var_name}' 在初始化前进行算术运算",
-                        f"建议在使用前初始化变量：{var_name} = 初始值;",
-                        line_content
-                    )
+        for var_name in facts.arithmetic:
+            if self._first_report(var_name, line_num, problem, state, reported):
+                self.error_reporter.add_template_report(
+                    'uninitialized_arithmetic',
+                    line_num,
+                    (var_name,),
+                    context.get_line(line_num)
+                )
     
-    def _detect_scope_issues(self, parsed_data: Dict[str, List]):
+    def _detect_scope_issues(self, context: AnalysisContext):
         """检测作用域问题"""
-        # 简化的作用域检测
-        brace_count = 0
-        current_scope = 0
-        
-        for line_num, line_content in enumerate(parsed_data['lines'], 1):
-            # 计算大括号
-            brace_count += line_content.count('{')
-            brace_count -= line_content.count('}')
-            
-            # 检查变量声明
-            if ';' in line_content and ('int ' in line_content or 'char ' in line_content or 
-                                       'float ' in line_content or 'double ' in line_content):
-                # 提取变量名
-                var_match = re.search(r'\b(int|char|float|double|long|short|unsigned|signed|void|struct\s+\w+)\s+(\w+)', line_content)
-                if var_match:
-                    var_name = var_match.group(2)
-                    if var_name in self.variable_states:
-                        self.variable_states[var_name]['scope'] = current_scope
-            
-            # 更新作用域
-            if brace_count > current_scope:
-                current_scope = brace_count
+        # 简化的作用域检测：每个声明的作用域层级和结束行已由符号表计算
+        # （Symbol.scope_level / scope_end），目前不产生报告
+        return
     
     def get_module_name(self) -> str:
         """获取模块名称"""
@@ -197,3 +158,86 @@ class VariableStateModule:
     def get_description(self) -> str:
         """获取模块描述"""
         return "检测变量未初始化即使用和变量作用域问题"
+
+
+class _MaybeUninitialized(BitVectorProblem):
+    """"可能未初始化"格：函数内每个局部变量声明一个稠密编号和一位，某条路径上未初始化即置位（并集）
+
+    构建时对函数的每一行解析一次名称，得到该行的定义集合 (gen, kill) 和使用集合：
+    未初始化的声明置位，对变量赋值或以 &变量 传给 scanf 时清除。
+    """
+    
+    def __init__(self, context: AnalysisContext, cfg: ControlFlowGraph, local_symbols: List[Symbol],
+                 declarations: Dict[int, List[Symbol]], scanf_targets: Dict[int, List[str]]):
+        super().__init__(len(local_symbols), may=True)
+        self.context = context
+        self.bits = {symbol.index: 1 << local_id for local_id, symbol in enumerate(local_symbols)}
+        self.names = frozenset(symbol.name for symbol in local_symbols)
+        self.effects: Dict[int, Tuple[int, int]] = {}
+        self.uses: Dict[int, int] = {}
+        # 先于同一行中的使用生效的写入：右侧不含被赋值变量本身的赋值，以及 scanf 的 &变量
+        self.prior_kills: Dict[int, int] = {}
+        
+        for block in cfg.blocks:
+            for line_num in block.lines:
+                self._compute_line_sets(line_num, declarations, scanf_targets)
+    
+    def _compute_line_sets(self, line_num: int, declarations: Dict[int, List[Symbol]],
+                           scanf_targets: Dict[int, List[str]]):
+        """计算一行的定义集合和使用集合"""
+        context = self.context
+        bit_of = self.bit_of
+        gen = kill = 0
+        for symbol in declarations.get(line_num, ()):
+            bit = self.bits.get(symbol.index, 0)
+            if symbol.info.is_initialized:
+                kill |= bit
+            else:
+                gen |= bit
+        # *p = ... 同样清除 p 的位：未初始化指针的解引用由内存安全模块报告
+        assignments = context.assignments_by_line.get(line_num, ())
+        prior = 0
+        for assignment in assignments:
+            bit = bit_of(assignment['variable'], line_num)
+            kill |= bit
+            if assignment['variable'] not in assignment['identifiers']:
+                prior |= bit
+        for name in scanf_targets.get(line_num, ()):
+            bit = bit_of(name, line_num)
+            kill |= bit
+            prior |= bit
+        if prior:
+            self.prior_kills[line_num] = prior
+        if gen or kill:
+            self.effects[line_num] = (gen & ~kill, kill)
+        
+        # 声明行没有可检查的使用
+        facts = context.line_facts[line_num - 1]
+        if facts is None or facts.is_declaration:
+            return
+        used = 0
+        for assignment in assignments:
+            for name in assignment['identifiers']:
+                used |= bit_of(name, line_num)
+        for func_name, arguments in facts.call_arguments:
+            if func_name not in _UNCHECKED_CALLS:
+                for name in arguments:
+                    used |= bit_of(name, line_num)
+        for names in (facts.array_accesses, facts.pointer_arithmetic, facts.comparisons, facts.arithmetic):
+            for name in names:
+                used |= bit_of(name, line_num)
+        if used:
+            self.uses[line_num] = used
+    
+    def bit_of(self, name: str, line_num: int) -> int:
+        """返回指定行可见的同名声明对应的位，不是本函数的局部变量时返回0"""
+        if name not in self.names:
+            return 0
+        symbol = self.context.resolve_symbol(name, line_num)
+        return self.bits.get(symbol.index, 0) if symbol else 0
+    
+    def is_uninitialized(self, name: str, line_num: int, state: int) -> bool:
+        return bool(state & self.bit_of(name, line_num))
+    
+    def line_effect(self, line_num: int) -> Tuple[int, int]:
+        return self.effects.get(line_num, (0, 0))
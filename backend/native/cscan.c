@@ -0,0 +1,479 @@
+/*
+ * C词法扫描核心 - utils/c_lexer.py 的原生实现（扩展模块 utils._cscan）
+ *
+ * 去注释、分词和记号切分规则与 c_lexer 中的正则表达式逐字符等价，
+ * c_lexer 在扩展模块可用时使用这里的实现，否则回退到正则表达式；两者的结果完全相同。
+ * 字符分类使用与 re 模块相同的 Unicode 判断（\s、\d、\w），
+ * 行切分和块注释结束符的查找在单字节文本上使用 memchr（libc 中为向量化实现）。
+ *
+ * 构建（在 backend 目录下）：python setup.py build_ext --inplace
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+
+typedef struct {
+    PyObject *object;
+    int kind;
+    const void *data;
+    Py_ssize_t length;
+} Text;
+
+#define CH(t, i) PyUnicode_READ((t)->kind, (t)->data, (i))
+
+/* ASCII 字符的分类表，非 ASCII 字符使用与 re 模块 str 模式相同的 Unicode 判断 */
+enum { CLASS_SPACE = 1, CLASS_DIGIT = 2, CLASS_WORD = 4 };
+static unsigned char ascii_class[128];
+
+static void init_ascii_class(void)
+{
+    for (int c = 0; c < 128; c++) {
+        unsigned char flags = 0;
+        if (Py_UNICODE_ISSPACE(c)) {
+            flags |= CLASS_SPACE;
+        }
+        if (Py_UNICODE_ISDECIMAL(c)) {
+            flags |= CLASS_DIGIT;
+        }
+        if (Py_UNICODE_ISALNUM(c) || c == '_') {
+            flags |= CLASS_WORD;
+        }
+        ascii_class[c] = flags;
+    }
+}
+
+/* 分别与 \s、\d、\w 相同 */
+#define IS_SPACE(c) ((c) < 128 ? (ascii_class[c] & CLASS_SPACE) : Py_UNICODE_ISSPACE(c))
+#define IS_DIGIT(c) ((c) < 128 ? (ascii_class[c] & CLASS_DIGIT) : Py_UNICODE_ISDECIMAL(c))
+#define IS_WORD(c) ((c) < 128 ? (ascii_class[c] & CLASS_WORD) : (Py_UNICODE_ISALNUM(c) || (c) == '_'))
+
+/* 按 c_lexer 中的记号顺序尝试的运算符；复合赋值 op= 在这些之后、... 之前 */
+static const char *const OPERATORS[] = {
+    "->", "++", "--", "<<=", ">>=", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", NULL
+};
+
+static int text_init(Text *t, PyObject *object)
+{
+    if (!PyUnicode_Check(object)) {
+        PyErr_SetString(PyExc_TypeError, "需要 str 类型的参数");
+        return -1;
+    }
+    if (PyUnicode_READY(object) < 0) {
+        return -1;
+    }
+    t->object = object;
+    t->kind = PyUnicode_KIND(object);
+    t->data = PyUnicode_DATA(object);
+    t->length = PyUnicode_GET_LENGTH(object);
+    return 0;
+}
+
+static int starts_with(const Text *t, Py_ssize_t i, const char *literal)
+{
+    for (; *literal; literal++, i++) {
+        if (i >= t->length || CH(t, i) != (Py_UCS4)(unsigned char)*literal) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 查找 ch 在 [start, length) 中第一次出现的位置，单字节文本使用 memchr */
+static Py_ssize_t find_char(const Text *t, Py_UCS4 ch, Py_ssize_t start)
+{
+    if (t->kind == PyUnicode_1BYTE_KIND) {
+        const Py_UCS1 *data = (const Py_UCS1 *)t->data;
+        const Py_UCS1 *found = memchr(data + start, (int)ch, (size_t)(t->length - start));
+        return found ? found - data : -1;
+    }
+    for (Py_ssize_t i = start; i < t->length; i++) {
+        if (CH(t, i) == ch) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* 字符串或字符字面量 "(?:\\.|[^"\\])*"? 的结束位置，i 指向开头的引号 */
+static Py_ssize_t skip_literal(const Text *t, Py_ssize_t i, Py_UCS4 quote)
+{
+    Py_ssize_t n = t->length;
+    for (i++; i < n;) {
+        Py_UCS4 c = CH(t, i);
+        if (c == '\\') {
+            if (i + 1 < n && CH(t, i + 1) != '\n') {
+                i += 2;
+                continue;
+            }
+            break;
+        }
+        if (c == quote) {
+            break;
+        }
+        i++;
+    }
+    if (i < n && CH(t, i) == quote) {
+        i++;
+    }
+    return i;
+}
+
+/* #[ \t]*include[ \t]*[<"][^>"]*[>"] 的结束位置，不匹配时返回 -1 */
+static Py_ssize_t match_include(const Text *t, Py_ssize_t i)
+{
+    Py_ssize_t n = t->length;
+    Py_ssize_t j = i + 1;
+    while (j < n && (CH(t, j) == ' ' || CH(t, j) == '\t')) {
+        j++;
+    }
+    if (!starts_with(t, j, "include")) {
+        return -1;
+    }
+    j += 7;
+    while (j < n && (CH(t, j) == ' ' || CH(t, j) == '\t')) {
+        j++;
+    }
+    if (j >= n || (CH(t, j) != '<' && CH(t, j) != '"')) {
+        return -1;
+    }
+    for (j++; j < n; j++) {
+        Py_UCS4 c = CH(t, j);
+        if (c == '>' || c == '"') {
+            return j + 1;
+        }
+    }
+    return -1;
+}
+
+/* 从 i（非空白字符）开始的记号的结束位置，各分支的顺序与 c_lexer._TOKEN_RE 相同 */
+static Py_ssize_t match_token(const Text *t, Py_ssize_t i)
+{
+    Py_ssize_t n = t->length;
+    Py_UCS4 c = CH(t, i);
+    Py_UCS4 next = i + 1 < n ? CH(t, i + 1) : 0;
+
+    if (c == '#') {
+        Py_ssize_t end = match_include(t, i);
+        if (end >= 0) {
+            return end;
+        }
+    }
+    if (c == '"' || c == '\'') {
+        return skip_literal(t, i, c);
+    }
+
+    /* 数值（预处理数）：\.?\d(?:[eEpP][+-]|[\w.])* */
+    if (IS_DIGIT(c) || (c == '.' && IS_DIGIT(next))) {
+        Py_ssize_t j = c == '.' ? i + 2 : i + 1;
+        while (j < n) {
+            Py_UCS4 d = CH(t, j);
+            if ((d == 'e' || d == 'E' || d == 'p' || d == 'P') && j + 1 < n
+                && (CH(t, j + 1) == '+' || CH(t, j + 1) == '-')) {
+                j += 2;
+            } else if (IS_WORD(d) || d == '.') {
+                j++;
+            } else {
+                break;
+            }
+        }
+        return j;
+    }
+
+    /* 标识符与关键字：[A-Za-z_]\w* */
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_') {
+        Py_ssize_t j = i + 1;
+        while (j < n && IS_WORD(CH(t, j))) {
+            j++;
+        }
+        return j;
+    }
+
+    if (c < 128) {
+        for (const char *const *op = OPERATORS; *op; op++) {
+            if ((Py_UCS4)(unsigned char)(*op)[0] == c && starts_with(t, i, *op)) {
+                return i + (Py_ssize_t)strlen(*op);
+            }
+        }
+        if (c != 0 && strchr("-+*/%&|^", (int)c) && next == '=') {
+            return i + 2;
+        }
+        if (starts_with(t, i, "...") || starts_with(t, i, "##")) {
+            return i + (c == '.' ? 3 : 2);
+        }
+    }
+    return i + 1;
+}
+
+/* 对 [start, end) 分词，记号追加到 tokens */
+static int tokenize_span(const Text *t, Py_ssize_t start, Py_ssize_t end, PyObject *tokens)
+{
+    Text span = *t;
+    span.length = end;
+    Py_ssize_t i = start;
+    while (i < end) {
+        if (IS_SPACE(CH(t, i))) {
+            i++;
+            continue;
+        }
+        Py_ssize_t token_end = match_token(&span, i);
+        PyObject *token = PyUnicode_Substring(t->object, i, token_end);
+        if (!token || PyList_Append(tokens, token) < 0) {
+            Py_XDECREF(token);
+            return -1;
+        }
+        Py_DECREF(token);
+        i = token_end;
+    }
+    return 0;
+}
+
+/* 把 [start, end) 追加到 pieces */
+static int append_piece(PyObject *pieces, PyObject *object, Py_ssize_t start, Py_ssize_t end)
+{
+    PyObject *piece = PyUnicode_Substring(object, start, end);
+    if (!piece) {
+        return -1;
+    }
+    int status = PyList_Append(pieces, piece);
+    Py_DECREF(piece);
+    return status;
+}
+
+/*
+ * 移除 [start, end) 中的注释，与 CLexer.strip_comments 相同：
+ * 块注释替换为一个空格（在注释结束处），行注释删除到行尾，字符串和字符字面量原样保留
+ */
+static PyObject *strip_span(const Text *t, Py_ssize_t start, Py_ssize_t end, int *in_block_comment)
+{
+    static PyObject *space = NULL;
+    static PyObject *empty = NULL;
+    if (!space && !(space = PyUnicode_InternFromString(" "))) {
+        return NULL;
+    }
+    if (!empty && !(empty = PyUnicode_InternFromString(""))) {
+        return NULL;
+    }
+
+    Text span = *t;
+    span.length = end;
+    PyObject *pieces = PyList_New(0);
+    if (!pieces) {
+        return NULL;
+    }
+
+    Py_ssize_t pos = start;
+    while (pos < end) {
+        if (*in_block_comment) {
+            Py_ssize_t close = -1;
+            for (Py_ssize_t star = find_char(&span, '*', pos); star >= 0; star = find_char(&span, '*', star + 1)) {
+                if (star + 1 < end && CH(t, star + 1) == '/') {
+                    close = star;
+                    break;
+                }
+            }
+            if (close < 0) {
+                break;
+            }
+            *in_block_comment = 0;
+            pos = close + 2;
+            if (PyList_Append(pieces, space) < 0) {
+                goto error;
+            }
+            continue;
+        }
+
+        /* 下一个字面量或注释的开始位置 */
+        Py_ssize_t i = pos;
+        Py_UCS4 c = 0;
+        for (; i < end; i++) {
+            c = CH(t, i);
+            if (c == '"' || c == '\'') {
+                break;
+            }
+            if (c == '/' && i + 1 < end && (CH(t, i + 1) == '/' || CH(t, i + 1) == '*')) {
+                break;
+            }
+        }
+        if (i >= end) {
+            if (append_piece(pieces, t->object, pos, end) < 0) {
+                goto error;
+            }
+            break;
+        }
+
+        if (c == '/') {
+            if (append_piece(pieces, t->object, pos, i) < 0) {
+                goto error;
+            }
+            if (CH(t, i + 1) == '/') {
+                break;
+            }
+            *in_block_comment = 1;
+            pos = i + 2;
+            continue;
+        }
+
+        Py_ssize_t literal_end = skip_literal(&span, i, c);
+        if (append_piece(pieces, t->object, pos, literal_end) < 0) {
+            goto error;
+        }
+        pos = literal_end;
+    }
+
+    PyObject *result = PyUnicode_Join(empty, pieces);
+    Py_DECREF(pieces);
+    return result;
+
+error:
+    Py_DECREF(pieces);
+    return NULL;
+}
+
+/* 是否需要去注释：与 c_lexer 的快速路径相同，处于块注释中或行内有 '/' */
+static int needs_strip(const Text *t, Py_ssize_t start, Py_ssize_t end, int in_block_comment)
+{
+    if (in_block_comment) {
+        return 1;
+    }
+    Text span = *t;
+    span.length = end;
+    return find_char(&span, '/', start) >= 0;
+}
+
+/*
+ * 处理一行 [start, end)，产出去注释后的行文本和记号列表
+ */
+static int lex_span(const Text *t, Py_ssize_t start, Py_ssize_t end, int *in_block_comment,
+                    PyObject **line_out, PyObject **tokens_out)
+{
+    PyObject *line;
+    if (needs_strip(t, start, end, *in_block_comment)) {
+        line = strip_span(t, start, end, in_block_comment);
+    } else {
+        line = PyUnicode_Substring(t->object, start, end);
+    }
+    if (!line) {
+        return -1;
+    }
+
+    PyObject *tokens = PyList_New(0);
+    if (!tokens) {
+        Py_DECREF(line);
+        return -1;
+    }
+    Text stripped;
+    if (text_init(&stripped, line) < 0 || tokenize_span(&stripped, 0, stripped.length, tokens) < 0) {
+        Py_DECREF(line);
+        Py_DECREF(tokens);
+        return -1;
+    }
+    *line_out = line;
+    *tokens_out = tokens;
+    return 0;
+}
+
+PyDoc_STRVAR(lex_line_doc,
+"lex_line(line, in_block_comment) -> (去注释后的行, 记号列表, 行尾是否处于块注释中)");
+
+static PyObject *cscan_lex_line(PyObject *module, PyObject *args)
+{
+    PyObject *object;
+    int in_block_comment;
+    Text t;
+    if (!PyArg_ParseTuple(args, "Up:lex_line", &object, &in_block_comment) || text_init(&t, object) < 0) {
+        return NULL;
+    }
+
+    PyObject *line, *tokens;
+    if (lex_span(&t, 0, t.length, &in_block_comment, &line, &tokens) < 0) {
+        return NULL;
+    }
+    return Py_BuildValue("(NNO)", line, tokens, in_block_comment ? Py_True : Py_False);
+}
+
+PyDoc_STRVAR(strip_comments_doc,
+"strip_comments(line, in_block_comment) -> (去注释后的行, 行尾是否处于块注释中)");
+
+static PyObject *cscan_strip_comments(PyObject *module, PyObject *args)
+{
+    PyObject *object;
+    int in_block_comment;
+    Text t;
+    if (!PyArg_ParseTuple(args, "Up:strip_comments", &object, &in_block_comment) || text_init(&t, object) < 0) {
+        return NULL;
+    }
+
+    PyObject *line = strip_span(&t, 0, t.length, &in_block_comment);
+    if (!line) {
+        return NULL;
+    }
+    return Py_BuildValue("(NO)", line, in_block_comment ? Py_True : Py_False);
+}
+
+PyDoc_STRVAR(tokenize_doc,
+"tokenize(content) -> (去注释后的行列表, 每行的记号列表, 文件末尾是否处于块注释中)\n\n"
+"按 '\\n' 切分（与 str.split('\\n') 相同），块注释状态从文件开头重新计算。");
+
+static PyObject *cscan_tokenize(PyObject *module, PyObject *arg)
+{
+    Text t;
+    if (text_init(&t, arg) < 0) {
+        return NULL;
+    }
+
+    PyObject *lines = PyList_New(0);
+    PyObject *line_tokens = PyList_New(0);
+    if (!lines || !line_tokens) {
+        goto error;
+    }
+
+    int in_block_comment = 0;
+    Py_ssize_t start = 0;
+    for (;;) {
+        Py_ssize_t end = find_char(&t, '\n', start);
+        Py_ssize_t line_end = end < 0 ? t.length : end;
+
+        PyObject *line, *tokens;
+        if (lex_span(&t, start, line_end, &in_block_comment, &line, &tokens) < 0) {
+            goto error;
+        }
+        int status = PyList_Append(lines, line) < 0 || PyList_Append(line_tokens, tokens) < 0;
+        Py_DECREF(line);
+        Py_DECREF(tokens);
+        if (status) {
+            goto error;
+        }
+
+        if (end < 0) {
+            break;
+        }
+        start = end + 1;
+    }
+    return Py_BuildValue("(NNO)", lines, line_tokens, in_block_comment ? Py_True : Py_False);
+
+error:
+    Py_XDECREF(lines);
+    Py_XDECREF(line_tokens);
+    return NULL;
+}
+
+static PyMethodDef cscan_methods[] = {
+    {"lex_line", cscan_lex_line, METH_VARARGS, lex_line_doc},
+    {"strip_comments", cscan_strip_comments, METH_VARARGS, strip_comments_doc},
+    {"tokenize", cscan_tokenize, METH_O, tokenize_doc},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef cscan_module = {
+    PyModuleDef_HEAD_INIT,
+    "_cscan",
+    "C词法扫描核心（utils.c_lexer 的原生实现）",
+    -1,
+    cscan_methods
+};
+
+PyMODINIT_FUNC PyInit__cscan(void)
+{
+    init_ascii_class();
+    return PyModule_Create(&cscan_module);
+}
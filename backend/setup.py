@@ -0,0 +1,16 @@
+"""
+可选的原生扩展构建脚本
+
+utils._cscan 是 utils/c_lexer.py 的原生实现，未构建时 c_lexer 使用等价的正则表达式实现。
+
+用法（在 backend 目录下）：
+    python setup.py build_ext --inplace
+"""
+from setuptools import Extension, setup
+
+setup(
+    name='c-bug-detector-backend',
+    ext_modules=[
+        Extension('utils._cscan', sources=['native/cscan.c']),
+    ],
+)
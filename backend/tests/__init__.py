@@ -0,0 +1 @@
+# 回归测试模块初始化文件
@@ -0,0 +1,22 @@
+"""
+回归测试的预期结果 - fixtures 目录中的输入和检查过的预期输出
+
+检测结果有意变化时，用 UPDATE_EXPECTED=1 运行测试，把实际结果写为新的预期结果后再检查差异。
+"""
+import json
+import os
+import unittest
+from typing import Any
+
+FIXTURES = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'fixtures')
+
+
+def check_expected(test: unittest.TestCase, actual: Any, expected_name: str):
+    """与 fixtures 中的预期结果比较；设置 UPDATE_EXPECTED 时改为写入预期结果"""
+    expected_path = os.path.join(FIXTURES, expected_name)
+    if os.environ.get('UPDATE_EXPECTED'):
+        with open(expected_path, 'w', encoding='utf-8') as f:
+            json.dump(actual, f, indent=2, ensure_ascii=False)
+            f.write('\n')
+    with open(expected_path, 'r', encoding='utf-8') as f:
+        test.assertEqual(json.load(f), actual)
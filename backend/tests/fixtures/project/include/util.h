@@ -0,0 +1,7 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+int *make_buffer(int size);
+int sum(int *values, int count);
+
+#endif
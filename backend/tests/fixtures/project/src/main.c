@@ -0,0 +1,14 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/util.h"
+
+int main(void) {
+    int count;
+    int *values = make_buffer(8);
+    if (values == NULL) {
+        return 1;
+    }
+    printf("%d\n", sum(values, count));
+    free(values);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#include <stdlib.h>
+#include "../include/util.h"
+
+int *make_buffer(int size) {
+    return malloc(sizeof(int) * size);
+}
+
+int sum(int *values, int count) {
+    int total = 0;
+    int i;
+    for (i = 0; i < count; i++) {
+        total += values[i];
+    }
+    return total;
+}
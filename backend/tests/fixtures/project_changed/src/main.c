@@ -0,0 +1,17 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/util.h"
+
+int main(void) {
+    int count = 8;
+    int scale;
+    int total;
+    int *values = make_buffer(count);
+    if (values == NULL) {
+        return 1;
+    }
+    total = sum(values, count) * scale;
+    printf("%d\n", total);
+    free(values);
+    return 0;
+}
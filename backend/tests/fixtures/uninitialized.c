@@ -0,0 +1,42 @@
+#include <stdio.h>
+
+int square(int v) {
+    return v * v;
+}
+
+int self_update(void) {
+    int result;
+    result = result + 2;
+    return result;
+}
+
+int loop_init(int n) {
+    int i;
+    int total = 0;
+    for (i = 0; i < n; i++) {
+        total = total + i;
+    }
+    return total;
+}
+
+int call_argument(void) {
+    int y;
+    int k;
+    k = square(y);
+    return k;
+}
+
+int compare_and_add(void) {
+    int x;
+    int y = 0;
+    if (x > 3) {
+        y = x + 1;
+    }
+    return y;
+}
+
+int read_input(void) {
+    int x;
+    scanf("%d", &x);
+    return x + 1;
+}
@@ -0,0 +1,87 @@
+"""
+变更检查的回归测试 - 在临时 git 仓库中运行 --write-baseline 和 --changed-since，与预期的输出比较
+
+基准版本为 fixtures/project，之后用 fixtures/project_changed 中的文件覆盖工作区：
+修改后的 src/main.c 修复了基线中的两个问题并引入了新的问题，util.c 不受影响、不重新分析。
+
+用法（在 backend 目录下）：
+    python -m unittest discover -s tests -t .
+"""
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+from tests.expected import FIXTURES, check_expected
+
+MAIN = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), 'main.py')
+
+
+def git(directory: str, *args: str):
+    subprocess.run(['git', '-c', 'user.name=test', '-c', 'user.email=test@example.com', *args],
+                   cwd=directory, check=True, capture_output=True)
+
+
+@unittest.skipIf(shutil.which('git') is None, '需要 git')
+class ChangeCheckTest(unittest.TestCase):
+
+    def setUp(self):
+        self.workdir = tempfile.mkdtemp()
+        self.project = os.path.join(self.workdir, 'project')
+        self.baseline = os.path.join(self.workdir, 'baseline.json')
+        self.cache_dir = os.path.join(self.workdir, 'cache')
+        shutil.copytree(os.path.join(FIXTURES, 'project'), self.project)
+        git(self.project, 'init', '-q')
+        git(self.project, 'add', '.')
+        git(self.project, 'commit', '-q', '-m', 'base')
+
+    def tearDown(self):
+        shutil.rmtree(self.workdir, ignore_errors=True)
+
+    def run_check(self, *args: str):
+        """运行变更检查，返回 (退出码, JSON 输出)"""
+        output = os.path.join(self.workdir, 'output.json')
+        result = subprocess.run([sys.executable, MAIN, self.project, '-f', 'json', '-o', output,
+                                 '--cache-dir', self.cache_dir, *args], capture_output=True, text=True)
+        with open(output, 'r', encoding='utf-8') as f:
+            return result.returncode, json.load(f)
+
+    def apply_changes(self):
+        changed = os.path.join(FIXTURES, 'project_changed')
+        for root, _dirs, files in os.walk(changed):
+            for name in files:
+                source = os.path.join(root, name)
+                shutil.copyfile(source, os.path.join(self.project, os.path.relpath(source, changed)))
+
+    def test_write_baseline_then_compare(self):
+        code, data = self.run_check('--write-baseline', self.baseline)
+        self.assertEqual(code, 0)
+        with open(self.baseline, 'r', encoding='utf-8') as f:
+            self.assertEqual(sorted(json.load(f)['files']), ['src/main.c', 'src/util.c'])
+
+        # 没有变化时没有新增或修复的问题
+        code, data = self.run_check('--changed-since', 'HEAD', '--baseline', self.baseline)
+        self.assertEqual((code, data['analyzed_files'], data['new'], data['fixed']), (0, [], [], []))
+
+        self.apply_changes()
+        code, data = self.run_check('--changed-since', 'HEAD', '--baseline', self.baseline)
+        self.assertEqual(code, 1)
+        check_expected(self, data, 'project_changed.expected.json')
+
+    def test_merged_baseline_accepts_changes(self):
+        self.run_check('--write-baseline', self.baseline)
+        self.apply_changes()
+        self.run_check('--changed-since', 'HEAD', '--baseline', self.baseline, '--write-baseline', self.baseline)
+
+        # 合并后的基线包含 main.c 修改后的结果，并保留了只分析变化文件时未重新分析的 util.c 的结果，
+        # 完整分析再与它比较时没有新增或修复的问题
+        code, data = self.run_check('--baseline', self.baseline)
+        self.assertEqual((code, data['new'], data['fixed']), (0, [], []))
+        self.assertEqual(data['analyzed_files'], ['src/main.c', 'src/util.c'])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,69 @@
+"""
+结果缓存的回归测试 - 在固定的小项目上重复批量分析，检查缓存命中和失效后的结果与预期的报告相同
+
+fixtures/project 中的两个源文件都包含工作区头文件 include/util.h：
+内容不变时第二次分析全部命中缓存；修改头文件中的声明后包含它的文件的缓存失效。
+
+用法（在 backend 目录下）：
+    python -m unittest discover -s tests -t .
+"""
+import os
+import shutil
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from main import CBugDetector
+from tests.expected import FIXTURES, check_expected
+
+
+class ResultCacheTest(unittest.TestCase):
+
+    def setUp(self):
+        self.workdir = tempfile.mkdtemp()
+        self.project = os.path.join(self.workdir, 'project')
+        self.cache_dir = os.path.join(self.workdir, 'cache')
+        shutil.copytree(os.path.join(FIXTURES, 'project'), self.project)
+
+    def tearDown(self):
+        shutil.rmtree(self.workdir, ignore_errors=True)
+
+    def analyze(self):
+        """用新的检测器分析整个项目，返回 (相对路径 -> 报告的字典列表, 检测器)"""
+        detector = CBugDetector(verbose=False, cache_dir=self.cache_dir)
+        file_paths = detector.collect_c_files(self.project)
+        results = detector.analyze_files(file_paths)
+        reports = {os.path.relpath(file_path, self.project).replace(os.sep, '/'):
+                   [report.to_dict() for report in results.get(file_path, [])] for file_path in file_paths}
+        return reports, detector
+
+    def test_second_run_hits_cache(self):
+        first, detector = self.analyze()
+        self.assertEqual((detector.cache.hits, detector.cache.misses), (0, 2))
+        check_expected(self, first, 'project.expected.json')
+
+        second, detector = self.analyze()
+        self.assertEqual((detector.cache.hits, detector.cache.misses), (2, 0))
+        self.assertEqual(first, second)
+
+    def test_header_change_invalidates_dependents(self):
+        first, _detector = self.analyze()
+        with open(os.path.join(self.project, 'include', 'util.h'), 'a', encoding='utf-8') as f:
+            f.write('int scale(int value);\n')
+
+        second, detector = self.analyze()
+        self.assertEqual((detector.cache.hits, detector.cache.misses), (0, 2))
+        self.assertEqual(first, second)
+
+    def test_module_selection_is_part_of_key(self):
+        self.analyze()
+        detector = CBugDetector(verbose=False, cache_dir=self.cache_dir)
+        detector.module_enabled['memory_safety'] = False
+        detector.analyze_files(detector.collect_c_files(self.project))
+        self.assertEqual(detector.cache.hits, 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
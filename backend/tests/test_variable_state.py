@@ -0,0 +1,52 @@
+"""
+变量状态模块的回归测试 - 在固定的C代码上运行基于数据流的未初始化检测，与预期的报告比较
+
+fixtures/uninitialized.c 覆盖的情形：自身参与运算的赋值（result = result + 2）、for 循环头部的初始化、
+同一行中多种用法只报告一次、if 条件中的比较和 scanf 写入的变量。
+检测结果有意变化时，用 UPDATE_EXPECTED=1 运行测试重新生成 fixtures/uninitialized.expected.json。
+
+用法（在 backend 目录下）：
+    python -m unittest discover -s tests -t .
+"""
+import os
+import sys
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from main import CBugDetector
+from tests.expected import FIXTURES, check_expected
+
+
+def analyze_fixture(name: str, modules=('variable_state',)):
+    """只启用 modules 分析 fixtures 中的文件，返回报告的字典列表"""
+    detector = CBugDetector(verbose=False)
+    for module_name in detector.module_enabled:
+        detector.module_enabled[module_name] = module_name in modules
+    return [report.to_dict() for report in detector.analyze_file(os.path.join(FIXTURES, name))]
+
+
+class UninitializedVariableTest(unittest.TestCase):
+
+    def setUp(self):
+        self.reports = analyze_fixture('uninitialized.c')
+
+    def test_expected_reports(self):
+        check_expected(self, self.reports, 'uninitialized.expected.json')
+
+    def test_self_update_is_reported(self):
+        # 赋值的右侧先于写入求值
+        self.assertIn((9, "变量 'result' 在初始化前被使用"),
+                      [(report['line_number'], report['message']) for report in self.reports])
+
+    def test_initializing_assignment_takes_effect_first(self):
+        # for (i = 0; i < n; i++) 中的比较和自增不报告
+        self.assertNotIn("'i'", ''.join(report['message'] for report in self.reports))
+
+    def test_one_report_per_line_and_variable(self):
+        keys = [(report['line_number'], report['message'].split("'")[1]) for report in self.reports]
+        self.assertEqual(len(keys), len(set(keys)))
+
+
+if __name__ == '__main__':
+    unittest.main()
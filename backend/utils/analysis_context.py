@@ -0,0 +1,185 @@
+"""
+分析上下文 - 每个文件只解析一次，所有检测模块共享同一份只读结果
+"""
+from bisect import bisect_right
+from dataclasses import dataclass
+from types import MappingProxyType
+from typing import Dict, FrozenSet, List, Mapping, Optional, Sequence, Tuple
+
+from utils.c_lexer import CLexer
+from utils.code_parser import FunctionInfo, LineFacts, VariableInfo
+from utils.control_flow import ControlFlowGraph, Loop, build_control_flow
+from utils.function_summaries import SummaryIndex
+from utils.include_graph import EMPTY_CLOSURE, IncludeClosure
+from utils.source_lines import SourceLines
+from utils.symbol_table import Symbol, SymbolTable
+from utils.time_budget import TimeBudget
+
+# 流式解析时对去注释后的行重新分词（行中已没有注释，分词器不会进入块注释状态）
+_LINE_LEXER = CLexer()
+
+
+@dataclass(frozen=True)
+class AnalysisContext:
+    """一次文件分析的只读上下文
+
+    由 CBugDetector.analyze_file 构建，包含记号流、解析分类和每行的预匹配结果。
+    检测模块只读取这里的数据，不再自行构造解析器或对源代码行重新运行正则表达式。
+    """
+    file_path: str
+    # 去注释后的行；流式解析时为按需读取的 SourceLines
+    lines: Sequence[str]
+    tokens: Tuple[Tuple[str, ...], ...]
+    line_facts: Tuple[Optional[LineFacts], ...]
+
+    variables: Tuple[VariableInfo, ...]
+    functions: Tuple[FunctionInfo, ...]
+    function_calls: Tuple[Dict, ...]
+    assignments: Tuple[Dict, ...]
+    pointer_dereferences: Tuple[Dict, ...]
+    malloc_calls: Tuple[Dict, ...]
+    free_calls: Tuple[Dict, ...]
+    scanf_calls: Tuple[Dict, ...]
+    printf_calls: Tuple[Dict, ...]
+    loops: Tuple[Dict, ...]
+    includes: Tuple[Dict, ...]
+
+    # 由 line_facts 派生的行号索引
+    assignments_by_line: Mapping[int, Tuple[Dict, ...]]
+    null_check_lines: FrozenSet[int]
+    exit_lines: FrozenSet[int]
+    close_brace_lines: FrozenSet[int]
+    pointer_return_lines: Tuple[int, ...]
+
+    # 按名称索引的符号表
+    symbols: SymbolTable
+    functions_by_name: Mapping[str, FunctionInfo]
+
+    # 每个函数的控制流图（按起始行排列）及其起始行
+    control_flow: Tuple[ControlFlowGraph, ...]
+    control_flow_starts: Tuple[int, ...]
+
+    # 本次分析的时间预算，检测模块通过 check_budget 检查
+    budget: Optional[TimeBudget] = None
+
+    # 经由工作区头文件传递得到的头文件、函数声明和宏（来自包含关系图中缓存的头文件摘要）
+    include_closure: IncludeClosure = EMPTY_CLOSURE
+
+    # 工作区中函数的摘要（分配、释放参数），流式解析时为 None
+    function_summaries: Optional[SummaryIndex] = None
+
+    @classmethod
+    def from_parsed_data(cls, parsed_data: Dict[str, List], file_path: str = '',
+                         budget: Optional[TimeBudget] = None,
+                         include_closure: IncludeClosure = EMPTY_CLOSURE,
+                         function_summaries: Optional[SummaryIndex] = None) -> 'AnalysisContext':
+        """由 CCodeParser 的词法路径解析结果构建上下文"""
+        line_facts = tuple(parsed_data['line_facts'])
+        lines = parsed_data['lines']
+
+        assignments_by_line: Dict[int, List[Dict]] = {}
+        for assignment in parsed_data['assignments']:
+            assignments_by_line.setdefault(assignment['line'], []).append(assignment)
+
+        null_check_lines = []
+        exit_lines = []
+        close_brace_lines = []
+        pointer_return_lines = []
+        for line_num, facts in enumerate(line_facts, 1):
+            if facts is None:
+                continue
+            if facts.has_null_check:
+                null_check_lines.append(line_num)
+            if facts.has_exit:
+                exit_lines.append(line_num)
+            if facts.has_close_brace:
+                close_brace_lines.append(line_num)
+            if facts.has_pointer_return:
+                pointer_return_lines.append(line_num)
+
+        symbols = SymbolTable.build(
+            parsed_data['variables'], line_facts, parsed_data['pointer_dereferences'],
+            parsed_data['assignments'], parsed_data['free_calls'], parsed_data['malloc_calls'])
+
+        functions_by_name: Dict[str, FunctionInfo] = {}
+        for func in parsed_data['functions']:
+            functions_by_name.setdefault(func.name, func)
+
+        control_flow = tuple(build_control_flow(line_facts, parsed_data['functions']))
+
+        return cls(
+            file_path=file_path,
+            lines=lines if isinstance(lines, SourceLines) else tuple(lines),
+            tokens=tuple(tuple(tokens) for tokens in parsed_data['tokens']),
+            line_facts=line_facts,
+            variables=tuple(parsed_data['variables']),
+            functions=tuple(parsed_data['functions']),
+            function_calls=tuple(parsed_data['function_calls']),
+            assignments=tuple(parsed_data['assignments']),
+            pointer_dereferences=tuple(parsed_data['pointer_dereferences']),
+            malloc_calls=tuple(parsed_data['malloc_calls']),
+            free_calls=tuple(parsed_data['free_calls']),
+            scanf_calls=tuple(parsed_data['scanf_calls']),
+            printf_calls=tuple(parsed_data['printf_calls']),
+            loops=tuple(parsed_data['loops']),
+            includes=tuple(parsed_data['includes']),
+            assignments_by_line=MappingProxyType({line: tuple(items) for line, items in assignments_by_line.items()}),
+            null_check_lines=frozenset(null_check_lines),
+            exit_lines=frozenset(exit_lines),
+            close_brace_lines=frozenset(close_brace_lines),
+            pointer_return_lines=tuple(pointer_return_lines),
+            symbols=symbols,
+            functions_by_name=MappingProxyType(functions_by_name),
+            control_flow=control_flow,
+            control_flow_starts=tuple(cfg.start_line for cfg in control_flow),
+            budget=budget,
+            include_closure=include_closure,
+            function_summaries=function_summaries,
+        )
+
+    def check_budget(self):
+        """超过时间预算时抛出 BudgetExceeded"""
+        if self.budget is not None:
+            self.budget.check()
+
+    def get_line(self, line_num: int) -> str:
+        """获取指定行（从1开始）的去注释文本"""
+        if 1 <= line_num <= len(self.lines):
+            return self.lines[line_num - 1]
+        return ''
+
+    def get_tokens(self, line_num: int) -> Sequence[str]:
+        """获取指定行（从1开始）的记号；流式解析不保留记号，此时对该行重新分词"""
+        if self.tokens:
+            return self.tokens[line_num - 1] if 1 <= line_num <= len(self.tokens) else ()
+        line = self.get_line(line_num)
+        return _LINE_LEXER.lex_line(line)[1] if line else ()
+
+    def get_snippet(self, line_num: int) -> str:
+        """获取报告使用的代码片段（去注释并去除首尾空白的行文本）"""
+        return self.get_line(line_num).strip()
+
+    def get_variable_by_name(self, name: str) -> Optional[VariableInfo]:
+        """根据名称获取变量信息（第一个同名声明）"""
+        symbol = self.symbols.lookup(name)
+        return symbol.info if symbol else None
+
+    def get_function_by_name(self, name: str) -> Optional[FunctionInfo]:
+        """根据名称获取函数信息"""
+        return self.functions_by_name.get(name)
+
+    def resolve_symbol(self, name: str, line_num: int) -> Optional[Symbol]:
+        """获取指定行可见的同名变量声明"""
+        return self.symbols.resolve(name, line_num)
+
+    def function_at(self, line_num: int) -> Optional[ControlFlowGraph]:
+        """获取包含指定行的函数控制流图"""
+        index = bisect_right(self.control_flow_starts, line_num) - 1
+        if index >= 0 and self.control_flow[index].contains(line_num):
+            return self.control_flow[index]
+        return None
+
+    def find_loop(self, line_num: int) -> Optional[Loop]:
+        """获取循环关键字位于指定行的循环"""
+        cfg = self.function_at(line_num)
+        return cfg.loops.get(line_num) if cfg else None
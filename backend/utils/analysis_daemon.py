@@ -0,0 +1,133 @@
+"""
+分析守护进程 - 常驻内存的检测器，通过标准输入输出以逐行JSON通信
+"""
+import json
+import os
+import sys
+from typing import Any, Dict, List, Optional, TextIO
+
+from utils.compact_reports import ReportArena
+
+# 每条响应消息最多携带的报告数
+REPORT_BATCH_SIZE = 200
+
+
+class AnalysisDaemon:
+    """常驻检测服务
+
+    每行一个JSON请求，格式为 {"id": 1, "method": "analyze", "params": {...}}。
+    analyze 的参数为 file_path，以及可选的 content（编辑器中的内容）、modules（本次启用的模块）、
+    time_budget_ms（本次分析的时间上限，毫秒）和 format。
+    响应同样每行一个JSON对象：报告按批次以 {"id": 1, "reports": [...]} 返回；
+    format 为 "compact" 时改为 {"id": 1, "templates": [...], "strings": [...], "rows": [...]}
+    （ReportArena 的格式，templates 只包含本进程之前未发送过的模板，编号在进程内连续，
+    客户端需要保留收到的所有模板，包括已取消请求的消息中的模板），
+    最后以 {"id": 1, "done": true, "count": N, "partial": false, "incomplete_modules": [], "stats": {...}} 结束，
+    stats 为各阶段的耗时和内存分配统计，超过时间预算时 partial 为 true，incomplete_modules 为未完成的模块；
+    出错时返回 {"id": 1, "error": "..."}。
+    其他方法：ping（返回检测器版本）、invalidate（参数 file_path 为变化的头文件，丢弃其摘要，
+    以 {"id": 1, "done": true, "dependents": [...]} 返回本进程分析过的、直接或间接包含它的文件）
+    和 shutdown（退出服务）。
+    """
+
+    def __init__(self, detector, version: str, output: TextIO):
+        self.detector = detector
+        self.version = version
+        self.output = output
+        # 紧凑格式的模板表在整个进程内共享，每个模板只发送一次
+        self.arena = ReportArena()
+
+    def serve(self, input_stream: TextIO) -> int:
+        """处理请求直到输入结束或收到 shutdown"""
+        for line in input_stream:
+            line = line.strip()
+            if not line:
+                continue
+
+            request_id = None
+            try:
+                request = json.loads(line)
+                request_id = request.get('id')
+                method = request.get('method')
+                params = request.get('params') or {}
+
+                if method == 'analyze':
+                    self._analyze(request_id, params)
+                elif method == 'invalidate':
+                    dependents = self.detector.include_graph.invalidate(params.get('file_path', ''))
+                    self._send({'id': request_id, 'done': True, 'dependents': sorted(dependents)})
+                elif method == 'ping':
+                    self._send({'id': request_id, 'done': True, 'version': self.version})
+                elif method == 'shutdown':
+                    self._send({'id': request_id, 'done': True})
+                    return 0
+                else:
+                    self._send({'id': request_id, 'error': f'未知的方法: {method}'})
+            except (ValueError, AttributeError) as e:
+                self._send({'id': request_id, 'error': f'无效的请求: {e}'})
+            except Exception as e:
+                self._send({'id': request_id, 'error': f'分析失败: {e}'})
+        return 0
+
+    def _analyze(self, request_id: Any, params: Dict[str, Any]):
+        """分析一个文件或一段内存中的内容，按批次返回报告"""
+        file_path = params.get('file_path', '')
+        content = params.get('content')
+
+        enabled = self._select_modules(params.get('modules'))
+        time_budget = self.detector.time_budget
+        if params.get('time_budget_ms') is not None:
+            self.detector.time_budget = params['time_budget_ms'] / 1000
+        try:
+            if content is not None:
+                reports = self.detector.analyze_content(content.encode('utf-8'), file_path)
+            elif os.path.isfile(file_path):
+                reports = self.detector.analyze_file(file_path)
+            else:
+                self._send({'id': request_id, 'error': f'文件不存在: {file_path}'})
+                return
+        finally:
+            self.detector.module_enabled.update(enabled)
+            self.detector.time_budget = time_budget
+
+        stats = self.detector.last_stats
+        if params.get('format') == 'compact':
+            self._send_compact(request_id, reports, stats)
+        else:
+            with stats.phase('format'):
+                items = [report.to_dict() for report in reports]
+            for start in range(0, len(items), REPORT_BATCH_SIZE):
+                self._send({'id': request_id, 'reports': items[start:start + REPORT_BATCH_SIZE]})
+        self._send({'id': request_id, 'done': True, 'count': len(reports),
+                    'partial': bool(stats.incomplete_modules),
+                    'incomplete_modules': list(stats.incomplete_modules), 'stats': stats.to_dict()})
+
+    def _send_compact(self, request_id: Any, reports, stats):
+        """以紧凑格式按批次发送报告，每批带自己的字符串表"""
+        for start in range(0, len(reports), REPORT_BATCH_SIZE):
+            with stats.phase('format'):
+                rows = [self.arena.encode(report) for report in reports[start:start + REPORT_BATCH_SIZE]]
+            self._send({'id': request_id, 'templates': self.arena.new_templates(),
+                        'strings': self.arena.take_strings(), 'rows': rows})
+
+    def _select_modules(self, modules: Optional[List[str]]) -> Dict[str, bool]:
+        """按请求启用模块，返回原来的启用状态以便请求结束后恢复"""
+        previous = dict(self.detector.module_enabled)
+        if modules is not None:
+            for name in self.detector.module_enabled:
+                self.detector.module_enabled[name] = name in modules
+        return previous
+
+    def _send(self, message: Dict[str, Any]):
+        self.output.write(json.dumps(message, ensure_ascii=False, separators=(',', ':')) + '\n')
+        self.output.flush()
+
+
+def run_daemon(detector, version: str, output: TextIO) -> int:
+    """以守护进程模式运行，请求从标准输入读取，响应写入 output"""
+    try:
+        sys.stdin.reconfigure(encoding='utf-8')
+        output.reconfigure(encoding='utf-8')
+    except AttributeError:
+        pass
+    return AnalysisDaemon(detector, version, output).serve(sys.stdin)
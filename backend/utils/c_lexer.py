@@ -0,0 +1,128 @@
+"""
+C词法分析器 - 单遍扫描生成按行分组的记号流
+
+扫描核心有两种等价的实现：原生扩展 utils._cscan（native/cscan.c，需要先构建）
+和这里的正则表达式。扩展可用时默认使用原生实现，两者产生完全相同的行文本和记号。
+"""
+import re
+from typing import Iterable, Iterator, List, Optional, Tuple
+
+try:
+    from utils import _cscan
+except ImportError:
+    _cscan = None
+
+# 原生扫描核心是否可用
+NATIVE_AVAILABLE = _cscan is not None
+
+
+# 记号模式：一次findall即可切分整行，空白字符自动跳过
+_TOKEN_RE = re.compile(r'''
+    \#[ \t]*include[ \t]*[<"][^>"]*[>"]     # 头文件包含作为一个整体记号
+  | "(?:\\.|[^"\\])*"?                      # 字符串字面量
+  | '(?:\\.|[^'\\])*'?                      # 字符字面量
+  | \.?\d(?:[eEpP][+-]|[\w.])*              # 数值（预处理数）
+  | [A-Za-z_]\w*                            # 标识符与关键字
+  | ->|\+\+|--|<<=|>>=|<<|>>|<=|>=|==|!=|&&|\|\||[-+*/%&|^]=|\.\.\.|\#\#
+  | \S                                      # 其他单字符运算符
+''', re.VERBOSE)
+
+# 注释定界符扫描：跳过字符串/字符字面量中的 // 和 /*
+_COMMENT_SCAN_RE = re.compile(r'''"(?:\\.|[^"\\])*"?|'(?:\\.|[^'\\])*'?|//|/\*''')
+
+
+def is_identifier(token: str) -> bool:
+    """判断记号是否为标识符或关键字"""
+    return token.isidentifier()
+
+
+class CLexer:
+    """C词法分析器
+
+    以行为单位工作，跨行状态只有"是否处于块注释中"一项，
+    因此同一个实例可以逐行喂入任意来源的文本。
+    native=False 时总是使用正则表达式实现（用于对比两种实现）。
+    """
+
+    def __init__(self, native: Optional[bool] = None):
+        self.in_block_comment = False
+        self.native = _cscan if native is not False else None
+
+    def reset(self):
+        """重置跨行状态"""
+        self.in_block_comment = False
+
+    def tokenize(self, content: str) -> Tuple[List[str], List[List[str]]]:
+        """对整个文件内容进行分词，返回 (去注释后的行, 每行的记号列表)"""
+        self.reset()
+        if self.native:
+            lines, line_tokens, self.in_block_comment = self.native.tokenize(content)
+            return lines, line_tokens
+        lines = []
+        line_tokens = []
+        for line, tokens in self.iter_lines(content.split('\n')):
+            lines.append(line)
+            line_tokens.append(tokens)
+        return lines, line_tokens
+
+    def iter_lines(self, raw_lines: Iterable[str]) -> Iterator[Tuple[str, List[str]]]:
+        """逐行分词，产出 (去注释后的行, 记号列表)"""
+        if self.native:
+            lex_line = self.native.lex_line
+            for line in raw_lines:
+                line, tokens, self.in_block_comment = lex_line(line, self.in_block_comment)
+                yield line, tokens
+            return
+        findall = _TOKEN_RE.findall
+        for line in raw_lines:
+            if self.in_block_comment or '/' in line:
+                line = self.strip_comments(line)
+            yield line, findall(line) if line else []
+
+    def lex_line(self, line: str) -> Tuple[str, List[str]]:
+        """对单行分词，返回 (去注释后的行, 记号列表)"""
+        if self.native:
+            line, tokens, self.in_block_comment = self.native.lex_line(line, self.in_block_comment)
+            return line, tokens
+        if self.in_block_comment or '/' in line:
+            line = self.strip_comments(line)
+        return line, _TOKEN_RE.findall(line) if line else []
+
+    def strip_comments(self, line: str) -> str:
+        """移除单行中的注释，块注释状态跨行保持"""
+        if self.native:
+            line, self.in_block_comment = self.native.strip_comments(line, self.in_block_comment)
+            return line
+        pieces = []
+        pos = 0
+        length = len(line)
+        while pos < length:
+            if self.in_block_comment:
+                end = line.find('*/', pos)
+                if end < 0:
+                    break
+                self.in_block_comment = False
+                pos = end + 2
+                pieces.append(' ')
+                continue
+
+            match = _COMMENT_SCAN_RE.search(line, pos)
+            if not match:
+                pieces.append(line[pos:])
+                break
+
+            text = match.group(0)
+            if text == '//':
+                pieces.append(line[pos:match.start()])
+                break
+            if text == '/*':
+                pieces.append(line[pos:match.start()])
+                self.in_block_comment = True
+                pos = match.end()
+                continue
+
+            # 字符串或字符字面量原样保留
+            pieces.append(line[pos:match.end()])
+            pos = match.end()
+
+        return ''.join(pieces)
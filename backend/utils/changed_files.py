@@ -0,0 +1,187 @@
+"""
+变更检查 - 只分析相对基准版本变化的文件及受其影响的文件，并与基线中的报告比较，只输出新增和已修复的问题
+"""
+import json
+import os
+import subprocess
+import sys
+from collections import Counter
+from typing import Callable, Dict, Iterable, List, Optional, Sequence, Set, Tuple
+
+from utils.c_lexer import CLexer
+from utils.error_reporter import BugReport
+from utils.function_summaries import SummaryIndex, summarize_functions
+from utils.include_graph import IncludeGraph, scan_includes
+
+# 基线文件的格式版本
+BASELINE_FORMAT = 1
+
+
+def _git(directory: str, *args: str) -> bytes:
+    return subprocess.run(['git', *args], cwd=directory, check=True, capture_output=True).stdout
+
+
+class ChangeSet:
+    """相对基准版本变化（包括新增和删除）的文件
+
+    base_content 给出文件在基准版本中的内容（不存在时为 None），用于找出被删除或改名的函数；
+    只有文件列表时为 None，此时只考虑文件中现有的函数。
+    """
+
+    def __init__(self, paths: Iterable[str],
+                 base_content: Optional[Callable[[str], Optional[bytes]]] = None):
+        self.paths = {os.path.abspath(path) for path in paths}
+        self.base_content = base_content
+
+    @classmethod
+    def from_git(cls, directory: str, base: str) -> 'ChangeSet':
+        """工作区（包括未提交的修改和未跟踪的文件）相对 git 版本 base 变化的文件"""
+        try:
+            top = _git(directory, 'rev-parse', '--show-toplevel').decode('utf-8').strip()
+            changed = _git(directory, 'diff', '--name-only', '--no-renames', '-z', base, '--', '.')
+            untracked = _git(directory, 'ls-files', '--others', '--exclude-standard', '--full-name', '-z', '--', '.')
+        except OSError as e:
+            raise ValueError(f"无法运行 git: {e}")
+        except subprocess.CalledProcessError as e:
+            raise ValueError(f"无法获取 {base} 以来的变更: {e.stderr.decode('utf-8', 'replace').strip()}")
+        names = [name.decode('utf-8') for name in (changed + b'\0' + untracked).split(b'\0') if name]
+
+        def base_content(path: str) -> Optional[bytes]:
+            relative = os.path.relpath(path, top).replace(os.sep, '/')
+            result = subprocess.run(['git', 'show', f'{base}:{relative}'], cwd=top, capture_output=True)
+            return result.stdout if result.returncode == 0 else None
+
+        return cls((os.path.join(top, name) for name in names), base_content)
+
+    @classmethod
+    def from_list(cls, list_path: str) -> 'ChangeSet':
+        """从文件（- 表示标准输入）读取变化的文件，每行一个路径，相对路径相对于当前目录"""
+        if list_path == '-':
+            lines = sys.stdin.read().splitlines()
+        else:
+            with open(list_path, 'r', encoding='utf-8') as f:
+                lines = f.read().splitlines()
+        return cls(line.strip() for line in lines if line.strip() and not line.startswith('#'))
+
+    def affected_files(self, c_files: Sequence[str], include_graph: IncludeGraph,
+                       summaries: SummaryIndex) -> List[str]:
+        """需要重新分析的文件（按 c_files 中的顺序）
+
+        包括变化的 .c 文件、直接或间接包含变化的头文件的文件，以及调用了变化的文件中（现在或基准版本中）
+        定义的函数的文件。summaries 中必须已经建立了 c_files 的局部摘要；其余文件的结果不会变化。
+        """
+        by_path = {os.path.abspath(path): path for path in c_files}
+        affected = {path for path in self.paths if path in by_path}
+
+        # 头文件或被删除的文件：找出包含它们的文件（被删除的头文件只能找到直接包含它的文件）
+        others = self.paths - affected
+        if others:
+            for path, file_path in by_path.items():
+                try:
+                    with open(file_path, 'rb') as f:
+                        names = scan_includes(f.read())
+                except OSError:
+                    continue
+                include_graph.file_closure(path, names)
+                for name in names:
+                    candidates = (os.path.normpath(os.path.join(directory, name))
+                                  for directory in (os.path.dirname(path), *include_graph.include_dirs))
+                    if any(candidate in others for candidate in candidates):
+                        affected.add(path)
+                        break
+            for path in others:
+                affected |= include_graph.dependents_of(path) & by_path.keys()
+
+        # 函数摘要可能变化的函数，调用它们的文件的结果可能随之变化
+        functions: Set[str] = set()
+        for path in self.paths:
+            if path in by_path:
+                functions |= summaries.functions_in(by_path[path])
+            if self.base_content is not None and path.endswith('.c'):
+                content = self.base_content(path)
+                if content is not None:
+                    _lines, token_lines = CLexer().tokenize(content.decode('utf-8', 'replace'))
+                    functions |= set(summarize_functions(token_lines))
+        if functions:
+            affected |= {os.path.abspath(path) for path in summaries.calling_files(functions)} & by_path.keys()
+
+        return [file_path for path, file_path in by_path.items() if path in affected]
+
+
+def baseline_key(root: str, file_path: str) -> str:
+    """基线中文件的键：相对于分析目录的路径（使用 / 分隔），在不同的检出目录之间通用"""
+    return os.path.relpath(os.path.abspath(file_path), os.path.abspath(root)).replace(os.sep, '/')
+
+
+def report_key(report: Dict) -> Tuple[str, str, str, str]:
+    """比较基线时报告的标识：不含行号，只在问题所在行之前插入或删除代码时不算新问题"""
+    return (report['module_name'], report['error_type'], report['message'], report.get('code_snippet', '').strip())
+
+
+class Baseline:
+    """已知问题的基线：相对于分析目录的文件路径 -> 该文件的报告（to_dict 的结果）"""
+
+    def __init__(self, root: str, files: Optional[Dict[str, List[Dict]]] = None,
+                 version: str = '', modules: Sequence[str] = ()):
+        self.root = os.path.abspath(root)
+        self.files = files if files is not None else {}
+        self.version = version
+        self.modules = list(modules)
+
+    @classmethod
+    def load(cls, path: str, root: str) -> 'Baseline':
+        with open(path, 'r', encoding='utf-8') as f:
+            data = json.load(f)
+        if data.get('format') != BASELINE_FORMAT:
+            raise ValueError(f"基线文件 {path} 的格式不受支持")
+        return cls(root, data['files'], data.get('version', ''), data.get('modules', ()))
+
+    def save(self, path: str, version: str, modules: Sequence[str]):
+        data = {'format': BASELINE_FORMAT, 'version': version, 'modules': list(modules),
+                'files': {key: self.files[key] for key in sorted(self.files)}}
+        with open(path, 'w', encoding='utf-8') as f:
+            json.dump(data, f, indent=1, ensure_ascii=False)
+            f.write('\n')
+
+    def key(self, file_path: str) -> str:
+        return baseline_key(self.root, file_path)
+
+    def missing_files(self, file_paths: Iterable[str]) -> List[str]:
+        """基线中有、但已不在分析目录中的文件"""
+        present = {self.key(file_path) for file_path in file_paths}
+        return sorted(key for key in self.files if key not in present)
+
+    def update(self, results: Dict[str, List[BugReport]], removed: Iterable[str] = ()):
+        """用重新分析的结果替换对应文件的报告，并删除已不存在的文件"""
+        for file_path, reports in results.items():
+            if reports:
+                self.files[self.key(file_path)] = [report.to_dict() for report in reports]
+            else:
+                self.files.pop(self.key(file_path), None)
+        for key in removed:
+            self.files.pop(key, None)
+
+    def compare(self, results: Dict[str, List[BugReport]],
+                removed: Iterable[str] = ()) -> Tuple[List[Tuple[str, Dict]], List[Tuple[str, Dict]]]:
+        """与基线比较重新分析的文件，返回 (新增的报告, 已修复的报告)，每项为 (文件键, 报告)
+
+        同一文件中相同的报告按出现次数比较；未重新分析的文件视为没有变化。
+        """
+        new: List[Tuple[str, Dict]] = []
+        fixed: List[Tuple[str, Dict]] = []
+        items = [(self.key(file_path), [report.to_dict() for report in reports])
+                 for file_path, reports in results.items()]
+        items.extend((key, []) for key in removed)
+        for key, current in items:
+            previous = self.files.get(key, [])
+            remaining = Counter(report_key(report) for report in previous)
+            for report in current:
+                if remaining[report_key(report)] > 0:
+                    remaining[report_key(report)] -= 1
+                else:
+                    new.append((key, report))
+            for report in previous:
+                if remaining[report_key(report)] > 0:
+                    remaining[report_key(report)] -= 1
+                    fixed.append((key, report))
+        return new, fixed
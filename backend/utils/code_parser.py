@@ -1,10 +1,49 @@
 """
-C代码解析器 - 使用正则表达式解析C代码
+C代码解析器 - 基于单遍词法分析构建解析结果（保留正则表达式解析路径用于对比）
 """
 import re
+from array import array
 from typing import List, Dict, Tuple, Optional
 from dataclasses import dataclass
 
+from utils.c_lexer import CLexer
+from utils.instrumentation import AnalysisStats, timed
+from utils.line_features import (ALLOC, ASSIGN, BRACE, DO, FOR, FREE, INCLUDE, PAREN, PRINTF, SCANF,
+                                 SEMICOLON, STAR, STRUCT, TYPE, WHILE, has_all, line_features)
+from utils.source_lines import SourceLines, iter_buffer_lines
+
+
+# 基本类型关键字
+TYPE_KEYWORDS = frozenset(['int', 'char', 'float', 'double', 'long', 'short', 'unsigned', 'signed', 'void'])
+
+# 不视为函数调用的关键字和类型名
+NON_CALL_KEYWORDS = frozenset(['int', 'char', 'float', 'double', 'long', 'short', 'unsigned', 'signed', 'void',
+                               'if', 'while', 'for', 'do', 'return', 'break', 'continue'])
+
+# 被视为变量声明行的类型关键字
+DECLARATION_KEYWORDS = frozenset(['int', 'char', 'float', 'double'])
+
+# 比较运算符（对应正则 [<>=!]+）与算术运算符（对应正则 [+\-*/]）
+COMPARISON_OPS = frozenset(['<', '>', '=', '!', '==', '!=', '<=', '>=', '<<', '>>', '<<=', '>>='])
+ARITHMETIC_OPS = frozenset(['+', '-', '*', '/', '++', '--', '+=', '-=', '*=', '/='])
+OPERATOR_OPS = COMPARISON_OPS | ARITHMETIC_OPS
+
+# 控制流关键字，以及控制流事件中原样保留的记号（其余记号合并为 EXPRESSION_EVENT）
+CONTROL_KEYWORDS = frozenset(['if', 'else', 'while', 'for', 'do', 'switch', 'case', 'default',
+                              'return', 'break', 'continue', 'goto'])
+_STRUCTURE_TOKENS = CONTROL_KEYWORDS | frozenset(['{', '}'])
+_EVENT_TOKENS = _STRUCTURE_TOKENS | frozenset(['(', ')', ';', ':'])
+EXPRESSION_EVENT = 'e'
+# 预处理指令行的控制流事件，构建控制流图时跳过
+DIRECTIVE_EVENTS = ('#',)
+
+# 记号遍历中需要处理的记号，其余记号直接跳过
+_WALK_TOKENS = TYPE_KEYWORDS | OPERATOR_OPS | frozenset(
+    ['struct', '(', '[', '{', '}', 'break', 'return', 'do'])
+
+_HEADER_RE = re.compile(r'[<"]([^>"]+)[>"]')
+_FORMAT_SPEC_RE = re.compile(r'%%|%[-+ #0]*(?:\d+|\*)?(?:\.(?:\d+|\*))?(?:hh|h|ll|l|L|z|j|t)?[diouxXeEfFgGaAcspn]')
+
 
 @dataclass
 class VariableInfo:
@@ -27,10 +66,124 @@ class FunctionInfo:
     scope_level: int = 0
 
 
-class CCodeParser:
-    """C代码解析器"""
+class LineFacts:
+    """单行的预匹配结果，由解析器在记号遍历中一次算出，供各检测模块共享"""
+    __slots__ = ('is_declaration', 'call_arguments', 'array_accesses', 'pointer_arithmetic',
+                 'comparisons', 'arithmetic', 'has_null_check', 'has_exit', 'has_pointer_return',
+                 'has_close_brace', 'brace_delta', 'null_checks', 'control')
     
     def __init__(self):
+        self.is_declaration = False          # 含分号和基本类型关键字的声明行
+        self.call_arguments = []             # [(函数名, 参数中的标识符列表)]
+        self.array_accesses = []             # name[...] 中的数组名
+        self.pointer_arithmetic = []         # name +/- 数字 中的变量名
+        self.comparisons = []                # 每条语句中第一个比较运算的左操作数
+        self.arithmetic = []                 # 每条语句中第一个算术运算的左操作数
+        self.has_null_check = False          # 含 name == NULL / name != NULL
+        self.has_exit = False                # 含 break; 或 return ...;
+        self.has_pointer_return = False      # 含 return ... * ...;
+        self.has_close_brace = False
+        self.brace_delta = 0                 # '{' 数量减去 '}' 数量
+        self.null_checks = []                # name == NULL / name != NULL 中的变量名
+        self.control = ()                    # 控制流事件，普通语句行为空（见 _control_events）
+    
+    def is_empty(self) -> bool:
+        """是否没有任何预匹配结果"""
+        return not (self.is_declaration or self.call_arguments or self.array_accesses
+                    or self.pointer_arithmetic or self.comparisons or self.arithmetic
+                    or self.has_null_check or self.has_exit or self.has_pointer_return
+                    or self.has_close_brace or self.brace_delta or self.control)
+
+
+# 流式解析时所有没有预匹配结果的行共享这一个实例（只读）
+EMPTY_LINE_FACTS = LineFacts()
+
+
+def _is_word(token: str) -> bool:
+    """判断记号是否为标识符或数值（对应正则中的 \\w+）"""
+    return token.isidentifier() or token[0].isdigit()
+
+
+def _next_semicolon(tokens: List[str], start: int) -> int:
+    """返回 start 之后第一个分号的下标，没有时返回记号数"""
+    try:
+        return tokens.index(';', start)
+    except ValueError:
+        return len(tokens)
+
+
+def _count_format_specifiers(tokens: List[str]) -> int:
+    """统计第一个字符串字面量中的格式说明符数量（不含 %%）"""
+    for token in tokens:
+        if token[0] == '"':
+            return sum(1 for spec in _FORMAT_SPEC_RE.findall(token) if spec != '%%')
+    return 0
+
+
+def _count_top_level_commas(tokens: List[str]) -> int:
+    """统计不在嵌套括号内的逗号数量，即格式字符串之后的参数个数"""
+    depth = 0
+    commas = 0
+    for token in tokens:
+        if token in ('(', '[', '{'):
+            depth += 1
+        elif token in (')', ']', '}'):
+            depth -= 1
+        elif token == ',' and depth == 0:
+            commas += 1
+    return commas
+
+
+def _control_events(tokens: List[str]) -> Tuple[str, ...]:
+    """把一行记号压缩为控制流事件：关键字、括号、分号和冒号原样保留，其余连续记号合并为一个表达式事件"""
+    events = []
+    for token in tokens:
+        if token in _EVENT_TOKENS:
+            events.append(token)
+        elif not events or events[-1] != EXPRESSION_EVENT:
+            events.append(EXPRESSION_EVENT)
+    return tuple(events)
+
+
+def join_tokens(tokens: List[str]) -> str:
+    """将记号拼接为规范化文本，仅在两个单词记号之间保留空格"""
+    if not tokens:
+        return ''
+    pieces = [tokens[0]]
+    prev = tokens[0]
+    for token in tokens[1:]:
+        if (prev[-1].isalnum() or prev[-1] == '_') and (token[0].isalnum() or token[0] == '_'):
+            pieces.append(' ')
+        pieces.append(token)
+        prev = token
+    return ''.join(pieces)
+
+
+def find_closing_paren(tokens: List[str], open_index: int) -> int:
+    """返回与 open_index 处 '(' 匹配的 ')' 下标，同一行内找不到时返回 -1"""
+    depth = 0
+    for i in range(open_index, len(tokens)):
+        token = tokens[i]
+        if token == '(':
+            depth += 1
+        elif token == ')':
+            depth -= 1
+            if depth == 0:
+                return i
+    return -1
+
+
+class CCodeParser:
+    """C代码解析器
+
+    默认先用 CLexer 对每行分词一次，再在一次记号遍历中填充所有结果分类；
+    use_lexer=False 时退回到逐行运行正则表达式的旧路径（按行特征位图跳过不可能匹配的模式）。
+    """
+    
+    def __init__(self, use_lexer: bool = True):
+        self.use_lexer = use_lexer
+        self.lexer = CLexer()
+        
         # 编译常用的正则表达式模式
         self.patterns = {
             # 变量声明
@@ -74,6 +227,11 @@ class CCodeParser:
             'multi_comment': re.compile(r'/\*.*?\*/', re.DOTALL),
         }
     
+    @staticmethod
+    def decode_source(raw_content: bytes) -> str:
+        """将文件字节解码为文本，并统一换行符（与文本模式读取一致）"""
+        return raw_content.decode('utf-8').replace('\r\n', '\n').replace('\r', '\n')
+    
     def parse_file(self, file_path: str) -> Dict[str, List]:
         """解析C文件"""
         try:
@@ -84,15 +242,30 @@ class CCodeParser:
             print(f"解析文件 {file_path} 时出错: {e}")
             return {}
     
-    def parse_content(self, content: str) -> Dict[str, List]:
-        """解析C代码内容"""
+    def parse_content(self, content: str, stats: Optional[AnalysisStats] = None) -> Dict[str, List]:
+        """解析C代码内容，指定 stats 时记录各解析阶段的耗时"""
+        if self.use_lexer:
+            return self._parse_tokens(content, stats)
+        
         # 移除注释
-        content = self._remove_comments(content)
+        with timed(stats, 'strip_comments'):
+            content = self._remove_comments(content)
         
-        # 按行分割
-        lines = content.split('\n')
+        with timed(stats, 'parse'):
+            # 按行分割
+            lines = content.split('\n')
+            
+            result = self._new_result(lines)
+            
+            # 解析各种结构
+            for line_num, line in enumerate(lines, 1):
+                self._parse_line(line, line_num, result)
         
-        result = {
+        return result
+    
+    def _new_result(self, lines: List[str]) -> Dict[str, List]:
+        """创建空的解析结果"""
+        return {
             'variables': [],
             'functions': [],
             'function_calls': [],
@@ -106,13 +279,289 @@ class CCodeParser:
             'includes': [],
             'lines': lines
         }
+    
+    def _parse_tokens(self, content: str, stats: Optional[AnalysisStats] = None) -> Dict[str, List]:
+        """分词后在一次记号遍历中构建解析结果
+
+        与正则路径相比：块注释不再吞掉换行（行号保持不变），
+        字符串字面量中的内容不会被误当作代码匹配。
+        除原有分类外，结果还包含每行的记号 'tokens' 和预匹配结果 'line_facts'。
+        分词与去注释在词法分析器中一次完成，统计中记为 tokenize 阶段。
+        """
+        with timed(stats, 'tokenize'):
+            lines, line_tokens = self.lexer.tokenize(content)
+        
+        with timed(stats, 'parse'):
+            result = self._new_result(lines)
+            result['tokens'] = line_tokens
+            line_facts = result['line_facts'] = [None] * len(lines)
+            
+            walk_line = self._walk_line
+            for line_num, tokens in enumerate(line_tokens, 1):
+                if tokens:
+                    line_facts[line_num - 1] = walk_line(tokens, lines[line_num - 1], line_num, result)
+        
+        return result
+    
+    def parse_buffer(self, buffer, stats: Optional[AnalysisStats] = None) -> Dict[str, List]:
+        """流式解析字节缓冲区（通常是内存映射的文件）
+
+        逐行解码、分词并遍历记号，不保存整份文本、行文本和记号：
+        结果中的 'lines' 是按需读取的 SourceLines，各分类条目的 'line_content' 为 None，
+        报告中的代码片段由检测模块通过 AnalysisContext.get_snippet 在需要时取出。
+        解码、分词和遍历逐行交替进行，统计中整体记为 parse 阶段。
+        """
+        with timed(stats, 'parse'):
+            return self._parse_buffer_lines(buffer)
+    
+    def _parse_buffer_lines(self, buffer) -> Dict[str, List]:
+        lexer = self.lexer
+        lexer.reset()
+        result = self._new_result([])
+        result['tokens'] = ()
+        line_facts = result['line_facts'] = []
+        line_offsets = array('q')
+        comment_states = bytearray()
         
-        # 解析各种结构
-        for line_num, line in enumerate(lines, 1):
-            self._parse_line(line, line_num, result)
+        walk_line = self._walk_line
+        lex_line = lexer.lex_line
+        append_facts = line_facts.append
+        line_num = 0
+        for offset, text in iter_buffer_lines(buffer):
+            line_num += 1
+            line_offsets.append(offset)
+            comment_states.append(lexer.in_block_comment)
+            line, tokens = lex_line(text)
+            if not tokens:
+                append_facts(None)
+                continue
+            facts = walk_line(tokens, line, line_num, result, keep_text=False)
+            append_facts(EMPTY_LINE_FACTS if facts.is_empty() else facts)
+        line_offsets.append(len(buffer) + 1)
         
+        result['lines'] = SourceLines(buffer, line_offsets, comment_states)
         return result
     
+    def _walk_line(self, tokens: List[str], line: str, line_num: int, result: Dict[str, List],
+                   keep_text: bool = True) -> 'LineFacts':
+        """遍历单行记号，按正则路径的语义填充各结果分类，并返回该行的预匹配结果
+
+        keep_text=False 时各分类条目不保存行文本（流式解析使用）。
+        """
+        line_content = line.strip() if keep_text else None
+        count = len(tokens)
+        has_close_paren = ')' in tokens
+        has_semicolon = ';' in tokens
+        facts = LineFacts()
+        facts.is_declaration = has_semicolon and not DECLARATION_KEYWORDS.isdisjoint(tokens)
+        assign_resume = compare_resume = arith_resume = 0
+        loop_type = None
+        loop_condition = ''
+        free_found = scanf_found = printf_found = False
+        
+        for i in range(count):
+            token = tokens[i]
+            if token not in _WALK_TOKENS:
+                # 普通标识符、数值和字符串不触发任何匹配，只需检查头文件包含
+                if token[0] == '#':
+                    match = _HEADER_RE.search(token)
+                    if match:
+                        result['includes'].append({
+                            'header': match.group(1),
+                            'line': line_num,
+                            'line_content': line_content
+                        })
+                continue
+            prev = tokens[i - 1] if i else ''
+            
+            # 比较/算术运算：每条语句只取第一个操作数（与原正则的 [^;]+ 贪婪语义一致）
+            if i and token in OPERATOR_OPS and _is_word(prev):
+                has_operand = len(token) > 1 or (i + 1 < count and tokens[i + 1] != ';')
+                if has_operand:
+                    if token in COMPARISON_OPS and i >= compare_resume:
+                        if prev.isidentifier():
+                            facts.comparisons.append(prev)
+                        compare_resume = _next_semicolon(tokens, i)
+                    elif token in ARITHMETIC_OPS and i >= arith_resume:
+                        if prev.isidentifier():
+                            facts.arithmetic.append(prev)
+                        arith_resume = _next_semicolon(tokens, i)
+                if (token == '+' or token == '-') and prev.isidentifier() \
+                        and i + 1 < count and tokens[i + 1][0].isdigit():
+                    facts.pointer_arithmetic.append(prev)
+            
+            if token in TYPE_KEYWORDS or token == 'struct':
+                self._match_declaration(tokens, i, line, line_num, result)
+            
+            elif token == '(':
+                if i == 0 or not has_close_paren or not prev.isidentifier():
+                    continue
+                name = prev
+                close = find_closing_paren(tokens, i)
+                inner = tokens[i + 1:close] if close > 0 else tokens[i + 1:]
+                if name not in NON_CALL_KEYWORDS:
+                    result['function_calls'].append({
+                        'name': name,
+                        'line': line_num,
+                        'line_content': line_content
+                    })
+                    facts.call_arguments.append((name, [t for t in inner if t.isidentifier()]))
+                if not inner:
+                    continue
+                if name == 'free' and not free_found:
+                    free_found = True
+                    names = [t for t in inner if t.isidentifier()]
+                    result['free_calls'].append({
+                        'variable': names[0] if names else '',
+                        'line': line_num,
+                        'line_content': line_content
+                    })
+                elif name == 'scanf' and not scanf_found:
+                    scanf_found = True
+                    result['scanf_calls'].append({
+                        'arguments': [(t, j > 0 and inner[j - 1] == '&')
+                                      for j, t in enumerate(inner) if t.isidentifier()],
+                        'line': line_num,
+                        'line_content': line_content
+                    })
+                elif name == 'printf' and not printf_found:
+                    printf_found = True
+                    result['printf_calls'].append({
+                        'format_count': _count_format_specifiers(inner),
+                        'argument_count': _count_top_level_commas(inner),
+                        'line': line_num,
+                        'line_content': line_content
+                    })
+                elif name in ('while', 'for') and loop_type != 'while':
+                    if close > i + 1 and close + 1 < count and tokens[close + 1] == '{':
+                        loop_type = name
+                        loop_condition = join_tokens(inner)
+            
+            elif token == '=':
+                if i == 0 or not prev.isidentifier():
+                    continue
+                if (i + 3 < count and tokens[i + 1] == 'malloc' and tokens[i + 2] == '('
+                        and tokens[i + 3] != ')' and has_close_paren):
+                    result['malloc_calls'].append({
+                        'variable': prev,
+                        'line': line_num,
+                        'line_content': line_content
+                    })
+                if i >= assign_resume and has_semicolon:
+                    end = _next_semicolon(tokens, i)
+                    if i + 1 < end < count:
+                        assign_resume = end + 1
+                        value_tokens = tokens[i + 1:end]
+                        # *p = ... 通过指针写入，不是对 p 本身赋值
+                        j = i - 2
+                        while j >= 0 and tokens[j] == '*':
+                            j -= 1
+                        result['assignments'].append({
+                            'variable': prev,
+                            'value': join_tokens(value_tokens),
+                            'identifiers': [t for t in value_tokens if t.isidentifier()],
+                            'through_pointer': j < i - 2 and (j < 0 or not _is_word(tokens[j])),
+                            'line': line_num,
+                            'line_content': line_content
+                        })
+            
+            elif token == '*':
+                if i + 1 < count:
+                    name = tokens[i + 1]
+                    if name.isidentifier() and '*' + name in line:
+                        result['pointer_dereferences'].append({
+                            'pointer': name,
+                            'line': line_num,
+                            'line_content': line_content
+                        })
+            
+            elif token == '[':
+                if prev.isidentifier() and i + 1 < count and tokens[i + 1] != ']' and ']' in tokens[i + 2:]:
+                    facts.array_accesses.append(prev)
+            
+            elif token == '==' or token == '!=':
+                if i + 1 < count and tokens[i + 1] == 'NULL' and prev.isidentifier():
+                    facts.has_null_check = True
+                    facts.null_checks.append(prev)
+            
+            elif token == 'break':
+                if i + 1 < count and tokens[i + 1] == ';':
+                    facts.has_exit = True
+            
+            elif token == 'return':
+                if has_semicolon:
+                    end = _next_semicolon(tokens, i)
+                    if end < count:
+                        facts.has_exit = True
+                        if '*' in tokens[i + 1:end]:
+                            facts.has_pointer_return = True
+            
+            elif token == 'do':
+                if not loop_type and i + 1 < count and tokens[i + 1] == '{':
+                    loop_type = 'do-while'
+            
+            elif token == '{':
+                facts.brace_delta += 1
+            
+            elif token == '}':
+                facts.brace_delta -= 1
+                facts.has_close_brace = True
+        
+        # 只有含控制关键字、大括号、未配对括号或以 ')' 结尾（函数头）的行才需要控制流事件
+        if tokens[0][0] == '#':
+            facts.control = DIRECTIVE_EVENTS
+        elif (not _STRUCTURE_TOKENS.isdisjoint(tokens) or tokens[-1] == ')'
+              or (has_close_paren or '(' in tokens) and tokens.count('(') != tokens.count(')')):
+            facts.control = _control_events(tokens)
+        
+        if loop_type:
+            result['loops'].append({
+                'type': loop_type,
+                'condition': loop_condition,
+                'line': line_num,
+                'line_content': line_content
+            })
+        
+        return facts
+    
+    def _match_declaration(self, tokens: List[str], i: int, line: str, line_num: int, result: Dict[str, List]):
+        """在类型关键字处匹配变量声明、指针声明和函数定义"""
+        count = len(tokens)
+        if tokens[i] == 'struct':
+            if i + 1 >= count or not tokens[i + 1].isidentifier():
+                return
+            type_name = 'struct ' + tokens[i + 1]
+            j = i + 2
+        else:
+            type_name = tokens[i]
+            j = i + 1
+        
+        is_pointer = j < count and tokens[j] == '*'
+        if is_pointer:
+            j += 1
+        if j >= count or not tokens[j].isidentifier():
+            return
+        name = tokens[j]
+        
+        following = tokens[j + 1] if j + 1 < count else None
+        if following == ';' or (following == '=' and ';' in tokens[j + 3:]):
+            result['variables'].append(VariableInfo(
+                name=name,
+                type=type_name,
+                line_number=line_num,
+                is_initialized='=' in line,
+                is_pointer=is_pointer
+            ))
+        elif following == '(' and not is_pointer:
+            close = find_closing_paren(tokens, j + 1)
+            if close > 0 and close + 1 < count and tokens[close + 1] == '{':
+                result['functions'].append(FunctionInfo(
+                    name=name,
+                    return_type=type_name,
+                    parameters=[],  # 简化处理，不解析参数
+                    line_number=line_num
+                ))
+    
     def _remove_comments(self, content: str) -> str:
         """移除注释"""
         # 移除单行注释
@@ -122,9 +571,17 @@ class CCodeParser:
         return content
     
     def _parse_line(self, line: str, line_num: int, result: Dict[str, List]):
-        """解析单行代码"""
+        """解析单行代码
+
+        先按行特征位图跳过不可能匹配的模式，大多数行只需运行其中少数几个正则表达式。
+        """
+        features = line_features(line)
+        if not features:
+            return
+        has_type = features & (TYPE | STRUCT)
+        
         # 变量声明
-        var_matches = self.patterns['variable_declaration'].findall(line)
+        var_matches = self.patterns['variable_declaration'].findall(line) if has_type and features & SEMICOLON else ()
         for var_type, var_name in var_matches:
             result['variables'].append(VariableInfo(
                 name=var_name,
@@ -135,7 +592,8 @@ class CCodeParser:
             ))
         
         # 指针声明
-        ptr_matches = self.patterns['pointer_declaration'].findall(line)
+        ptr_matches = (self.patterns['pointer_declaration'].findall(line)
+                       if has_type and has_all(features, SEMICOLON | STAR) else ())
         for ptr_type, ptr_name in ptr_matches:
             result['variables'].append(VariableInfo(
                 name=ptr_name,
@@ -146,7 +604,8 @@ class CCodeParser:
             ))
         
         # 函数定义
-        func_matches = self.patterns['function_definition'].findall(line)
+        func_matches = (self.patterns['function_definition'].findall(line)
+                        if has_type and has_all(features, PAREN | BRACE) else ())
         for return_type, func_name in func_matches:
             result['functions'].append(FunctionInfo(
                 name=func_name,
@@ -156,7 +615,7 @@ class CCodeParser:
             ))
         
         # 函数调用
-        call_matches = self.patterns['function_call'].findall(line)
+        call_matches = self.patterns['function_call'].findall(line) if features & PAREN else ()
         for func_name in call_matches:
             # 过滤掉关键字和类型名
             if func_name not in ['int', 'char', 'float', 'double', 'long', 'short', 'unsigned', 'signed', 'void', 'if', 'while', 'for', 'do', 'return', 'break', 'continue']:
@@ -167,7 +626,8 @@ class CCodeParser:
                 })
         
         # 赋值语句
-        assign_matches = self.patterns['assignment'].findall(line)
+        assign_matches = (self.patterns['assignment'].findall(line)
+                          if has_all(features, ASSIGN | SEMICOLON) else ())
         for var_name, value in assign_matches:
             result['assignments'].append({
                 'variable': var_name,
@@ -177,7 +637,7 @@ class CCodeParser:
             })
         
         # 指针解引用
-        deref_matches = self.patterns['pointer_dereference'].findall(line)
+        deref_matches = self.patterns['pointer_dereference'].findall(line) if features & STAR else ()
         for ptr_name in deref_matches:
             result['pointer_dereferences'].append({
                 'pointer': ptr_name,
@@ -186,7 +646,8 @@ class CCodeParser:
             })
         
         # malloc调用
-        malloc_matches = self.patterns['malloc_call'].findall(line)
+        malloc_matches = (self.patterns['malloc_call'].findall(line)
+                          if has_all(features, ALLOC | ASSIGN | PAREN) else ())
         for var_name in malloc_matches:
             result['malloc_calls'].append({
                 'variable': var_name,
@@ -195,40 +656,40 @@ class CCodeParser:
             })
         
         # free调用
-        if self.patterns['free_call'].search(line):
+        if has_all(features, FREE | PAREN) and self.patterns['free_call'].search(line):
             result['free_calls'].append({
                 'line': line_num,
                 'line_content': line.strip()
             })
         
         # scanf调用
-        if self.patterns['scanf_call'].search(line):
+        if has_all(features, SCANF | PAREN) and self.patterns['scanf_call'].search(line):
             result['scanf_calls'].append({
                 'line': line_num,
                 'line_content': line.strip()
             })
         
         # printf调用
-        if self.patterns['printf_call'].search(line):
+        if has_all(features, PRINTF | PAREN) and self.patterns['printf_call'].search(line):
             result['printf_calls'].append({
                 'line': line_num,
                 'line_content': line.strip()
             })
         
         # 循环结构
-        if self.patterns['while_loop'].search(line):
+        if has_all(features, WHILE | PAREN | BRACE) and self.patterns['while_loop'].search(line):
             result['loops'].append({
                 'type': 'while',
                 'line': line_num,
                 'line_content': line.strip()
             })
-        elif self.patterns['for_loop'].search(line):
+        elif has_all(features, FOR | PAREN | BRACE) and self.patterns['for_loop'].search(line):
             result['loops'].append({
                 'type': 'for',
                 'line': line_num,
                 'line_content': line.strip()
             })
-        elif self.patterns['do_while_loop'].search(line):
+        elif has_all(features, DO | BRACE) and self.patterns['do_while_loop'].search(line):
             result['loops'].append({
                 'type': 'do-while',
                 'line': line_num,
@@ -236,7 +697,7 @@ class CCodeParser:
             })
         
         # 头文件包含
-        include_matches = self.patterns['include'].findall(line)
+        include_matches = self.patterns['include'].findall(line) if features & INCLUDE else ()
         for header in include_matches:
             result['includes'].append({
                 'header': header,
@@ -0,0 +1,209 @@
+"""
+紧凑报告格式 - 模板和字符串各存一份，每个报告只保存编号，用于结果缓存、命令行输出和守护进程协议
+"""
+import json
+from typing import Any, Dict, Iterable, Iterator, List, Optional, Tuple, TextIO
+
+from utils.error_reporter import REPORT_TEMPLATES, BugReport, ErrorType, Severity
+from utils.instrumentation import AnalysisStats, timed
+
+# 紧凑格式的版本，字段含义变化时需要更新
+COMPACT_VERSION = 1
+
+# 错误类型和严重程度的编号即在下列表中的位置（枚举定义顺序，新成员只能追加在末尾）
+ERROR_TYPES: List[ErrorType] = list(ErrorType)
+SEVERITIES: List[Severity] = list(Severity)
+_ERROR_TYPE_CODES = {error_type: code for code, error_type in enumerate(ERROR_TYPES)}
+_SEVERITY_CODES = {severity: code for code, severity in enumerate(SEVERITIES)}
+
+# 报告行中的标志位
+FLAG_PARTIAL = 1
+
+
+class ReportArena:
+    """紧凑的报告存储
+
+    模板为 [名称, 错误类型编号, 严重程度编号, 模块名称, 消息, 建议]，不是按模板生成的报告
+    （template 为 None）以其完整的消息和建议作为一个名称为 null、没有参数的模板；
+    字符串表保存模板参数和代码片段。每个报告是一行 [行号, 模板编号, 代码片段编号, 标志, 参数编号...]，
+    没有代码片段时编号为 -1。
+    """
+
+    def __init__(self):
+        self.templates: List[List[Any]] = []
+        self.strings: List[str] = []
+        self._template_ids: Dict[Tuple, int] = {}
+        self._string_ids: Dict[str, int] = {}
+        self._sent_templates = 0
+
+    def template_id(self, report: BugReport) -> int:
+        """报告所属模板的编号，首次出现的模板追加到模板表"""
+        if report.template is not None:
+            key = (report.template, report.module_name)
+        else:
+            key = (None, report.error_type, report.severity, report.module_name, report.message, report.suggestion)
+        template_id = self._template_ids.get(key)
+        if template_id is None:
+            if report.template is not None:
+                template = REPORT_TEMPLATES[report.template]
+                message, suggestion = template.message, template.suggestion
+            else:
+                message, suggestion = report.message, report.suggestion
+            template_id = len(self.templates)
+            self.templates.append([report.template, _ERROR_TYPE_CODES[report.error_type],
+                                   _SEVERITY_CODES[report.severity], report.module_name, message, suggestion])
+            self._template_ids[key] = template_id
+        return template_id
+
+    def string_id(self, text: str) -> int:
+        string_id = self._string_ids.get(text)
+        if string_id is None:
+            string_id = len(self.strings)
+            self.strings.append(text)
+            self._string_ids[text] = string_id
+        return string_id
+
+    def encode(self, report: BugReport) -> List[int]:
+        """把报告编码为一行整数"""
+        row = [report.line_number, self.template_id(report),
+               self.string_id(report.code_snippet) if report.code_snippet else -1,
+               FLAG_PARTIAL if report.partial else 0]
+        row.extend(self.string_id(arg) for arg in report.args)
+        return row
+
+    def decode(self, row: List[int]) -> BugReport:
+        """由一行整数还原报告"""
+        name, error_type, severity, module_name, message, suggestion = self.templates[row[1]]
+        args = tuple(self.strings[index] for index in row[4:])
+        if name is not None:
+            message, suggestion = message.format(*args), suggestion.format(*args)
+        return BugReport(
+            line_number=row[0],
+            error_type=ERROR_TYPES[error_type],
+            severity=SEVERITIES[severity],
+            message=message,
+            suggestion=suggestion,
+            code_snippet=self.strings[row[2]] if row[2] >= 0 else '',
+            module_name=module_name,
+            partial=bool(row[3] & FLAG_PARTIAL),
+            template=name,
+            args=args
+        )
+
+    def new_templates(self) -> List[List[Any]]:
+        """上次调用之后新增的模板（流式输出时每个模板只发送一次）"""
+        templates = self.templates[self._sent_templates:]
+        self._sent_templates = len(self.templates)
+        return templates
+
+    def take_strings(self) -> List[str]:
+        """取出并清空字符串表（流式输出时每条记录带自己的字符串表）"""
+        strings = self.strings
+        self.strings = []
+        self._string_ids = {}
+        return strings
+
+    def to_dict(self, reports: Iterable[BugReport]) -> Dict[str, Any]:
+        """编码为自包含的字典（模板、字符串和报告行）"""
+        rows = [self.encode(report) for report in reports]
+        return {'templates': self.templates, 'strings': self.strings, 'reports': rows}
+
+    @classmethod
+    def from_dict(cls, data: Dict[str, Any]) -> List[BugReport]:
+        """由 to_dict 的结果还原报告列表"""
+        arena = cls()
+        arena.templates = data['templates']
+        arena.strings = data['strings']
+        return [arena.decode(row) for row in data['reports']]
+
+
+def compact_header(detector_version: str) -> Dict[str, Any]:
+    """紧凑格式的头部：版本和编号表"""
+    return {
+        'type': 'header',
+        'version': COMPACT_VERSION,
+        'detector_version': detector_version,
+        'error_types': [error_type.value for error_type in ERROR_TYPES],
+        'severities': [severity.value for severity in SEVERITIES],
+    }
+
+
+def dumps_compact(data: Any) -> str:
+    """不缩进、不转义非ASCII字符的JSON"""
+    return json.dumps(data, ensure_ascii=False, separators=(',', ':'))
+
+
+class CompactStreamWriter:
+    """逐文件输出的 NDJSON 报告流
+
+    第一行为头部（compact_header），之后每个文件一行 {"type": "file", "file": ..., "templates": [...],
+    "strings": [...], "reports": [...]}，templates 为本行之前未出现过的模板（编号接着之前的模板），
+    最后一行为 {"type": "summary", "files": N, "reports": M}，由 StreamingReporter 关闭时还带有
+    ReportSummary.to_dict() 中的其余字段（按严重程度、模块的计数和问题最多的文件）。
+    """
+
+    def __init__(self, output: TextIO, detector_version: str):
+        self.output = output
+        self.arena = ReportArena()
+        self.files = 0
+        self.reports = 0
+        self._write(compact_header(detector_version))
+
+    def write_file(self, file_path: str, reports: List[BugReport], stats: Optional[AnalysisStats] = None):
+        """输出一个文件的记录，指定 stats 时编码耗时记为 format 阶段并附带统计"""
+        record = encode_file_record(self.arena, file_path, reports, stats)
+        record = {'type': 'file', 'file': file_path, 'templates': self.arena.new_templates(), **record}
+        self._write(record)
+        self.files += 1
+        self.reports += len(reports)
+
+    def close(self, summary=None):
+        record = {'type': 'summary', 'files': self.files, 'reports': self.reports}
+        if summary is not None:
+            record.update({key: value for key, value in summary.to_dict().items() if key not in record})
+        self._write(record)
+
+    def _write(self, record: Dict[str, Any]):
+        self.output.write(dumps_compact(record) + '\n')
+        self.output.flush()
+
+
+def encode_file_record(arena: ReportArena, file_path: str, reports: List[BugReport],
+                       stats: Optional[AnalysisStats]) -> Dict[str, Any]:
+    """编码一个文件的报告：{"file": ..., "strings": [...], "reports": [...], "stats": {...}}"""
+    if stats is not None:
+        # 同一份报告可能格式化多次，只保留最近一次的耗时
+        stats.phases.pop('format', None)
+    with timed(stats, 'format'):
+        rows = [arena.encode(report) for report in reports]
+    record = {'file': file_path, 'strings': arena.take_strings(), 'reports': rows}
+    if stats is not None:
+        record['stats'] = stats.to_dict()
+    return record
+
+
+def compact_document(detector_version: str,
+                     files: Iterable[Tuple[str, List[BugReport], Optional[AnalysisStats]]]) -> str:
+    """整体输出的紧凑格式：头部字段加上所有模板和每个文件的记录（记录中不再带 templates）"""
+    arena = ReportArena()
+    records = [encode_file_record(arena, file_path, reports, stats) for file_path, reports, stats in files]
+    document = compact_header(detector_version)
+    del document['type']
+    document['templates'] = arena.templates
+    document['files'] = records
+    return dumps_compact(document)
+
+
+def read_compact_stream(lines: Iterable[str]) -> Iterator[Tuple[str, List[BugReport]]]:
+    """读取 CompactStreamWriter 写出的报告流，逐文件返回 (文件路径, 报告列表)"""
+    arena = ReportArena()
+    for line in lines:
+        line = line.strip()
+        if not line:
+            continue
+        record = json.loads(line)
+        if record.get('type') != 'file':
+            continue
+        arena.templates.extend(record['templates'])
+        arena.strings = record['strings']
+        yield record['file'], [arena.decode(row) for row in record['reports']]
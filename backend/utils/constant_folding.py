@@ -0,0 +1,541 @@
+"""
+常量折叠 - 按C语言的优先级、类型宽度和算术转换规则对常量表达式求值
+
+表达式先解析为由元组构成的语法树（可哈希，用作缓存键），再自底向上求值：
+有符号整数运算保留数学上的结果（溢出正是要报告的问题），无符号运算按类型宽度回绕，
+强制类型转换按目标类型截断。整数宽度按 LP64（int 32 位，long 和 long long 64 位）。
+"""
+import re
+from dataclasses import dataclass
+from typing import Callable, Dict, List, Optional, Sequence, Set, Tuple, Union
+
+from utils.code_parser import DIRECTIVE_EVENTS, LineFacts
+
+
+@dataclass(frozen=True)
+class CType:
+    """算术类型：floating 为浮点类型，rank 为整数转换等级（浮点类型按精度排列）"""
+    name: str
+    bits: int
+    signed: bool
+    rank: int
+    floating: bool = False
+
+    @property
+    def min_value(self) -> int:
+        return -(1 << (self.bits - 1)) if self.signed else 0
+
+    @property
+    def max_value(self) -> int:
+        return (1 << (self.bits - 1)) - 1 if self.signed else (1 << self.bits) - 1
+
+
+CHAR = CType('char', 8, True, 1)
+UCHAR = CType('unsigned char', 8, False, 1)
+SHORT = CType('short', 16, True, 2)
+USHORT = CType('unsigned short', 16, False, 2)
+INT = CType('int', 32, True, 3)
+UINT = CType('unsigned int', 32, False, 3)
+LONG = CType('long', 64, True, 4)
+ULONG = CType('unsigned long', 64, False, 4)
+LLONG = CType('long long', 64, True, 5)
+ULLONG = CType('unsigned long long', 64, False, 5)
+FLOAT = CType('float', 32, True, 1, floating=True)
+DOUBLE = CType('double', 64, True, 2, floating=True)
+
+# 类型说明符组合（排序后的关键字）-> 类型
+_TYPE_SPECIFIERS: Dict[Tuple[str, ...], CType] = {}
+for _ctype, _spellings in (
+        (CHAR, ['char', 'signed char']), (UCHAR, ['unsigned char']),
+        (SHORT, ['short', 'short int', 'signed short', 'signed short int']),
+        (USHORT, ['unsigned short', 'unsigned short int']),
+        (INT, ['int', 'signed', 'signed int']), (UINT, ['unsigned', 'unsigned int']),
+        (LONG, ['long', 'long int', 'signed long', 'signed long int']),
+        (ULONG, ['unsigned long', 'unsigned long int']),
+        (LLONG, ['long long', 'long long int', 'signed long long', 'signed long long int']),
+        (ULLONG, ['unsigned long long', 'unsigned long long int']),
+        (FLOAT, ['float']), (DOUBLE, ['double', 'long double'])):
+    for _spelling in _spellings:
+        _TYPE_SPECIFIERS[tuple(sorted(_spelling.split()))] = _ctype
+_TYPE_WORDS = frozenset(word for spelling in _TYPE_SPECIFIERS for word in spelling) | frozenset(['const'])
+# 声明中可以出现在类型说明符之间的其他关键字
+_DECLARATION_WORDS = _TYPE_WORDS | frozenset(['static', 'volatile', 'register', 'extern', 'auto'])
+
+# sizeof 的结果类型与指针宽度
+SIZE_TYPE = ULONG
+POINTER_BYTES = 8
+
+# 整数字面量的候选类型（按顺序取第一个能表示该值的类型）
+_DECIMAL_CANDIDATES = {
+    '': (INT, LONG, LLONG), 'u': (UINT, ULONG, ULLONG),
+    'l': (LONG, LLONG), 'ul': (ULONG, ULLONG), 'll': (LLONG,), 'ull': (ULLONG,),
+}
+_OTHER_CANDIDATES = {
+    '': (INT, UINT, LONG, ULONG, LLONG, ULLONG), 'u': (UINT, ULONG, ULLONG),
+    'l': (LONG, ULONG, LLONG, ULLONG), 'ul': (ULONG, ULLONG), 'll': (LLONG, ULLONG), 'ull': (ULLONG,),
+}
+_INTEGER_RE = re.compile(r'(0[xX][0-9a-fA-F]+|0[bB][01]+|0[0-7]*|[1-9][0-9]*)([uUlL]*)$')
+_FLOAT_RE = re.compile(r'(?:[0-9]+\.[0-9]*|\.[0-9]+|[0-9]+(?=[eE]))(?:[eE][+-]?[0-9]+)?([fFlL]?)$')
+_CHAR_ESCAPES = {'n': 10, 't': 9, 'r': 13, '0': 0, 'a': 7, 'b': 8, 'f': 12, 'v': 11,
+                 '\\': 92, "'": 39, '"': 34, '?': 63}
+
+# 二元运算符的绑定强度（越大越紧）
+_BINARY_PRECEDENCE = {
+    '||': 4, '&&': 5, '|': 6, '^': 7, '&': 8, '==': 9, '!=': 9,
+    '<': 10, '>': 10, '<=': 10, '>=': 10, '<<': 11, '>>': 11,
+    '+': 12, '-': 12, '*': 13, '/': 13, '%': 13,
+}
+_CONDITIONAL_PRECEDENCE = 3
+_UNARY_OPS = frozenset(['+', '-', '~', '!'])
+
+# <stdbool.h> 中的 true/false（文件中没有重新定义时）
+_BOOL_CONSTANTS = {'true': 1, 'false': 0}
+# 常量表达式中可以出现的非宏标识符
+_CONSTANT_WORDS = _TYPE_WORDS | frozenset(['sizeof']) | frozenset(_BOOL_CONSTANTS)
+
+Number = Union[int, float]
+Value = Tuple[Number, CType]
+# 语法树节点：('num', 记号) | ('name', 名称) | ('unary', 运算符, 子树) | ('binary', 运算符, 左, 右)
+#           | ('cast', 类型, 子树) | ('cond', 条件, 真分支, 假分支) | ('sizeof', 字节数)
+Node = tuple
+
+
+class _NotConstant(Exception):
+    """记号序列不是能够解析的常量表达式"""
+
+
+def type_from_specifiers(words: Sequence[str]) -> Optional[CType]:
+    """由类型说明符（如 ['unsigned', 'long']）得到类型，不是算术类型时返回 None"""
+    key = tuple(sorted(word for word in words if word != 'const'))
+    return _TYPE_SPECIFIERS.get(key)
+
+
+def declared_type(tokens: Sequence[str], name: str) -> Optional[CType]:
+    """声明行中紧接在变量名之前的类型说明符所表示的类型（如 unsigned char c 中的 unsigned char）"""
+    for i, token in enumerate(tokens):
+        if token != name:
+            continue
+        start = i
+        while start > 0 and tokens[start - 1] in _DECLARATION_WORDS:
+            start -= 1
+        if start < i:
+            return type_from_specifiers([word for word in tokens[start:i] if word in _TYPE_WORDS])
+    return None
+
+
+def parse_literal(token: str) -> Optional[Value]:
+    """解析数值或字符字面量记号"""
+    if token[0] == "'":
+        value = _char_value(token)
+        return (value, INT) if value is not None else None
+    match = _INTEGER_RE.match(token)
+    if match:
+        digits, suffix = match.groups()
+        suffix = suffix.lower()
+        if digits[:2] in ('0x', '0X'):
+            value = int(digits[2:], 16)
+        elif digits[:2] in ('0b', '0B'):
+            value = int(digits[2:], 2)
+        elif len(digits) > 1 and digits[0] == '0':
+            value = int(digits, 8)
+        else:
+            value = int(digits)
+        key = ''.join(sorted(suffix, key=lambda c: c != 'u'))
+        table = _DECIMAL_CANDIDATES if digits[0] != '0' or digits == '0' else _OTHER_CANDIDATES
+        candidates = table.get(key)
+        if candidates is None:
+            return None
+        for ctype in candidates:
+            if value <= ctype.max_value:
+                return value, ctype
+        return None
+    match = _FLOAT_RE.match(token)
+    if match:
+        try:
+            value = float(token.rstrip('fFlL'))
+        except ValueError:
+            return None
+        return value, FLOAT if match.group(1) in ('f', 'F') else DOUBLE
+    return None
+
+
+def _char_value(token: str) -> Optional[int]:
+    """单字符字面量的值（按有符号 char 转换为 int）"""
+    body = token[1:-1] if len(token) >= 3 and token[-1] == "'" else None
+    if not body:
+        return None
+    if body[0] != '\\':
+        if len(body) != 1:
+            return None
+        value = ord(body)
+    elif len(body) == 2 and body[1] in _CHAR_ESCAPES:
+        value = _CHAR_ESCAPES[body[1]]
+    elif body[1] == 'x' and len(body) > 2:
+        try:
+            value = int(body[2:], 16)
+        except ValueError:
+            return None
+    elif body[1:].isdigit() and len(body) <= 4:
+        try:
+            value = int(body[1:], 8)
+        except ValueError:
+            return None
+    else:
+        return None
+    return convert(value, CHAR) if value < 256 else None
+
+
+def convert(value: Number, ctype: CType) -> Optional[Number]:
+    """把值转换为指定类型（强制类型转换或赋值的语义），结果无定义时返回 None"""
+    if ctype.floating:
+        return float(value)
+    if isinstance(value, float):
+        if value != value or value in (float('inf'), float('-inf')):
+            return None
+        value = int(value)
+        if not ctype.min_value <= value <= ctype.max_value:
+            return None
+        return value
+    value &= (1 << ctype.bits) - 1
+    if ctype.signed and value > ctype.max_value:
+        value -= 1 << ctype.bits
+    return value
+
+
+def _promote(ctype: CType) -> CType:
+    """整数提升"""
+    return INT if not ctype.floating and ctype.rank < INT.rank else ctype
+
+
+def _common_type(left: CType, right: CType) -> CType:
+    """一般算术转换"""
+    if left.floating or right.floating:
+        if left.floating and right.floating:
+            return left if left.rank >= right.rank else right
+        return left if left.floating else right
+    left, right = _promote(left), _promote(right)
+    if left == right:
+        return left
+    if left.signed == right.signed:
+        return left if left.rank >= right.rank else right
+    unsigned, signed = (left, right) if not left.signed else (right, left)
+    if unsigned.rank >= signed.rank:
+        return unsigned
+    if signed.bits > unsigned.bits:
+        return signed
+    return next(ctype for ctype in (UINT, ULONG, ULLONG) if ctype.rank == signed.rank)
+
+
+def _normalize(value: Number, ctype: CType) -> Number:
+    """运算结果按类型规范化：无符号整数回绕，有符号整数保留数学结果"""
+    if ctype.floating:
+        return float(value)
+    if not ctype.signed:
+        return value & ((1 << ctype.bits) - 1)
+    return value
+
+
+class _Parser:
+    """常量表达式的优先级爬升解析器"""
+
+    def __init__(self, tokens: Sequence[str]):
+        self.tokens = tokens
+        self.pos = 0
+
+    def parse(self) -> Node:
+        node = self.expression(_CONDITIONAL_PRECEDENCE)
+        if self.pos != len(self.tokens):
+            raise _NotConstant()
+        return node
+
+    def peek(self) -> str:
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else ''
+
+    def take(self, expected: Optional[str] = None) -> str:
+        token = self.peek()
+        if not token or (expected is not None and token != expected):
+            raise _NotConstant()
+        self.pos += 1
+        return token
+
+    def expression(self, min_precedence: int) -> Node:
+        left = self.unary()
+        while True:
+            token = self.peek()
+            if token == '?' and min_precedence <= _CONDITIONAL_PRECEDENCE:
+                self.pos += 1
+                then = self.expression(_CONDITIONAL_PRECEDENCE)
+                self.take(':')
+                otherwise = self.expression(_CONDITIONAL_PRECEDENCE)
+                left = ('cond', left, then, otherwise)
+                continue
+            precedence = _BINARY_PRECEDENCE.get(token)
+            if precedence is None or precedence < min_precedence:
+                return left
+            self.pos += 1
+            left = ('binary', token, left, self.expression(precedence + 1))
+
+    def unary(self) -> Node:
+        token = self.take()
+        if token in _UNARY_OPS:
+            return ('unary', token, self.unary())
+        if token == 'sizeof':
+            return self.sizeof()
+        if token == '(':
+            ctype = self.type_name()
+            if ctype is not None:
+                return ('cast', ctype, self.unary())
+            node = self.expression(_CONDITIONAL_PRECEDENCE)
+            self.take(')')
+            return node
+        if token[0].isdigit() or token[0] == '.' or token[0] == "'":
+            return ('num', token)
+        if token.isidentifier() and self.peek() != '(':
+            return ('name', token)
+        raise _NotConstant()
+
+    def type_name(self) -> Optional[CType]:
+        """'(' 之后是类型名时读到 ')'，返回类型（指针类型返回 None 并视为非常量）"""
+        end = self.pos
+        while end < len(self.tokens) and self.tokens[end] in _TYPE_WORDS:
+            end += 1
+        if end == self.pos:
+            return None
+        if end >= len(self.tokens) or self.tokens[end] != ')':
+            raise _NotConstant()
+        ctype = type_from_specifiers(self.tokens[self.pos:end])
+        if ctype is None:
+            raise _NotConstant()
+        self.pos = end + 1
+        return ctype
+
+    def sizeof(self) -> Node:
+        """sizeof(类型) 与 sizeof(类型 *)"""
+        self.take('(')
+        end = self.pos
+        while end < len(self.tokens) and self.tokens[end] in _TYPE_WORDS:
+            end += 1
+        ctype = type_from_specifiers(self.tokens[self.pos:end]) if end > self.pos else None
+        if ctype is None:
+            raise _NotConstant()
+        pointer = False
+        while end < len(self.tokens) and self.tokens[end] == '*':
+            pointer = True
+            end += 1
+        self.pos = end
+        self.take(')')
+        return ('sizeof', POINTER_BYTES if pointer else ctype.bits // 8)
+
+
+class ConstantFolder:
+    """一个文件的常量表达式求值器
+
+    记号序列到语法树、语法树节点到值的结果都被缓存，同一表达式（或公共子表达式）只求值一次。
+    文件中的对象式宏（#define NAME 表达式）在第一次遇到标识符时一次性收集，其值同样按节点缓存；
+    递归定义的宏和其他标识符不是常量。
+    """
+
+    def __init__(self, line_facts: Sequence[Optional[LineFacts]], get_tokens: Callable[[int], Sequence[str]],
+                 get_line: Callable[[int], str]):
+        self._line_facts = line_facts
+        self._get_tokens = get_tokens
+        self._get_line = get_line
+        self._macros: Optional[Dict[str, Tuple[str, ...]]] = None
+        self._trees: Dict[Tuple[str, ...], Optional[Node]] = {}
+        self._values: Dict[Node, Optional[Value]] = {}
+        self._expanding: Set[str] = set()
+        self.evaluations = 0
+
+    def may_be_constant(self, identifiers: Sequence[str]) -> bool:
+        """表达式中的标识符是否都可能出现在常量表达式中（宏、类型名、sizeof、true/false）"""
+        macros = None
+        for name in identifiers:
+            if name in _CONSTANT_WORDS:
+                continue
+            if macros is None:
+                macros = self.macros()
+            if name not in macros:
+                return False
+        return True
+
+    def evaluate(self, tokens: Sequence[str]) -> Optional[Value]:
+        """对记号序列求值，返回 (值, 类型)；不是常量表达式时返回 None"""
+        tree = self.parse(tuple(tokens))
+        return self._value(tree) if tree is not None else None
+
+    def parse(self, tokens: Tuple[str, ...]) -> Optional[Node]:
+        if tokens in self._trees:
+            return self._trees[tokens]
+        try:
+            tree = _Parser(tokens).parse() if tokens else None
+        except _NotConstant:
+            tree = None
+        self._trees[tokens] = tree
+        return tree
+
+    def macros(self) -> Dict[str, Tuple[str, ...]]:
+        """文件中对象式宏的替换记号（后出现的定义覆盖先前的定义，#undef 删除定义）"""
+        if self._macros is None:
+            macros: Dict[str, Tuple[str, ...]] = {}
+            for line_num, facts in enumerate(self._line_facts, 1):
+                if facts is None or facts.control is not DIRECTIVE_EVENTS:
+                    continue
+                tokens = self._get_tokens(line_num)
+                if len(tokens) < 3 or tokens[0] != '#' or not tokens[2].isidentifier():
+                    continue
+                name = tokens[2]
+                if tokens[1] == 'undef':
+                    macros.pop(name, None)
+                elif tokens[1] == 'define':
+                    line = self._get_line(line_num)
+                    end = line.find(name, line.find('define') + 6) + len(name)
+                    if line[end:end + 1] == '(':
+                        # 函数式宏
+                        macros.pop(name, None)
+                    else:
+                        macros[name] = tuple(tokens[3:])
+            self._macros = macros
+        return self._macros
+
+    def _value(self, node: Node) -> Optional[Value]:
+        if node in self._values:
+            return self._values[node]
+        self.evaluations += 1
+        result = self._compute(node)
+        self._values[node] = result
+        return result
+
+    def _compute(self, node: Node) -> Optional[Value]:
+        kind = node[0]
+        if kind == 'num':
+            return parse_literal(node[1])
+        if kind == 'name':
+            return self._macro_value(node[1])
+        if kind == 'sizeof':
+            return node[1], SIZE_TYPE
+        if kind == 'cast':
+            operand = self._value(node[2])
+            if operand is None:
+                return None
+            value = convert(operand[0], node[1])
+            return (value, node[1]) if value is not None else None
+        if kind == 'unary':
+            return self._unary(node[1], node[2])
+        if kind == 'cond':
+            condition = self._value(node[1])
+            if condition is None:
+                return None
+            then, otherwise = self._value(node[2]), self._value(node[3])
+            if then is None or otherwise is None:
+                return None
+            ctype = _common_type(then[1], otherwise[1])
+            chosen = then if condition[0] else otherwise
+            return _normalize(chosen[0], ctype), ctype
+        return self._binary(node[1], node[2], node[3])
+
+    def _macro_value(self, name: str) -> Optional[Value]:
+        body = self.macros().get(name)
+        if body is None and name in _BOOL_CONSTANTS:
+            return _BOOL_CONSTANTS[name], INT
+        if not body or name in self._expanding:
+            return None
+        tree = self.parse(body)
+        if tree is None:
+            return None
+        self._expanding.add(name)
+        try:
+            return self._value(tree)
+        finally:
+            self._expanding.discard(name)
+
+    def _unary(self, op: str, child: Node) -> Optional[Value]:
+        operand = self._value(child)
+        if operand is None:
+            return None
+        value, ctype = operand
+        if op == '!':
+            return int(not value), INT
+        if ctype.floating:
+            if op == '~':
+                return None
+            return (-value if op == '-' else value), ctype
+        ctype = _promote(ctype)
+        if op == '-':
+            value = -value
+        elif op == '~':
+            value = ~value if ctype.signed else ~value & ((1 << ctype.bits) - 1)
+        return _normalize(value, ctype), ctype
+
+    def _binary(self, op: str, left_node: Node, right_node: Node) -> Optional[Value]:
+        left = self._value(left_node)
+        if op in ('&&', '||'):
+            # 短路求值：决定结果的一侧之外不要求是常量
+            if left is not None and bool(left[0]) == (op == '||'):
+                return int(op == '||'), INT
+            right = self._value(right_node)
+            if left is None or right is None:
+                return None
+            return int(bool(right[0])), INT
+        right = self._value(right_node)
+        if left is None or right is None:
+            return None
+        (a, left_type), (b, right_type) = left, right
+        if op in ('<<', '>>'):
+            ctype = _promote(left_type)
+            if ctype.floating or right_type.floating or not 0 <= b < ctype.bits or (ctype.signed and a < 0):
+                return None
+            return _normalize(a << b if op == '<<' else a >> b, ctype), ctype
+        ctype = _common_type(left_type, right_type)
+        a, b = _normalize(a, ctype), _normalize(b, ctype)
+        if op in ('==', '!=', '<', '>', '<=', '>='):
+            result = {'==': a == b, '!=': a != b, '<': a < b, '>': a > b, '<=': a <= b, '>=': a >= b}[op]
+            return int(result), INT
+        if op in ('&', '|', '^', '%') and ctype.floating:
+            return None
+        if op == '+':
+            value = a + b
+        elif op == '-':
+            value = a - b
+        elif op == '*':
+            value = a * b
+        elif op in ('/', '%'):
+            if b == 0:
+                return None
+            if ctype.floating:
+                value = a / b
+            else:
+                # C 的整数除法向零截断
+                quotient = abs(a) // abs(b)
+                quotient = quotient if (a < 0) == (b < 0) else -quotient
+                value = quotient if op == '/' else a - quotient * b
+        elif op == '&':
+            value = a & b
+        elif op == '|':
+            value = a | b
+        else:
+            value = a ^ b
+        return _normalize(value, ctype), ctype
+
+
+def assignment_values(tokens: Sequence[str], variable: str) -> List[Tuple[str, ...]]:
+    """一行记号中对 variable 的每次赋值（'=' 之后到顶层的 ',' 或 ';' 为止）的右侧记号"""
+    values: List[Tuple[str, ...]] = []
+    count = len(tokens)
+    for i in range(1, count):
+        if tokens[i] != '=' or tokens[i - 1] != variable:
+            continue
+        depth = 0
+        end = i + 1
+        while end < count:
+            token = tokens[end]
+            if token in ('(', '[', '{'):
+                depth += 1
+            elif token in (')', ']', '}'):
+                if depth == 0:
+                    break
+                depth -= 1
+            elif depth == 0 and token in (',', ';'):
+                break
+            end += 1
+        values.append(tuple(tokens[i + 1:end]))
+    return values
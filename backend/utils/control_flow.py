@@ -0,0 +1,394 @@
+"""
+控制流图 - 为每个函数构建以行为语句单位的基本块图，供数据流分析共享
+"""
+from dataclasses import dataclass
+from typing import Dict, Iterator, List, Optional, Sequence, Tuple
+
+from utils.code_parser import CONTROL_KEYWORDS, DIRECTIVE_EVENTS, FunctionInfo, LineFacts
+
+# 整行都是普通语句（没有控制关键字和大括号、括号配对）时在事件流中的标记
+STATEMENT_EVENT = 'stmt'
+
+
+class BasicBlock:
+    """基本块：按顺序执行的若干行"""
+    __slots__ = ('index', 'lines', 'successors', 'predecessors')
+
+    def __init__(self, index: int):
+        self.index = index
+        self.lines: List[int] = []
+        self.successors: List[int] = []
+        self.predecessors: List[int] = []
+
+
+@dataclass(frozen=True)
+class Loop:
+    """循环的结构信息"""
+    kind: str                  # 'while'、'for' 或 'do-while'
+    line: int                  # 循环关键字所在行
+    has_exit: bool             # 除条件判断外，循环体内是否有离开循环的边（break、return、goto）
+    end_line: int = 0          # 循环的最后一行（配对的 '}' 或 do-while 的条件所在行）
+
+
+class ControlFlowGraph:
+    """一个函数的控制流图
+
+    每个源代码行只属于一个基本块（第一次出现时所在的块），因此同一行中的多条语句
+    被视为一个整体；blocks 按行号顺序排列，0 号为入口块，1 号为出口块，二者都不含行。
+    """
+
+    def __init__(self, start_line: int, end_line: int, function: Optional[FunctionInfo]):
+        self.start_line = start_line
+        self.end_line = end_line
+        self.function = function
+        self.blocks: List[BasicBlock] = []
+        self.loops: Dict[int, Loop] = {}
+        self.entry = self.new_block().index
+        self.exit = self.new_block().index
+
+    def new_block(self) -> BasicBlock:
+        block = BasicBlock(len(self.blocks))
+        self.blocks.append(block)
+        return block
+
+    def add_edge(self, source: BasicBlock, target: BasicBlock):
+        source.successors.append(target.index)
+        target.predecessors.append(source.index)
+
+    def contains(self, line_num: int) -> bool:
+        return self.start_line <= line_num <= self.end_line
+
+
+class _EventStream:
+    """带一个前瞻的 (行号, 事件) 流，consumed_line 为最后一个已消费事件所在的行"""
+
+    def __init__(self, items: Iterator[Tuple[int, str]]):
+        self._items = items
+        self.line = 0
+        self.consumed_line = 0
+        self.event: Optional[str] = None
+        self.advance()
+
+    def advance(self):
+        self.consumed_line = self.line
+        item = next(self._items, None)
+        if item is None:
+            self.event = None
+        else:
+            self.line, self.event = item
+
+
+class _FunctionBuilder:
+    """对函数体的控制流事件做递归下降，边解析边连接基本块
+
+    current 为 None 表示当前位置不可达（return、break 等之后），下一条语句会开启一个没有前驱的块。
+    goto 的目标未解析，保守地当作离开函数。
+    """
+
+    def __init__(self, cfg: ControlFlowGraph, stream: _EventStream):
+        self.cfg = cfg
+        self.stream = stream
+        self.current: Optional[BasicBlock] = None
+        self.last_line = 0
+        self.breaks: List[List[BasicBlock]] = []
+        self.continues: List[List[BasicBlock]] = []
+        self.switches: List[List] = []       # [switch 块, 是否有 default]
+
+    def build(self):
+        cfg = self.cfg
+        self.current = cfg.new_block()
+        cfg.add_edge(cfg.blocks[cfg.entry], self.current)
+        self._compound()
+        if self.current is not None:
+            cfg.add_edge(self.current, cfg.blocks[cfg.exit])
+
+    def _touch(self):
+        """把当前行归入当前块（每行只归入第一次出现时的块）"""
+        line = self.stream.line
+        if self.current is None:
+            self.current = self.cfg.new_block()
+        if line != self.last_line:
+            self.last_line = line
+            self.current.lines.append(line)
+
+    def _start_block(self, *predecessors: Optional[BasicBlock]) -> BasicBlock:
+        block = self.cfg.new_block()
+        for predecessor in predecessors:
+            if predecessor is not None:
+                self.cfg.add_edge(predecessor, block)
+        return block
+
+    def _jump(self, targets: List[BasicBlock]):
+        """记录一条跳转（break/continue），其后的代码不可达"""
+        if self.current is not None:
+            targets.append(self.current)
+        self.current = None
+
+    def _statement(self):
+        stream = self.stream
+        event = stream.event
+        if event == '{':
+            self._compound()
+        elif event == 'if':
+            self._if()
+        elif event == 'while' or event == 'for':
+            self._loop(event)
+        elif event == 'do':
+            self._do_while()
+        elif event == 'switch':
+            self._switch()
+        elif event == 'case' or event == 'default':
+            self._case_label(event)
+        elif event == 'return' or event == 'goto':
+            self._touch()
+            stream.advance()
+            self._expression()
+            if self.current is not None:
+                self.cfg.add_edge(self.current, self.cfg.blocks[self.cfg.exit])
+            self.current = None
+        elif event == 'break' or event == 'continue':
+            self._touch()
+            stream.advance()
+            if stream.event == ';':
+                stream.advance()
+            targets = self.breaks if event == 'break' else self.continues
+            if targets:
+                self._jump(targets[-1])
+        elif event in ('else', ';', ')', ':'):
+            # 空语句或不匹配的记号
+            stream.advance()
+        else:
+            self._expression()
+
+    def _compound(self):
+        stream = self.stream
+        stream.advance()
+        while stream.event is not None and stream.event != '}':
+            self._statement()
+        if stream.event == '}':
+            stream.advance()
+
+    def _condition(self):
+        """跳过关键字之后括号中的条件，条件所在的行归入当前块"""
+        stream = self.stream
+        self._touch()
+        stream.advance()
+        if stream.event != '(':
+            return
+        depth = 0
+        while stream.event is not None and stream.event != '}':
+            self._touch()
+            if stream.event == '(':
+                depth += 1
+            elif stream.event == ')':
+                depth -= 1
+            stream.advance()
+            if depth == 0:
+                return
+
+    def _expression(self):
+        """跳过一条表达式语句（到顶层分号为止），括号和大括号（初始化列表、结构体定义）内的内容一并跳过"""
+        stream = self.stream
+        depth = 0
+        consumed = False
+        while stream.event is not None:
+            event = stream.event
+            if depth == 0:
+                if event == STATEMENT_EVENT:
+                    if not consumed:
+                        self._touch()
+                        stream.advance()
+                    return
+                if event == ';':
+                    self._touch()
+                    stream.advance()
+                    return
+                if event == '}' or event in CONTROL_KEYWORDS or (event == '{' and not consumed):
+                    return
+            if event == '(' or event == '{':
+                depth += 1
+            elif event == ')' or event == '}':
+                if event == '}' and depth == 0:
+                    return
+                depth = max(0, depth - 1)
+            self._touch()
+            stream.advance()
+            consumed = True
+
+    def _if(self):
+        self._condition()
+        branch = self.current
+        self.current = self._start_block(branch)
+        self._statement()
+        then_end = self.current
+        if self.stream.event == 'else':
+            self.stream.advance()
+            self.current = self._start_block(branch)
+            self._statement()
+            self.current = self._start_block(then_end, self.current)
+        else:
+            self.current = self._start_block(then_end, branch)
+
+    def _loop(self, kind: str):
+        cfg = self.cfg
+        line = self.stream.line
+        header = self._start_block(self.current)
+        self.current = header
+        self._condition()
+        self.current = self._start_block(header)
+        self.breaks.append([])
+        self.continues.append([])
+        self._statement()
+        for block in self.continues.pop() + [self.current]:
+            if block is not None:
+                cfg.add_edge(block, header)
+        self._finish_loop(kind, line, header.index, header, self.breaks.pop())
+
+    def _do_while(self):
+        cfg = self.cfg
+        line = self.stream.line
+        self._touch()
+        self.stream.advance()
+        body = self._start_block(self.current)
+        self.current = body
+        self.breaks.append([])
+        self.continues.append([])
+        self._statement()
+        condition = self._start_block(self.current, *self.continues.pop())
+        self.current = condition
+        if self.stream.event == 'while':
+            self._condition()
+            if self.stream.event == ';':
+                self.stream.advance()
+        cfg.add_edge(self.current, body)
+        self._finish_loop('do-while', line, body.index, self.current, self.breaks.pop())
+
+    def _finish_loop(self, kind: str, line: int, first: int, condition: BasicBlock, breaks: List[BasicBlock]):
+        """连接循环出口，并记录循环体内是否存在离开循环的边
+
+        循环的块是编号 [first, 当前块数) 的连续区间，条件块的出边是正常的循环结束，不算退出。
+        调用时循环的最后一个事件刚被消费，其所在行即循环的最后一行。
+        """
+        cfg = self.cfg
+        end = len(cfg.blocks)
+        has_exit = bool(breaks)
+        for index in range(first, end):
+            if index != condition.index and any(not first <= target < end
+                                                for target in cfg.blocks[index].successors):
+                has_exit = True
+                break
+        self.current = self._start_block(condition, *breaks)
+        cfg.loops.setdefault(line, Loop(kind=kind, line=line, has_exit=has_exit,
+                                        end_line=self.stream.consumed_line))
+
+    def _switch(self):
+        self._condition()
+        switch_block = self.current
+        state = [switch_block, False]
+        self.switches.append(state)
+        self.breaks.append([])
+        self.current = None
+        self._statement()
+        has_default = self.switches.pop()[1]
+        self.current = self._start_block(self.current, *self.breaks.pop())
+        if not has_default:
+            self.cfg.add_edge(switch_block, self.current)
+
+    def _case_label(self, event: str):
+        """case/default 开启一个新块，前驱为 switch 块和上一个分支的直通"""
+        stream = self.stream
+        if self.switches:
+            state = self.switches[-1]
+            self.current = self._start_block(state[0], self.current)
+            if event == 'default':
+                state[1] = True
+        self._touch()
+        stream.advance()
+        while stream.event is not None and stream.event not in (':', '{', '}', ';'):
+            self._touch()
+            stream.advance()
+        if stream.event == ':':
+            stream.advance()
+
+
+def _function_events(line_facts: Sequence[Optional[LineFacts]], start_line: int, start_index: int,
+                     end_line: int) -> Iterator[Tuple[int, str]]:
+    """产出函数体 [start_line 中下标 start_index 的 '{', end_line] 范围内的控制流事件"""
+    for line_num in range(start_line, end_line + 1):
+        facts = line_facts[line_num - 1]
+        if facts is None or facts.control is DIRECTIVE_EVENTS:
+            continue
+        events = facts.control
+        if not events:
+            yield line_num, STATEMENT_EVENT
+            continue
+        for event in (events[start_index:] if line_num == start_line else events):
+            yield line_num, event
+
+
+def build_control_flow(line_facts: Sequence[Optional[LineFacts]],
+                       functions: Sequence[FunctionInfo]) -> List[ControlFlowGraph]:
+    """找出所有函数体（顶层的、紧跟在 ')' 之后的大括号块）并为每个函数构建控制流图
+
+    函数头与 '{' 可以在同一行，也可以在上一行（'{' 单独成行的风格）。
+    """
+    functions_by_line = {func.line_number: func for func in functions}
+    graphs: List[ControlFlowGraph] = []
+    depth = 0
+    start: Optional[Tuple[int, int, int]] = None    # (头部行号, '{' 所在行号, '{' 在事件中的下标)
+    previous = (0, ())
+    for line_num, facts in enumerate(line_facts, 1):
+        if facts is None:
+            continue
+        events = facts.control
+        if events is DIRECTIVE_EVENTS:
+            continue
+        for index, event in enumerate(events):
+            if event == '{':
+                if depth == 0:
+                    if index > 0 and events[index - 1] == ')':
+                        start = (line_num, line_num, index)
+                    elif index == 0 and previous[1] and previous[1][-1] == ')':
+                        start = (previous[0], line_num, index)
+                    else:
+                        start = None
+                depth += 1
+            elif event == '}' and depth > 0:
+                depth -= 1
+                if depth == 0 and start is not None:
+                    graphs.append(_build_function(line_facts, functions_by_line, start, line_num))
+                    start = None
+        previous = (line_num, events)
+    # 文件末尾未闭合的函数（编辑中的代码）一直延伸到最后一行
+    if start is not None:
+        graphs.append(_build_function(line_facts, functions_by_line, start, len(line_facts)))
+    return graphs
+
+
+def _build_function(line_facts: Sequence[Optional[LineFacts]], functions_by_line: Dict[int, FunctionInfo],
+                    start: Tuple[int, int, int], end_line: int) -> ControlFlowGraph:
+    header_line, open_line, open_index = start
+    function = functions_by_line.get(header_line)
+    cfg = ControlFlowGraph(header_line, end_line, function)
+    stream = _EventStream(_function_events(line_facts, open_line, open_index, end_line))
+    try:
+        _FunctionBuilder(cfg, stream).build()
+    except RecursionError:
+        # 嵌套过深（数百层）超出递归下降的深度时退化为一个顺序执行的块
+        cfg = _straight_line_function(line_facts, header_line, open_line, end_line, function)
+    return cfg
+
+
+def _straight_line_function(line_facts: Sequence[Optional[LineFacts]], header_line: int, open_line: int,
+                            end_line: int, function: Optional[FunctionInfo]) -> ControlFlowGraph:
+    """把函数体的所有行放入同一个块的控制流图，不记录循环"""
+    cfg = ControlFlowGraph(header_line, end_line, function)
+    body = cfg.new_block()
+    for line_num in range(open_line, end_line + 1):
+        facts = line_facts[line_num - 1]
+        if facts is not None and facts.control is not DIRECTIVE_EVENTS:
+            body.lines.append(line_num)
+    cfg.add_edge(cfg.blocks[cfg.entry], body)
+    cfg.add_edge(body, cfg.blocks[cfg.exit])
+    return cfg
+
@@ -0,0 +1,123 @@
+"""
+数据流分析 - 在函数控制流图上运行的通用位向量工作表求解器
+"""
+from collections import deque
+from typing import Dict, Iterator, List, Tuple
+
+from utils.control_flow import ControlFlowGraph
+
+
+class BitVectorProblem:
+    """前向位向量数据流问题
+
+    检测模块继承此类并提供自己的格：位数 width、交汇方式（may=True 为并集，表示"某条路径上成立"；
+    may=False 为交集，表示"所有路径上都成立"）、入口状态以及每行的 gen/kill 集合。
+    每一位的状态为整数中的一个二进制位，一行的传递函数为 out = (in & ~kill) | gen。
+    """
+
+    def __init__(self, width: int, may: bool = True):
+        self.width = width
+        self.may = may
+        self.full = (1 << width) - 1
+
+    def boundary(self) -> int:
+        """函数入口处的状态"""
+        return 0
+
+    def line_effect(self, line_num: int) -> Tuple[int, int]:
+        """返回一行的 (gen, kill)"""
+        return 0, 0
+
+
+class DataflowResult:
+    """求解结果：每个基本块入口处的状态，以及求解时算出的各行 (gen, kill)"""
+
+    def __init__(self, cfg: ControlFlowGraph, block_in: List[int], effects: Dict[int, Tuple[int, int]]):
+        self.cfg = cfg
+        self.block_in = block_in
+        self.effects = effects
+
+    def effect(self, line_num: int) -> Tuple[int, int]:
+        """返回一行的 (gen, kill)"""
+        return self.effects.get(line_num, _NO_EFFECT)
+
+    def apply(self, line_num: int, state: int) -> int:
+        """对状态应用一行的传递函数"""
+        effect = self.effects.get(line_num)
+        return (state & ~effect[1]) | effect[0] if effect else state
+
+    def line_states(self) -> Iterator[Tuple[int, int]]:
+        """按行号顺序产出 (行号, 执行该行之前的状态)"""
+        effects = self.effects
+        for block in self.cfg.blocks:
+            state = self.block_in[block.index]
+            for line_num in block.lines:
+                yield line_num, state
+                effect = effects.get(line_num)
+                if effect:
+                    state = (state & ~effect[1]) | effect[0]
+
+
+def solve(cfg: ControlFlowGraph, problem: BitVectorProblem) -> DataflowResult:
+    """用工作表算法求解到不动点
+
+    先把每个基本块的各行传递函数合成为一对 (gen, kill)，之后每次访问块只需常数次位运算；
+    基本块按行号顺序（结构化代码中即逆后序）入队，无循环时每个块只访问一次。
+    不可达的块（没有前驱）保持格的初始值：并集问题为全 0，交集问题为全 1。
+    """
+    blocks = cfg.blocks
+    count = len(blocks)
+    gen = [0] * count
+    kill = [0] * count
+    effects: Dict[int, Tuple[int, int]] = {}
+    for block in blocks:
+        block_gen = block_kill = 0
+        for line_num in block.lines:
+            line_gen, line_kill = effect = problem.line_effect(line_num)
+            if line_gen or line_kill:
+                effects[line_num] = effect
+                block_gen = (block_gen & ~line_kill) | line_gen
+                block_kill |= line_kill
+        gen[block.index] = block_gen
+        kill[block.index] = block_kill
+
+    may = problem.may
+    initial = 0 if may else problem.full
+    block_in = [initial] * count
+    block_out = [initial] * count
+    boundary = problem.boundary()
+
+    pending = deque(range(count))
+    queued = [True] * count
+    while pending:
+        index = pending.popleft()
+        queued[index] = False
+        block = blocks[index]
+
+        if index == cfg.entry:
+            state = boundary
+        elif block.predecessors:
+            predecessors = iter(block.predecessors)
+            state = block_out[next(predecessors)]
+            if may:
+                for predecessor in predecessors:
+                    state |= block_out[predecessor]
+            else:
+                for predecessor in predecessors:
+                    state &= block_out[predecessor]
+        else:
+            state = initial
+        block_in[index] = state
+
+        out = (state & ~kill[index]) | gen[index]
+        if out != block_out[index]:
+            block_out[index] = out
+            for successor in block.successors:
+                if not queued[successor]:
+                    queued[successor] = True
+                    pending.append(successor)
+
+    return DataflowResult(cfg, block_in, effects)
+
+
+_NO_EFFECT = (0, 0)
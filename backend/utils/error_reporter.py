@@ -1,7 +1,7 @@
 """
 错误报告器 - 为初学者提供易懂的错误报告
 """
-from typing import List, Dict, Any
+from typing import List, Dict, Any, Optional, Sequence, Tuple
 from dataclasses import dataclass
 from enum import Enum
 
@@ -21,6 +21,90 @@ class Severity(Enum):
     INFO = "提示"
 
 
+@dataclass(frozen=True)
+class ReportTemplate:
+    """报告模板：消息和建议中的 {0}、{1} 等位置由参数填充（字面花括号写作 {{ 和 }}）"""
+    category: str
+    message: str
+    suggestion: str
+
+    def render(self, args: Sequence[str]) -> Tuple[str, str]:
+        return self.message.format(*args), self.suggestion.format(*args)
+
+
+# 报告类别：错误类型、严重程度和检测模块的显示名称
+REPORT_CATEGORIES: Dict[str, Tuple[ErrorType, Severity, str]] = {
+    'memory': (ErrorType.MEMORY_SAFETY, Severity.ERROR, "内存安全卫士"),
+    'variable': (ErrorType.VARIABLE_STATE, Severity.WARNING, "变量状态监察官"),
+    'library': (ErrorType.STANDARD_LIBRARY, Severity.ERROR, "标准库使用助手"),
+    'numeric': (ErrorType.NUMERIC_CONTROL_FLOW, Severity.ERROR, "数值与控制流分析器"),
+}
+
+# 各检测模块使用的报告模板，紧凑格式中同一模板的消息和建议只传输一次
+REPORT_TEMPLATES: Dict[str, ReportTemplate] = {
+    'malloc_unchecked': ReportTemplate(
+        'memory', "变量 '{0}' 通过malloc分配内存后未检查返回值",
+        "建议添加NULL检查：if (var_name == NULL) {{ /* 处理错误 */ }}"),
+    'memory_leak': ReportTemplate(
+        'memory', "变量 '{0}' 分配了内存但未释放，可能导致内存泄漏",
+        "建议在适当位置添加 free(var_name); 语句"),
+    'use_after_free': ReportTemplate(
+        'memory', "指针 '{0}' 已被释放，但仍在被使用（野指针）",
+        "建议在free后设置指针为NULL：free(ptr); ptr = NULL;"),
+    'uninitialized_pointer_deref': ReportTemplate(
+        'memory', "指针 '{0}' 未初始化就被解引用",
+        "建议在使用前初始化指针：ptr = NULL; 或 ptr = malloc(size);"),
+    'unchecked_deref': ReportTemplate(
+        'memory', "解引用指针 '{0}' 前未进行NULL检查",
+        "建议添加NULL检查：if (ptr != NULL) {{ /* 使用ptr */ }}"),
+    'return_local_pointer': ReportTemplate(
+        'memory', "函数 '{0}' 返回局部指针，这是危险的",
+        "建议返回动态分配的内存或静态变量"),
+    'uninitialized_use': ReportTemplate(
+        'variable', "变量 '{0}' 在初始化前被使用",
+        "建议在使用前初始化变量：{0} = 初始值;"),
+    'uninitialized_array': ReportTemplate(
+        'variable', "数组 '{0}' 在初始化前被访问",
+        "建议在使用前初始化数组：{0}[0] = 初始值;"),
+    'uninitialized_pointer_arithmetic': ReportTemplate(
+        'variable', "指针 '{0}' 在初始化前进行运算",
+        "建议在使用前初始化指针：{0} = NULL; 或 {0} = malloc(size);"),
+    'uninitialized_comparison': ReportTemplate(
+        'variable', "变量 '{0}' 在初始化前进行比较",
+        "建议在使用前初始化变量：{0} = 初始值;"),
+    'uninitialized_arithmetic': ReportTemplate(
+        'variable', "变量 '{0}' 在初始化前进行算术运算",
+        "建议在使用前初始化变量：{0} = 初始值;"),
+    'missing_header': ReportTemplate(
+        'library', "使用函数 '{0}' 但未包含必要的头文件 '{1}'",
+        "建议在文件开头添加：#include <{1}>"),
+    'misspelled_header': ReportTemplate(
+        'library', "头文件 '{0}' 拼写错误",
+        "建议修正为：#include <{1}>"),
+    'scanf_missing_address': ReportTemplate(
+        'library', "scanf中变量 '{0}' 缺少地址运算符 &",
+        "建议修正为：scanf(\"...\", &{0});"),
+    'printf_argument_count': ReportTemplate(
+        'library', "printf格式字符串数量({0})与参数数量({1})不匹配",
+        "建议检查格式字符串和参数数量是否一致"),
+    'integer_overflow': ReportTemplate(
+        'numeric', "变量 '{0}' (类型: {1}) 赋值 {2} 超出范围 [{3}, {4}]",
+        "建议使用更大的数据类型或检查赋值逻辑"),
+    'infinite_while': ReportTemplate(
+        'numeric', "while循环条件 '{0}' 恒定为真且循环体内无退出语句，可能导致死循环",
+        "建议添加break语句或修改循环条件"),
+    'infinite_for': ReportTemplate(
+        'numeric', "for循环条件 '{0}' 恒定为真且循环体内无退出语句，可能导致死循环",
+        "建议添加break语句或修改循环条件"),
+    'infinite_do_while': ReportTemplate(
+        'numeric', "do-while循环体内无退出语句，可能导致死循环",
+        "建议添加break语句或确保while条件能正确终止循环"),
+    'loop_variable_unchanged': ReportTemplate(
+        'numeric', "{0}循环条件 '{1}' 中的变量 {2} 在循环内从未被修改且循环体内无退出语句，可能导致死循环",
+        "建议在循环体内更新循环变量或添加break语句"),
+}
+
+
 @dataclass
 class BugReport:
     """Bug报告数据结构"""
@@ -31,6 +115,40 @@ class BugReport:
     suggestion: str
     code_snippet: str = ""
     module_name: str = ""
+    # 模块因超过时间预算未完成时，它已产生的报告标记为部分结果
+    partial: bool = False
+    # 按模板生成的报告记录模板名称和参数（字符串），紧凑格式据此只传输模板编号和参数
+    template: Optional[str] = None
+    args: Tuple[str, ...] = ()
+    
+    def to_dict(self) -> Dict[str, Any]:
+        """转换为可JSON序列化的字典（partial 只在为真时输出）"""
+        data = {
+            'line_number': self.line_number,
+            'error_type': self.error_type.value,
+            'severity': self.severity.value,
+            'message': self.message,
+            'suggestion': self.suggestion,
+            'code_snippet': self.code_snippet,
+            'module_name': self.module_name
+        }
+        if self.partial:
+            data['partial'] = True
+        return data
+    
+    @classmethod
+    def from_dict(cls, data: Dict[str, Any]) -> 'BugReport':
+        """由 to_dict 的结果还原报告"""
+        return cls(
+            line_number=data['line_number'],
+            error_type=ErrorType(data['error_type']),
+            severity=Severity(data['severity']),
+            message=data['message'],
+            suggestion=data['suggestion'],
+            code_snippet=data.get('code_snippet', ''),
+            module_name=data.get('module_name', ''),
+            partial=data.get('partial', False)
+        )
 
 
 class ErrorReporter:
@@ -43,55 +161,44 @@ class ErrorReporter:
         """添加错误报告"""
         self.reports.append(report)
     
+    def add_template_report(self, template_name: str, line_num: int, args: Sequence[Any] = (),
+                            code_snippet: str = ""):
+        """按模板添加报告，参数转换为字符串后填入消息和建议"""
+        template = REPORT_TEMPLATES[template_name]
+        args = tuple(str(arg) for arg in args)
+        message, suggestion = template.render(args)
+        self._add_category_report(template.category, line_num, message, suggestion, code_snippet,
+                                  template_name, args)
+    
     def add_memory_error(self, line_num: int, message: str, suggestion: str, code_snippet: str = ""):
         """添加内存安全错误"""
-        report = BugReport(
-            line_number=line_num,
-            error_type=ErrorType.MEMORY_SAFETY,
-            severity=Severity.ERROR,
-            message=message,
-            suggestion=suggestion,
-            code_snippet=code_snippet,
-            module_name="内存安全卫士"
-        )
-        self.add_report(report)
+        self._add_category_report('memory', line_num, message, suggestion, code_snippet)
     
     def add_variable_error(self, line_num: int, message: str, suggestion: str, code_snippet: str = ""):
         """添加变量状态错误"""
-        report = BugReport(
-            line_number=line_num,
-            error_type=ErrorType.VARIABLE_STATE,
-            severity=Severity.WARNING,
-            message=message,
-            suggestion=suggestion,
-            code_snippet=code_snippet,
-            module_name="变量状态监察官"
-        )
-        self.add_report(report)
+        self._add_category_report('variable', line_num, message, suggestion, code_snippet)
     
     def add_library_error(self, line_num: int, message: str, suggestion: str, code_snippet: str = ""):
         """添加标准库使用错误"""
-        report = BugReport(
-            line_number=line_num,
-            error_type=ErrorType.STANDARD_LIBRARY,
-            severity=Severity.ERROR,
-            message=message,
-            suggestion=suggestion,
-            code_snippet=code_snippet,
-            module_name="标准库使用助手"
-        )
-        self.add_report(report)
+        self._add_category_report('library', line_num, message, suggestion, code_snippet)
     
     def add_numeric_error(self, line_num: int, message: str, suggestion: str, code_snippet: str = ""):
         """添加数值与控制流错误"""
+        self._add_category_report('numeric', line_num, message, suggestion, code_snippet)
+    
+    def _add_category_report(self, category: str, line_num: int, message: str, suggestion: str,
+                             code_snippet: str, template: Optional[str] = None, args: Tuple[str, ...] = ()):
+        error_type, severity, module_name = REPORT_CATEGORIES[category]
         report = BugReport(
             line_number=line_num,
-            error_type=ErrorType.NUMERIC_CONTROL_FLOW,
-            severity=Severity.ERROR,
+            error_type=error_type,
+            severity=severity,
             message=message,
             suggestion=suggestion,
             code_snippet=code_snippet,
-            module_name="数值与控制流分析器"
+            module_name=module_name,
+            template=template,
+            args=args
         )
         self.add_report(report)
     
@@ -107,10 +214,20 @@ class ErrorReporter:
         """清空所有报告"""
         self.reports.clear()
     
+    def truncate(self, count: int):
+        """丢弃第 count 条之后的报告（用于撤销出错模块的部分结果）"""
+        del self.reports[count:]
+    
+    def mark_partial(self, count: int):
+        """把第 count 条之后的报告标记为部分结果（用于超过时间预算的模块）"""
+        for report in self.reports[count:]:
+            report.partial = True
+    
     def format_report(self, report: BugReport) -> str:
         """格式化单个报告"""
+        partial = "（部分结果，模块超过时间预算未完成）" if report.partial else ""
         return f"""
-🔍 {report.module_name} 检测到问题：
+🔍 {report.module_name} 检测到问题{partial}：
 
 📍 位置：第 {report.line_number} 行
 ⚠️  类型：{report.error_type.value} - {report.severity.value}
@@ -118,15 +235,17 @@ class ErrorReporter:
 💡 建议：{report.suggestion}
 """
     
-    def format_all_reports(self) -> str:
-        """格式化所有报告"""
-        if not self.reports:
+    def format_all_reports(self, reports: Optional[List[BugReport]] = None) -> str:
+        """格式化所有报告，指定 reports 时格式化给定的报告"""
+        if reports is None:
+            reports = self.reports
+        if not reports:
             return "✅ 恭喜！没有发现任何问题。"
         
-        result = f"📊 检测完成，共发现 {len(self.reports)} 个问题：\n"
+        result = f"📊 检测完成，共发现 {len(reports)} 个问题：\n"
         result += "=" * 50 + "\n"
         
-        for i, report in enumerate(self.reports, 1):
+        for i, report in enumerate(reports, 1):
             result += f"\n{i}. {self.format_report(report)}"
             result += "-" * 30 + "\n"
         
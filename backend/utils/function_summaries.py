@@ -0,0 +1,389 @@
+"""
+函数摘要 - 自底向上计算每个函数对内存所有权的影响（分配并返回、释放第N个参数），供跨函数、跨文件的泄漏检查使用
+"""
+import hashlib
+import zlib
+from dataclasses import dataclass
+from typing import Dict, FrozenSet, Iterable, Iterator, List, Optional, Sequence, Set, Tuple
+
+from utils.c_lexer import CLexer, is_identifier
+from utils.code_parser import NON_CALL_KEYWORDS, TYPE_KEYWORDS, find_closing_paren
+
+# 返回新分配内存的库函数
+ALLOCATORS = frozenset(['malloc', 'calloc', 'realloc', 'strdup'])
+
+# 参数列表中不是参数名的关键字
+_PARAMETER_KEYWORDS = TYPE_KEYWORDS | frozenset(['const', 'volatile', 'struct', 'union', 'enum', 'register',
+                                                 'restrict'])
+# 出现在 "名称(" 之前时不是函数定义的关键字
+_NON_DEFINITION_KEYWORDS = NON_CALL_KEYWORDS | frozenset(['switch', 'sizeof', 'else', 'case', 'goto'])
+
+
+@dataclass(frozen=True)
+class LocalSummary:
+    """只由函数自身的代码得到的摘要（不依赖被调用的函数）"""
+    name: str
+    parameters: Tuple[Optional[str], ...]
+    # (被调用函数, 实参位置, 本函数的形参位置)：形参原样传给被调用函数
+    forwarded: Tuple[Tuple[str, int, int], ...]
+    # 其结果被本函数返回的被调用函数（直接 return f(...)，或先赋给局部变量再返回）
+    returned_calls: FrozenSet[str]
+    # return 语句直接返回的变量名
+    returned_names: FrozenSet[str]
+    # 调用的所有函数
+    callees: FrozenSet[str]
+    digest: str
+
+
+@dataclass(frozen=True)
+class FunctionSummary:
+    """考虑了被调用函数之后的摘要"""
+    name: str
+    # 返回新分配内存的所有权（调用者负责释放）
+    allocates: bool
+    # 会释放的参数位置（从0开始）
+    frees_params: FrozenSet[int]
+
+
+EMPTY_SUMMARY = FunctionSummary('', False, frozenset())
+
+_BUILTIN_SUMMARIES = {name: FunctionSummary(name, True, frozenset()) for name in ALLOCATORS}
+_BUILTIN_SUMMARIES['free'] = FunctionSummary('free', False, frozenset([0]))
+
+
+def content_stamp(content) -> Tuple[int, int]:
+    """内容的标记（长度和 CRC32），用于判断文件自上次建立摘要以来是否变化"""
+    return len(content), zlib.crc32(content)
+
+
+def _split_arguments(tokens: Sequence[str], open_index: int, close: int) -> List[List[str]]:
+    """按顶层逗号切分括号内的记号"""
+    arguments: List[List[str]] = [[]]
+    depth = 0
+    for token in tokens[open_index + 1:close]:
+        if token in ('(', '[', '{'):
+            depth += 1
+        elif token in (')', ']', '}'):
+            depth -= 1
+        elif token == ',' and depth == 0:
+            arguments.append([])
+            continue
+        arguments[-1].append(token)
+    return arguments if arguments != [[]] else []
+
+
+def _skip_cast(tokens: Sequence[str], index: int) -> int:
+    """index 处为 ')' 时跳过一个类型转换，返回转换之前的记号位置"""
+    if index < 0 or tokens[index] != ')':
+        return index
+    depth = 0
+    for j in range(index, -1, -1):
+        if tokens[j] == ')':
+            depth += 1
+        elif tokens[j] == '(':
+            depth -= 1
+            if depth == 0:
+                return j - 1
+    return index
+
+
+def statement_calls(tokens: Sequence[str]) -> Iterator[Tuple[str, Tuple[Optional[str], ...], Optional[str], bool]]:
+    """一行记号中的函数调用：(函数名, 各实参（单个标识符时为其名称，否则为 None）, 结果赋给的变量, 是否直接返回)"""
+    count = len(tokens)
+    i = 0
+    while True:
+        try:
+            i = tokens.index('(', i + 1)
+        except ValueError:
+            return
+        callee = tokens[i - 1]
+        if not is_identifier(callee) or callee in _NON_DEFINITION_KEYWORDS:
+            continue
+        close = find_closing_paren(tokens, i)
+        if close < 0:
+            close = count
+        arguments = tuple(argument[0] if len(argument) == 1 and is_identifier(argument[0]) else None
+                          for argument in _split_arguments(tokens, i, close))
+        before = _skip_cast(tokens, i - 2)
+        assigned = None
+        if before >= 1 and tokens[before] == '=' and is_identifier(tokens[before - 1]):
+            assigned = tokens[before - 1]
+        yield callee, arguments, assigned, before >= 0 and tokens[before] == 'return'
+
+
+def _parameter_names(tokens: Sequence[str], open_index: int, close: int) -> Tuple[Optional[str], ...]:
+    """函数定义的形参名，无法识别的形参（如函数指针）为 None"""
+    names: List[Optional[str]] = []
+    for parameter in _split_arguments(tokens, open_index, close):
+        if parameter in (['void'], ['...']):
+            continue
+        candidates = [token for token in parameter if is_identifier(token) and token not in _PARAMETER_KEYWORDS]
+        names.append(candidates[-1] if candidates and '(' not in parameter else None)
+    return tuple(names)
+
+
+class _Builder:
+    """在函数体内逐行收集局部摘要"""
+
+    def __init__(self, name: str, parameters: Tuple[Optional[str], ...]):
+        self.name = name
+        self.parameters = parameters
+        self.parameter_index = {param: index for index, param in enumerate(parameters) if param}
+        self.forwarded: Set[Tuple[str, int, int]] = set()
+        self.returned_calls: Set[str] = set()
+        self.returned_names: Set[str] = set()
+        self.callees: Set[str] = set()
+        # 局部变量 -> 其值来自的函数调用
+        self.holders: Dict[str, Set[str]] = {}
+
+    def add_line(self, tokens: Sequence[str]):
+        for callee, arguments, assigned, returned in statement_calls(tokens):
+            self.callees.add(callee)
+            for position, argument in enumerate(arguments):
+                if argument in self.parameter_index:
+                    self.forwarded.add((callee, position, self.parameter_index[argument]))
+            if returned:
+                self.returned_calls.add(callee)
+            elif assigned is not None:
+                self.holders.setdefault(assigned, set()).add(callee)
+        if 'return' not in tokens:
+            return
+        for i in range(len(tokens) - 2):
+            if tokens[i] == 'return' and is_identifier(tokens[i + 1]) and tokens[i + 2] == ';':
+                self.returned_names.add(tokens[i + 1])
+
+    def finish(self) -> LocalSummary:
+        returned_calls = set(self.returned_calls)
+        for name in self.returned_names:
+            returned_calls |= self.holders.get(name, set())
+        forwarded = tuple(sorted(self.forwarded))
+        digest = hashlib.sha256(repr((self.parameters, forwarded, sorted(returned_calls),
+                                      sorted(self.returned_names), sorted(self.callees))).encode('utf-8'))
+        return LocalSummary(self.name, self.parameters, forwarded, frozenset(returned_calls),
+                            frozenset(self.returned_names), frozenset(self.callees), digest.hexdigest())
+
+
+def summarize_functions(token_lines: Iterable[Sequence[str]]) -> Dict[str, LocalSummary]:
+    """由按行分组的记号得到文件中每个函数定义的局部摘要
+
+    顶层的 "名称(...)" 之后（同一行或下一行开头）紧接 '{' 时视为函数定义，直到配对的 '}' 为函数体。
+    """
+    summaries: Dict[str, LocalSummary] = {}
+    depth = 0
+    header: Optional[Tuple[str, Tuple[Optional[str], ...]]] = None
+    builder: Optional[_Builder] = None
+    for tokens in token_lines:
+        if not tokens or tokens[0][0] == '#':
+            continue
+        if builder is not None and '{' not in tokens and '}' not in tokens:
+            # 函数体内不含花括号的行
+            builder.add_line(tokens)
+            continue
+        start = 0
+        if depth == 0 and tokens[0] != '{':
+            header = None
+            for i in range(1, len(tokens)):
+                if tokens[i] == '(' and is_identifier(tokens[i - 1]) \
+                        and tokens[i - 1] not in _NON_DEFINITION_KEYWORDS:
+                    close = find_closing_paren(tokens, i)
+                    if close > 0:
+                        header = (tokens[i - 1], _parameter_names(tokens, i, close))
+                        start = close + 1
+                    break
+            if header is not None and start < len(tokens) and tokens[start] != '{':
+                # 函数声明或其他顶层语句
+                header = None
+        body_start = 0 if builder is not None else None
+        for i in range(start, len(tokens)):
+            token = tokens[i]
+            if token == '{':
+                if depth == 0 and header is not None:
+                    builder = _Builder(*header)
+                    header = None
+                    body_start = i + 1
+                depth += 1
+            elif token == '}':
+                depth = max(0, depth - 1)
+                if depth == 0 and builder is not None:
+                    builder.add_line(tokens[body_start:i])
+                    summaries.setdefault(builder.name, builder.finish())
+                    builder = None
+                    body_start = None
+        if builder is not None and body_start is not None:
+            builder.add_line(tokens[body_start:])
+    return summaries
+
+
+class SummaryIndex:
+    """工作区中所有函数的摘要
+
+    文件的局部摘要按内容标记缓存，只在内容变化时重新计算；完整摘要在查询时沿调用图自底向上计算并
+    缓存，某个函数的局部摘要变化时，只丢弃它和（直接或间接）调用它的函数的完整摘要。
+    递归调用的函数在环上视为没有影响。同名函数在多个文件中定义时使用路径最小的文件中的定义。
+    """
+
+    def __init__(self):
+        self._files: Dict[str, Tuple[Tuple[int, int], Dict[str, LocalSummary]]] = {}
+        # 函数名 -> {文件路径: 局部摘要}
+        self._definitions: Dict[str, Dict[str, LocalSummary]] = {}
+        self._resolved: Dict[str, FunctionSummary] = {}
+        # 反向调用图：函数名 -> 调用它的函数名
+        self._callers: Dict[str, Set[str]] = {}
+        self.summarized_files = 0
+
+    def has_file(self, file_path: str, stamp: Tuple[int, int]) -> bool:
+        cached = self._files.get(file_path)
+        return cached is not None and cached[0] == stamp
+
+    def index_files(self, file_paths: Iterable[str]):
+        """读取并建立多个文件的局部摘要（目录分析之前调用，使跨文件的摘要在分析第一个文件时就可用）"""
+        for file_path in file_paths:
+            try:
+                with open(file_path, 'rb') as f:
+                    content = f.read()
+            except OSError:
+                continue
+            self.index_content(file_path, content)
+
+    def index_content(self, file_path: str, raw_content: bytes):
+        """内容变化时重新词法分析并建立局部摘要"""
+        stamp = content_stamp(raw_content)
+        if self.has_file(file_path, stamp):
+            return
+        _lines, token_lines = CLexer().tokenize(raw_content.decode('utf-8', 'replace'))
+        self.update_file(file_path, stamp, summarize_functions(token_lines))
+
+    def update_file(self, file_path: str, stamp: Tuple[int, int], summaries: Dict[str, LocalSummary]):
+        """替换一个文件的局部摘要，丢弃受影响函数的完整摘要"""
+        cached = self._files.get(file_path)
+        old = cached[1] if cached else {}
+        self._files[file_path] = (stamp, summaries)
+        self.summarized_files += 1
+        changed = set()
+        for name in set(old) | set(summaries):
+            before, after = old.get(name), summaries.get(name)
+            if before is not None and after is not None and before.digest == after.digest:
+                continue
+            changed.add(name)
+            definitions = self._definitions.setdefault(name, {})
+            if before is not None:
+                definitions.pop(file_path, None)
+                for callee in before.callees:
+                    callers = self._callers.get(callee)
+                    if callers is not None:
+                        callers.discard(name)
+            if after is not None:
+                definitions[file_path] = after
+            if not definitions:
+                del self._definitions[name]
+        # 调用边以当前使用的定义为准重新加入
+        for name in changed:
+            local = self.local(name)
+            if local is not None:
+                for callee in local.callees:
+                    self._callers.setdefault(callee, set()).add(name)
+        self.invalidate(changed)
+
+    def export(self) -> Dict[str, Tuple[Tuple[int, int], Dict[str, LocalSummary]]]:
+        """局部摘要（传给并行工作进程）"""
+        return dict(self._files)
+
+    def load(self, files: Dict[str, Tuple[Tuple[int, int], Dict[str, LocalSummary]]]):
+        for file_path, (stamp, summaries) in files.items():
+            self.update_file(file_path, stamp, summaries)
+
+    def local(self, name: str) -> Optional[LocalSummary]:
+        definitions = self._definitions.get(name)
+        if not definitions:
+            return None
+        return definitions[min(definitions)]
+
+    def invalidate(self, names: Iterable[str]):
+        """丢弃这些函数及直接或间接调用它们的函数的完整摘要"""
+        pending = list(names)
+        seen = set(pending)
+        while pending:
+            name = pending.pop()
+            self._resolved.pop(name, None)
+            for caller in self._callers.get(name, ()):
+                if caller not in seen:
+                    seen.add(caller)
+                    pending.append(caller)
+
+    def resolve(self, name: str) -> FunctionSummary:
+        """函数的完整摘要；未定义的函数（库函数或不在工作区中）返回没有影响的摘要"""
+        builtin = _BUILTIN_SUMMARIES.get(name)
+        if builtin is not None:
+            return builtin
+        summary = self._resolved.get(name)
+        if summary is not None:
+            return summary
+        local = self.local(name)
+        if local is None:
+            return EMPTY_SUMMARY
+
+        # 按后序遍历调用图，被调用的函数先于调用者计算（显式栈，调用链很长时不会超出递归深度）
+        visiting = {name}
+        stack = [(name, iter(sorted(local.callees)))]
+        while stack:
+            current, callees = stack[-1]
+            for callee in callees:
+                if callee in visiting or callee in self._resolved or callee in _BUILTIN_SUMMARIES:
+                    continue
+                callee_local = self.local(callee)
+                if callee_local is not None:
+                    visiting.add(callee)
+                    stack.append((callee, iter(sorted(callee_local.callees))))
+                    break
+            else:
+                stack.pop()
+                visiting.discard(current)
+                self._resolved[current] = self._combine(self.local(current))
+        return self._resolved[name]
+
+    def _combine(self, local: LocalSummary) -> FunctionSummary:
+        """由局部摘要和被调用函数的完整摘要（环上尚未计算的视为没有影响）得到完整摘要"""
+        def callee_summary(callee: str) -> FunctionSummary:
+            return _BUILTIN_SUMMARIES.get(callee) or self._resolved.get(callee) or EMPTY_SUMMARY
+
+        allocates = any(callee_summary(callee).allocates for callee in local.returned_calls)
+        frees = frozenset(param for callee, position, param in local.forwarded
+                          if position in callee_summary(callee).frees_params)
+        return FunctionSummary(local.name, allocates, frees)
+
+    def functions_in(self, file_path: str) -> Set[str]:
+        """文件中定义的函数名"""
+        cached = self._files.get(file_path)
+        return set(cached[1]) if cached else set()
+
+    def calling_files(self, names: Iterable[str]) -> Set[str]:
+        """调用了这些函数、或调用了（直接或间接）调用它们的函数的其他文件
+
+        这些函数的完整摘要变化时，只有这些文件的 dependency_digest 可能变化。
+        """
+        affected = set(names)
+        pending = list(affected)
+        while pending:
+            for caller in self._callers.get(pending.pop(), ()):
+                if caller not in affected:
+                    affected.add(caller)
+                    pending.append(caller)
+        return {file_path for file_path, (_stamp, own) in self._files.items()
+                if any(callee in affected and callee not in own
+                       for local in own.values() for callee in local.callees)}
+
+    def dependency_digest(self, file_path: str) -> str:
+        """文件中的函数调用的、在其他文件中定义的函数的完整摘要的组合哈希，参与结果缓存键"""
+        cached = self._files.get(file_path)
+        if not cached:
+            return ''
+        own = cached[1]
+        external = sorted({callee for local in own.values() for callee in local.callees
+                           if callee not in own and callee in self._definitions})
+        if not external:
+            return ''
+        digest = hashlib.sha256()
+        for name in external:
+            summary = self.resolve(name)
+            digest.update(f"{name}:{int(summary.allocates)}:{sorted(summary.frees_params)};".encode('utf-8'))
+        return digest.hexdigest()
@@ -0,0 +1,235 @@
+"""
+包含关系图 - 工作区头文件的摘要只解析一次，供每个包含它们的 .c 文件的分析共享
+"""
+import hashlib
+import os
+import re
+from dataclasses import dataclass
+from typing import Dict, FrozenSet, Iterable, List, Optional, Sequence, Set, Tuple
+
+from utils.c_lexer import CLexer, is_identifier
+
+# 记号中的头文件名（词法分析器把整条 #include 作为一个记号）
+_HEADER_RE = re.compile(r'[<"]([^>"]+)[>"]')
+# 在原始内容上快速查找 #include（查找缓存之前使用，不经过词法分析）
+_RAW_INCLUDE_RE = re.compile(rb'^[ \t]*#[ \t]*include[ \t]*[<"]([^>"\r\n]+)[>"]', re.MULTILINE)
+
+# 出现在 "名称(" 之前时不构成函数声明的关键字
+_NON_DECLARATION_KEYWORDS = frozenset([
+    'if', 'while', 'for', 'switch', 'return', 'sizeof', 'do', 'else', 'case', 'goto', 'typedef',
+])
+
+
+@dataclass(frozen=True)
+class HeaderSummary:
+    """一个工作区头文件本身的摘要（不含它包含的其他头文件）"""
+    path: str
+    # 包含的头文件名（原样，是否位于工作区在建立闭包时解析）
+    includes: Tuple[str, ...]
+    # 顶层声明或定义的函数名
+    functions: FrozenSet[str]
+    # 定义的宏名
+    macros: FrozenSet[str]
+    # 摘要内容的哈希：只有摘要变化时依赖它的文件才需要重新分析
+    digest: str
+
+
+@dataclass(frozen=True)
+class IncludeClosure:
+    """一组 #include 经由工作区头文件传递得到的内容"""
+    # 不在工作区中的头文件名（标准库或第三方头文件），包括直接包含的和经由工作区头文件传递包含的
+    headers: FrozenSet[str]
+    functions: FrozenSet[str]
+    macros: FrozenSet[str]
+    # 直接包含的头文件名中解析到工作区文件的部分
+    local_names: FrozenSet[str]
+    # 传递依赖的工作区头文件路径
+    dependencies: FrozenSet[str]
+    # 所有依赖摘要的组合哈希，参与结果缓存键
+    digest: str
+
+
+EMPTY_CLOSURE = IncludeClosure(frozenset(), frozenset(), frozenset(), frozenset(), frozenset(), '')
+
+
+def summarize_header(path: str, content: str) -> HeaderSummary:
+    """解析头文件内容，得到包含的头文件、函数声明和宏定义"""
+    lexer = CLexer()
+    _lines, token_lines = lexer.tokenize(content)
+    includes: List[str] = []
+    functions: Set[str] = set()
+    macros: Set[str] = set()
+    depth = 0
+    for tokens in token_lines:
+        if not tokens:
+            continue
+        first = tokens[0]
+        if first[0] == '#':
+            match = _HEADER_RE.search(first) if first != '#' else None
+            if match:
+                includes.append(match.group(1))
+            elif len(tokens) >= 3 and tokens[1] == 'define' and is_identifier(tokens[2]):
+                macros.add(tokens[2])
+            continue
+        for i, token in enumerate(tokens):
+            if token == '{':
+                depth += 1
+            elif token == '}':
+                depth = max(0, depth - 1)
+            elif (depth == 0 and token == '(' and i >= 2 and is_identifier(tokens[i - 1])
+                  and tokens[i - 1] not in _NON_DECLARATION_KEYWORDS
+                  and (is_identifier(tokens[i - 2]) or tokens[i - 2] == '*')):
+                functions.add(tokens[i - 1])
+
+    digest = hashlib.sha256()
+    for part in (includes, sorted(functions), sorted(macros)):
+        digest.update('\0'.join(part).encode('utf-8'))
+        digest.update(b'\1')
+    return HeaderSummary(path, tuple(includes), frozenset(functions), frozenset(macros), digest.hexdigest())
+
+
+def scan_includes(raw_content: bytes) -> List[str]:
+    """在原始内容中查找 #include 的头文件名（不区分注释中的内容，用于计算缓存键）"""
+    return [name.decode('utf-8', 'replace') for name in _RAW_INCLUDE_RE.findall(raw_content)]
+
+
+class IncludeGraph:
+    """工作区的包含关系图
+
+    头文件名先相对包含它的文件所在目录查找，再依次在 include_dirs 中查找，找不到的视为标准库或
+    第三方头文件。每个工作区头文件的摘要按 (修改时间, 大小) 缓存，只在文件变化时重新解析；
+    摘要变化时，依赖它的头文件的闭包随之失效，其他文件不受影响。
+    循环包含时，闭包中不包含环上正在建立闭包的头文件的内容。
+    """
+
+    def __init__(self, include_dirs: Sequence[str] = ()):
+        self.include_dirs = [os.path.abspath(directory) for directory in include_dirs]
+        self._summaries: Dict[str, Tuple[Tuple[int, int], HeaderSummary]] = {}
+        self._closures: Dict[str, IncludeClosure] = {}
+        # 反向边：头文件路径 -> 直接包含它的头文件和 .c 文件
+        self._dependents: Dict[str, Set[str]] = {}
+        self.parsed_headers = 0
+
+    def resolve(self, name: str, from_dir: str) -> Optional[str]:
+        """把头文件名解析为工作区中的文件路径"""
+        for directory in (from_dir, *self.include_dirs):
+            path = os.path.normpath(os.path.join(directory, name))
+            if os.path.isfile(path):
+                return path
+        return None
+
+    def summary(self, path: str) -> Optional[HeaderSummary]:
+        """头文件本身的摘要，文件变化后重新解析；文件不存在或无法读取时返回 None"""
+        try:
+            stat = os.stat(path)
+        except OSError:
+            self.invalidate(path)
+            return None
+        stamp = (stat.st_mtime_ns, stat.st_size)
+        cached = self._summaries.get(path)
+        if cached and cached[0] == stamp:
+            return cached[1]
+        try:
+            with open(path, 'rb') as f:
+                content = f.read().decode('utf-8', 'replace')
+        except OSError:
+            self.invalidate(path)
+            return None
+        summary = summarize_header(path, content)
+        self.parsed_headers += 1
+        if cached and cached[1].digest != summary.digest:
+            self.invalidate(path)
+        self._summaries[path] = (stamp, summary)
+        return summary
+
+    def header_closure(self, path: str) -> IncludeClosure:
+        """头文件及其传递包含的工作区头文件提供的内容"""
+        closure = self._closures.get(path)
+        if closure is not None:
+            return closure
+        return self._build_closure(path, set())
+
+    def file_closure(self, file_path: str, include_names: Sequence[str]) -> IncludeClosure:
+        """一个 .c 文件（或编辑器中的内容）的 #include 经由工作区头文件提供的内容
+
+        同时记录该文件对这些头文件的依赖，供 dependents_of 查询。
+        """
+        if not file_path:
+            return EMPTY_CLOSURE
+        file_path = os.path.abspath(file_path)
+        closure = self._merge(file_path, include_names, set())
+        # 缓存中的闭包可能已过期：依赖的头文件有变化时重新计算
+        if any(self._changed(path) for path in closure.dependencies):
+            closure = self._merge(file_path, include_names, set())
+        return closure
+
+    def dependents_of(self, path: str) -> Set[str]:
+        """直接或间接包含该头文件的所有文件"""
+        path = os.path.abspath(path)
+        result: Set[str] = set()
+        pending = [path]
+        while pending:
+            for dependent in self._dependents.get(pending.pop(), ()):
+                if dependent not in result:
+                    result.add(dependent)
+                    pending.append(dependent)
+        return result
+
+    def invalidate(self, path: str) -> Set[str]:
+        """丢弃头文件的摘要和依赖它的闭包，返回需要重新分析的文件"""
+        path = os.path.abspath(path)
+        dependents = self.dependents_of(path)
+        self._summaries.pop(path, None)
+        self._closures.pop(path, None)
+        for dependent in dependents:
+            self._closures.pop(dependent, None)
+        return dependents
+
+    def _changed(self, path: str) -> bool:
+        cached = self._summaries.get(path)
+        summary = self.summary(path)
+        return cached is None or summary is None or summary is not cached[1]
+
+    def _build_closure(self, path: str, visiting: Set[str]) -> IncludeClosure:
+        summary = self.summary(path)
+        if summary is None:
+            return EMPTY_CLOSURE
+        visiting.add(path)
+        merged = self._merge(path, summary.includes, visiting)
+        closure = IncludeClosure(
+            merged.headers, merged.functions | summary.functions, merged.macros | summary.macros,
+            merged.local_names, merged.dependencies | {path},
+            hashlib.sha256((summary.digest + merged.digest).encode('utf-8')).hexdigest())
+        visiting.discard(path)
+        self._closures[path] = closure
+        return closure
+
+    def _merge(self, including_path: str, include_names: Iterable[str], visiting: Set[str]) -> IncludeClosure:
+        """合并一组头文件名的闭包；正在建立闭包的头文件（循环包含）跳过"""
+        from_dir = os.path.dirname(including_path)
+        headers: Set[str] = set()
+        functions: Set[str] = set()
+        macros: Set[str] = set()
+        local_names: Set[str] = set()
+        dependencies: Set[str] = set()
+        digest = hashlib.sha256()
+        for name in include_names:
+            path = self.resolve(name, from_dir)
+            if path is None:
+                headers.add(name)
+                continue
+            local_names.add(name)
+            self._dependents.setdefault(path, set()).add(including_path)
+            if path in visiting:
+                continue
+            closure = self._closures.get(path)
+            if closure is None:
+                closure = self._build_closure(path, visiting)
+            headers |= closure.headers
+            functions |= closure.functions
+            macros |= closure.macros
+            dependencies |= closure.dependencies
+            digest.update(closure.digest.encode('utf-8'))
+        return IncludeClosure(frozenset(headers), frozenset(functions), frozenset(macros),
+                              frozenset(local_names), frozenset(dependencies),
+                              digest.hexdigest() if local_names else '')
@@ -0,0 +1,90 @@
+"""
+分析统计 - 记录一次文件分析中各阶段（读取、分词、各检测模块、报告格式化）的耗时和内存分配
+"""
+import sys
+import time
+import unicodedata
+from contextlib import contextmanager, nullcontext
+from typing import Dict, Iterator, List, Optional
+
+
+def _allocated_blocks() -> int:
+    # 非 CPython 实现没有 getallocatedblocks，此时分配统计恒为0
+    return sys.getallocatedblocks() if hasattr(sys, 'getallocatedblocks') else 0
+
+
+class AnalysisStats:
+    """一个文件的分阶段统计
+
+    每个阶段记录墙钟耗时和 allocated_blocks：阶段结束时比开始时多出的存活内存块数
+    （sys.getallocatedblocks 的差值），阶段中分配后又释放的临时对象不计入，可能为负。
+    同名阶段多次记录时累加；阶段按第一次出现的顺序输出。
+    """
+
+    def __init__(self):
+        self.phases: Dict[str, List[float]] = {}
+        self.cached = False
+        # 超过时间预算而被中断或跳过的模块
+        self.incomplete_modules: List[str] = []
+
+    @contextmanager
+    def phase(self, name: str) -> Iterator[None]:
+        """记录 with 语句块的耗时和分配"""
+        blocks = _allocated_blocks()
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.add(name, time.perf_counter() - start, _allocated_blocks() - blocks)
+
+    def add(self, name: str, seconds: float, allocated_blocks: int = 0):
+        entry = self.phases.get(name)
+        if entry is None:
+            self.phases[name] = [seconds, allocated_blocks]
+        else:
+            entry[0] += seconds
+            entry[1] += allocated_blocks
+
+    def seconds(self, name: str) -> float:
+        entry = self.phases.get(name)
+        return entry[0] if entry else 0.0
+
+    @property
+    def total_seconds(self) -> float:
+        return sum(entry[0] for entry in self.phases.values())
+
+    def to_dict(self) -> Dict:
+        """转换为 --format json 输出和守护进程响应中的 stats 对象"""
+        return {
+            'phases': [{'name': name, 'seconds': round(seconds, 6), 'allocated_blocks': int(blocks)}
+                       for name, (seconds, blocks) in self.phases.items()],
+            'total_seconds': round(self.total_seconds, 6),
+            'cached': self.cached,
+            'incomplete_modules': list(self.incomplete_modules),
+        }
+
+    def format_text(self, module_names: Optional[Dict[str, str]] = None) -> str:
+        """格式化为文本表格，module_names 把模块名映射为显示名"""
+        module_names = module_names or {}
+        total = self.total_seconds
+        lines = ["⏱️  分阶段耗时" + ("（缓存结果）" if self.cached else "") + ":"]
+        for name, (seconds, blocks) in self.phases.items():
+            share = seconds / total * 100 if total > 0 else 0.0
+            label = module_names.get(name, name)
+            lines.append(f"  {_pad(label, 24)} {seconds * 1000:10.2f} ms  {share:5.1f}%  {int(blocks):+10d} 块")
+        lines.append(f"  {_pad('合计', 24)} {total * 1000:10.2f} ms")
+        if self.incomplete_modules:
+            names = ', '.join(module_names.get(name, name) for name in self.incomplete_modules)
+            lines.append(f"  超过时间预算，未完成的模块: {names}")
+        return '\n'.join(lines)
+
+
+def _pad(text: str, width: int) -> str:
+    """按终端显示宽度（中文字符占两列）右侧补齐空格"""
+    display = sum(2 if unicodedata.east_asian_width(ch) in 'WF' else 1 for ch in text)
+    return text + ' ' * max(0, width - display)
+
+
+def timed(stats: Optional[AnalysisStats], name: str):
+    """stats 不为 None 时记录一个阶段，否则不做任何事"""
+    return stats.phase(name) if stats is not None else nullcontext()
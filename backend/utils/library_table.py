@@ -0,0 +1,75 @@
+"""
+标准库查找表 - 从数据文件编译函数与头文件的对应关系和头文件拼写纠正表
+"""
+import hashlib
+import json
+import os
+from functools import lru_cache
+from typing import Dict, Optional, Sequence, Tuple
+
+# 内置的C标准库表
+DEFAULT_TABLE_PATH = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+                                  'data', 'library_headers.json')
+
+
+class LibraryTable:
+    """编译后的查找表
+
+    数据文件的格式为 {"headers": {"stdio.h": {"functions": [...], "misspellings": [...]}}}，
+    多个表按加载顺序合并，后加载的表覆盖先前同名函数的头文件（如 POSIX/glibc 扩展表）。
+    编译结果是两张哈希表：函数名 -> 所需头文件、错误拼写 -> 正确头文件，
+    每个调用点和每条 #include 都只需一次字典查找，与表的大小无关。
+    """
+
+    def __init__(self):
+        self.function_headers: Dict[str, str] = {}
+        self.header_corrections: Dict[str, str] = {}
+        self.known_headers = set()
+        self._digest = hashlib.sha256()
+
+    def add_table(self, data: Dict):
+        """合并一张表"""
+        for header, entry in data.get('headers', {}).items():
+            self.known_headers.add(header)
+            self.header_corrections.pop(header, None)
+            for function in entry.get('functions', ()):
+                self.function_headers[function] = header
+            for misspelling in entry.get('misspellings', ()):
+                # 已知的正确头文件不会被当作其他头文件的错误拼写
+                if misspelling not in self.known_headers:
+                    self.header_corrections[misspelling] = header
+
+    def load(self, path: str):
+        """从JSON文件加载一张表并合并"""
+        with open(path, 'rb') as f:
+            raw = f.read()
+        self.add_table(json.loads(raw.decode('utf-8')))
+        self._digest.update(raw)
+
+    @property
+    def digest(self) -> str:
+        """已加载表内容的摘要，用于区分结果缓存"""
+        return self._digest.hexdigest()[:16]
+
+    def required_header(self, function_name: str) -> Optional[str]:
+        """返回函数所需的头文件，不是已知的库函数时返回 None"""
+        return self.function_headers.get(function_name)
+
+    def correct_header(self, header: str) -> Optional[str]:
+        """返回错误拼写对应的正确头文件，拼写正确或未知时返回 None"""
+        return self.header_corrections.get(header)
+
+
+@lru_cache(maxsize=None)
+def load_library_table(extra_paths: Tuple[str, ...] = ()) -> LibraryTable:
+    """加载内置表和额外的表并编译，同一组路径在进程内只编译一次"""
+    table = LibraryTable()
+    table.load(DEFAULT_TABLE_PATH)
+    for path in extra_paths:
+        table.load(path)
+    return table
+
+
+def library_table_paths(paths: Optional[Sequence[str]]) -> Tuple[str, ...]:
+    """规范化额外表的路径，作为 load_library_table 的缓存键"""
+    return tuple(os.path.abspath(path) for path in paths or ())
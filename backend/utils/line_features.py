@@ -0,0 +1,53 @@
+"""
+行特征位图 - 用子串检查记录一行中出现的关键字和运算符，检测前据此跳过不可能匹配的正则表达式
+
+位图只会多报（注释、字符串或更长的标识符中的子串也算出现），不会漏报：
+某个模式要求的特征不全时，该模式在这一行上一定不匹配。位的定义与 src/lineFeatures.ts 相同。
+"""
+from functools import lru_cache
+
+ALLOC = 1 << 0         # malloc/calloc/realloc
+FREE = 1 << 1
+SCANF = 1 << 2
+PRINTF = 1 << 3
+WHILE = 1 << 4
+FOR = 1 << 5
+DO = 1 << 6
+INCLUDE = 1 << 7       # #include
+STAR = 1 << 8          # *
+ASSIGN = 1 << 9        # =（包括 ==、<= 等）
+PAREN = 1 << 10        # (
+BRACE = 1 << 11        # {
+SEMICOLON = 1 << 12
+TYPE = 1 << 13         # 基本类型关键字 int/char/float/double/long/short/signed/void（unsigned 含 signed）
+STRUCT = 1 << 14
+NULL = 1 << 15
+COMMENT = 1 << 16      # /* 或 */，行中可能改变块注释状态
+
+_SUBSTRINGS = (
+    ('alloc', ALLOC), ('free', FREE), ('scanf', SCANF), ('printf', PRINTF),
+    ('while', WHILE), ('for', FOR), ('do', DO), ('#include', INCLUDE),
+    ('*', STAR), ('=', ASSIGN), ('(', PAREN), ('{', BRACE), (';', SEMICOLON),
+    ('struct', STRUCT), ('NULL', NULL), ('/*', COMMENT), ('*/', COMMENT),
+)
+
+_TYPE_KEYWORDS = ('int', 'char', 'float', 'double', 'long', 'short', 'signed', 'void')
+
+
+@lru_cache(maxsize=1 << 16)
+def line_features(line: str) -> int:
+    """一行的特征位图，按行文本缓存：重复的行和增量分析中未修改的行只计算一次"""
+    features = 0
+    for substring, bit in _SUBSTRINGS:
+        if substring in line:
+            features |= bit
+    for keyword in _TYPE_KEYWORDS:
+        if keyword in line:
+            features |= TYPE
+            break
+    return features
+
+
+def has_all(features: int, required: int) -> bool:
+    """位图中是否包含 required 的所有特征"""
+    return features & required == required
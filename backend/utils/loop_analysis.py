@@ -0,0 +1,293 @@
+"""
+循环分析 - 在控制流图记录的循环上找出条件变量和归纳变量，判断静态不终止的循环
+"""
+from bisect import bisect_right
+from dataclasses import dataclass
+from typing import Callable, Dict, FrozenSet, List, Optional, Sequence, Set, Tuple
+
+from utils.code_parser import find_closing_paren, join_tokens
+from utils.control_flow import ControlFlowGraph, Loop
+from utils.symbol_table import SymbolTable
+
+# 修改左侧变量的赋值运算符与自增自减运算符
+ASSIGNMENT_OPS = frozenset(['=', '+=', '-=', '*=', '/=', '%=', '&=', '|=', '^=', '<<=', '>>='])
+STEP_OPS = frozenset(['++', '--'])
+
+# 调用后不再返回的函数：循环体内调用它们等同于离开循环
+NORETURN_FUNCTIONS = frozenset(['exit', 'abort', '_Exit', 'quick_exit', 'longjmp', 'siglongjmp'])
+
+# 恒为真的常量条件（记号拼接后的文本，for(;;) 的条件为空）
+CONSTANT_TRUE_CONDITIONS = frozenset(['', '1', 'true', '!0', '!NULL', '1==1', '1!=0'])
+
+# 条件中可以出现的运算符；调用、下标、成员访问等其他记号使条件无法分析
+_CONDITION_OPS = frozenset(['<', '>', '<=', '>=', '==', '!=', '!', '&&', '||', '+', '-', '*', '/', '%',
+                            '&', '|', '^', '~', '<<', '>>', '(', ')'])
+_CONSTANT_NAMES = frozenset(['true', 'false', 'NULL'])
+# 形参中出现时说明形参不是按值传递的标量
+_NON_SCALAR_TOKENS = frozenset(['*', '[', '(', '...'])
+# 出现在这些记号之后的 '&' 是二元运算符而不是取地址
+_OPERAND_END = frozenset([')', ']'])
+# 不含这些记号的行不修改变量，建立索引时跳过
+_SCAN_TOKENS = ASSIGNMENT_OPS | STEP_OPS | NORETURN_FUNCTIONS | frozenset(['&'])
+
+
+@dataclass(frozen=True)
+class LoopInfo:
+    """一个循环的分析结果"""
+    loop: Loop
+    # 循环条件的记号（for 循环为第二个子句），条件跨行等无法取得时为 None
+    condition: Optional[Tuple[str, ...]]
+    # 报告中显示的条件文本（for 循环为括号内的全部内容）
+    condition_text: str
+    # 条件恒为真
+    constant_true: bool
+    # 条件中出现的局部变量；条件含有无法分析的部分时为 None
+    condition_variables: Optional[FrozenSet[str]]
+    # 在循环内（条件、for 的第三个子句和循环体）被修改的条件变量
+    induction_variables: FrozenSet[str]
+    # 循环体内是否有离开循环的边或不返回的调用
+    has_exit: bool
+
+    @property
+    def non_terminating(self) -> bool:
+        """条件恒为真，或条件只依赖循环内从未修改的局部变量，且循环无法从内部退出"""
+        if self.has_exit or self.condition is None:
+            return False
+        if self.constant_true:
+            return True
+        return bool(self.condition_variables) and not self.induction_variables
+
+    @property
+    def unchanged_variables(self) -> Tuple[str, ...]:
+        return tuple(sorted(self.condition_variables or ()))
+
+
+class _FunctionIndex:
+    """一个函数内每个变量被修改的行、取地址的变量和不返回的调用所在的行
+
+    每个函数只扫描一次，函数中所有（包括嵌套的）循环共享这份索引，按行区间二分查询。
+    """
+
+    def __init__(self, cfg: ControlFlowGraph, line_tokens: Callable[[int], Sequence[str]]):
+        self.modified: Dict[str, List[int]] = {}
+        self.address_taken: Set[str] = set()
+        self.noreturn_lines: List[int] = []
+        self.parameters: FrozenSet[str] = _scalar_parameters(line_tokens(cfg.start_line))
+        for line_num in range(cfg.start_line, cfg.end_line + 1):
+            tokens = line_tokens(line_num)
+            if tokens and not _SCAN_TOKENS.isdisjoint(tokens):
+                self._scan(line_num, tokens)
+
+    def _scan(self, line_num: int, tokens: Sequence[str]):
+        modified = self.modified
+        for name in modified_names(tokens, 0, self.address_taken):
+            lines = modified.setdefault(name, [])
+            if not lines or lines[-1] != line_num:
+                lines.append(line_num)
+        if not NORETURN_FUNCTIONS.isdisjoint(tokens) and has_noreturn_call(tokens, 0):
+            self.noreturn_lines.append(line_num)
+
+    def modified_between(self, name: str, first: int, last: int) -> bool:
+        """变量是否在 [first, last] 行内被修改"""
+        lines = self.modified.get(name)
+        if not lines:
+            return False
+        index = bisect_right(lines, last) - 1
+        return index >= 0 and lines[index] >= first
+
+    def noreturn_between(self, first: int, last: int) -> bool:
+        index = bisect_right(self.noreturn_lines, last) - 1
+        return index >= 0 and self.noreturn_lines[index] >= first
+
+
+def modified_names(tokens: Sequence[str], start: int, address_taken: Optional[Set[str]] = None) -> Set[str]:
+    """记号中（从 start 开始）被赋值、自增或自减的变量名；取地址的变量名加入 address_taken"""
+    names: Set[str] = set()
+    count = len(tokens)
+    for i in range(start, count):
+        token = tokens[i]
+        if token not in _SCAN_TOKENS:
+            continue
+        if token in ASSIGNMENT_OPS:
+            if i > 0 and tokens[i - 1].isidentifier():
+                names.add(tokens[i - 1])
+        elif token in STEP_OPS:
+            if i > 0 and tokens[i - 1].isidentifier():
+                names.add(tokens[i - 1])
+            if i + 1 < count and tokens[i + 1].isidentifier():
+                names.add(tokens[i + 1])
+        elif token == '&' and address_taken is not None and i + 1 < count and tokens[i + 1].isidentifier():
+            previous = tokens[i - 1] if i > 0 else ''
+            if not (previous.isidentifier() or previous[:1].isdigit() or previous in _OPERAND_END):
+                address_taken.add(tokens[i + 1])
+    return names
+
+
+def has_noreturn_call(tokens: Sequence[str], start: int) -> bool:
+    """记号中（从 start 开始）是否有对不返回函数的调用"""
+    for i in range(start, len(tokens) - 1):
+        if tokens[i] in NORETURN_FUNCTIONS and tokens[i + 1] == '(':
+            return True
+    return False
+
+
+def _scalar_parameters(tokens: Sequence[str]) -> FrozenSet[str]:
+    """函数头中按值传递的标量形参名"""
+    names: Set[str] = set()
+    for i in range(1, len(tokens)):
+        if tokens[i] == '(' and tokens[i - 1].isidentifier():
+            close = find_closing_paren(tokens, i)
+            if close < 0:
+                break
+            parameter: List[str] = []
+            for token in list(tokens[i + 1:close]) + [',']:
+                if token != ',':
+                    parameter.append(token)
+                    continue
+                if parameter and _NON_SCALAR_TOKENS.isdisjoint(parameter) and parameter[-1].isidentifier() \
+                        and len(parameter) > 1:
+                    names.add(parameter[-1])
+                parameter = []
+            break
+    return frozenset(names)
+
+
+def _keyword_condition(tokens: Sequence[str], keyword: str, last: bool) -> Optional[Tuple[int, int]]:
+    """关键字之后括号的 ('(' 下标, ')' 下标)；括号不在同一行内配对时返回 None"""
+    indices = [i for i, token in enumerate(tokens[:-1]) if token == keyword and tokens[i + 1] == '(']
+    if not indices:
+        return None
+    open_index = (indices[-1] if last else indices[0]) + 1
+    close = find_closing_paren(tokens, open_index)
+    return (open_index, close) if close > 0 else None
+
+
+def _for_clauses(tokens: Sequence[str], open_index: int, close: int) -> Optional[Tuple[int, int]]:
+    """for 括号内两个顶层分号的下标"""
+    semicolons = []
+    depth = 0
+    for i in range(open_index + 1, close):
+        token = tokens[i]
+        if token == '(':
+            depth += 1
+        elif token == ')':
+            depth -= 1
+        elif token == ';' and depth == 0:
+            semicolons.append(i)
+    return (semicolons[0], semicolons[1]) if len(semicolons) == 2 else None
+
+
+class LoopAnalyzer:
+    """为文件中所有函数体内的循环计算 LoopInfo，每个函数的修改索引只在第一次需要时构建一次"""
+
+    def __init__(self, control_flow: Sequence[ControlFlowGraph], symbols: SymbolTable,
+                 line_tokens: Callable[[int], Sequence[str]]):
+        self.control_flow = control_flow
+        self.symbols = symbols
+        self.line_tokens = line_tokens
+
+    def analyze(self, check: Optional[Callable[[], None]] = None) -> Dict[int, LoopInfo]:
+        """返回 循环关键字所在行 -> LoopInfo；check 在每个函数之前调用（用于检查时间预算）"""
+        results: Dict[int, LoopInfo] = {}
+        for cfg in self.control_flow:
+            if not cfg.loops:
+                continue
+            if check is not None:
+                check()
+            indexes: List[_FunctionIndex] = []
+
+            def function_index() -> _FunctionIndex:
+                if not indexes:
+                    indexes.append(_FunctionIndex(cfg, self.line_tokens))
+                return indexes[0]
+
+            for line, loop in cfg.loops.items():
+                results[line] = self._analyze_loop(cfg, function_index, loop)
+        return results
+
+    def _analyze_loop(self, cfg: ControlFlowGraph, function_index: Callable[[], _FunctionIndex],
+                      loop: Loop) -> LoopInfo:
+        """分析一个循环；函数的修改索引只在循环没有 break/return 等出口时才需要"""
+        end_line = max(loop.end_line, loop.line)
+        if loop.kind == 'do-while':
+            tokens = self.line_tokens(end_line)
+            parens = _keyword_condition(tokens, 'while', last=True)
+            condition = tuple(tokens[parens[0] + 1:parens[1]]) if parens else None
+            condition_text = join_tokens(list(condition or ()))
+            # 条件行属于循环，整行的修改都计入
+            header_start = None
+            body_first = loop.line
+        else:
+            tokens = self.line_tokens(loop.line)
+            parens = _keyword_condition(tokens, loop.kind, last=False)
+            condition = None
+            condition_text = ''
+            header_start = None
+            if parens is not None:
+                open_index, close = parens
+                condition_text = join_tokens(list(tokens[open_index + 1:close]))
+                if loop.kind == 'for':
+                    clauses = _for_clauses(tokens, open_index, close)
+                    if clauses is not None:
+                        condition = tuple(tokens[clauses[0] + 1:clauses[1]])
+                        # for 的第一个子句只执行一次，不算循环内的修改
+                        header_start = clauses[0] + 1
+                else:
+                    condition = tuple(tokens[open_index + 1:close])
+                    header_start = open_index + 1
+            body_first = loop.line + 1
+
+        constant_true = condition is not None and join_tokens(list(condition)) in CONSTANT_TRUE_CONDITIONS
+        if loop.has_exit or condition is None:
+            return LoopInfo(loop, condition, condition_text, constant_true, None, frozenset(), loop.has_exit)
+        index = function_index()
+        has_exit = (header_start is not None and has_noreturn_call(tokens, header_start)) \
+            or index.noreturn_between(body_first, end_line)
+
+        variables = None
+        if not constant_true and not has_exit:
+            variables = self._condition_variables(cfg, index, condition, loop.line)
+
+        induction: Set[str] = set()
+        if variables:
+            header_modified = modified_names(tokens, header_start) if header_start is not None else set()
+            for name in variables:
+                if name in header_modified or index.modified_between(name, body_first, end_line):
+                    induction.add(name)
+
+        return LoopInfo(
+            loop=loop,
+            condition=condition,
+            condition_text=condition_text,
+            constant_true=constant_true,
+            condition_variables=variables,
+            induction_variables=frozenset(induction),
+            has_exit=has_exit,
+        )
+
+    def _condition_variables(self, cfg: ControlFlowGraph, index: _FunctionIndex,
+                             condition: Sequence[str], line: int) -> Optional[FrozenSet[str]]:
+        """条件中的局部变量；条件含有调用、下标、全局变量、指针等无法确定是否被修改的部分时返回 None"""
+        names: Set[str] = set()
+        for i, token in enumerate(condition):
+            if token in _CONDITION_OPS or token[0].isdigit() or token[0] == "'":
+                continue
+            if not token.isidentifier() or (i + 1 < len(condition) and condition[i + 1] == '('):
+                return None
+            if token in _CONSTANT_NAMES or (token.isupper() and any(c.isalpha() for c in token)):
+                # 宏或枚举常量
+                continue
+            if token in index.address_taken:
+                return None
+            if token in index.parameters:
+                names.add(token)
+                continue
+            symbol = self.symbols.resolve(token, line)
+            if symbol is None or symbol.scope_level == 0 or symbol.info.is_pointer \
+                    or not cfg.contains(symbol.info.line_number):
+                return None
+            declaration = self.line_tokens(symbol.info.line_number)
+            if 'volatile' in declaration or 'static' in declaration:
+                return None
+            names.add(token)
+        return frozenset(names)
@@ -0,0 +1,228 @@
+"""
+流式报告输出 - 每个文件分析完成后立即把报告写到输出中，内存中只保留计数和问题最多的前 N 个文件
+
+输出格式：text（按文件分节的可读文本）、json（与一次性输出相同的报告数组）、
+ndjson（CompactStreamWriter 的紧凑报告流）和 sarif（SARIF 2.1.0）。
+"""
+import heapq
+import json
+import os
+import pathlib
+import string
+import textwrap
+from collections import Counter
+from typing import Any, Dict, List, Optional, TextIO, Tuple
+
+from utils.compact_reports import CompactStreamWriter, dumps_compact
+from utils.error_reporter import REPORT_CATEGORIES, REPORT_TEMPLATES, BugReport, ErrorReporter, Severity
+from utils.instrumentation import AnalysisStats
+
+# 摘要中默认列出的问题最多的文件数
+DEFAULT_TOP_FILES = 10
+
+SARIF_VERSION = '2.1.0'
+SARIF_SCHEMA = 'https://json.schemastore.org/sarif-2.1.0.json'
+
+_SARIF_LEVELS = {Severity.ERROR: 'error', Severity.WARNING: 'warning', Severity.INFO: 'note'}
+
+
+class ReportSummary:
+    """已输出报告的摘要：按严重程度、模块和错误类型的计数，以及问题最多的 top_n 个文件"""
+
+    def __init__(self, top_n: int = DEFAULT_TOP_FILES):
+        self.top_n = top_n
+        self.files = 0
+        self.files_with_issues = 0
+        self.reports = 0
+        self.severities: Counter = Counter()
+        self.modules: Counter = Counter()
+        self.error_types: Counter = Counter()
+        # 最小堆 (问题数, -序号, 文件)：问题数相同时先分析的文件排在前面
+        self._top: List[Tuple[int, int, str]] = []
+
+    def add(self, file_path: str, reports: List[BugReport]):
+        self.files += 1
+        if not reports:
+            return
+        self.files_with_issues += 1
+        self.reports += len(reports)
+        for report in reports:
+            self.severities[report.severity.value] += 1
+            self.modules[report.module_name] += 1
+            self.error_types[report.error_type.value] += 1
+        entry = (len(reports), -self.files, file_path)
+        if len(self._top) < self.top_n:
+            heapq.heappush(self._top, entry)
+        elif self._top and entry > self._top[0]:
+            heapq.heapreplace(self._top, entry)
+
+    def top_files(self) -> List[Tuple[str, int]]:
+        """问题最多的文件 [(文件, 问题数)]，按问题数降序"""
+        return [(file_path, count) for count, _order, file_path in sorted(self._top, reverse=True)]
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            'files': self.files,
+            'files_with_issues': self.files_with_issues,
+            'reports': self.reports,
+            'severities': dict(self.severities),
+            'modules': dict(self.modules),
+            'error_types': dict(self.error_types),
+            'top_files': [{'file': file_path, 'reports': count} for file_path, count in self.top_files()],
+        }
+
+    def format_text(self) -> str:
+        lines = [f"📊 批量检测完成，共分析 {self.files} 个文件，{self.files_with_issues} 个文件中发现 {self.reports} 个问题"]
+        if self.reports:
+            severities = [f"{severity.value} {self.severities[severity.value]}"
+                          for severity in Severity if self.severities[severity.value]]
+            lines.append(f"   按严重程度：{'，'.join(severities)}")
+            modules = [f"{name} {count}" for name, count in self.modules.most_common()]
+            lines.append(f"   按模块：{'，'.join(modules)}")
+            if self._top:
+                lines.append(f"   问题最多的 {len(self._top)} 个文件：")
+                lines.extend(f"   {count:6d}  {file_path}" for file_path, count in self.top_files())
+        return '\n'.join(lines)
+
+
+class TextStreamWriter:
+    """可读文本：每个有问题的文件一节，格式与单个文件的文本报告相同"""
+
+    def __init__(self, output: TextIO):
+        self.output = output
+        self.formatter = ErrorReporter()
+
+    def write_file(self, file_path: str, reports: List[BugReport], stats: Optional[AnalysisStats] = None):
+        if not reports:
+            return
+        self.output.write(f"\n📁 文件: {file_path}\n{self.formatter.format_all_reports(reports)}\n")
+        self.output.flush()
+
+    def close(self, summary: Optional[ReportSummary] = None):
+        if summary is not None:
+            self.output.write('\n' + summary.format_text() + '\n')
+
+
+class JsonStreamWriter:
+    """所有文件的报告组成的一个JSON数组，内容与对全部报告调用 json.dumps(..., indent=2) 相同"""
+
+    def __init__(self, output: TextIO):
+        self.output = output
+        self.reports = 0
+
+    def write_file(self, file_path: str, reports: List[BugReport], stats: Optional[AnalysisStats] = None):
+        for report in reports:
+            text = textwrap.indent(json.dumps(report.to_dict(), indent=2, ensure_ascii=False), '  ')
+            self.output.write(('[\n' if self.reports == 0 else ',\n') + text)
+            self.reports += 1
+        self.output.flush()
+
+    def close(self, summary: Optional[ReportSummary] = None):
+        self.output.write('\n]' if self.reports else '[]')
+
+
+def _has_placeholders(text: str) -> bool:
+    return any(field is not None for _literal, field, _spec, _conversion in string.Formatter().parse(text))
+
+
+def _sarif_rules() -> List[Dict[str, Any]]:
+    """每个报告模板一条规则
+
+    消息和建议模板中的 {0}、{1} 及 {{、}} 与 SARIF 的 messageStrings 语法相同，原样放入 messageStrings；
+    help 是纯文本，只给不依赖参数的建议，并把 {{、}} 还原为花括号。
+    """
+    rules = []
+    for name, template in REPORT_TEMPLATES.items():
+        error_type, severity, module_name = REPORT_CATEGORIES[template.category]
+        rule: Dict[str, Any] = {
+            'id': name,
+            'shortDescription': {'text': error_type.value},
+            'messageStrings': {'default': {'text': template.message},
+                               'suggestion': {'text': template.suggestion}},
+        }
+        if not _has_placeholders(template.suggestion):
+            rule['help'] = {'text': template.suggestion.format()}
+        rule['defaultConfiguration'] = {'level': _SARIF_LEVELS[severity]}
+        rule['properties'] = {'module': module_name}
+        rules.append(rule)
+    return rules
+
+
+def _artifact_uri(file_path: str) -> str:
+    if os.path.isabs(file_path):
+        return pathlib.Path(file_path).as_uri()
+    return file_path.replace(os.sep, '/')
+
+
+class SarifStreamWriter:
+    """SARIF 2.1.0 日志：一个 run，规则表在开头写出，之后每个报告一个 result，关闭时附上摘要
+
+    不是按模板生成的报告以错误类型的枚举名作为 ruleId。
+    """
+
+    def __init__(self, output: TextIO, detector_version: str):
+        self.output = output
+        self.results = 0
+        driver = {'name': 'C Bug Detector', 'version': detector_version, 'rules': _sarif_rules()}
+        self.output.write(f'{{"$schema":{json.dumps(SARIF_SCHEMA)},"version":"{SARIF_VERSION}",'
+                          f'"runs":[{{"tool":{dumps_compact({"driver": driver})},"results":[')
+
+    def write_file(self, file_path: str, reports: List[BugReport], stats: Optional[AnalysisStats] = None):
+        uri = _artifact_uri(file_path)
+        for report in reports:
+            region: Dict[str, Any] = {'startLine': max(1, report.line_number)}
+            if report.code_snippet:
+                region['snippet'] = {'text': report.code_snippet}
+            properties: Dict[str, Any] = {'module': report.module_name, 'errorType': report.error_type.value,
+                                          'suggestion': report.suggestion}
+            if report.partial:
+                properties['partial'] = True
+            result = {
+                'ruleId': report.template or report.error_type.name.lower(),
+                'level': _SARIF_LEVELS[report.severity],
+                'message': {'text': report.message},
+                'locations': [{'physicalLocation': {'artifactLocation': {'uri': uri}, 'region': region}}],
+                'properties': properties,
+            }
+            self.output.write(('\n' if self.results == 0 else ',\n') + dumps_compact(result))
+            self.results += 1
+        self.output.flush()
+
+    def close(self, summary: Optional[ReportSummary] = None):
+        properties = {'summary': summary.to_dict()} if summary is not None else {}
+        self.output.write(f'\n],"properties":{dumps_compact(properties)}}}]}}\n')
+
+
+class StreamingReporter:
+    """把每个文件的报告立即交给输出格式的写出器，并累计摘要；报告本身不在内存中保留
+
+    writer 为上面的写出器之一或 CompactStreamWriter，write_file 可以直接作为 analyze_files 的 on_result。
+    """
+
+    def __init__(self, writer, top_n: int = DEFAULT_TOP_FILES):
+        self.writer = writer
+        self.summary = ReportSummary(top_n)
+
+    def write_file(self, file_path: str, reports: List[BugReport], stats: Optional[AnalysisStats] = None):
+        self.writer.write_file(file_path, reports, stats)
+        self.summary.add(file_path, reports)
+
+    def close(self) -> ReportSummary:
+        self.writer.close(self.summary)
+        return self.summary
+
+
+def open_report_stream(output_format: str, output: TextIO, detector_version: str,
+                       top_n: int = DEFAULT_TOP_FILES) -> StreamingReporter:
+    """按输出格式（text、json、ndjson、sarif）创建流式报告器"""
+    if output_format == 'text':
+        writer = TextStreamWriter(output)
+    elif output_format == 'json':
+        writer = JsonStreamWriter(output)
+    elif output_format == 'ndjson':
+        writer = CompactStreamWriter(output, detector_version)
+    elif output_format == 'sarif':
+        writer = SarifStreamWriter(output, detector_version)
+    else:
+        raise ValueError(f"不支持流式输出的格式: {output_format}")
+    return StreamingReporter(writer, top_n)
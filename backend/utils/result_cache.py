@@ -0,0 +1,70 @@
+"""
+结果缓存 - 以文件内容哈希为键的持久化检测结果缓存
+"""
+import hashlib
+import json
+import os
+import tempfile
+from typing import Iterable, List, Optional
+
+from utils.compact_reports import ReportArena
+from utils.error_reporter import BugReport
+
+
+class ResultCache:
+    """磁盘结果缓存
+
+    缓存键由文件内容哈希、启用的模块集合、所包含的工作区头文件的摘要和检测器版本共同决定，
+    内容未变化的文件可以直接复用上次的 BugReport 列表。报告以紧凑格式（ReportArena）保存。
+    每个条目单独存成一个JSON文件并通过原子重命名写入，多个进程可以安全地共享同一目录。
+    """
+
+    def __init__(self, cache_dir: str, detector_version: str):
+        self.cache_dir = cache_dir
+        self.detector_version = detector_version
+        self.hits = 0
+        self.misses = 0
+
+    def make_key(self, content: bytes, enabled_modules: Iterable[str], dependencies: str = '') -> str:
+        """计算缓存键，dependencies 为所包含的工作区头文件摘要的组合哈希"""
+        digest = hashlib.sha256()
+        digest.update(self.detector_version.encode('utf-8'))
+        digest.update(b'\0')
+        digest.update(','.join(sorted(enabled_modules)).encode('utf-8'))
+        digest.update(b'\0')
+        digest.update(dependencies.encode('utf-8'))
+        digest.update(b'\0')
+        digest.update(content)
+        return digest.hexdigest()
+
+    def get(self, key: str) -> Optional[List[BugReport]]:
+        """读取缓存的报告列表，未命中或条目损坏时返回 None"""
+        try:
+            with open(self._entry_path(key), 'r', encoding='utf-8') as f:
+                data = json.load(f)
+            reports = ReportArena.from_dict(data)
+        except (OSError, ValueError, KeyError, IndexError, TypeError):
+            self.misses += 1
+            return None
+        self.hits += 1
+        return reports
+
+    def put(self, key: str, reports: List[BugReport]):
+        """写入缓存条目，写入失败时静默忽略"""
+        path = self._entry_path(key)
+        tmp_path = None
+        try:
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            fd, tmp_path = tempfile.mkstemp(dir=os.path.dirname(path), suffix='.tmp')
+            with os.fdopen(fd, 'w', encoding='utf-8') as f:
+                entry = {'version': self.detector_version}
+                entry.update(ReportArena().to_dict(reports))
+                json.dump(entry, f, ensure_ascii=False, separators=(',', ':'))
+            os.replace(tmp_path, path)
+        except OSError:
+            if tmp_path and os.path.exists(tmp_path):
+                os.unlink(tmp_path)
+
+    def _entry_path(self, key: str) -> str:
+        """按键的前两位分目录存放，避免单目录文件过多"""
+        return os.path.join(self.cache_dir, key[:2], key + '.json')
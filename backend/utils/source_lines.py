@@ -0,0 +1,80 @@
+"""
+源代码行 - 只保存每行的起始偏移，按需从内存映射的文件中取出行文本
+"""
+import mmap
+from array import array
+from typing import Iterator, Sequence, Tuple, Union
+
+from utils.c_lexer import CLexer
+
+Buffer = Union[bytes, mmap.mmap]
+
+
+def open_source_buffer(file_path: str) -> Buffer:
+    """以只读方式内存映射文件，空文件或无法映射时回退为读入字节串"""
+    with open(file_path, 'rb') as f:
+        try:
+            return mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except (ValueError, OSError):
+            # 空文件不能映射，管道等特殊文件不支持映射
+            return f.read()
+
+
+def iter_buffer_lines(buffer: Buffer) -> Iterator[Tuple[int, str]]:
+    """逐行产出 (行起始偏移, 解码后的行文本)，行数与 content.split('\\n') 一致"""
+    find = buffer.find
+    pos = 0
+    size = len(buffer)
+    while True:
+        end = find(b'\n', pos)
+        if end < 0:
+            end = size
+        raw = buffer[pos:end]
+        if raw.endswith(b'\r'):
+            raw = raw[:-1]
+        yield pos, raw.decode('utf-8')
+        if end >= size:
+            return
+        pos = end + 1
+
+
+class SourceLines(Sequence):
+    """按行号访问的去注释源代码行
+
+    只保存每行在缓冲区中的起始偏移和行首是否处于块注释中，
+    取出某一行时才解码并去除注释，因此只有产生报告的行才会生成文本。
+    """
+
+    def __init__(self, buffer: Buffer, line_offsets: array, comment_states: bytearray):
+        # line_offsets 比行数多一项，最后一项为缓冲区末尾之后的位置
+        self.buffer = buffer
+        self.line_offsets = line_offsets
+        self.comment_states = comment_states
+        self._lexer = CLexer()
+
+    def __len__(self) -> int:
+        return len(self.comment_states)
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(len(self)))]
+        if index < 0:
+            index += len(self)
+        if not 0 <= index < len(self):
+            raise IndexError('line index out of range')
+
+        raw = self.buffer[self.line_offsets[index]:self.line_offsets[index + 1] - 1]
+        if raw.endswith(b'\r'):
+            raw = raw[:-1]
+        line = raw.decode('utf-8')
+
+        in_block_comment = bool(self.comment_states[index])
+        if in_block_comment or '/' in line:
+            self._lexer.in_block_comment = in_block_comment
+            line = self._lexer.strip_comments(line)
+        return line
+
+    def close(self):
+        """释放内存映射"""
+        if isinstance(self.buffer, mmap.mmap):
+            self.buffer.close()
@@ -0,0 +1,139 @@
+"""
+符号表 - 按名称哈希索引的作用域符号表，记录每个变量的使用位置
+"""
+from bisect import bisect_right
+from dataclasses import dataclass, field
+from typing import Dict, Iterator, List, Optional, Sequence
+
+from utils.code_parser import LineFacts, VariableInfo
+
+
+@dataclass
+class Symbol:
+    """一个变量声明及其在作用域内的使用位置"""
+    info: VariableInfo
+    scope_level: int
+    index: int = 0                         # 在文件所有声明中的稠密编号
+    scope_end: Optional[int] = None        # 作用域结束的行号，None 表示直到文件末尾
+    deref_lines: List[int] = field(default_factory=list)
+    assignment_lines: List[int] = field(default_factory=list)
+    free_lines: List[int] = field(default_factory=list)
+    malloc_lines: List[int] = field(default_factory=list)
+
+    @property
+    def name(self) -> str:
+        return self.info.name
+
+    def is_visible_at(self, line_num: int) -> bool:
+        """判断该声明在指定行是否可见"""
+        return self.info.line_number <= line_num and (self.scope_end is None or line_num <= self.scope_end)
+
+
+class SymbolTable:
+    """作用域符号表
+
+    构建时按行维护作用域栈：每个名称对应一个遮蔽栈，离开作用域时弹出该作用域声明的名称，
+    使用位置总是归属于当时可见的最内层声明。构建完成后按名称查找为 O(1)，
+    按行解析同名声明时先二分定位到该行之前的最后一个声明。
+    """
+
+    def __init__(self):
+        self.symbols: List[Symbol] = []
+        self._by_name: Dict[str, List[Symbol]] = {}
+        self._lines_by_name: Dict[str, List[int]] = {}
+        self._visible: Dict[str, List[Symbol]] = {}
+        self._scopes: List[List[str]] = [[]]
+
+    def __iter__(self) -> Iterator[Symbol]:
+        return iter(self.symbols)
+
+    def __len__(self) -> int:
+        return len(self.symbols)
+
+    @classmethod
+    def build(cls, variables: Sequence[VariableInfo], line_facts: Sequence[Optional[LineFacts]],
+              pointer_dereferences: Sequence[Dict], assignments: Sequence[Dict],
+              free_calls: Sequence[Dict], malloc_calls: Sequence[Dict]) -> 'SymbolTable':
+        """按行顺序一次遍历声明、使用记录和作用域变化来构建符号表"""
+        table = cls()
+        declarations = _group_by_line(variables, lambda var: var.line_number)
+        uses = _group_by_line(pointer_dereferences, lambda item: item['line'])
+        assigned = _group_by_line(assignments, lambda item: item['line'])
+        freed = _group_by_line(free_calls, lambda item: item['line'])
+        allocated = _group_by_line(malloc_calls, lambda item: item['line'])
+
+        for line_num, facts in enumerate(line_facts, 1):
+            if facts is None:
+                continue
+
+            for var in declarations.get(line_num, ()):
+                table._declare(var)
+            for deref in uses.get(line_num, ()):
+                table._record(deref['pointer'], 'deref_lines', line_num)
+            for assignment in assigned.get(line_num, ()):
+                table._record(assignment['variable'], 'assignment_lines', line_num)
+            for free_call in freed.get(line_num, ()):
+                if free_call['variable']:
+                    table._record(free_call['variable'], 'free_lines', line_num)
+            for malloc_call in allocated.get(line_num, ()):
+                table._record(malloc_call['variable'], 'malloc_lines', line_num)
+
+            delta = facts.brace_delta
+            while delta > 0:
+                table._scopes.append([])
+                delta -= 1
+            while delta < 0 and len(table._scopes) > 1:
+                table._exit_scope(line_num)
+                delta += 1
+
+        table._visible.clear()
+        for name, symbols in table._by_name.items():
+            table._lines_by_name[name] = [symbol.info.line_number for symbol in symbols]
+        return table
+
+    def lookup(self, name: str) -> Optional[Symbol]:
+        """返回文件中第一个同名声明"""
+        symbols = self._by_name.get(name)
+        return symbols[0] if symbols else None
+
+    def lookup_all(self, name: str) -> List[Symbol]:
+        """返回所有同名声明（按声明顺序）"""
+        return self._by_name.get(name, [])
+
+    def resolve(self, name: str, line_num: int) -> Optional[Symbol]:
+        """返回指定行可见的最内层同名声明"""
+        symbols = self._by_name.get(name)
+        if not symbols:
+            return None
+        # 声明按行号顺序排列，只需检查该行之前的声明
+        for index in range(bisect_right(self._lines_by_name[name], line_num) - 1, -1, -1):
+            if symbols[index].is_visible_at(line_num):
+                return symbols[index]
+        return None
+
+    def _declare(self, var: VariableInfo):
+        """在当前作用域声明变量"""
+        symbol = Symbol(info=var, scope_level=len(self._scopes) - 1, index=len(self.symbols))
+        self.symbols.append(symbol)
+        self._by_name.setdefault(var.name, []).append(symbol)
+        self._visible.setdefault(var.name, []).append(symbol)
+        self._scopes[-1].append(var.name)
+
+    def _record(self, name: str, kind: str, line_num: int):
+        """把一次使用记到当前可见的声明上，未声明的名称忽略"""
+        stack = self._visible.get(name)
+        if stack:
+            getattr(stack[-1], kind).append(line_num)
+
+    def _exit_scope(self, line_num: int):
+        """离开当前作用域，弹出其中声明的名称"""
+        for name in self._scopes.pop():
+            self._visible[name].pop().scope_end = line_num
+
+
+def _group_by_line(items: Sequence, key) -> Dict[int, List]:
+    """按行号分组"""
+    grouped: Dict[int, List] = {}
+    for item in items:
+        grouped.setdefault(key(item), []).append(item)
+    return grouped
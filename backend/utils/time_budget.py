@@ -0,0 +1,28 @@
+"""
+时间预算 - 限制单个文件的分析时间，超时后跳过尚未完成的检测模块
+"""
+import time
+from typing import Optional
+
+
+class BudgetExceeded(Exception):
+    """分析超过了时间预算，由检测模块中的检查点抛出"""
+
+
+class TimeBudget:
+    """一个文件的分析期限
+
+    seconds 为 None 或不大于0时不限制时间。检测模块在每个函数、每条语句等检查点调用 check，
+    超过期限时抛出 BudgetExceeded，由 CBugDetector 把该模块已产生的报告标记为部分结果。
+    """
+
+    def __init__(self, seconds: Optional[float] = None):
+        self.seconds = seconds if seconds and seconds > 0 else None
+        self.deadline = time.perf_counter() + self.seconds if self.seconds else None
+
+    def expired(self) -> bool:
+        return self.deadline is not None and time.perf_counter() > self.deadline
+
+    def check(self):
+        if self.expired():
+            raise BudgetExceeded(f"超过时间预算 {self.seconds} 秒")
@@ -0,0 +1,271 @@
+import { AnalysisResult } from './cDetector';
+import { CancellationSignal } from './workerPool';
+
+// 优先级数值越小越先执行；可见编辑器中的文件总是按 Visible 执行
+export enum AnalysisPriority {
+    Visible = 0,
+    Open = 1,
+    Background = 2
+}
+
+// 最近一次编辑之后这么久内不启动新的后台任务
+const TYPING_PAUSE_MS = 1500;
+
+/**
+ * 调度器自己创建的取消信号，用于中断被取代的任务
+ */
+class SignalSource implements CancellationSignal {
+    private listeners: Set<() => void> = new Set();
+    private cancelled = false;
+
+    public get isCancellationRequested(): boolean {
+        return this.cancelled;
+    }
+
+    public onCancellationRequested(listener: () => void): { dispose(): void } {
+        this.listeners.add(listener);
+        return { dispose: () => this.listeners.delete(listener) };
+    }
+
+    public cancel(): void {
+        if (this.cancelled) {
+            return;
+        }
+        this.cancelled = true;
+        for (const listener of [...this.listeners]) {
+            listener();
+        }
+        this.listeners.clear();
+    }
+}
+
+interface ScheduledJob {
+    key: string;
+    priority: AnalysisPriority;
+    sequence: number;
+    task: (token: CancellationSignal) => Promise<AnalysisResult>;
+    resolve: (result: AnalysisResult) => void;
+    source: SignalSource;
+    state: 'debouncing' | 'queued' | 'running' | 'done';
+    timer?: NodeJS.Timeout;
+    cancellation?: { dispose(): void };
+}
+
+/**
+ * 分析任务调度器
+ *
+ * 所有分析（保存、编辑、打开文件和工作区扫描）都经过这里：同时执行的任务数不超过 concurrency，
+ * 空出的位置按优先级（可见编辑器 > 打开的文档 > 后台扫描）分配，同一优先级按提交顺序。
+ * 同一文件提交新任务时，取消该文件所有优先级不高于新任务的旧任务（排队中的直接丢弃，运行中的发出取消），
+ * 它们以 cancelled 结果结束；debounceMs 大于0的任务在等待期间被取代时从不执行。
+ * 用户编辑时（notifyTyping）暂停启动新的后台任务，已在运行的任务不受影响。
+ */
+export class AnalysisScheduler {
+    private jobs: Map<string, Set<ScheduledJob>> = new Map();
+    private queue: ScheduledJob[] = [];
+    private running = 0;
+    private nextSequence = 0;
+    private visible: Set<string> = new Set();
+    private pausedUntil = 0;
+    private resumeTimer?: NodeJS.Timeout;
+    private disposed = false;
+
+    constructor(private concurrency: () => number) {}
+
+    public schedule(key: string, priority: AnalysisPriority,
+                    task: (token: CancellationSignal) => Promise<AnalysisResult>,
+                    debounceMs = 0, token?: CancellationSignal): Promise<AnalysisResult> {
+        if (this.disposed) {
+            return Promise.resolve(this.cancelled(key, '分析调度器已关闭'));
+        }
+        if (token && token.isCancellationRequested) {
+            return Promise.resolve(this.cancelled(key, '分析已取消'));
+        }
+
+        const existing = this.jobs.get(key);
+        if (existing) {
+            for (const job of [...existing]) {
+                if (job.priority >= priority) {
+                    this.cancel(job, '已被同一文件更新的分析取代');
+                }
+            }
+        }
+
+        return new Promise(resolve => {
+            const job: ScheduledJob = {
+                key,
+                priority,
+                sequence: this.nextSequence++,
+                task,
+                resolve,
+                source: new SignalSource(),
+                state: 'debouncing'
+            };
+            let jobs = this.jobs.get(key);
+            if (!jobs) {
+                jobs = new Set();
+                this.jobs.set(key, jobs);
+            }
+            jobs.add(job);
+            if (token) {
+                job.cancellation = token.onCancellationRequested(() => this.cancel(job, '分析已取消'));
+            }
+            if (debounceMs > 0) {
+                job.timer = setTimeout(() => this.enqueue(job), debounceMs);
+            } else {
+                this.enqueue(job);
+            }
+        });
+    }
+
+    /**
+     * 可见编辑器中的文件，排队中的任务按 Visible 优先级执行
+     */
+    public setVisible(keys: Iterable<string>): void {
+        this.visible = new Set(keys);
+    }
+
+    /**
+     * 用户正在编辑：在 TYPING_PAUSE_MS 内不启动新的后台任务
+     */
+    public notifyTyping(): void {
+        this.pausedUntil = Date.now() + TYPING_PAUSE_MS;
+    }
+
+    public dispose(): void {
+        this.disposed = true;
+        if (this.resumeTimer) {
+            clearTimeout(this.resumeTimer);
+        }
+        for (const jobs of [...this.jobs.values()]) {
+            for (const job of [...jobs]) {
+                this.cancel(job, '分析调度器已关闭');
+            }
+        }
+    }
+
+    private enqueue(job: ScheduledJob): void {
+        if (job.state !== 'debouncing') {
+            return;
+        }
+        job.timer = undefined;
+        job.state = 'queued';
+        this.queue.push(job);
+        this.dispatch();
+    }
+
+    private effectivePriority(job: ScheduledJob): AnalysisPriority {
+        return this.visible.has(job.key) ? AnalysisPriority.Visible : job.priority;
+    }
+
+    /**
+     * 空出的位置交给优先级最高、提交最早的任务；暂停期间跳过后台任务，暂停结束后再分发
+     */
+    private dispatch(): void {
+        const limit = Math.max(1, this.concurrency());
+        while (this.running < limit && this.queue.length > 0) {
+            const paused = Date.now() < this.pausedUntil;
+            let best = -1;
+            for (let i = 0; i < this.queue.length; i++) {
+                const job = this.queue[i];
+                const priority = this.effectivePriority(job);
+                if (paused && priority === AnalysisPriority.Background) {
+                    continue;
+                }
+                if (best < 0 || priority < this.effectivePriority(this.queue[best])
+                    || (priority === this.effectivePriority(this.queue[best]) && job.sequence < this.queue[best].sequence)) {
+                    best = i;
+                }
+            }
+            if (best < 0) {
+                this.scheduleResume();
+                return;
+            }
+            const [job] = this.queue.splice(best, 1);
+            this.start(job);
+        }
+    }
+
+    private scheduleResume(): void {
+        if (this.resumeTimer) {
+            return;
+        }
+        this.resumeTimer = setTimeout(() => {
+            this.resumeTimer = undefined;
+            this.dispatch();
+        }, Math.max(0, this.pausedUntil - Date.now()));
+    }
+
+    private start(job: ScheduledJob): void {
+        job.state = 'running';
+        this.running++;
+        const settle = (result: AnalysisResult) => {
+            this.running--;
+            this.finish(job, result);
+            if (!this.disposed) {
+                this.dispatch();
+            }
+        };
+        let run: Promise<AnalysisResult>;
+        try {
+            run = job.task(job.source);
+        } catch (error) {
+            run = Promise.resolve(this.failure(job.key, `分析失败: ${error}`));
+        }
+        run.then(settle, error => settle(this.failure(job.key, `分析失败: ${error}`)));
+    }
+
+    /**
+     * 取消任务：等待中和排队中的任务直接结束，运行中的任务发出取消后立即以 cancelled 结果结束
+     * （之后返回的结果被忽略，其占用的位置在任务真正结束时释放）
+     */
+    private cancel(job: ScheduledJob, message: string): void {
+        if (job.state === 'done') {
+            return;
+        }
+        if (job.timer) {
+            clearTimeout(job.timer);
+            job.timer = undefined;
+        }
+        if (job.state === 'queued') {
+            const index = this.queue.indexOf(job);
+            if (index >= 0) {
+                this.queue.splice(index, 1);
+            }
+        } else if (job.state === 'running') {
+            job.source.cancel();
+        }
+        this.finish(job, this.cancelled(job.key, message));
+    }
+
+    private finish(job: ScheduledJob, result: AnalysisResult): void {
+        if (job.state === 'done') {
+            return;
+        }
+        job.state = 'done';
+        if (job.cancellation) {
+            job.cancellation.dispose();
+        }
+        const jobs = this.jobs.get(job.key);
+        if (jobs) {
+            jobs.delete(job);
+            if (jobs.size === 0) {
+                this.jobs.delete(job.key);
+            }
+        }
+        job.resolve(result);
+    }
+
+    private cancelled(key: string, message: string): AnalysisResult {
+        return { ...this.failure(key, message), cancelled: true };
+    }
+
+    private failure(key: string, message: string): AnalysisResult {
+        return {
+            file_path: key,
+            reports: [],
+            success: false,
+            error: message
+        };
+    }
+}
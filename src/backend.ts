@@ -1,24 +1,410 @@
 import * as vscode from 'vscode';
 import * as path from 'path';
 import * as fs from 'fs';
+import * as os from 'os';
+import * as cp from 'child_process';
+import { AnalysisPriority, AnalysisScheduler } from './analysisScheduler';
 import { CDetector, BugReport, AnalysisResult } from './cDetector';
+import { scanIncludes } from './includeGraph';
+import { IncrementalAnalyzer } from './incrementalAnalyzer';
+import { AnalysisJob, CancellationSignal, DetectorWorkerPool } from './workerPool';
 
-export { BugReport, AnalysisResult };
+export { BugReport, AnalysisResult, AnalysisPriority };
+
+// 工作区扫描的汇总信息（各文件的结果通过回调流式返回，不在这里保存）
+export interface ScanSummary {
+    totalFiles: number;
+    totalIssues: number;
+}
+
+// 配置项与模块名的对应关系
+const MODULE_SETTINGS: { [setting: string]: string } = {
+    enableMemorySafety: 'memory_safety',
+    enableVariableState: 'variable_state',
+    enableStandardLibrary: 'standard_library',
+    enableNumericControlFlow: 'numeric_control_flow'
+};
+
+// Python后端的严重程度取值与TypeScript检测器的对应关系
+const PYTHON_SEVERITIES: { [severity: string]: string } = {
+    '错误': 'Error',
+    '警告': 'Warning',
+    '提示': 'Info'
+};
+
+// 紧凑格式中错误类型和严重程度的编号顺序（与后端 compact_reports.py 的 ERROR_TYPES、SEVERITIES 相同）
+const COMPACT_ERROR_TYPES = ['内存安全', '变量状态', '标准库使用', '数值与控制流'];
+const COMPACT_SEVERITIES = ['Error', 'Warning', 'Info'];
+const COMPACT_FLAG_PARTIAL = 1;
+
+// 紧凑格式的模板：[名称, 错误类型编号, 严重程度编号, 模块名称, 消息, 建议]，名称为 null 时消息和建议没有参数
+type CompactTemplate = [string | null, number, number, string, string, string];
+
+function formatTemplate(text: string, args: string[]): string {
+    return text.replace(/\{\{|\}\}|\{(\d+)\}/g, (match: string, index: string) =>
+        index !== undefined ? args[Number(index)] : match[0]);
+}
+
+/**
+ * 把紧凑格式的报告行 [行号, 模板编号, 代码片段编号, 标志, 参数编号...] 还原为报告
+ */
+export function decodeCompactRows(templates: CompactTemplate[], strings: string[], rows: number[][]): BugReport[] {
+    return rows.map(row => {
+        const [name, errorType, severity, moduleName, message, suggestion] = templates[row[1]];
+        const args = row.slice(4).map(index => strings[index]);
+        const report: BugReport = {
+            line_number: row[0],
+            error_type: COMPACT_ERROR_TYPES[errorType],
+            severity: COMPACT_SEVERITIES[severity],
+            message: name !== null ? formatTemplate(message, args) : message,
+            suggestion: name !== null ? formatTemplate(suggestion, args) : suggestion,
+            code_snippet: row[2] >= 0 ? strings[row[2]] : '',
+            module_name: moduleName
+        };
+        if (row[3] & COMPACT_FLAG_PARTIAL) {
+            report.partial = true;
+        }
+        return report;
+    });
+}
+
+// 超过时间预算后，再等待这么久仍未收到 done 消息时重启Python后端
+const DAEMON_TIMEOUT_GRACE_MS = 5000;
+
+interface DaemonRequest {
+    filePath: string;
+    // invalidate 请求返回的依赖文件
+    dependents?: string[];
+    reports: BugReport[];
+    resolve: (result: AnalysisResult) => void;
+    cancellation?: { dispose(): void };
+    timer?: NodeJS.Timeout;
+}
+
+/**
+ * Python守护进程客户端
+ *
+ * 首次请求时启动 `main.py --serve`，之后保持进程常驻；请求和响应都是逐行JSON，
+ * 报告使用紧凑格式（模板只随第一次使用它的消息发送一次），
+ * 一个请求的报告可能分多批返回，收到 done 消息后才完成该请求。进程退出后下次请求时自动重启。
+ * 取消的请求立即返回，之后到达的该请求的消息被忽略；超过时间预算后仍未完成的请求会重启后端。
+ */
+export class PythonDaemonClient {
+    private process?: cp.ChildProcess;
+    private pending: Map<number, DaemonRequest> = new Map();
+    private nextId = 1;
+    private buffer = '';
+    // 当前进程已发送的紧凑格式模板，进程重启时清空
+    private templates: CompactTemplate[] = [];
+
+    constructor(private pythonPath: string, private scriptPath: string, private includeDirs: string[] = []) {}
+
+    public analyze(job: AnalysisJob, token?: CancellationSignal): Promise<AnalysisResult> {
+        return new Promise(resolve => {
+            if (token && token.isCancellationRequested) {
+                resolve(this.cancelled(job.filePath));
+                return;
+            }
+
+            let child: cp.ChildProcess;
+            try {
+                child = this.ensureProcess();
+            } catch (error) {
+                resolve(this.failure(job.filePath, `无法启动Python后端: ${error}`));
+                return;
+            }
+
+            const id = this.nextId++;
+            const request: DaemonRequest = { filePath: job.filePath, reports: [], resolve };
+            if (token) {
+                request.cancellation = token.onCancellationRequested(() => this.finish(id, this.cancelled(job.filePath)));
+            }
+            this.pending.set(id, request);
+
+            const params: { [key: string]: any } = { file_path: job.filePath, modules: job.enabledModules, format: 'compact' };
+            if (job.content !== undefined) {
+                params.content = job.content;
+            }
+            if (job.timeBudgetMs && job.timeBudgetMs > 0) {
+                params.time_budget_ms = job.timeBudgetMs;
+                // 守护进程按顺序处理请求，计时包括排在前面的请求
+                request.timer = setTimeout(() => {
+                    this.finish(id, this.failure(job.filePath, `分析超过时间预算 ${job.timeBudgetMs} ms，已重启Python后端`));
+                    if (this.process === child) {
+                        child.kill();
+                    }
+                }, job.timeBudgetMs * this.pending.size + DAEMON_TIMEOUT_GRACE_MS);
+            }
+            child.stdin!.write(JSON.stringify({ id, method: 'analyze', params }) + '\n');
+        });
+    }
+
+    /**
+     * 通知后端头文件已变化，返回它分析过的、直接或间接包含该头文件的文件；后端未启动时返回空列表
+     */
+    public invalidate(headerPath: string): Promise<string[]> {
+        return new Promise(resolve => {
+            const child = this.process;
+            if (!child) {
+                resolve([]);
+                return;
+            }
+            const id = this.nextId++;
+            this.pending.set(id, {
+                filePath: headerPath,
+                reports: [],
+                resolve: result => resolve(result.dependencies || [])
+            });
+            child.stdin!.write(JSON.stringify({ id, method: 'invalidate', params: { file_path: headerPath } }) + '\n');
+        });
+    }
+
+    /**
+     * 以给定结果结束请求；已结束的请求忽略
+     */
+    private finish(id: number, result: AnalysisResult): void {
+        const request = this.pending.get(id);
+        if (!request) {
+            return;
+        }
+        this.pending.delete(id);
+        if (request.timer) {
+            clearTimeout(request.timer);
+        }
+        if (request.cancellation) {
+            request.cancellation.dispose();
+        }
+        request.resolve(result);
+    }
+
+    public dispose(): void {
+        const child = this.process;
+        this.process = undefined;
+        this.failAll('Python后端已关闭');
+        if (child) {
+            // 关闭标准输入后守护进程会自行退出
+            child.stdin!.end();
+        }
+    }
+
+    private ensureProcess(): cp.ChildProcess {
+        if (this.process) {
+            return this.process;
+        }
+
+        const args = [this.scriptPath, '--serve'];
+        for (const directory of this.includeDirs) {
+            args.push('--include-dir', directory);
+        }
+        const child = cp.spawn(this.pythonPath, args, {
+            cwd: path.dirname(this.scriptPath),
+            stdio: ['pipe', 'pipe', 'pipe']
+        });
+        this.buffer = '';
+        this.templates = [];
+
+        child.stdout!.setEncoding('utf8');
+        child.stdout!.on('data', (chunk: string) => this.onData(chunk));
+        child.stderr!.on('data', chunk => console.error(`Python后端: ${chunk}`));
+        child.stdin!.on('error', error => console.error('写入Python后端失败:', error));
+        child.on('error', error => this.onExit(child, `无法启动Python后端: ${error.message}`));
+        child.on('exit', code => this.onExit(child, `Python后端已退出: ${code}`));
+
+        this.process = child;
+        return child;
+    }
+
+    private onData(chunk: string): void {
+        this.buffer += chunk;
+        let newline: number;
+        while ((newline = this.buffer.indexOf('\n')) >= 0) {
+            const line = this.buffer.substring(0, newline).trim();
+            this.buffer = this.buffer.substring(newline + 1);
+            if (line) {
+                try {
+                    this.onMessage(JSON.parse(line));
+                } catch (error) {
+                    console.error('无法解析Python后端的响应:', line);
+                }
+            }
+        }
+    }
+
+    private onMessage(message: any): void {
+        // 模板在整个进程内编号，已取消或已超时的请求的消息中的模板也要保留
+        if (Array.isArray(message.templates)) {
+            this.templates.push(...message.templates);
+        }
+
+        const request = this.pending.get(message.id);
+        if (!request) {
+            return;
+        }
+
+        if (Array.isArray(message.rows)) {
+            request.reports.push(...decodeCompactRows(this.templates, message.strings, message.rows));
+        }
+        if (Array.isArray(message.reports)) {
+            for (const report of message.reports) {
+                request.reports.push({
+                    ...report,
+                    severity: PYTHON_SEVERITIES[report.severity] || report.severity
+                });
+            }
+        }
+
+        if (message.error !== undefined) {
+            this.finish(message.id, this.failure(request.filePath, message.error));
+        } else if (message.done) {
+            const result: AnalysisResult = {
+                file_path: request.filePath,
+                reports: request.reports,
+                success: true,
+                stats: message.stats
+            };
+            if (message.partial) {
+                result.partial = true;
+                result.incomplete_modules = message.incomplete_modules;
+            }
+            if (Array.isArray(message.dependents)) {
+                result.dependencies = message.dependents;
+            }
+            this.finish(message.id, result);
+        }
+    }
+
+    private onExit(child: cp.ChildProcess, message: string): void {
+        if (this.process !== child) {
+            return;
+        }
+        this.process = undefined;
+        this.failAll(message);
+    }
+
+    private failAll(message: string): void {
+        for (const [id, request] of [...this.pending]) {
+            this.finish(id, this.failure(request.filePath, message));
+        }
+    }
+
+    private cancelled(filePath: string): AnalysisResult {
+        return { ...this.failure(filePath, '分析已取消'), cancelled: true };
+    }
+
+    private failure(filePath: string, message: string): AnalysisResult {
+        return {
+            file_path: filePath,
+            reports: [],
+            success: false,
+            error: message
+        };
+    }
+}
 
 export class BugDetectorBackend {
     private config: vscode.WorkspaceConfiguration;
     private detector: CDetector;
+    private incremental: IncrementalAnalyzer;
+    private pool: DetectorWorkerPool;
+    private daemon?: PythonDaemonClient;
+    private scheduler: AnalysisScheduler;
+    // 反向依赖：工作区头文件路径 -> 分析结果依赖它的文件
+    private dependents: Map<string, Set<string>> = new Map();
 
-    constructor() {
+    constructor(storagePath?: string, private extensionPath?: string) {
         this.config = vscode.workspace.getConfiguration('c-bug-detector');
-        this.detector = new CDetector();
+        this.detector = new CDetector(this.getIncludeDirs());
+        this.incremental = new IncrementalAnalyzer(this.detector);
+
+        // 文件和工作区分析在工作线程中运行，不阻塞扩展主线程；
+        // 有存储目录时启用按内容哈希的结果缓存，工作区重复扫描只分析变化的文件
+        this.pool = new DetectorWorkerPool(path.join(__dirname, 'detectorWorker.js'), {
+            cacheDir: storagePath ? path.join(storagePath, 'result-cache') : undefined
+        });
+
+        // 所有分析都经过调度器：可见编辑器优先，同一文件的新任务取代旧任务，编辑时暂停后台扫描
+        this.scheduler = new AnalysisScheduler(() => this.getConcurrency());
     }
 
     public updateConfiguration(): void {
         this.config = vscode.workspace.getConfiguration('c-bug-detector');
+        this.detector.setIncludeDirs(this.getIncludeDirs());
+
+        // Python路径等配置可能已变化，下次请求时按新配置重新启动守护进程
+        if (this.daemon) {
+            this.daemon.dispose();
+            this.daemon = undefined;
+        }
     }
 
-    public async analyzeFile(filePath: string): Promise<AnalysisResult> {
+    /**
+     * 把任务交给调度器，轮到它时由 execute 执行
+     */
+    private runJob(job: AnalysisJob, priority: AnalysisPriority, token?: CancellationSignal): Promise<AnalysisResult> {
+        return this.scheduler.schedule(path.resolve(job.filePath), priority, signal => this.execute(job, signal), 0, token);
+    }
+
+    /**
+     * 按 engine 配置把任务交给工作线程中的TypeScript检测器或常驻的Python后端
+     */
+    private execute(job: AnalysisJob, token: CancellationSignal): Promise<AnalysisResult> {
+        const run = this.config.get<string>('engine', 'typescript') === 'python'
+            ? this.getDaemon().analyze(job, token)
+            : this.pool.run(job, token);
+        return run.then(result => this.recordDependencies(result));
+    }
+
+    /**
+     * 记录结果依赖的工作区头文件（Python后端不返回依赖，由 invalidateHeader 向后端查询）
+     */
+    private recordDependencies(result: AnalysisResult): AnalysisResult {
+        if (result.success && !result.cancelled) {
+            for (const dependents of this.dependents.values()) {
+                dependents.delete(result.file_path);
+            }
+            for (const dependency of result.dependencies || []) {
+                let dependents = this.dependents.get(dependency);
+                if (!dependents) {
+                    dependents = new Set();
+                    this.dependents.set(dependency, dependents);
+                }
+                dependents.add(result.file_path);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * 头文件保存后调用：丢弃主线程中缓存的头文件摘要，返回结果依赖该头文件的文件
+     * （工作线程按修改时间自行检查头文件是否变化）
+     */
+    public async invalidateHeader(headerPath: string): Promise<string[]> {
+        const absolutePath = path.resolve(headerPath);
+        const files = new Set(this.dependents.get(absolutePath) || []);
+        for (const file of this.detector.getIncludeGraph().invalidate(absolutePath)) {
+            files.add(file);
+        }
+        if (this.daemon) {
+            for (const file of await this.daemon.invalidate(absolutePath)) {
+                files.add(file);
+            }
+        }
+        return [...files];
+    }
+
+    private getDaemon(): PythonDaemonClient {
+        if (!this.daemon) {
+            const pythonPath = this.config.get<string>('pythonPath', 'python');
+            const backendPath = this.config.get<string>('backendPath', 'backend/main.py');
+            const scriptPath = path.isAbsolute(backendPath)
+                ? backendPath
+                : path.join(this.extensionPath || path.join(__dirname, '..'), backendPath);
+            this.daemon = new PythonDaemonClient(pythonPath, scriptPath, this.getIncludeDirs());
+        }
+        return this.daemon;
+    }
+
+    public async analyzeFile(filePath: string, token?: vscode.CancellationToken): Promise<AnalysisResult> {
         try {
             // 检查文件是否存在
             if (!fs.existsSync(filePath)) {
@@ -41,9 +427,8 @@ export class BugDetectorBackend {
                 };
             }
 
-            // 使用TypeScript检测器
-            const result = this.detector.analyzeFile(filePath);
-            return result;
+            // 使用TypeScript检测器（在工作线程中运行）或Python后端
+            return await this.runJob(this.createJob(filePath, false), AnalysisPriority.Open, token);
         } catch (error) {
             return {
                 file_path: filePath,
@@ -54,98 +439,246 @@ export class BugDetectorBackend {
         }
     }
 
-    public async analyzeWorkspace(): Promise<AnalysisResult[]> {
+    /**
+     * 分析编辑器中的文档（使用内存中的内容，而不是磁盘上的文件）
+     *
+     * debounceMs 大于0时等待这么久再开始，期间同一文档的新请求取代本次请求；
+     * 文档内容在真正开始分析时读取。
+     */
+    public async analyzeDocument(document: vscode.TextDocument, token?: CancellationSignal, debounceMs = 0,
+                                 priority = AnalysisPriority.Open): Promise<AnalysisResult> {
+        return this.scheduler.schedule(path.resolve(document.fileName), priority, signal => {
+            const job = this.createJob(document.fileName, false);
+            job.content = document.getText();
+            return this.execute(job, signal);
+        }, debounceMs, token);
+    }
+
+    /**
+     * 记录文档变化事件（立即更新增量分析的文档模型），之后由 analyzeDocumentChanges 检测
+     */
+    public recordDocumentChanges(event: vscode.TextDocumentChangeEvent): void {
+        this.incremental.recordChanges(event);
+    }
+
+    /**
+     * 增量地重新分析已记录的变化，只重新检测变化的区域
+     *
+     * 在 debounceMs 内连续的编辑只分析一次（被取代的请求以 cancelled 结果结束）；
+     * 增量分析只处理变化的区域，耗时很短，直接在主线程中运行以保证编辑时的响应速度；
+     * 同样受时间预算限制，超时后未完整分析的区域在下一次分析时重新检测。
+     */
+    public analyzeDocumentChanges(document: vscode.TextDocument, debounceMs = this.getDebounceMs()): Promise<AnalysisResult> {
+        return this.scheduler.schedule(path.resolve(document.fileName), AnalysisPriority.Visible, async () =>
+            this.recordDependencies(this.incremental.analyzePending(document, this.getTimeBudget())), debounceMs);
+    }
+
+    /**
+     * 用户正在编辑，暂时不启动新的后台分析
+     */
+    public notifyTyping(): void {
+        this.scheduler.notifyTyping();
+    }
+
+    /**
+     * 可见编辑器中的文件，它们的分析优先执行
+     */
+    public setVisibleDocuments(filePaths: string[]): void {
+        this.scheduler.setVisible(filePaths.map(filePath => path.resolve(filePath)));
+    }
+
+    public closeDocument(document: vscode.TextDocument): void {
+        this.incremental.closeDocument(document);
+    }
+
+    private getEnabledModules(): string[] {
+        return Object.keys(MODULE_SETTINGS)
+            .filter(setting => this.config.get<boolean>(setting, true))
+            .map(setting => MODULE_SETTINGS[setting]);
+    }
+
+    /**
+     * 查找工作区头文件的目录，相对路径相对于第一个工作区文件夹
+     */
+    private getIncludeDirs(): string[] {
+        const folders = vscode.workspace.workspaceFolders;
+        const root = folders && folders.length > 0 ? folders[0].uri.fsPath : '';
+        return this.config.get<string[]>('includePaths', [])
+            .map(directory => path.isAbsolute(directory) || !root ? directory : path.join(root, directory));
+    }
+
+    public getDebounceMs(): number {
+        return Math.max(0, this.config.get<number>('debounceMs', 300));
+    }
+
+    private getTimeBudget(): number {
+        return Math.max(0, this.config.get<number>('timeBudgetMs', 5000));
+    }
+
+    private createJob(filePath: string, useCache: boolean): AnalysisJob {
+        return {
+            filePath,
+            enabledModules: this.getEnabledModules(),
+            useCache,
+            timeBudgetMs: this.getTimeBudget(),
+            includeDirs: this.getIncludeDirs()
+        };
+    }
+
+    /**
+     * 流式分析工作区中的所有C文件
+     *
+     * 文件发现、分析和结果返回同时进行：每找到一个文件就分发给工作线程，
+     * 同时进行中的任务数不超过 maxConcurrency，每完成一个文件就通过 onResult 回调返回结果。
+     * token 取消后不再查找和分发新文件，进行中的任务立即以 cancelled 结果结束（不通过 onResult 返回）。
+     */
+    public async analyzeWorkspace(onResult: (result: AnalysisResult) => void,
+                                  token?: vscode.CancellationToken): Promise<ScanSummary> {
+        const summary: ScanSummary = { totalFiles: 0, totalIssues: 0 };
+        const emit = (result: AnalysisResult) => {
+            if (result.cancelled) {
+                return;
+            }
+            summary.totalFiles++;
+            summary.totalIssues += result.success ? result.reports.length : 0;
+            onResult(result);
+        };
+
         try {
             if (!vscode.workspace.workspaceFolders) {
-                return [{
+                emit({
                     file_path: 'workspace',
                     reports: [],
                     success: false,
                     error: '没有打开的工作区'
-                }];
+                });
+                return summary;
             }
 
-            const results: AnalysisResult[] = [];
-            
             for (const folder of vscode.workspace.workspaceFolders) {
-                const folderResults = await this.analyzeDirectory(folder.uri.fsPath);
-                results.push(...folderResults);
+                if (token && token.isCancellationRequested) {
+                    break;
+                }
+                await this.analyzeDirectory(folder.uri.fsPath, emit, token);
             }
-
-            return results;
         } catch (error) {
-            return [{
+            emit({
                 file_path: 'workspace',
                 reports: [],
                 success: false,
                 error: `工作区分析失败: ${error}`
-            }];
+            });
         }
+        return summary;
     }
 
-    private async analyzeDirectory(directoryPath: string): Promise<AnalysisResult[]> {
-        try {
-            const results: AnalysisResult[] = [];
-            
-            // 检查目录是否存在
-            if (!fs.existsSync(directoryPath)) {
-                return [{
-                    file_path: directoryPath,
-                    reports: [],
-                    success: false,
-                    error: `目录不存在: ${directoryPath}`
-                }];
+    private getConcurrency(): number {
+        const configured = this.config.get<number>('maxConcurrency', 0);
+        return configured > 0 ? configured : Math.max(1, os.cpus().length);
+    }
+
+    private async analyzeDirectory(directoryPath: string, onResult: (result: AnalysisResult) => void,
+                                   token?: vscode.CancellationToken): Promise<void> {
+        // 检查目录是否存在
+        if (!fs.existsSync(directoryPath)) {
+            onResult({
+                file_path: directoryPath,
+                reports: [],
+                success: false,
+                error: `目录不存在: ${directoryPath}`
+            });
+            return;
+        }
+
+        const limit = this.getConcurrency();
+        const inFlight: Set<Promise<void>> = new Set();
+        const dispatch = async (filePath: string) => {
+            const task: Promise<void> = this.runJob(this.createJob(filePath, true), AnalysisPriority.Background, token).then(result => {
+                inFlight.delete(task);
+                onResult(result);
+            });
+            inFlight.add(task);
+
+            if (inFlight.size >= limit) {
+                await Promise.race(inFlight);
             }
+        };
 
-            // 递归查找C文件
-            const cFiles = await this.findCFiles(directoryPath);
-            
-            // 分析每个文件
-            for (const filePath of cFiles) {
-                const result = await this.analyzeFile(filePath);
-                results.push(result);
+        // 头文件的内容随包含它的 .c 文件一起分析，先分析所有 .c 文件，
+        // 之后只单独分析没有被任何 .c 文件直接或间接包含的头文件
+        const headers: string[] = [];
+        const reachable: Set<string> = new Set();
+
+        // 边查找边分发到工作线程（内容未变化的文件直接使用缓存结果）
+        for await (const filePath of this.discoverCFiles(directoryPath)) {
+            if (token && token.isCancellationRequested) {
+                break;
+            }
+            if (filePath.endsWith('.h')) {
+                headers.push(filePath);
+                continue;
             }
+            await dispatch(filePath);
+            for (const dependency of await this.includedHeaders(filePath)) {
+                reachable.add(dependency);
+            }
+        }
 
-            return results;
+        for (const filePath of headers) {
+            if (token && token.isCancellationRequested) {
+                break;
+            }
+            if (!reachable.has(path.resolve(filePath))) {
+                await dispatch(filePath);
+            }
+        }
+
+        await Promise.all(inFlight);
+    }
+
+    /**
+     * 源文件直接或间接包含的工作区头文件路径（只查找 #include，头文件摘要按修改时间缓存）
+     */
+    private async includedHeaders(filePath: string): Promise<Set<string>> {
+        let content: string;
+        try {
+            content = await fs.promises.readFile(filePath, 'utf8');
         } catch (error) {
-            return [{
-                file_path: directoryPath,
-                reports: [],
-                success: false,
-                error: `检测器执行失败: ${error}`
-            }];
+            return new Set();
         }
+        return this.detector.getIncludeGraph().fileClosure(filePath, scanIncludes(content)).dependencies;
     }
 
-    private async findCFiles(rootPath: string): Promise<string[]> {
-        const cFiles: string[] = [];
-        
-        const findFiles = async (dirPath: string): Promise<void> => {
-            try {
-                const entries = await fs.promises.readdir(dirPath, { withFileTypes: true });
-                
-                for (const entry of entries) {
-                    const fullPath = path.join(dirPath, entry.name);
-                    
-                    if (entry.isDirectory()) {
-                        // 跳过常见的忽略目录
-                        if (!['node_modules', '.git', '.vscode', 'out', 'build'].includes(entry.name)) {
-                            await findFiles(fullPath);
-                        }
-                    } else if (entry.isFile() && (entry.name.endsWith('.c') || entry.name.endsWith('.h'))) {
-                        cFiles.push(fullPath);
-                    }
+    private async *discoverCFiles(dirPath: string): AsyncGenerator<string> {
+        let entries: fs.Dirent[];
+        try {
+            entries = await fs.promises.readdir(dirPath, { withFileTypes: true });
+        } catch (error) {
+            console.error(`读取目录失败 ${dirPath}:`, error);
+            return;
+        }
+
+        for (const entry of entries) {
+            const fullPath = path.join(dirPath, entry.name);
+
+            if (entry.isDirectory()) {
+                // 跳过常见的忽略目录
+                if (!['node_modules', '.git', '.vscode', 'out', 'build'].includes(entry.name)) {
+                    yield* this.discoverCFiles(fullPath);
                 }
-            } catch (error) {
-                console.error(`读取目录失败 ${dirPath}:`, error);
+            } else if (entry.isFile() && (entry.name.endsWith('.c') || entry.name.endsWith('.h'))) {
+                yield fullPath;
             }
-        };
-
-        await findFiles(rootPath);
-        return cFiles;
+        }
     }
 
     public dispose(): void {
         // 清理资源
+        this.scheduler.dispose();
+        this.incremental.clear();
+        this.pool.dispose();
+        if (this.daemon) {
+            this.daemon.dispose();
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,172 @@
+import * as cp from 'child_process';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { CDetector } from './cDetector';
+
+/**
+ * CDetector 基准测试（npm run benchmark）
+ *
+ * 语料由 backend/benchmarks/corpus.py 生成（npm run benchmark:corpus），
+ * 结果格式与 Python 流水线的 bench_pipeline.py 相同，可以用 backend/benchmarks/compare.py 与基线比较。
+ * 每份语料在单独的子进程中测量，峰值内存只包含该语料本身的分析。
+ *
+ * 用法：node out/benchmark.js <语料目录> [--repeat 3] [--output results.json] [语料 ...]
+ */
+
+// 结果文件格式的版本，与 bench_pipeline.py 的 RESULT_SCHEMA 保持一致
+const RESULT_SCHEMA = 1;
+
+interface CorpusEntry {
+    file: string;
+    lines: number;
+    bytes: number;
+}
+
+interface CorpusResult {
+    corpus: string;
+    lines: number;
+    bytes: number;
+    reports: number;
+    peak_rss_kb: number;
+    seconds: { [phase: string]: number };
+    lines_per_second: { [phase: string]: number | null };
+}
+
+/**
+ * 在当前进程中测量一份语料，各阶段取多次运行中的最短耗时
+ */
+function measureCorpus(name: string, filePath: string, repeat: number): CorpusResult {
+    const content = fs.readFileSync(filePath, 'utf8');
+    const detector = new CDetector();
+    const seconds: { [phase: string]: number } = {};
+    let reportCount = 0;
+
+    const record = (phase: string, elapsed: number) => {
+        seconds[phase] = phase in seconds ? Math.min(seconds[phase], elapsed) : elapsed;
+    };
+
+    // 各阶段的耗时来自检测器自身记录的统计（扫描、各模块、合并）
+    for (let run = 0; run < repeat; run++) {
+        const result = detector.analyzeContent(name, content);
+        if (!result.success || !result.stats) {
+            throw new Error(result.error || `语料 ${name} 分析失败`);
+        }
+        for (const phase of result.stats.phases) {
+            record(phase.name, phase.seconds);
+        }
+        reportCount = result.reports.length;
+    }
+
+    seconds['total'] = Object.values(seconds).reduce((sum, value) => sum + value, 0);
+    const lineCount = content.split('\n').length;
+    const linesPerSecond: { [phase: string]: number | null } = {};
+    for (const [phase, value] of Object.entries(seconds)) {
+        seconds[phase] = Math.round(value * 1e6) / 1e6;
+        linesPerSecond[phase] = value > 0 ? Math.round(lineCount / value) : null;
+    }
+
+    return {
+        corpus: name,
+        lines: lineCount,
+        bytes: Buffer.byteLength(content, 'utf8'),
+        reports: reportCount,
+        // resourceUsage().maxRSS 以KB为单位
+        peak_rss_kb: process.resourceUsage().maxRSS,
+        seconds,
+        lines_per_second: linesPerSecond
+    };
+}
+
+/**
+ * 在新的子进程中测量一份语料
+ */
+function runIsolated(name: string, filePath: string, repeat: number): Promise<CorpusResult> {
+    return new Promise((resolve, reject) => {
+        const child = cp.fork(__filename, ['--child', name, filePath, String(repeat)]);
+        let result: CorpusResult | undefined;
+        child.on('message', message => {
+            result = message as CorpusResult;
+        });
+        child.on('error', reject);
+        child.on('exit', code => {
+            if (result) {
+                resolve(result);
+            } else {
+                reject(new Error(`测量语料 ${name} 的子进程异常退出（状态码 ${code}）`));
+            }
+        });
+    });
+}
+
+function printResult(result: CorpusResult): void {
+    console.log(`${result.corpus}: ${result.lines} 行，${result.reports} 个问题，峰值内存 ${(result.peak_rss_kb / 1024).toFixed(1)} MB`);
+    for (const [phase, value] of Object.entries(result.seconds)) {
+        const rate = result.lines_per_second[phase];
+        const rateText = rate ? `${rate.toLocaleString('en-US')} 行/秒` : '-';
+        console.log(`  ${phase.padEnd(22)} ${(value * 1000).toFixed(1).padStart(10)} ms  ${rateText.padStart(18)}`);
+    }
+}
+
+async function main(argv: string[]): Promise<void> {
+    let corpusDir = '';
+    let outputPath = '';
+    let repeat = 3;
+    const names: string[] = [];
+    for (let i = 0; i < argv.length; i++) {
+        if (argv[i] === '--repeat') {
+            repeat = Math.max(1, parseInt(argv[++i], 10) || 1);
+        } else if (argv[i] === '--output') {
+            outputPath = argv[++i];
+        } else if (!corpusDir) {
+            corpusDir = argv[i];
+        } else {
+            names.push(argv[i]);
+        }
+    }
+
+    const manifestPath = path.join(corpusDir || '.', 'manifest.json');
+    if (!corpusDir || !fs.existsSync(manifestPath)) {
+        console.error(`找不到语料清单 ${manifestPath}，请先运行 npm run benchmark:corpus`);
+        process.exit(2);
+    }
+    const manifest: { [name: string]: CorpusEntry } = JSON.parse(fs.readFileSync(manifestPath, 'utf8'));
+    for (const name of names) {
+        if (!(name in manifest)) {
+            console.error(`未知的语料: ${name}（可用: ${Object.keys(manifest).join(', ')}）`);
+            process.exit(2);
+        }
+    }
+
+    const results: CorpusResult[] = [];
+    for (const name of names.length > 0 ? names : Object.keys(manifest)) {
+        const result = await runIsolated(name, path.join(corpusDir, manifest[name].file), repeat);
+        printResult(result);
+        results.push(result);
+    }
+
+    if (outputPath) {
+        const data = {
+            schema: RESULT_SCHEMA,
+            implementation: 'typescript',
+            detector_version: CDetector.VERSION,
+            node: process.version,
+            platform: `${os.platform()}-${os.release()}-${os.arch()}`,
+            repeat,
+            results
+        };
+        fs.writeFileSync(outputPath, JSON.stringify(data, null, 2), 'utf8');
+        console.log(`结果已保存到: ${outputPath}`);
+    }
+}
+
+const args = process.argv.slice(2);
+if (args[0] === '--child') {
+    const result = measureCorpus(args[1], args[2], parseInt(args[3], 10) || 1);
+    process.send!(result, () => process.exit(0));
+} else {
+    main(args).catch(error => {
+        console.error(`基准测试失败: ${error}`);
+        process.exit(1);
+    });
+}
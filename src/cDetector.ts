@@ -1,4 +1,8 @@
-import * as vscode from 'vscode';
+import { lexLine, Region, scanLine, splitRegions } from './cLexer';
+import { CallSite, LocalSummary, summarizeRegion, SummaryIndex } from './functionSummaries';
+import { emptyClosure, IncludeClosure, IncludeGraph } from './includeGraph';
+import { AnalysisStats, PhaseRecorder } from './instrumentation';
+import { hasAll, LineFeature, LineFeatureCache } from './lineFeatures';
 
 export interface BugReport {
     line_number: number;
@@ -8,6 +12,10 @@ export interface BugReport {
     suggestion: string;
     code_snippet: string;
     module_name: string;
+    // 模块因超过时间预算未完成时，它已产生的报告标记为部分结果
+    partial?: boolean;
+    // 同一问题出现在多行时合并为一个报告，locations 为所有出现的行号（升序，包含 line_number）
+    locations?: number[];
 }
 
 export interface AnalysisResult {
@@ -15,13 +23,132 @@ export interface AnalysisResult {
     reports: BugReport[];
     success: boolean;
     error?: string;
+    // 各阶段的耗时和内存统计（增量分析和缓存命中时只包含实际执行的阶段）
+    stats?: AnalysisStats;
+    // 超过时间预算时为 true，incomplete_modules 为被中断或跳过的模块
+    partial?: boolean;
+    incomplete_modules?: string[];
+    // 分析在完成前被取消（结果中没有报告，不应覆盖之前的结果）
+    cancelled?: boolean;
+    // 结果依赖的工作区头文件（头文件变化后需要重新分析）
+    dependencies?: string[];
+}
+
+// 一个区域的检测结果，行号相对于区域起始行（从1开始）
+export interface RegionFacts {
+    memory: BugReport[];
+    allocations: { name: string, line: number, snippet: string }[];
+    frees: string[];
+    // 区域内的函数定义的局部摘要、函数体内的调用和 return 的变量（跨函数的所有权检查使用）
+    functions: LocalSummary[];
+    calls: CallSite[];
+    returns: string[];
+    variable: BugReport[];
+    includes: { name: string, line: number }[];
+    // 带 requiredHeader 的报告只有在该行之前未包含对应头文件时才输出，
+    // 带 functionName 的报告在工作区头文件声明了同名函数或宏时不输出
+    library: { report: BugReport, requiredHeader?: string, functionName?: string }[];
+    numeric: BugReport[];
+}
+
+// 变量声明开头的类型关键字（可以连续出现，如 unsigned long）
+const DECLARATION_TYPES = new Set(['int', 'char', 'float', 'double', 'long', 'short', 'unsigned', 'signed', 'void']);
+const IDENTIFIER = /^[A-Za-z_]\w*$/;
+
+// 检测模块名称，与后端的模块名一致
+export const DETECTOR_MODULES = ['memory_safety', 'variable_state', 'standard_library', 'numeric_control_flow'] as const;
+export type DetectorModule = typeof DETECTOR_MODULES[number];
+
+export function createRegionFacts(): RegionFacts {
+    return {
+        memory: [],
+        allocations: [],
+        frees: [],
+        functions: [],
+        calls: [],
+        returns: [],
+        variable: [],
+        includes: [],
+        library: [],
+        numeric: []
+    };
+}
+
+/**
+ * 把未完成模块的报告标记为部分结果（包括合并时由这些模块的中间结果得到的报告）
+ */
+export function markPartial(reports: BugReport[], incompleteModules: string[]): BugReport[] {
+    if (incompleteModules.length === 0) {
+        return reports;
+    }
+    const incomplete = new Set(incompleteModules);
+    return reports.map(report => incomplete.has(report.module_name) ? { ...report, partial: true } : report);
 }
 
 export class CDetector {
-    private patterns: { [key: string]: RegExp } = {};
+    // 检测器版本，检测逻辑变化时需要更新，以使旧的缓存结果失效
+    public static readonly VERSION = '1.3.0';
 
-    constructor() {
+    private patterns: { [key: string]: RegExp } = {};
+    // 各行的特征位图，检测模块据此跳过不可能匹配的模式；按行文本缓存，再次分析同一文件时大多直接命中
+    private lineFeatures: LineFeatureCache = new LineFeatureCache();
+    private includeGraph: IncludeGraph;
+    private includeDirs: string[];
+    // 分析过的文件中的函数摘要，由之后分析的所有文件共享
+    private functionSummaries: SummaryIndex = new SummaryIndex();
+
+    constructor(includeDirs: string[] = []) {
         this.initializePatterns();
+        this.includeDirs = [...includeDirs];
+        this.includeGraph = new IncludeGraph(this.includeDirs);
+    }
+
+    /**
+     * 设置查找工作区头文件的目录，目录变化时丢弃已缓存的头文件摘要
+     */
+    public setIncludeDirs(includeDirs: string[]): void {
+        if (includeDirs.join('\0') !== this.includeDirs.join('\0')) {
+            this.includeDirs = [...includeDirs];
+            this.includeGraph = new IncludeGraph(this.includeDirs);
+        }
+    }
+
+    public getIncludeGraph(): IncludeGraph {
+        return this.includeGraph;
+    }
+
+    public getFunctionSummaries(): SummaryIndex {
+        return this.functionSummaries;
+    }
+
+    /**
+     * 只建立文件的函数摘要而不运行检测（计算结果缓存键之前使用）
+     */
+    public indexFunctions(filePath: string, content: string): void {
+        const lines = content.split('\n');
+        const braceDeltas: number[] = [];
+        let inBlockComment = false;
+        for (const line of lines) {
+            const scan = scanLine(line, inBlockComment);
+            braceDeltas.push(scan.braceDelta);
+            inBlockComment = scan.inBlockComment;
+        }
+        const functions: LocalSummary[] = [];
+        for (const region of splitRegions(braceDeltas)) {
+            functions.push(...summarizeRegion(lines, region.start, region.end, this.headerLine(lines, region)).functions);
+        }
+        this.functionSummaries.updateFile(filePath, functions);
+    }
+
+    /**
+     * 用各区域的局部摘要更新文件的函数摘要（内存安全模块未完整运行时不更新）
+     */
+    public updateFunctionSummaries(filePath: string, facts: RegionFacts[]): void {
+        const functions: LocalSummary[] = [];
+        for (const regionFacts of facts) {
+            functions.push(...regionFacts.functions);
+        }
+        this.functionSummaries.updateFile(filePath, functions);
     }
 
     private initializePatterns(): void {
@@ -64,21 +191,82 @@ export class CDetector {
 
     public analyzeFile(filePath: string): AnalysisResult {
         try {
-            const content = this.readFileContent(filePath);
-            const lines = content.split('\n');
-            const reports: BugReport[] = [];
+            const recorder = new PhaseRecorder();
+            const content = recorder.time('read', () => this.readFileContent(filePath));
+            return this.analyzeContent(filePath, content, recorder);
+        } catch (error) {
+            return {
+                file_path: filePath,
+                reports: [],
+                success: false,
+                error: `分析失败: ${error}`
+            };
+        }
+    }
 
-            // 运行所有检测模块
-            reports.push(...this.detectMemorySafety(lines, filePath));
-            reports.push(...this.detectVariableState(lines, filePath));
-            reports.push(...this.detectStandardLibrary(lines, filePath));
-            reports.push(...this.detectNumericControlFlow(lines, filePath));
+    /**
+     * 分析一段内容，recorder 中已有的阶段（如读取文件）一并计入结果的统计
+     *
+     * deadline 为分析期限（Date.now() 的毫秒时间），每个区域之前检查一次：超过期限时当前模块
+     * 已产生的报告标记为部分结果，之后的模块不再运行。
+     */
+    public analyzeContent(filePath: string, content: string, recorder: PhaseRecorder = new PhaseRecorder(),
+                          deadline: number = Infinity): AnalysisResult {
+        try {
+            // 逐行扫描（跳过注释和字面量）得到花括号增量和特征位图
+            recorder.begin();
+            const lines = content.split('\n');
+            const braceDeltas: number[] = [];
+            const features: number[] = [];
+            let inBlockComment = false;
+            for (const line of lines) {
+                const scan = scanLine(line, inBlockComment);
+                braceDeltas.push(scan.braceDelta);
+                features.push(this.lineFeatures.get(line));
+                inBlockComment = scan.inBlockComment;
+            }
+            const regions = splitRegions(braceDeltas);
+            recorder.end('scan');
+
+            // 按区域运行所有检测模块后合并，与增量分析的结果保持一致；
+            // 各模块写入的结果互不相关，按模块依次处理所有区域，以便分别计时
+            const facts = regions.map(() => createRegionFacts());
+            const incomplete: string[] = [];
+            for (const moduleName of DETECTOR_MODULES) {
+                if (Date.now() > deadline) {
+                    incomplete.push(moduleName);
+                    continue;
+                }
+                recorder.begin();
+                for (let i = 0; i < regions.length; i++) {
+                    if (Date.now() > deadline) {
+                        incomplete.push(moduleName);
+                        break;
+                    }
+                    this.analyzeRegionModule(moduleName, lines, regions[i], facts[i], features);
+                }
+                recorder.end(moduleName);
+            }
 
-            return {
+            if (!incomplete.includes('memory_safety')) {
+                recorder.time('summaries', () => this.updateFunctionSummaries(filePath, facts));
+            }
+            const closure = recorder.time('includes', () => this.resolveIncludes(filePath, facts));
+            const reports = recorder.time('merge', () => this.mergeRegions(regions, facts, closure));
+            const result: AnalysisResult = {
                 file_path: filePath,
-                reports: reports,
-                success: true
+                reports: markPartial(reports, incomplete),
+                success: true,
+                stats: recorder.finish()
             };
+            if (closure.dependencies.size > 0) {
+                result.dependencies = [...closure.dependencies];
+            }
+            if (incomplete.length > 0) {
+                result.partial = true;
+                result.incomplete_modules = incomplete;
+            }
+            return result;
         } catch (error) {
             return {
                 file_path: filePath,
@@ -89,6 +277,170 @@ export class CDetector {
         }
     }
 
+    /**
+     * 在一个区域内运行所有检测模块，结果中的行号相对于区域起始行
+     *
+     * features 为各行的特征位图（下标与 lines 相同），未指定时按行文本从缓存中取得
+     */
+    public analyzeRegion(lines: string[], region: Region, features: number[] = this.lineFeatures.forLines(lines)): RegionFacts {
+        const facts = createRegionFacts();
+
+        this.detectMemorySafety(lines, region, features, facts);
+        this.detectVariableState(lines, region, features, facts);
+        this.detectStandardLibrary(lines, region, features, facts);
+        this.detectNumericControlFlow(lines, region, features, facts);
+        return facts;
+    }
+
+    /**
+     * 在一个区域内只运行一个检测模块，结果追加到 facts（按模块分别计时时使用）
+     */
+    public analyzeRegionModule(moduleName: DetectorModule, lines: string[], region: Region, facts: RegionFacts,
+                               features: number[]): void {
+        switch (moduleName) {
+            case 'memory_safety':
+                this.detectMemorySafety(lines, region, features, facts);
+                break;
+            case 'variable_state':
+                this.detectVariableState(lines, region, features, facts);
+                break;
+            case 'standard_library':
+                this.detectStandardLibrary(lines, region, features, facts);
+                break;
+            case 'numeric_control_flow':
+                this.detectNumericControlFlow(lines, region, features, facts);
+                break;
+        }
+    }
+
+    /**
+     * 由各区域记录的 #include 得到经由工作区头文件传递提供的头文件、函数和宏
+     */
+    public resolveIncludes(filePath: string, facts: RegionFacts[]): IncludeClosure {
+        const names: string[] = [];
+        for (const regionFacts of facts) {
+            for (const include of regionFacts.includes) {
+                names.push(include.name);
+            }
+        }
+        return names.length > 0 ? this.includeGraph.fileClosure(filePath, names) : emptyClosure();
+    }
+
+    /**
+     * 合并各区域的检测结果，并完成依赖整个文件的检查（内存泄漏、缺失头文件）
+     *
+     * closure 为 resolveIncludes 的结果：工作区头文件传递包含的头文件视为在包含它的那一行包含。
+     * 泄漏检查使用函数摘要：返回所有权的函数的结果视为分配，传给释放该参数的函数视为释放，
+     * return 给调用者的变量不算泄漏。
+     */
+    public mergeRegions(regions: Region[], facts: RegionFacts[], closure: IncludeClosure = emptyClosure()): BugReport[] {
+        const memory: BugReport[] = [];
+        const variable: BugReport[] = [];
+        const library: BugReport[] = [];
+        const numeric: BugReport[] = [];
+        const allocations: Map<string, { line: number, snippet: string }> = new Map();
+        const frees: Set<string> = new Set();
+        const returned: Set<string> = new Set();
+        const includeLines: Map<string, number> = new Map();
+
+        const shift = (reports: BugReport[], offset: number, target: BugReport[]) => {
+            for (const report of reports) {
+                if (offset === 0) {
+                    target.push(report);
+                } else if (report.locations) {
+                    target.push({
+                        ...report,
+                        line_number: report.line_number + offset,
+                        locations: report.locations.map(line => line + offset)
+                    });
+                } else {
+                    target.push({ ...report, line_number: report.line_number + offset });
+                }
+            }
+        };
+
+        for (let i = 0; i < regions.length; i++) {
+            const offset = regions[i].start;
+            const regionFacts = facts[i];
+
+            shift(regionFacts.memory, offset, memory);
+            shift(regionFacts.variable, offset, variable);
+            shift(regionFacts.numeric, offset, numeric);
+
+            for (const allocation of regionFacts.allocations) {
+                allocations.set(allocation.name, { line: allocation.line + offset, snippet: allocation.snippet });
+            }
+            for (const name of regionFacts.frees) {
+                frees.add(name);
+            }
+            for (const call of regionFacts.calls) {
+                const summary = this.functionSummaries.resolve(call.callee);
+                if (call.assigned !== undefined && summary.allocates && !allocations.has(call.assigned)) {
+                    allocations.set(call.assigned, { line: call.line + offset, snippet: call.snippet });
+                }
+                for (const position of summary.freesParams) {
+                    const arg = call.args[position];
+                    if (arg) {
+                        frees.add(arg);
+                    }
+                }
+            }
+            for (const name of regionFacts.returns) {
+                returned.add(name);
+            }
+            for (const include of regionFacts.includes) {
+                const expansion = closure.expansions.get(include.name);
+                for (const name of expansion ? [include.name, ...expansion] : [include.name]) {
+                    if (!includeLines.has(name)) {
+                        includeLines.set(name, include.line + offset);
+                    }
+                }
+            }
+        }
+
+        // 缺失头文件：使用处之前（含同一行）没有包含对应头文件
+        for (let i = 0; i < regions.length; i++) {
+            const offset = regions[i].start;
+            for (const entry of facts[i].library) {
+                const lineNum = entry.report.line_number + offset;
+                if (entry.functionName && (closure.functions.has(entry.functionName) || closure.macros.has(entry.functionName))) {
+                    continue;
+                }
+                if (entry.requiredHeader) {
+                    const includeLine = includeLines.get(entry.requiredHeader);
+                    if (includeLine !== undefined && includeLine <= lineNum) {
+                        continue;
+                    }
+                }
+                library.push(offset === 0 ? entry.report : { ...entry.report, line_number: lineNum });
+            }
+        }
+
+        // 检测内存泄漏
+        for (const [varName, allocation] of allocations) {
+            if (!frees.has(varName) && !returned.has(varName)) {
+                memory.push({
+                    line_number: allocation.line,
+                    error_type: '内存泄漏',
+                    severity: 'Warning',
+                    message: `变量 ${varName} 分配了内存但未释放`,
+                    suggestion: '在适当位置调用free()释放内存',
+                    code_snippet: allocation.snippet,
+                    module_name: 'memory_safety'
+                });
+            }
+        }
+
+        return [...memory, ...variable, ...library, ...numeric];
+    }
+
+    /**
+     * '{' 单独起一行的函数体区域，其函数头在前一行（属于前一个区域）
+     */
+    private headerLine(lines: string[], region: Region): string | undefined {
+        return region.start > 0 && /^\s*\{/.test(lines[region.start]) ? lines[region.start - 1] : undefined;
+    }
+
     private readFileContent(filePath: string): string {
         try {
             const fs = require('fs');
@@ -98,35 +450,34 @@ export class CDetector {
         }
     }
 
-    private detectMemorySafety(lines: string[], filePath: string): BugReport[] {
-        const reports: BugReport[] = [];
-        const allocations: { [key: string]: number } = {};
-        const frees: Set<string> = new Set();
-
-        for (let i = 0; i < lines.length; i++) {
+    private detectMemorySafety(lines: string[], region: Region, features: number[], facts: RegionFacts): void {
+        for (let i = region.start; i < region.end; i++) {
+            const lineFeatures = features[i];
+            if (!(lineFeatures & (LineFeature.Alloc | LineFeature.Free | LineFeature.Null))) {
+                continue;
+            }
             const line = lines[i];
-            const lineNum = i + 1;
+            const lineNum = i - region.start + 1;
 
-            // 检测内存分配
-            const allocMatch = line.match(this.patterns['memory_allocation']);
+            // 检测内存分配（是否泄漏在合并时按整个文件判断）
+            const allocMatch = hasAll(lineFeatures, LineFeature.Alloc | LineFeature.Assign | LineFeature.Paren)
+                ? line.match(this.patterns['memory_allocation']) : null;
             if (allocMatch) {
-                const varName = allocMatch[1];
-                allocations[varName] = lineNum;
+                facts.allocations.push({ name: allocMatch[1], line: lineNum, snippet: line.trim() });
             }
 
             // 检测free调用
-            const freeMatch = line.match(this.patterns['memory_free']);
-            if (freeMatch) {
+            if (hasAll(lineFeatures, LineFeature.Free | LineFeature.Paren) && this.patterns['memory_free'].test(line)) {
                 // 简单检测：如果free后面有变量名
                 const varMatch = line.match(/free\s*\(\s*(\w+)/);
                 if (varMatch) {
-                    frees.add(varMatch[1]);
+                    facts.frees.push(varMatch[1]);
                 }
             }
 
             // 检测空指针解引用
-            if (line.includes('*') && line.includes('NULL')) {
-                reports.push({
+            if (hasAll(lineFeatures, LineFeature.Star | LineFeature.Null)) {
+                facts.memory.push({
                     line_number: lineNum,
                     error_type: '空指针解引用',
                     severity: 'Error',
@@ -138,105 +489,133 @@ export class CDetector {
             }
         }
 
-        // 检测内存泄漏
-        for (const [varName, lineNum] of Object.entries(allocations)) {
-            if (!frees.has(varName)) {
-                reports.push({
-                    line_number: lineNum,
-                    error_type: '内存泄漏',
-                    severity: 'Warning',
-                    message: `变量 ${varName} 分配了内存但未释放`,
-                    suggestion: '在适当位置调用free()释放内存',
-                    code_snippet: lines[lineNum - 1].trim(),
-                    module_name: 'memory_safety'
-                });
-            }
-        }
-
-        return reports;
+        // 函数摘要和所有权转移（调用、返回）在合并时结合其他函数的摘要判断
+        const ownership = summarizeRegion(lines, region.start, region.end, this.headerLine(lines, region));
+        facts.functions.push(...ownership.functions);
+        facts.calls.push(...ownership.calls);
+        facts.returns.push(...ownership.returns);
     }
 
-    private detectVariableState(lines: string[], filePath: string): BugReport[] {
-        const reports: BugReport[] = [];
-        const variables: { [key: string]: { declared: number, initialized: boolean, used: number[] } } = {};
-
-        for (let i = 0; i < lines.length; i++) {
-            const line = lines[i];
-            const lineNum = i + 1;
-
-            // 检测变量声明
-            const declMatch = line.match(this.patterns['variable_declaration']);
-            if (declMatch) {
-                const varName = declMatch[2];
-                const isInitialized = line.includes('=');
-                variables[varName] = {
-                    declared: lineNum,
-                    initialized: isInitialized,
-                    used: []
-                };
+    /**
+     * 检测未初始化变量的使用
+     *
+     * 每行切分一次记号，只在标识符记号上查找被跟踪的变量名，每行的代价与行长成正比；
+     * 成员访问（a.x、p->x）中的成员名不算变量。声明时带初值、赋值（x = ...）或取地址（&x）之后
+     * 变量视为已初始化；之前的所有使用合并为一个报告，locations 列出每个使用行。
+     */
+    private detectVariableState(lines: string[], region: Region, features: number[], facts: RegionFacts): void {
+        // 变量的声明和使用只在同一区域（函数体）内匹配
+        const variables: Map<string, { initialized: boolean, used: number[] }> = new Map();
+        let inBlockComment = false;
+
+        for (let i = region.start; i < region.end; i++) {
+            // 还没有跟踪的变量时，只有含类型关键字（可能是声明）或可能改变块注释状态的行需要切分
+            if (variables.size === 0 && !(features[i] & (LineFeature.Type | LineFeature.Comment))) {
+                continue;
+            }
+            const lexed = lexLine(lines[i], inBlockComment);
+            inBlockComment = lexed.inBlockComment;
+            const tokens = lexed.tokens;
+            const lineNum = i - region.start + 1;
+
+            // 变量声明：类型关键字之后的第一个标识符
+            let declared = -1;
+            let typeEnd = 0;
+            while (typeEnd < tokens.length && DECLARATION_TYPES.has(tokens[typeEnd])) {
+                typeEnd++;
+            }
+            if (typeEnd > 0 && typeEnd < tokens.length && IDENTIFIER.test(tokens[typeEnd])) {
+                declared = typeEnd;
             }
 
-            // 检测变量使用
-            for (const varName of Object.keys(variables)) {
-                if (line.includes(varName) && !line.includes('=') && !line.includes('int ') && !line.includes('char ')) {
-                    variables[varName].used.push(lineNum);
+            if (variables.size > 0) {
+                for (let j = 0; j < tokens.length; j++) {
+                    if (j === declared) {
+                        continue;
+                    }
+                    const info = variables.get(tokens[j]);
+                    if (!info || info.initialized) {
+                        continue;
+                    }
+                    const previous = j > 0 ? tokens[j - 1] : '';
+                    if (previous === '.' || previous === '->') {
+                        continue;
+                    }
+                    if (tokens[j + 1] === '=' || previous === '&') {
+                        info.initialized = true;
+                    } else if (info.used[info.used.length - 1] !== lineNum) {
+                        info.used.push(lineNum);
+                    }
                 }
             }
-        }
 
-        // 检测未初始化变量使用
-        for (const [varName, info] of Object.entries(variables)) {
-            if (!info.initialized && info.used.length > 0) {
-                for (const useLine of info.used) {
-                    reports.push({
-                        line_number: useLine,
-                        error_type: '未初始化变量',
-                        severity: 'Warning',
-                        message: `变量 ${varName} 在使用前未初始化`,
-                        suggestion: '在使用变量前为其赋值',
-                        code_snippet: lines[useLine - 1].trim(),
-                        module_name: 'variable_state'
-                    });
-                }
+            if (declared >= 0) {
+                const varName = tokens[declared];
+                // 数组和带初值的声明不跟踪
+                const next = tokens[declared + 1];
+                variables.set(varName, { initialized: next === '=' || next === '[', used: [] });
             }
         }
 
-        return reports;
+        // 每个变量在初始化之前的使用合并为一个报告（重新声明的变量以最后一次声明为准）
+        for (const [varName, info] of variables) {
+            if (info.used.length === 0) {
+                continue;
+            }
+            const count = info.used.length;
+            facts.variable.push({
+                line_number: info.used[0],
+                error_type: '未初始化变量',
+                severity: 'Warning',
+                message: count > 1 ? `变量 ${varName} 在使用前未初始化（共 ${count} 处使用）` : `变量 ${varName} 在使用前未初始化`,
+                suggestion: '在使用变量前为其赋值',
+                code_snippet: lines[region.start + info.used[0] - 1].trim(),
+                module_name: 'variable_state',
+                locations: info.used
+            });
+        }
     }
 
-    private detectStandardLibrary(lines: string[], filePath: string): BugReport[] {
-        const reports: BugReport[] = [];
-        const includes: Set<string> = new Set();
-
-        // 检测头文件包含
-        for (let i = 0; i < lines.length; i++) {
+    private detectStandardLibrary(lines: string[], region: Region, features: number[], facts: RegionFacts): void {
+        for (let i = region.start; i < region.end; i++) {
+            const lineFeatures = features[i];
+            if (!(lineFeatures & (LineFeature.Include | LineFeature.Printf | LineFeature.Scanf))) {
+                continue;
+            }
             const line = lines[i];
-            const lineNum = i + 1;
+            const lineNum = i - region.start + 1;
 
-            if (line.includes('#include')) {
+            // 检测头文件包含
+            if (lineFeatures & LineFeature.Include) {
                 const includeMatch = line.match(/#include\s*[<"]([^>"]+)[>"]/);
                 if (includeMatch) {
-                    includes.add(includeMatch[1]);
+                    facts.includes.push({ name: includeMatch[1], line: lineNum });
                 }
             }
 
-            // 检测printf使用
-            if (line.match(this.patterns['printf']) && !includes.has('stdio.h')) {
-                reports.push({
-                    line_number: lineNum,
-                    error_type: '缺失头文件',
-                    severity: 'Error',
-                    message: '使用printf但未包含stdio.h',
-                    suggestion: '添加 #include <stdio.h>',
-                    code_snippet: line.trim(),
-                    module_name: 'standard_library'
+            // 检测printf使用（是否缺失头文件在合并时判断）
+            if (hasAll(lineFeatures, LineFeature.Printf | LineFeature.Paren) && this.patterns['printf'].test(line)) {
+                facts.library.push({
+                    requiredHeader: 'stdio.h',
+                    functionName: 'printf',
+                    report: {
+                        line_number: lineNum,
+                        error_type: '缺失头文件',
+                        severity: 'Error',
+                        message: '使用printf但未包含stdio.h',
+                        suggestion: '添加 #include <stdio.h>',
+                        code_snippet: line.trim(),
+                        module_name: 'standard_library'
+                    }
                 });
             }
 
             // 检测scanf使用
-            if (line.match(this.patterns['scanf'])) {
-                if (!includes.has('stdio.h')) {
-                    reports.push({
+            if (hasAll(lineFeatures, LineFeature.Scanf | LineFeature.Paren) && this.patterns['scanf'].test(line)) {
+                facts.library.push({
+                    requiredHeader: 'stdio.h',
+                    functionName: 'scanf',
+                    report: {
                         line_number: lineNum,
                         error_type: '缺失头文件',
                         severity: 'Error',
@@ -244,42 +623,45 @@ export class CDetector {
                         suggestion: '添加 #include <stdio.h>',
                         code_snippet: line.trim(),
                         module_name: 'standard_library'
-                    });
-                }
+                    }
+                });
 
                 // 检测scanf缺少&
                 if (!line.includes('&') && line.includes('%')) {
-                    reports.push({
-                        line_number: lineNum,
-                        error_type: 'scanf参数错误',
-                        severity: 'Warning',
-                        message: 'scanf可能缺少&操作符',
-                        suggestion: '检查scanf参数是否需要&操作符',
-                        code_snippet: line.trim(),
-                        module_name: 'standard_library'
+                    facts.library.push({
+                        report: {
+                            line_number: lineNum,
+                            error_type: 'scanf参数错误',
+                            severity: 'Warning',
+                            message: 'scanf可能缺少&操作符',
+                            suggestion: '检查scanf参数是否需要&操作符',
+                            code_snippet: line.trim(),
+                            module_name: 'standard_library'
+                        }
                     });
                 }
             }
         }
-
-        return reports;
     }
 
-    private detectNumericControlFlow(lines: string[], filePath: string): BugReport[] {
-        const reports: BugReport[] = [];
-
-        for (let i = 0; i < lines.length; i++) {
+    private detectNumericControlFlow(lines: string[], region: Region, features: number[], facts: RegionFacts): void {
+        for (let i = region.start; i < region.end; i++) {
+            const lineFeatures = features[i];
+            if (!(lineFeatures & (LineFeature.Type | LineFeature.While))) {
+                continue;
+            }
             const line = lines[i];
-            const lineNum = i + 1;
+            const lineNum = i - region.start + 1;
 
             // 检测类型溢出
-            const overflowMatch = line.match(/(char|short)\s+(\w+)\s*=\s*(\d+)/);
+            const overflowMatch = hasAll(lineFeatures, LineFeature.Type | LineFeature.Assign)
+                ? line.match(/(char|short)\s+(\w+)\s*=\s*(\d+)/) : null;
             if (overflowMatch) {
                 const type = overflowMatch[1];
                 const value = parseInt(overflowMatch[3]);
                 
                 if (type === 'char' && (value > 127 || value < -128)) {
-                    reports.push({
+                    facts.numeric.push({
                         line_number: lineNum,
                         error_type: '类型溢出',
                         severity: 'Warning',
@@ -292,8 +674,9 @@ export class CDetector {
             }
 
             // 检测死循环
-            if (line.match(/while\s*\(\s*1\s*\)/) && !line.includes('break')) {
-                reports.push({
+            if (hasAll(lineFeatures, LineFeature.While | LineFeature.Paren)
+                && /while\s*\(\s*1\s*\)/.test(line) && !line.includes('break')) {
+                facts.numeric.push({
                     line_number: lineNum,
                     error_type: '死循环',
                     severity: 'Warning',
@@ -304,7 +687,5 @@ export class CDetector {
                 });
             }
         }
-
-        return reports;
     }
 }
@@ -0,0 +1,340 @@
+/**
+ * C代码逐行扫描
+ *
+ * 与后端的 c_lexer 一样以行为单位工作，跨行状态只有"是否处于块注释中"一项，
+ * 因此编辑后只需要重新扫描变化的行，以及块注释状态因此改变的后续行。
+ *
+ * lexLine 是后端扫描核心（backend/native/cscan.c，以及与之等价的 c_lexer 正则实现）的移植：
+ * 去注释和记号切分规则逐字符相同，字符分类按 Unicode 码点进行，
+ * 因此编辑器与命令行对同一行得到相同的记号序列。
+ */
+
+export interface LineScan {
+    // 本行花括号的净增量（忽略字符串、字符字面量和注释中的花括号）
+    braceDelta: number;
+    // 行尾是否仍处于块注释中
+    inBlockComment: boolean;
+}
+
+export interface LineTokens {
+    // 去注释后的行文本：块注释替换为一个空格，行注释删除到行尾
+    text: string;
+    tokens: string[];
+    // 行尾是否仍处于块注释中
+    inBlockComment: boolean;
+}
+
+// 一个分析区域：顶层花括号块（函数体、结构体等）或相邻的顶层行，行号从0开始，左闭右开
+export interface Region {
+    start: number;
+    end: number;
+}
+
+export function scanLine(line: string, inBlockComment: boolean): LineScan {
+    let braceDelta = 0;
+    let i = 0;
+    const length = line.length;
+
+    while (i < length) {
+        if (inBlockComment) {
+            const end = line.indexOf('*/', i);
+            if (end < 0) {
+                break;
+            }
+            inBlockComment = false;
+            i = end + 2;
+            continue;
+        }
+
+        const ch = line[i];
+        if (ch === '/' && line[i + 1] === '/') {
+            break;
+        }
+        if (ch === '/' && line[i + 1] === '*') {
+            inBlockComment = true;
+            i += 2;
+            continue;
+        }
+        if (ch === '"' || ch === '\'') {
+            // 跳过字面量，未闭合的字面量到行尾结束
+            i++;
+            while (i < length && line[i] !== ch) {
+                i += line[i] === '\\' ? 2 : 1;
+            }
+            i++;
+            continue;
+        }
+        if (ch === '{') {
+            braceDelta++;
+        } else if (ch === '}') {
+            braceDelta--;
+        }
+        i++;
+    }
+
+    return { braceDelta, inBlockComment };
+}
+
+/**
+ * 按花括号深度把文件划分为分析区域
+ *
+ * 深度从0变为正数的行开始一个块区域，深度回到0的行结束该区域；
+ * 块之间相邻的顶层行合并为一个区域。多余的右花括号不会使深度小于0。
+ */
+export function splitRegions(braceDeltas: ArrayLike<number>): Region[] {
+    const regions: Region[] = [];
+    let depth = 0;
+    let start = 0;
+    let inBlock = false;
+
+    for (let i = 0; i < braceDeltas.length; i++) {
+        const delta = braceDeltas[i];
+        if (!inBlock && delta > 0) {
+            // 进入顶层块，先结束前面的顶层行区域
+            if (start < i) {
+                regions.push({ start, end: i });
+            }
+            start = i;
+            inBlock = true;
+        }
+
+        depth = Math.max(0, depth + delta);
+        if (inBlock && depth === 0) {
+            regions.push({ start, end: i + 1 });
+            start = i + 1;
+            inBlock = false;
+        }
+    }
+
+    if (start < braceDeltas.length) {
+        regions.push({ start, end: braceDeltas.length });
+    }
+    return regions;
+}
+
+// 按后端记号顺序尝试的运算符；复合赋值 op= 在这些之后、... 之前
+const OPERATORS = ['->', '++', '--', '<<=', '>>=', '<<', '>>', '<=', '>=', '==', '!=', '&&', '||'];
+const COMPOUND_ASSIGNMENT = '-+*/%&|^';
+const OPERATOR_STARTS = '-+<>=!&|';
+
+// 非ASCII字符的分类与 Python re 模块 str 模式中的 \s、\d、\w 相同
+const UNICODE_SPACE = /^\s$/;
+const UNICODE_DIGIT = /^\p{Nd}$/u;
+const UNICODE_WORD = /^[\p{L}\p{N}_]$/u;
+
+function isSpace(code: number): boolean {
+    if (code < 128) {
+        return code === 32 || (code >= 9 && code <= 13) || (code >= 28 && code <= 31);
+    }
+    return code === 0x85 || (code !== 0xfeff && UNICODE_SPACE.test(String.fromCodePoint(code)));
+}
+
+function isDigit(code: number): boolean {
+    if (code < 128) {
+        return code >= 48 && code <= 57;
+    }
+    return UNICODE_DIGIT.test(String.fromCodePoint(code));
+}
+
+function isWord(code: number): boolean {
+    if (code < 128) {
+        return (code >= 48 && code <= 57) || (code >= 65 && code <= 90) || (code >= 97 && code <= 122) || code === 95;
+    }
+    return UNICODE_WORD.test(String.fromCodePoint(code));
+}
+
+// 码点占用的UTF-16代码单元数
+function width(code: number): number {
+    return code > 0xffff ? 2 : 1;
+}
+
+// 字符串或字符字面量的结束位置，i 指向开头的引号；未闭合的字面量到行尾结束
+function skipLiteral(line: string, i: number, quote: string): number {
+    const length = line.length;
+    for (i++; i < length;) {
+        const ch = line[i];
+        if (ch === '\\') {
+            if (i + 1 < length && line[i + 1] !== '\n') {
+                i += 2;
+                continue;
+            }
+            break;
+        }
+        if (ch === quote) {
+            break;
+        }
+        i++;
+    }
+    return i < length && line[i] === quote ? i + 1 : i;
+}
+
+// #include <...> 或 #include "..." 作为一个整体记号，不匹配时返回 -1
+function matchInclude(line: string, i: number): number {
+    const length = line.length;
+    let j = i + 1;
+    while (j < length && (line[j] === ' ' || line[j] === '\t')) {
+        j++;
+    }
+    if (!line.startsWith('include', j)) {
+        return -1;
+    }
+    j += 7;
+    while (j < length && (line[j] === ' ' || line[j] === '\t')) {
+        j++;
+    }
+    if (j >= length || (line[j] !== '<' && line[j] !== '"')) {
+        return -1;
+    }
+    for (j++; j < length; j++) {
+        if (line[j] === '>' || line[j] === '"') {
+            return j + 1;
+        }
+    }
+    return -1;
+}
+
+// 从 i（非空白字符）开始的记号的结束位置
+function matchToken(line: string, i: number): number {
+    const length = line.length;
+    const ch = line[i];
+    const code = line.codePointAt(i)!;
+
+    if (ch === '#') {
+        const end = matchInclude(line, i);
+        if (end >= 0) {
+            return end;
+        }
+    }
+    if (ch === '"' || ch === '\'') {
+        return skipLiteral(line, i, ch);
+    }
+
+    // 数值（预处理数），包括指数部分的符号
+    if (isDigit(code) || (ch === '.' && i + 1 < length && isDigit(line.codePointAt(i + 1)!))) {
+        let j = ch === '.' ? i + 1 : i;
+        j += width(line.codePointAt(j)!);
+        while (j < length) {
+            const next = line.codePointAt(j)!;
+            const c = line[j];
+            if ((c === 'e' || c === 'E' || c === 'p' || c === 'P') && (line[j + 1] === '+' || line[j + 1] === '-')) {
+                j += 2;
+            } else if (isWord(next) || c === '.') {
+                j += width(next);
+            } else {
+                break;
+            }
+        }
+        return j;
+    }
+
+    // 标识符与关键字：首字符只能是ASCII字母或下划线
+    if ((code >= 65 && code <= 90) || (code >= 97 && code <= 122) || code === 95) {
+        let j = i + 1;
+        while (j < length) {
+            const next = line.codePointAt(j)!;
+            if (!isWord(next)) {
+                break;
+            }
+            j += width(next);
+        }
+        return j;
+    }
+
+    if (OPERATOR_STARTS.includes(ch)) {
+        for (const operator of OPERATORS) {
+            if (line.startsWith(operator, i)) {
+                return i + operator.length;
+            }
+        }
+    }
+    if (COMPOUND_ASSIGNMENT.includes(ch) && line[i + 1] === '=') {
+        return i + 2;
+    }
+    if (line.startsWith('...', i)) {
+        return i + 3;
+    }
+    if (line.startsWith('##', i)) {
+        return i + 2;
+    }
+    return i + width(code);
+}
+
+/**
+ * 移除一行中的注释，返回去注释后的文本和行尾的块注释状态
+ */
+export function stripComments(line: string, inBlockComment: boolean): { text: string, inBlockComment: boolean } {
+    const pieces: string[] = [];
+    const length = line.length;
+    let pos = 0;
+
+    while (pos < length) {
+        if (inBlockComment) {
+            const end = line.indexOf('*/', pos);
+            if (end < 0) {
+                break;
+            }
+            inBlockComment = false;
+            pos = end + 2;
+            pieces.push(' ');
+            continue;
+        }
+
+        // 下一个字面量或注释的开始位置
+        let i = pos;
+        while (i < length) {
+            const ch = line[i];
+            if (ch === '"' || ch === '\'' || (ch === '/' && (line[i + 1] === '/' || line[i + 1] === '*'))) {
+                break;
+            }
+            i++;
+        }
+        if (i >= length) {
+            pieces.push(line.substring(pos));
+            break;
+        }
+
+        if (line[i] === '/') {
+            pieces.push(line.substring(pos, i));
+            if (line[i + 1] === '/') {
+                break;
+            }
+            inBlockComment = true;
+            pos = i + 2;
+            continue;
+        }
+
+        // 字符串或字符字面量原样保留
+        const end = skipLiteral(line, i, line[i]);
+        pieces.push(line.substring(pos, end));
+        pos = end;
+    }
+
+    return { text: pieces.join(''), inBlockComment };
+}
+
+/**
+ * 对一行去注释并切分记号（与后端 c_lexer 的 lex_line 相同）
+ */
+export function lexLine(line: string, inBlockComment: boolean): LineTokens {
+    let text = line;
+    if (inBlockComment || line.indexOf('/') >= 0) {
+        const stripped = stripComments(line, inBlockComment);
+        text = stripped.text;
+        inBlockComment = stripped.inBlockComment;
+    }
+
+    const tokens: string[] = [];
+    const length = text.length;
+    let i = 0;
+    while (i < length) {
+        const code = text.codePointAt(i)!;
+        if (isSpace(code)) {
+            i += width(code);
+            continue;
+        }
+        const end = matchToken(text, i);
+        tokens.push(text.substring(i, end));
+        i = end;
+    }
+    return { text, tokens, inBlockComment };
+}
@@ -1,11 +1,28 @@
 import * as vscode from 'vscode';
-import { BugDetectorBackend, AnalysisResult } from './backend';
+import { BugDetectorBackend, AnalysisResult, BugReport } from './backend';
 import { ResultsProvider } from './resultsProvider';
 
+// 工作区扫描时结果批量推送的间隔
+const RESULT_FLUSH_INTERVAL_MS = 100;
+
+// 发送给面板的单个文件的结果
+interface WebviewFileResult {
+    fileName: string;
+    filePath: string;
+    success: boolean;
+    error?: string;
+    reports: BugReport[];
+    stats?: AnalysisResult['stats'];
+    partial?: boolean;
+    incompleteModules: string[];
+}
+
 export class DetectionPanel {
     private panel: vscode.WebviewPanel | undefined;
     private backend: BugDetectorBackend;
     private resultsProvider: ResultsProvider;
+    // 已发送给面板的各文件结果，下次只发送与它不同的文件
+    private sentResults: Map<string, AnalysisResult> = new Map();
 
     constructor(
         private context: vscode.ExtensionContext,
@@ -36,11 +53,17 @@ export class DetectionPanel {
 
         this.panel.onDidDispose(() => {
             this.panel = undefined;
+            this.sentResults.clear();
         });
 
         this.panel.webview.onDidReceiveMessage(
             async (message) => {
                 switch (message.command) {
+                    case 'ready':
+                        // 面板（重新）加载后没有任何结果，发送全部结果
+                        this.sentResults.clear();
+                        this.updateWebview();
+                        break;
                     case 'analyzeFile':
                         await this.handleAnalyzeFile(message.filePath);
                         break;
@@ -58,15 +81,27 @@ export class DetectionPanel {
         );
     }
 
-    public async analyzeFile(document: vscode.TextDocument): Promise<void> {
-        const result = await this.backend.analyzeFile(document.fileName);
+    /**
+     * debounceMs 大于0时（例如保存触发的分析）等待这么久再开始，期间同一文档的新分析取代本次分析
+     */
+    public async analyzeFile(document: vscode.TextDocument, debounceMs = 0): Promise<void> {
+        const fileName = document.fileName.split(/[\\/]/).pop() || document.fileName;
+        const result = await this.runFileAnalysis(`正在分析 ${fileName}`,
+            token => this.backend.analyzeDocument(document, token, debounceMs));
+        if (result.cancelled) {
+            return;
+        }
         this.resultsProvider.addResult(result);
         
         if (result.success) {
             const message = result.reports.length > 0 
                 ? `检测完成！发现 ${result.reports.length} 个问题`
                 : '检测完成！没有发现任何问题';
-            vscode.window.showInformationMessage(message);
+            if (result.partial) {
+                vscode.window.showWarningMessage(`${message}（超过时间预算，未完成的模块: ${(result.incomplete_modules || []).join(', ')}）`);
+            } else {
+                vscode.window.showInformationMessage(message);
+            }
         } else {
             vscode.window.showErrorMessage(`检测失败: ${result.error}`);
         }
@@ -74,33 +109,111 @@ export class DetectionPanel {
         this.updateWebview();
     }
 
+    /**
+     * 在可取消的进度通知中分析一个文件；同一文件上一次尚未完成的分析由调度器取消（以 cancelled 结果结束）
+     */
+    private async runFileAnalysis(title: string,
+                                  analyze: (token: vscode.CancellationToken) => Promise<AnalysisResult>): Promise<AnalysisResult> {
+        return vscode.window.withProgress({
+            location: vscode.ProgressLocation.Notification,
+            title,
+            cancellable: true
+        }, (_progress, token) => analyze(token));
+    }
+
+    /**
+     * 重新分析包含了已修改头文件的文档，只更新结果，不弹出提示
+     */
+    public async reanalyzeDocuments(documents: vscode.TextDocument[]): Promise<void> {
+        const results = await Promise.all(documents.map(document => this.backend.analyzeDocument(document)));
+        for (const result of results) {
+            if (!result.cancelled) {
+                this.resultsProvider.addResult(result);
+            }
+        }
+        this.updateWebview();
+    }
+
+    /**
+     * 编辑时的增量分析，只更新结果，不弹出提示
+     *
+     * 编辑事件已由 backend.recordDocumentChanges 记录，停止输入 debounceMs 后才分析一次；
+     * 被后续编辑取代的分析不更新结果。
+     */
+    public async analyzeChanges(document: vscode.TextDocument): Promise<void> {
+        const result = await this.backend.analyzeDocumentChanges(document);
+        if (result.cancelled) {
+            return;
+        }
+        this.resultsProvider.addResult(result);
+        this.updateWebview();
+    }
+
     public async analyzeWorkspace(): Promise<void> {
-        const statusBarItem = vscode.window.createStatusBarItem(vscode.StatusBarAlignment.Left);
-        statusBarItem.text = "$(loading~spin) 正在分析工作区...";
-        statusBarItem.show();
+        await vscode.window.withProgress({
+            location: vscode.ProgressLocation.Notification,
+            title: '正在分析工作区',
+            cancellable: true
+        }, (progress, token) => this.scanWorkspace(progress, token));
+    }
 
-        try {
-            const results = await this.backend.analyzeWorkspace();
-            this.resultsProvider.updateResults(results);
+    private async scanWorkspace(progress: vscode.Progress<{ message?: string }>,
+                                token: vscode.CancellationToken): Promise<void> {
+        // 扫描过程中按批次把结果推送到结果视图，不必等待整个工作区分析完成
+        const pending: AnalysisResult[] = [];
+        let flushTimer: NodeJS.Timeout | undefined;
+        const flush = () => {
+            flushTimer = undefined;
+            if (pending.length > 0) {
+                this.resultsProvider.addResults(pending.splice(0));
+                this.updateWebview();
+            }
+        };
 
-            const totalIssues = results.reduce((sum, result) => sum + (result.success ? result.reports.length : 0), 0);
-            const totalFiles = results.length;
+        try {
+            this.resultsProvider.clearResults();
 
-            vscode.window.showInformationMessage(
-                `工作区分析完成！检查了 ${totalFiles} 个文件，发现 ${totalIssues} 个问题`
-            );
+            let finished = 0;
+            let partial = 0;
+            const summary = await this.backend.analyzeWorkspace(result => {
+                pending.push(result);
+                finished++;
+                if (result.partial) {
+                    partial++;
+                }
+                progress.report({ message: `已完成 ${finished} 个文件` });
+                if (!flushTimer) {
+                    flushTimer = setTimeout(flush, RESULT_FLUSH_INTERVAL_MS);
+                }
+            }, token);
 
-            this.updateWebview();
+            const partialNote = partial > 0 ? `，其中 ${partial} 个文件超过时间预算只有部分结果` : '';
+            if (token.isCancellationRequested) {
+                vscode.window.showInformationMessage(
+                    `工作区分析已取消：已检查 ${summary.totalFiles} 个文件，发现 ${summary.totalIssues} 个问题${partialNote}`
+                );
+            } else {
+                vscode.window.showInformationMessage(
+                    `工作区分析完成！检查了 ${summary.totalFiles} 个文件，发现 ${summary.totalIssues} 个问题${partialNote}`
+                );
+            }
         } catch (error) {
             vscode.window.showErrorMessage(`工作区分析失败: ${error}`);
         } finally {
-            statusBarItem.hide();
-            statusBarItem.dispose();
+            if (flushTimer) {
+                clearTimeout(flushTimer);
+            }
+            flush();
         }
     }
 
     private async handleAnalyzeFile(filePath: string): Promise<void> {
-        const result = await this.backend.analyzeFile(filePath);
+        const fileName = filePath.split(/[\\/]/).pop() || filePath;
+        const result = await this.runFileAnalysis(`正在分析 ${fileName}`,
+            token => this.backend.analyzeFile(filePath, token));
+        if (result.cancelled) {
+            return;
+        }
         this.resultsProvider.addResult(result);
         this.updateWebview();
     }
@@ -109,30 +222,51 @@ export class DetectionPanel {
         await this.analyzeWorkspace();
     }
 
+    /**
+     * 只向面板发送上次以来新增、变化和移除的文件，面板在自己的索引中合并
+     */
     private updateWebview(): void {
-        if (this.panel) {
-            this.panel.webview.postMessage({
-                command: 'updateResults',
-                results: this.getResultsForWebview()
-            });
+        if (!this.panel) {
+            return;
         }
-    }
 
-    private getResultsForWebview(): any[] {
-        const results: any[] = [];
-        
-        for (const [filePath, result] of (this.resultsProvider as any).results) {
-            const fileName = filePath.split(/[\\/]/).pop() || filePath;
-            results.push({
-                fileName,
-                filePath,
-                success: result.success,
-                error: result.error,
-                reports: result.reports || []
-            });
+        const results = this.resultsProvider.getResults();
+        const added: WebviewFileResult[] = [];
+        const changed: WebviewFileResult[] = [];
+        const removed: string[] = [];
+        for (const [filePath, result] of results) {
+            const sent = this.sentResults.get(filePath);
+            if (sent === result) {
+                continue;
+            }
+            (sent ? changed : added).push(this.toWebviewResult(filePath, result));
+            this.sentResults.set(filePath, result);
         }
-        
-        return results;
+        for (const filePath of this.sentResults.keys()) {
+            if (!results.has(filePath)) {
+                removed.push(filePath);
+            }
+        }
+        for (const filePath of removed) {
+            this.sentResults.delete(filePath);
+        }
+
+        if (added.length > 0 || changed.length > 0 || removed.length > 0) {
+            this.panel.webview.postMessage({ command: 'applyDiff', added, changed, removed });
+        }
+    }
+
+    private toWebviewResult(filePath: string, result: AnalysisResult): WebviewFileResult {
+        return {
+            fileName: filePath.split(/[\\/]/).pop() || filePath,
+            filePath,
+            success: result.success,
+            error: result.error,
+            reports: result.reports || [],
+            stats: result.stats,
+            partial: result.partial,
+            incompleteModules: result.incomplete_modules || []
+        };
     }
 
     private getWebviewContent(): string {
@@ -150,10 +284,14 @@ export class DetectionPanel {
             background-color: var(--vscode-editor-background);
             margin: 0;
             padding: 20px;
+            box-sizing: border-box;
+            height: 100vh;
+            display: flex;
+            flex-direction: column;
         }
         
         .header {
-            margin-bottom: 20px;
+            margin-bottom: 10px;
             padding-bottom: 10px;
             border-bottom: 1px solid var(--vscode-panel-border);
         }
@@ -167,7 +305,7 @@ export class DetectionPanel {
         .buttons {
             display: flex;
             gap: 10px;
-            margin-bottom: 20px;
+            margin-bottom: 10px;
         }
         
         button {
@@ -190,31 +328,70 @@ export class DetectionPanel {
             cursor: not-allowed;
         }
         
-        .results {
-            margin-top: 20px;
+        .filters {
+            display: flex;
+            gap: 10px;
         }
         
-        .file-result {
-            margin-bottom: 20px;
-            border: 1px solid var(--vscode-panel-border);
-            border-radius: 4px;
+        .filters input, .filters select {
+            background-color: var(--vscode-input-background);
+            color: var(--vscode-input-foreground);
+            border: 1px solid var(--vscode-input-border, transparent);
+            padding: 4px 6px;
+        }
+        
+        .filters input {
+            flex: 1;
+        }
+        
+        .status {
+            margin-bottom: 6px;
+            font-size: 12px;
+            color: var(--vscode-descriptionForeground);
+        }
+        
+        /* 虚拟列表：只有可见区域附近的行存在于DOM中，每行按固定高度绝对定位 */
+        .viewport {
+            flex: 1;
+            overflow-y: auto;
+            position: relative;
+        }
+        
+        .canvas {
+            position: relative;
+        }
+        
+        .row {
+            position: absolute;
+            left: 0;
+            right: 0;
+            box-sizing: border-box;
             overflow: hidden;
         }
         
+        .row div, .row.note, .row.file-header {
+            white-space: nowrap;
+            overflow: hidden;
+            text-overflow: ellipsis;
+        }
+        
         .file-header {
             background-color: var(--vscode-panel-background);
-            padding: 10px;
+            padding: 8px 10px;
             font-weight: bold;
-            border-bottom: 1px solid var(--vscode-panel-border);
+            border: 1px solid var(--vscode-panel-border);
+            border-radius: 4px 4px 0 0;
         }
         
-        .file-content {
-            padding: 10px;
+        .note {
+            padding: 4px 10px;
+            line-height: 16px;
         }
         
         .bug-item {
-            margin-bottom: 10px;
-            padding: 8px;
+            margin: 0 10px;
+            padding: 4px 8px;
+            line-height: 17px;
             border-left: 3px solid var(--vscode-charts-red);
             background-color: var(--vscode-textCodeBlock-background);
         }
@@ -229,11 +406,6 @@ export class DetectionPanel {
         
         .bug-line {
             font-weight: bold;
-            margin-bottom: 4px;
-        }
-        
-        .bug-message {
-            margin-bottom: 4px;
         }
         
         .bug-suggestion {
@@ -244,7 +416,10 @@ export class DetectionPanel {
         .bug-module {
             font-size: 12px;
             color: var(--vscode-descriptionForeground);
-            margin-top: 4px;
+        }
+        
+        .partial {
+            color: var(--vscode-editorWarning-foreground);
         }
         
         .no-results {
@@ -253,13 +428,43 @@ export class DetectionPanel {
             margin-top: 40px;
         }
         
+        .stats {
+            margin-bottom: 10px;
+            font-size: 12px;
+            color: var(--vscode-descriptionForeground);
+        }
+        
+        .stats summary {
+            cursor: pointer;
+        }
+        
+        .stats table {
+            border-collapse: collapse;
+            margin-top: 6px;
+        }
+        
+        .stats td {
+            padding: 2px 10px 2px 0;
+            text-align: right;
+        }
+        
+        .stats td:first-child {
+            text-align: left;
+        }
+        
+        .stats-bar {
+            display: inline-block;
+            height: 8px;
+            background-color: var(--vscode-charts-blue);
+        }
+        
         .error {
             color: var(--vscode-errorForeground);
             background-color: var(--vscode-inputValidation-errorBackground);
             border: 1px solid var(--vscode-inputValidation-errorBorder);
-            padding: 10px;
+            margin: 0 10px;
+            padding: 4px 10px;
             border-radius: 4px;
-            margin-bottom: 10px;
         }
     </style>
 </head>
@@ -271,10 +476,27 @@ export class DetectionPanel {
             <button onclick="analyzeWorkspace()">分析工作区</button>
             <button onclick="clearResults()">清除结果</button>
         </div>
+        <div class="filters">
+            <input id="filterText" type="search" placeholder="筛选文件名、消息或模块">
+            <select id="filterSeverity">
+                <option value="all">全部严重程度</option>
+                <option value="Error">错误</option>
+                <option value="Warning">警告</option>
+                <option value="Info">提示</option>
+            </select>
+            <select id="sortOrder">
+                <option value="name">按文件名排序</option>
+                <option value="issues">按问题数排序</option>
+                <option value="severity">按严重程度排序</option>
+            </select>
+        </div>
     </div>
     
-    <div id="results" class="results">
-        <div class="no-results">点击上方按钮开始检测</div>
+    <div id="summary"></div>
+    <div id="status" class="status"></div>
+    <div id="viewport" class="viewport">
+        <div id="canvas" class="canvas"></div>
+        <div id="empty" class="no-results">点击上方按钮开始检测</div>
     </div>
 
     <script>
@@ -299,52 +521,381 @@ export class DetectionPanel {
             });
         }
         
-        function updateResults(results) {
-            const resultsDiv = document.getElementById('results');
-            
-            if (results.length === 0) {
-                resultsDiv.innerHTML = '<div class="no-results">没有检测结果</div>';
+        // 统计中的阶段名与显示名的对应关系
+        const PHASE_LABELS = {
+            read: '读取',
+            decode: '解码',
+            cache: '缓存',
+            strip_comments: '去注释',
+            tokenize: '分词',
+            scan: '扫描',
+            parse: '解析',
+            context: '构建上下文',
+            memory_safety: '内存安全',
+            variable_state: '变量状态',
+            standard_library: '标准库',
+            numeric_control_flow: '数值与控制流',
+            merge: '合并结果',
+            format: '格式化报告'
+        };
+        
+        function formatAllocation(phase) {
+            if (phase.allocated_blocks !== undefined) {
+                return (phase.allocated_blocks >= 0 ? '+' : '') + phase.allocated_blocks + ' 块';
+            }
+            if (phase.heap_bytes !== undefined) {
+                return (phase.heap_bytes >= 0 ? '+' : '') + (phase.heap_bytes / 1024).toFixed(1) + ' KB';
+            }
+            return '';
+        }
+        
+        function renderStats(title, phases, totalSeconds, open) {
+            let html = \`<details class="stats"\${open ? ' open' : ''}><summary>⏱️ \${title}：\${(totalSeconds * 1000).toFixed(2)} ms</summary><table>\`;
+            for (const phase of phases) {
+                const share = totalSeconds > 0 ? phase.seconds / totalSeconds : 0;
+                html += \`<tr>
+                    <td>\${PHASE_LABELS[phase.name] || phase.name}</td>
+                    <td>\${(phase.seconds * 1000).toFixed(2)} ms</td>
+                    <td>\${(share * 100).toFixed(1)}%</td>
+                    <td><span class="stats-bar" style="width: \${Math.round(share * 120)}px"></span></td>
+                    <td>\${formatAllocation(phase)}</td>
+                </tr>\`;
+            }
+            return html + '</table></details>';
+        }
+        
+        // 各类行的固定高度（像素）；文件之间留出 FILE_GAP 的间隔
+        const ROW_HEIGHTS = { file: 34, note: 24, error: 30, report: 64 };
+        const FILE_GAP = 12;
+        // 可见区域上下额外渲染的高度，滚动时不会看到空白
+        const OVERSCAN_PX = 600;
+        
+        // 面板内的结果索引：文件路径 -> 条目。扩展只发送新增、变化和移除的文件，
+        // 筛选和排序都在这里完成，不需要扩展重新发送数据
+        const files = new Map();
+        // 当前排序下、筛选后有内容的文件，以及它们在列表中的起始位置
+        let ordered = [];
+        let tops = [];
+        let totalHeight = 0;
+        const filter = { text: '', severity: 'all', sort: 'name' };
+        let received = false;
+        
+        // 所有文件按阶段累加的耗时和问题总数，随差异增减
+        const phaseTotals = new Map();
+        let statsFiles = 0;
+        let statsSeconds = 0;
+        let totalReports = 0;
+        let summaryOpen = false;
+        
+        function createEntry(result) {
+            const counts = { Error: 0, Warning: 0, Info: 0 };
+            if (result.success) {
+                for (const report of result.reports) {
+                    counts[report.severity] = (counts[report.severity] || 0) + 1;
+                }
+            }
+            const entry = { result, counts, issues: result.success ? result.reports.length : 0, head: [], reports: [], height: 0 };
+            buildRows(entry);
+            return entry;
+        }
+        
+        function searchText(report) {
+            if (report.searchText === undefined) {
+                report.searchText = (report.message + ' ' + report.suggestion + ' ' + report.module_name + ' ' + report.error_type).toLowerCase();
+            }
+            return report.searchText;
+        }
+        
+        // 按当前筛选计算文件的行：少量固定的表头行，加上筛选后的报告（报告行不单独创建对象）
+        function buildRows(entry) {
+            const result = entry.result;
+            const nameMatches = !filter.text || result.filePath.toLowerCase().includes(filter.text);
+            let reports = result.success ? result.reports : [];
+            if (filter.severity !== 'all' || !nameMatches) {
+                reports = reports.filter(report => (filter.severity === 'all' || report.severity === filter.severity)
+                    && (nameMatches || searchText(report).includes(filter.text)));
+            }
+            entry.head = [];
+            entry.reports = reports;
+            entry.height = 0;
+            const filtering = filter.text !== '' || filter.severity !== 'all';
+            if (filtering && reports.length === 0 && !(nameMatches && filter.severity === 'all')) {
                 return;
             }
             
-            let html = '';
+            entry.head.push({ kind: 'file' });
+            if (result.stats) {
+                entry.head.push({ kind: 'note', type: 'stats' });
+            }
+            if (result.partial) {
+                entry.head.push({ kind: 'note', type: 'partial' });
+            }
+            if (!result.success) {
+                entry.head.push({ kind: 'error' });
+            } else if (result.reports.length === 0) {
+                entry.head.push({ kind: 'note', type: 'clean' });
+            }
+            for (const row of entry.head) {
+                entry.height += ROW_HEIGHTS[row.kind];
+            }
+            entry.height += reports.length * ROW_HEIGHTS.report + FILE_GAP;
+        }
+        
+        function compareEntries(a, b) {
+            if (filter.sort === 'issues' && a.issues !== b.issues) {
+                return b.issues - a.issues;
+            }
+            if (filter.sort === 'severity') {
+                for (const severity of ['Error', 'Warning', 'Info']) {
+                    if (a.counts[severity] !== b.counts[severity]) {
+                        return b.counts[severity] - a.counts[severity];
+                    }
+                }
+            }
+            return a.result.fileName.localeCompare(b.result.fileName) || a.result.filePath.localeCompare(b.result.filePath);
+        }
+        
+        // 重新排列文件并计算各文件的起始位置（只处理文件，不遍历报告）
+        function relayout() {
+            ordered = [];
+            for (const entry of files.values()) {
+                if (entry.height > 0) {
+                    ordered.push(entry);
+                }
+            }
+            ordered.sort(compareEntries);
+            tops = new Array(ordered.length);
+            totalHeight = 0;
+            for (let i = 0; i < ordered.length; i++) {
+                tops[i] = totalHeight;
+                totalHeight += ordered[i].height;
+            }
+        }
+        
+        function addTotals(result, sign) {
+            totalReports += sign * (result.success ? result.reports.length : 0);
+            if (!result.stats) {
+                return;
+            }
+            statsFiles += sign;
+            for (const phase of result.stats.phases) {
+                const entry = phaseTotals.get(phase.name) || { name: phase.name, seconds: 0 };
+                entry.seconds += sign * phase.seconds;
+                statsSeconds += sign * phase.seconds;
+                phaseTotals.set(phase.name, entry);
+            }
+        }
+        
+        function applyDiff(message) {
+            received = true;
+            for (const filePath of message.removed) {
+                const entry = files.get(filePath);
+                if (entry) {
+                    addTotals(entry.result, -1);
+                    files.delete(filePath);
+                }
+            }
+            for (const result of message.added.concat(message.changed)) {
+                const previous = files.get(result.filePath);
+                if (previous) {
+                    addTotals(previous.result, -1);
+                }
+                files.set(result.filePath, createEntry(result));
+                addTotals(result, 1);
+            }
+            relayout();
+            renderSummary();
+            scheduleRender();
+        }
+        
+        function applyFilter() {
+            filter.text = document.getElementById('filterText').value.trim().toLowerCase();
+            filter.severity = document.getElementById('filterSeverity').value;
+            filter.sort = document.getElementById('sortOrder').value;
+            for (const entry of files.values()) {
+                buildRows(entry);
+            }
+            relayout();
+            renderSummary();
+            document.getElementById('viewport').scrollTop = 0;
+            scheduleRender();
+        }
+        
+        function resort() {
+            filter.sort = document.getElementById('sortOrder').value;
+            relayout();
+            scheduleRender();
+        }
+        
+        // 所有文件按阶段累加的耗时，找出整体上最慢的阶段
+        function renderSummary() {
+            const summaryDiv = document.getElementById('summary');
+            if (statsFiles < 2) {
+                summaryDiv.innerHTML = '';
+            } else {
+                const phases = [...phaseTotals.values()].filter(phase => phase.seconds > 0).sort((a, b) => b.seconds - a.seconds);
+                summaryDiv.innerHTML = renderStats(\`全部 \${statsFiles} 个文件的分阶段耗时\`, phases, Math.max(0, statsSeconds), summaryOpen);
+            }
             
-            for (const result of results) {
-                html += \`<div class="file-result">
-                    <div class="file-header">📁 \${result.fileName}</div>
-                    <div class="file-content">\`;
-                
-                if (!result.success) {
-                    html += \`<div class="error">检测失败: \${result.error}</div>\`;
-                } else if (result.reports.length === 0) {
-                    html += '<div class="no-results">✅ 没有发现任何问题</div>';
+            let shown = 0;
+            let shownReports = 0;
+            for (const entry of ordered) {
+                shown++;
+                shownReports += entry.reports.length;
+            }
+            let status = \`\${files.size} 个文件，\${totalReports} 个问题\`;
+            if (filter.text || filter.severity !== 'all') {
+                status += \`；筛选后 \${shown} 个文件，\${shownReports} 个问题\`;
+            }
+            document.getElementById('status').textContent = files.size > 0 ? status : '';
+        }
+        
+        function describeStats(stats) {
+            const phases = stats.phases.slice().sort((a, b) => b.seconds - a.seconds).slice(0, 3);
+            const shares = phases.map(phase => (PHASE_LABELS[phase.name] || phase.name) + ' '
+                + (stats.total_seconds > 0 ? (phase.seconds / stats.total_seconds * 100).toFixed(1) : '0.0') + '%');
+            return '⏱️ ' + (stats.cached ? '分阶段耗时（缓存结果）' : '分阶段耗时') + '：'
+                + (stats.total_seconds * 1000).toFixed(2) + ' ms' + (shares.length > 0 ? '（' + shares.join('，') + '）' : '');
+        }
+        
+        function createRow(className, top, height, text) {
+            const row = document.createElement('div');
+            row.className = 'row ' + className;
+            row.style.top = top + 'px';
+            row.style.height = height + 'px';
+            if (text !== undefined) {
+                row.textContent = text;
+                row.title = text;
+            }
+            return row;
+        }
+        
+        function renderHeadRow(entry, row, top) {
+            const result = entry.result;
+            const height = ROW_HEIGHTS[row.kind];
+            if (row.kind === 'file') {
+                const element = createRow('file-header', top, height, '📁 ' + result.fileName + (result.success ? '（' + entry.issues + ' 个问题）' : ''));
+                element.title = result.filePath;
+                return element;
+            }
+            if (row.kind === 'error') {
+                return createRow('error', top, height - 4, '检测失败: ' + result.error);
+            }
+            if (row.type === 'stats') {
+                return createRow('note stats', top, height, describeStats(result.stats));
+            }
+            if (row.type === 'partial') {
+                return createRow('note partial', top, height, '⏱️ 超过时间预算，以下模块未完成，其结果不完整: ' + result.incompleteModules.join(', '));
+            }
+            return createRow('note', top, height, '✅ 没有发现任何问题');
+        }
+        
+        function renderReport(report, top) {
+            const row = createRow('bug-item ' + report.severity.toLowerCase(), top, ROW_HEIGHTS.report - 6);
+            const lines = [
+                ['bug-line', '第 ' + (report.locations ? report.locations.join(', ') : report.line_number) + ' 行：' + report.message],
+                ['bug-suggestion', '💡 ' + report.suggestion],
+                ['bug-module', '🔧 ' + report.module_name + (report.partial ? '（部分结果）' : '')]
+            ];
+            for (const [className, text] of lines) {
+                const line = document.createElement('div');
+                line.className = className;
+                line.textContent = text;
+                line.title = text;
+                row.appendChild(line);
+            }
+            return row;
+        }
+        
+        // 第一个起始位置大于 y 的文件
+        function upperBound(y) {
+            let low = 0;
+            let high = tops.length;
+            while (low < high) {
+                const middle = (low + high) >> 1;
+                if (tops[middle] > y) {
+                    high = middle;
                 } else {
-                    for (const report of result.reports) {
-                        const severityClass = report.severity.toLowerCase();
-                        html += \`<div class="bug-item \${severityClass}">
-                            <div class="bug-line">第 \${report.line_number} 行</div>
-                            <div class="bug-message">\${report.message}</div>
-                            <div class="bug-suggestion">💡 \${report.suggestion}</div>
-                            <div class="bug-module">🔧 \${report.module_name}</div>
-                        </div>\`;
-                    }
+                    low = middle + 1;
                 }
-                
-                html += '</div></div>';
             }
+            return low;
+        }
+        
+        // 只渲染可见区域（上下各加 OVERSCAN_PX）内的行
+        function render() {
+            const viewport = document.getElementById('viewport');
+            const canvas = document.getElementById('canvas');
+            const empty = document.getElementById('empty');
+            canvas.style.height = totalHeight + 'px';
+            
+            if (ordered.length === 0) {
+                canvas.replaceChildren();
+                empty.style.display = '';
+                empty.textContent = !received ? '点击上方按钮开始检测'
+                    : files.size === 0 ? '没有检测结果' : '没有符合筛选条件的结果';
+                return;
+            }
+            empty.style.display = 'none';
             
-            resultsDiv.innerHTML = html;
+            const top = viewport.scrollTop - OVERSCAN_PX;
+            const bottom = viewport.scrollTop + viewport.clientHeight + OVERSCAN_PX;
+            const fragment = document.createDocumentFragment();
+            for (let index = Math.max(0, upperBound(top) - 1); index < ordered.length && tops[index] < bottom; index++) {
+                const entry = ordered[index];
+                let y = tops[index];
+                for (const row of entry.head) {
+                    if (y + ROW_HEIGHTS[row.kind] > top && y < bottom) {
+                        fragment.appendChild(renderHeadRow(entry, row, y));
+                    }
+                    y += ROW_HEIGHTS[row.kind];
+                }
+                const first = Math.max(0, Math.floor((top - y) / ROW_HEIGHTS.report));
+                const last = Math.min(entry.reports.length, Math.ceil((bottom - y) / ROW_HEIGHTS.report));
+                for (let i = first; i < last; i++) {
+                    fragment.appendChild(renderReport(entry.reports[i], y + i * ROW_HEIGHTS.report));
+                }
+            }
+            canvas.replaceChildren(fragment);
         }
         
+        // 同一帧内的多次更新和滚动只渲染一次
+        let renderQueued = false;
+        function scheduleRender() {
+            if (!renderQueued) {
+                renderQueued = true;
+                requestAnimationFrame(() => {
+                    renderQueued = false;
+                    render();
+                });
+            }
+        }
+        
+        let filterTimer;
+        document.getElementById('filterText').addEventListener('input', () => {
+            clearTimeout(filterTimer);
+            filterTimer = setTimeout(applyFilter, 150);
+        });
+        document.getElementById('filterSeverity').addEventListener('change', applyFilter);
+        document.getElementById('sortOrder').addEventListener('change', resort);
+        document.getElementById('viewport').addEventListener('scroll', scheduleRender);
+        window.addEventListener('resize', scheduleRender);
+        // toggle 事件不冒泡，在捕获阶段记录汇总的展开状态，重新渲染汇总时保持
+        document.getElementById('summary').addEventListener('toggle', event => {
+            summaryOpen = event.target.open;
+        }, true);
+        
         // 监听来自扩展的消息
         window.addEventListener('message', event => {
             const message = event.data;
             switch (message.command) {
-                case 'updateResults':
-                    updateResults(message.results);
+                case 'applyDiff':
+                    applyDiff(message);
                     break;
             }
         });
+        
+        vscode.postMessage({ command: 'ready' });
     </script>
 </body>
 </html>`;
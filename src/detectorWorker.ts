@@ -0,0 +1,84 @@
+import * as fs from 'fs';
+import { parentPort, workerData } from 'worker_threads';
+import { AnalysisResult, CDetector } from './cDetector';
+import { scanIncludes } from './includeGraph';
+import { PhaseRecorder } from './instrumentation';
+import { ResultCache } from './resultCache';
+import { AnalysisJob, WorkerOptions, WorkerRequest, WorkerResponse } from './workerPool';
+
+// 工作线程入口：在扩展主线程之外运行 CDetector
+const options: WorkerOptions = workerData || {};
+const detector = new CDetector();
+const cache = options.cacheDir ? new ResultCache(options.cacheDir, CDetector.VERSION) : undefined;
+
+async function analyzeJob(job: AnalysisJob): Promise<AnalysisResult> {
+    // 时间预算从任务开始计算，包括读取文件和查找缓存
+    const deadline = job.timeBudgetMs && job.timeBudgetMs > 0 ? Date.now() + job.timeBudgetMs : Infinity;
+    const recorder = new PhaseRecorder();
+    let content: Buffer;
+    try {
+        recorder.begin();
+        content = job.content !== undefined ? Buffer.from(job.content, 'utf8') : await fs.promises.readFile(job.filePath);
+        recorder.end('read');
+    } catch (error) {
+        return {
+            file_path: job.filePath,
+            reports: [],
+            success: false,
+            error: `无法读取文件: ${job.filePath}`
+        };
+    }
+
+    detector.setIncludeDirs(job.includeDirs || []);
+    const text = recorder.time('decode', () => content.toString('utf8'));
+
+    // 内容、包含的工作区头文件的摘要和调用的其他文件中函数的摘要都未变化的文件直接使用缓存结果
+    let key: string | undefined;
+    if (cache && job.useCache) {
+        recorder.begin();
+        const closure = detector.getIncludeGraph().fileClosure(job.filePath, scanIncludes(text));
+        detector.indexFunctions(job.filePath, text);
+        const dependencies = closure.digest + detector.getFunctionSummaries().dependencyDigest(job.filePath);
+        key = cache.makeKey(content, job.enabledModules, dependencies);
+        const cachedReports = cache.get(key);
+        recorder.end('cache');
+        if (cachedReports) {
+            const cached: AnalysisResult = {
+                file_path: job.filePath,
+                reports: cachedReports,
+                success: true,
+                stats: recorder.finish(true)
+            };
+            if (closure.dependencies.size > 0) {
+                cached.dependencies = [...closure.dependencies];
+            }
+            return cached;
+        }
+    }
+
+    const result = detector.analyzeContent(job.filePath, text, recorder, deadline);
+    // 部分结果不写入缓存
+    if (cache && key && result.success && !result.partial) {
+        cache.set(key, result.reports);
+    }
+    return result;
+}
+
+if (parentPort) {
+    const port = parentPort;
+    port.on('message', async (request: WorkerRequest) => {
+        let result: AnalysisResult;
+        try {
+            result = await analyzeJob(request.job);
+        } catch (error) {
+            result = {
+                file_path: request.job.filePath,
+                reports: [],
+                success: false,
+                error: `检测器执行失败: ${error}`
+            };
+        }
+        const response: WorkerResponse = { id: request.id, result };
+        port.postMessage(response);
+    });
+}
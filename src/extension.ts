@@ -6,8 +6,9 @@ import { DetectionPanel } from './detectionPanel';
 export function activate(context: vscode.ExtensionContext) {
     console.log('C Bug Detector extension is now active!');
 
-    // 初始化后端
-    const backend = new BugDetectorBackend();
+    // 初始化后端（结果缓存存放在扩展的存储目录中）
+    const storageUri = context.storageUri || context.globalStorageUri;
+    const backend = new BugDetectorBackend(storageUri.fsPath, context.extensionPath);
     const resultsProvider = new ResultsProvider();
     const detectionPanel = new DetectionPanel(context, backend, resultsProvider);
 
@@ -58,12 +59,44 @@ export function activate(context: vscode.ExtensionContext) {
 
     // 监听文档保存
     const saveListener = vscode.workspace.onDidSaveTextDocument(async (document) => {
+        const config = vscode.workspace.getConfiguration('c-bug-detector');
         if (document.fileName.endsWith('.c')) {
-            const config = vscode.workspace.getConfiguration('c-bug-detector');
             if (config.get('autoAnalyzeOnSave', false)) {
-                await detectionPanel.analyzeFile(document);
+                // 连续保存只分析最后一次
+                await detectionPanel.analyzeFile(document, backend.getDebounceMs());
             }
+        } else if (document.fileName.endsWith('.h')) {
+            // 头文件的摘要变化后，重新分析打开的、直接或间接包含它的C文件
+            const dependents = new Set(await backend.invalidateHeader(document.fileName));
+            const documents = vscode.workspace.textDocuments.filter(
+                openDocument => openDocument.fileName.endsWith('.c') && dependents.has(openDocument.fileName));
+            if (documents.length > 0 && (config.get('analyzeOnType', true) || config.get('autoAnalyzeOnSave', false))) {
+                await detectionPanel.reanalyzeDocuments(documents);
+            }
+        }
+    });
+
+    // 监听文档编辑：立即记录变化并暂停后台分析，停止输入后增量地重新分析变化的区域
+    const changeListener = vscode.workspace.onDidChangeTextDocument(event => {
+        if (event.contentChanges.length === 0 || !event.document.fileName.endsWith('.c')) {
+            return;
         }
+        backend.recordDocumentChanges(event);
+        backend.notifyTyping();
+        const config = vscode.workspace.getConfiguration('c-bug-detector');
+        if (config.get('analyzeOnType', true)) {
+            detectionPanel.analyzeChanges(event.document);
+        }
+    });
+
+    // 可见编辑器中的文件优先分析
+    const updateVisibleDocuments = () => backend.setVisibleDocuments(
+        vscode.window.visibleTextEditors.map(editor => editor.document.fileName));
+    const visibleEditorsListener = vscode.window.onDidChangeVisibleTextEditors(updateVisibleDocuments);
+    updateVisibleDocuments();
+
+    const closeListener = vscode.workspace.onDidCloseTextDocument(document => {
+        backend.closeDocument(document);
     });
 
     // 注册到上下文
@@ -76,6 +109,9 @@ export function activate(context: vscode.ExtensionContext) {
         diagnosticCollection,
         configChangeListener,
         saveListener,
+        changeListener,
+        visibleEditorsListener,
+        closeListener,
         backend,
         resultsProvider,
         detectionPanel
@@ -0,0 +1,454 @@
+import * as crypto from 'crypto';
+import { lexLine } from './cLexer';
+
+/**
+ * 函数摘要（与后端 utils/function_summaries.py 相同）
+ *
+ * 局部摘要只由函数自身的代码得到：形参原样传给了哪些函数的第几个参数、返回了哪些函数调用的结果。
+ * 完整摘要（返回新分配内存的所有权、释放第N个参数）在查询时沿调用图自底向上计算并缓存，
+ * 某个函数的局部摘要变化时只丢弃它和调用它的函数的完整摘要；递归调用的函数在环上视为没有影响。
+ */
+
+export interface LocalSummary {
+    name: string;
+    parameters: (string | null)[];
+    // [被调用函数, 实参位置, 本函数的形参位置]
+    forwarded: [string, number, number][];
+    returnedCalls: string[];
+    callees: string[];
+    digest: string;
+}
+
+export interface FunctionSummary {
+    allocates: boolean;
+    freesParams: Set<number>;
+}
+
+// 函数体内的调用，行号相对于区域起始行
+export interface CallSite {
+    callee: string;
+    args: (string | null)[];
+    assigned?: string;
+    line: number;
+    snippet: string;
+}
+
+export interface RegionOwnership {
+    functions: LocalSummary[];
+    calls: CallSite[];
+    // return 语句直接返回的变量（所有权交给调用者）
+    returns: string[];
+}
+
+// 返回新分配内存的库函数
+const ALLOCATORS = ['malloc', 'calloc', 'realloc', 'strdup'];
+const BUILTIN_SUMMARIES: Map<string, FunctionSummary> = new Map(
+    ALLOCATORS.map(name => [name, { allocates: true, freesParams: new Set<number>() }] as [string, FunctionSummary]));
+BUILTIN_SUMMARIES.set('free', { allocates: false, freesParams: new Set([0]) });
+const EMPTY_SUMMARY: FunctionSummary = { allocates: false, freesParams: new Set() };
+
+const IDENTIFIER = /^[A-Za-z_]\w*$/;
+// 出现在 "名称(" 之前时不是函数调用或定义的关键字
+const NON_CALL_KEYWORDS = new Set(['int', 'char', 'float', 'double', 'long', 'short', 'unsigned', 'signed', 'void',
+    'if', 'while', 'for', 'do', 'return', 'break', 'continue', 'switch', 'sizeof', 'else', 'case', 'goto']);
+// 参数列表中不是参数名的关键字
+const PARAMETER_KEYWORDS = new Set(['int', 'char', 'float', 'double', 'long', 'short', 'unsigned', 'signed', 'void',
+    'const', 'volatile', 'struct', 'union', 'enum', 'register', 'restrict']);
+
+function findClosingParen(tokens: string[], open: number): number {
+    let depth = 0;
+    for (let i = open; i < tokens.length; i++) {
+        if (tokens[i] === '(') {
+            depth++;
+        } else if (tokens[i] === ')') {
+            depth--;
+            if (depth === 0) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+function splitArguments(tokens: string[], open: number, close: number): string[][] {
+    const args: string[][] = [[]];
+    let depth = 0;
+    for (let i = open + 1; i < close; i++) {
+        const token = tokens[i];
+        if (token === '(' || token === '[' || token === '{') {
+            depth++;
+        } else if (token === ')' || token === ']' || token === '}') {
+            depth--;
+        } else if (token === ',' && depth === 0) {
+            args.push([]);
+            continue;
+        }
+        args[args.length - 1].push(token);
+    }
+    return args.length === 1 && args[0].length === 0 ? [] : args;
+}
+
+function skipCast(tokens: string[], index: number): number {
+    if (index < 0 || tokens[index] !== ')') {
+        return index;
+    }
+    let depth = 0;
+    for (let j = index; j >= 0; j--) {
+        if (tokens[j] === ')') {
+            depth++;
+        } else if (tokens[j] === '(') {
+            depth--;
+            if (depth === 0) {
+                return j - 1;
+            }
+        }
+    }
+    return index;
+}
+
+/**
+ * 一行记号中的函数调用：实参为单个标识符时记录其名称；结果赋给变量（可带类型转换）或直接返回
+ */
+export function statementCalls(tokens: string[]): { callee: string, args: (string | null)[], assigned?: string, returned: boolean }[] {
+    const calls = [];
+    for (let i = 1; i < tokens.length; i++) {
+        const callee = tokens[i - 1];
+        if (tokens[i] !== '(' || !IDENTIFIER.test(callee) || NON_CALL_KEYWORDS.has(callee)) {
+            continue;
+        }
+        let close = findClosingParen(tokens, i);
+        if (close < 0) {
+            close = tokens.length;
+        }
+        const args = splitArguments(tokens, i, close)
+            .map(arg => arg.length === 1 && IDENTIFIER.test(arg[0]) ? arg[0] : null);
+        const before = skipCast(tokens, i - 2);
+        const assigned = before >= 1 && tokens[before] === '=' && IDENTIFIER.test(tokens[before - 1]) ? tokens[before - 1] : undefined;
+        calls.push({ callee, args, assigned, returned: before >= 0 && tokens[before] === 'return' });
+    }
+    return calls;
+}
+
+function parameterNames(tokens: string[], open: number, close: number): (string | null)[] {
+    const names: (string | null)[] = [];
+    for (const parameter of splitArguments(tokens, open, close)) {
+        if (parameter.length === 1 && (parameter[0] === 'void' || parameter[0] === '...')) {
+            continue;
+        }
+        const candidates = parameter.filter(token => IDENTIFIER.test(token) && !PARAMETER_KEYWORDS.has(token));
+        names.push(candidates.length > 0 && !parameter.includes('(') ? candidates[candidates.length - 1] : null);
+    }
+    return names;
+}
+
+class SummaryBuilder {
+    private parameterIndex: Map<string, number> = new Map();
+    private forwarded: Map<string, [string, number, number]> = new Map();
+    private returnedCalls: Set<string> = new Set();
+    private returnedNames: Set<string> = new Set();
+    private callees: Set<string> = new Set();
+    private holders: Map<string, Set<string>> = new Map();
+
+    constructor(private name: string, private parameters: (string | null)[], private ownership: RegionOwnership) {
+        parameters.forEach((param, index) => {
+            if (param) {
+                this.parameterIndex.set(param, index);
+            }
+        });
+    }
+
+    public addLine(tokens: string[], line: number, snippet: string): void {
+        for (const call of statementCalls(tokens)) {
+            this.callees.add(call.callee);
+            call.args.forEach((arg, position) => {
+                const param = arg !== null ? this.parameterIndex.get(arg) : undefined;
+                if (param !== undefined) {
+                    this.forwarded.set(`${call.callee}\0${position}\0${param}`, [call.callee, position, param]);
+                }
+            });
+            if (call.returned) {
+                this.returnedCalls.add(call.callee);
+            } else if (call.assigned !== undefined) {
+                let holder = this.holders.get(call.assigned);
+                if (!holder) {
+                    holder = new Set();
+                    this.holders.set(call.assigned, holder);
+                }
+                holder.add(call.callee);
+            }
+            this.ownership.calls.push({ callee: call.callee, args: call.args, assigned: call.assigned, line, snippet });
+        }
+        for (let i = 0; i + 2 < tokens.length; i++) {
+            if (tokens[i] === 'return' && IDENTIFIER.test(tokens[i + 1]) && tokens[i + 2] === ';') {
+                this.returnedNames.add(tokens[i + 1]);
+                this.ownership.returns.push(tokens[i + 1]);
+            }
+        }
+    }
+
+    public finish(): LocalSummary {
+        const returnedCalls = new Set(this.returnedCalls);
+        for (const name of this.returnedNames) {
+            for (const callee of this.holders.get(name) || []) {
+                returnedCalls.add(callee);
+            }
+        }
+        const forwarded = [...this.forwarded.keys()].sort().map(key => this.forwarded.get(key)!);
+        const summary = {
+            parameters: this.parameters,
+            forwarded,
+            returnedCalls: [...returnedCalls].sort(),
+            callees: [...this.callees].sort()
+        };
+        const digest = crypto.createHash('sha256').update(JSON.stringify(summary)).digest('hex');
+        return { name: this.name, ...summary, digest };
+    }
+}
+
+/**
+ * 区域内各函数定义的局部摘要，以及函数体内的调用和返回的变量
+ *
+ * 顶层的 "名称(...)" 之后（同一行或下一行开头）紧接 '{' 时视为函数定义。函数头单独占一行、
+ * '{' 在下一行时，函数头位于前一个区域，这时由 headerLine 给出函数头所在的行。
+ */
+export function summarizeRegion(lines: string[], start: number, end: number, headerLine?: string): RegionOwnership {
+    const ownership: RegionOwnership = { functions: [], calls: [], returns: [] };
+    let depth = 0;
+    let header: [string, (string | null)[]] | undefined;
+    let builder: SummaryBuilder | undefined;
+    let inBlockComment = false;
+
+    const sources: [string, number][] = [];
+    if (headerLine !== undefined) {
+        sources.push([headerLine, 0]);
+    }
+    for (let i = start; i < end; i++) {
+        sources.push([lines[i], i - start + 1]);
+    }
+
+    for (const [line, lineNum] of sources) {
+        const lexed = lexLine(line, inBlockComment);
+        inBlockComment = lexed.inBlockComment;
+        const tokens = lexed.tokens;
+        if (tokens.length === 0 || tokens[0][0] === '#') {
+            continue;
+        }
+        let first = 0;
+        if (depth === 0 && tokens[0] !== '{') {
+            header = undefined;
+            for (let i = 1; i < tokens.length; i++) {
+                if (tokens[i] === '(' && IDENTIFIER.test(tokens[i - 1]) && !NON_CALL_KEYWORDS.has(tokens[i - 1])) {
+                    const close = findClosingParen(tokens, i);
+                    if (close > 0) {
+                        header = [tokens[i - 1], parameterNames(tokens, i, close)];
+                        first = close + 1;
+                    }
+                    break;
+                }
+            }
+            if (header && first < tokens.length && tokens[first] !== '{') {
+                // 函数声明或其他顶层语句
+                header = undefined;
+            }
+        }
+        let bodyStart = builder ? 0 : -1;
+        for (let i = first; i < tokens.length; i++) {
+            if (tokens[i] === '{') {
+                if (depth === 0 && header) {
+                    builder = new SummaryBuilder(header[0], header[1], ownership);
+                    header = undefined;
+                    bodyStart = i + 1;
+                }
+                depth++;
+            } else if (tokens[i] === '}') {
+                depth = Math.max(0, depth - 1);
+                if (depth === 0 && builder) {
+                    builder.addLine(tokens.slice(bodyStart, i), lineNum, line.trim());
+                    ownership.functions.push(builder.finish());
+                    builder = undefined;
+                    bodyStart = -1;
+                }
+            }
+        }
+        if (builder && bodyStart >= 0) {
+            builder.addLine(bodyStart === 0 ? tokens : tokens.slice(bodyStart), lineNum, line.trim());
+        }
+    }
+    return ownership;
+}
+
+/**
+ * 工作区中所有函数的摘要，按文件记录局部摘要；同名函数在多个文件中定义时使用路径最小的文件中的定义
+ */
+export class SummaryIndex {
+    private files: Map<string, Map<string, LocalSummary>> = new Map();
+    private definitions: Map<string, Map<string, LocalSummary>> = new Map();
+    private resolved: Map<string, FunctionSummary> = new Map();
+    // 反向调用图：函数名 -> 调用它的函数名
+    private callers: Map<string, Set<string>> = new Map();
+
+    /**
+     * 替换一个文件的局部摘要，丢弃受影响函数的完整摘要
+     */
+    public updateFile(filePath: string, functions: LocalSummary[]): void {
+        const old = this.files.get(filePath) || new Map<string, LocalSummary>();
+        const summaries: Map<string, LocalSummary> = new Map();
+        for (const summary of functions) {
+            if (!summaries.has(summary.name)) {
+                summaries.set(summary.name, summary);
+            }
+        }
+        this.files.set(filePath, summaries);
+
+        const changed: Set<string> = new Set();
+        for (const name of new Set([...old.keys(), ...summaries.keys()])) {
+            const before = old.get(name);
+            const after = summaries.get(name);
+            if (before && after && before.digest === after.digest) {
+                continue;
+            }
+            changed.add(name);
+            let definitions = this.definitions.get(name);
+            if (!definitions) {
+                definitions = new Map();
+                this.definitions.set(name, definitions);
+            }
+            if (before) {
+                definitions.delete(filePath);
+                for (const callee of before.callees) {
+                    const callers = this.callers.get(callee);
+                    if (callers) {
+                        callers.delete(name);
+                    }
+                }
+            }
+            if (after) {
+                definitions.set(filePath, after);
+            }
+            if (definitions.size === 0) {
+                this.definitions.delete(name);
+            }
+        }
+        for (const name of changed) {
+            const local = this.local(name);
+            for (const callee of local ? local.callees : []) {
+                let callers = this.callers.get(callee);
+                if (!callers) {
+                    callers = new Set();
+                    this.callers.set(callee, callers);
+                }
+                callers.add(name);
+            }
+        }
+        this.invalidate(changed);
+    }
+
+    public local(name: string): LocalSummary | undefined {
+        const definitions = this.definitions.get(name);
+        if (!definitions || definitions.size === 0) {
+            return undefined;
+        }
+        return definitions.get([...definitions.keys()].sort()[0]);
+    }
+
+    /**
+     * 丢弃这些函数及直接或间接调用它们的函数的完整摘要
+     */
+    public invalidate(names: Iterable<string>): void {
+        const pending = [...names];
+        const seen = new Set(pending);
+        while (pending.length > 0) {
+            const name = pending.pop()!;
+            this.resolved.delete(name);
+            for (const caller of this.callers.get(name) || []) {
+                if (!seen.has(caller)) {
+                    seen.add(caller);
+                    pending.push(caller);
+                }
+            }
+        }
+    }
+
+    /**
+     * 函数的完整摘要；未定义的函数返回没有影响的摘要
+     */
+    public resolve(name: string): FunctionSummary {
+        const builtin = BUILTIN_SUMMARIES.get(name);
+        if (builtin) {
+            return builtin;
+        }
+        const cached = this.resolved.get(name);
+        if (cached) {
+            return cached;
+        }
+        const local = this.local(name);
+        if (!local) {
+            return EMPTY_SUMMARY;
+        }
+
+        // 按后序遍历调用图，被调用的函数先于调用者计算
+        const visiting = new Set([name]);
+        const stack: { name: string, callees: string[], next: number }[] = [{ name, callees: local.callees, next: 0 }];
+        while (stack.length > 0) {
+            const top = stack[stack.length - 1];
+            let descended = false;
+            while (top.next < top.callees.length) {
+                const callee = top.callees[top.next++];
+                if (visiting.has(callee) || this.resolved.has(callee) || BUILTIN_SUMMARIES.has(callee)) {
+                    continue;
+                }
+                const calleeLocal = this.local(callee);
+                if (calleeLocal) {
+                    visiting.add(callee);
+                    stack.push({ name: callee, callees: calleeLocal.callees, next: 0 });
+                    descended = true;
+                    break;
+                }
+            }
+            if (!descended) {
+                stack.pop();
+                visiting.delete(top.name);
+                this.resolved.set(top.name, this.combine(this.local(top.name)!));
+            }
+        }
+        return this.resolved.get(name)!;
+    }
+
+    /**
+     * 文件中调用的、在其他文件中定义的函数的完整摘要的组合哈希，参与结果缓存键
+     */
+    public dependencyDigest(filePath: string): string {
+        const own = this.files.get(filePath);
+        if (!own) {
+            return '';
+        }
+        const external: Set<string> = new Set();
+        for (const local of own.values()) {
+            for (const callee of local.callees) {
+                if (!own.has(callee) && this.definitions.has(callee)) {
+                    external.add(callee);
+                }
+            }
+        }
+        if (external.size === 0) {
+            return '';
+        }
+        const digest = crypto.createHash('sha256');
+        for (const name of [...external].sort()) {
+            const summary = this.resolve(name);
+            digest.update(`${name}:${summary.allocates ? 1 : 0}:${[...summary.freesParams].sort().join(',')};`);
+        }
+        return digest.digest('hex');
+    }
+
+    private combine(local: LocalSummary): FunctionSummary {
+        const summaryOf = (callee: string) => BUILTIN_SUMMARIES.get(callee) || this.resolved.get(callee) || EMPTY_SUMMARY;
+        const freesParams: Set<number> = new Set();
+        for (const [callee, position, param] of local.forwarded) {
+            if (summaryOf(callee).freesParams.has(position)) {
+                freesParams.add(param);
+            }
+        }
+        return { allocates: local.returnedCalls.some(callee => summaryOf(callee).allocates), freesParams };
+    }
+}
@@ -0,0 +1,281 @@
+import * as crypto from 'crypto';
+import * as fs from 'fs';
+import * as path from 'path';
+import { lexLine } from './cLexer';
+
+/**
+ * 工作区的包含关系图（与后端 utils/include_graph.py 相同）
+ *
+ * 头文件名先相对包含它的文件所在目录查找，再依次在 includeDirs 中查找，找不到的视为标准库或
+ * 第三方头文件。每个工作区头文件的摘要（包含的头文件、函数声明和宏定义）按 (修改时间, 大小) 缓存，
+ * 只在文件变化时重新解析；摘要变化时，依赖它的头文件的闭包随之失效，其他文件不受影响。
+ * 循环包含时，闭包中不包含环上正在建立闭包的头文件的内容。
+ */
+
+export interface HeaderSummary {
+    includes: string[];
+    functions: Set<string>;
+    macros: Set<string>;
+    // 摘要内容的哈希：只有摘要变化时依赖它的文件才需要重新分析
+    digest: string;
+}
+
+export interface IncludeClosure {
+    // 不在工作区中的头文件名（标准库或第三方头文件），包括直接包含的和经由工作区头文件传递包含的
+    headers: Set<string>;
+    functions: Set<string>;
+    macros: Set<string>;
+    // 直接包含的、解析到工作区文件的头文件名，及其传递提供的非工作区头文件
+    expansions: Map<string, Set<string>>;
+    // 传递依赖的工作区头文件路径
+    dependencies: Set<string>;
+    // 所有依赖摘要的组合哈希，参与结果缓存键
+    digest: string;
+}
+
+export function emptyClosure(): IncludeClosure {
+    return {
+        headers: new Set(),
+        functions: new Set(),
+        macros: new Set(),
+        expansions: new Map(),
+        dependencies: new Set(),
+        digest: ''
+    };
+}
+
+// 记号中的头文件名（词法分析把整条 #include 作为一个记号）
+const HEADER_NAME = /[<"]([^>"]+)[>"]/;
+// 在原始内容上快速查找 #include（查找缓存之前使用，不经过词法分析）
+const RAW_INCLUDE = /^[ \t]*#[ \t]*include[ \t]*[<"]([^>"\r\n]+)[>"]/gm;
+const IDENTIFIER = /^[A-Za-z_]\w*$/;
+// 出现在 "名称(" 之前时不构成函数声明的关键字
+const NON_DECLARATION_KEYWORDS = new Set(['if', 'while', 'for', 'switch', 'return', 'sizeof', 'do', 'else', 'case', 'goto', 'typedef']);
+
+/**
+ * 解析头文件内容，得到包含的头文件、函数声明和宏定义
+ */
+export function summarizeHeader(content: string): HeaderSummary {
+    const includes: string[] = [];
+    const functions: Set<string> = new Set();
+    const macros: Set<string> = new Set();
+    let depth = 0;
+    let inBlockComment = false;
+
+    for (const line of content.split('\n')) {
+        const lexed = lexLine(line, inBlockComment);
+        inBlockComment = lexed.inBlockComment;
+        const tokens = lexed.tokens;
+        if (tokens.length === 0) {
+            continue;
+        }
+        if (tokens[0][0] === '#') {
+            const match = tokens[0] !== '#' ? HEADER_NAME.exec(tokens[0]) : null;
+            if (match) {
+                includes.push(match[1]);
+            } else if (tokens.length >= 3 && tokens[1] === 'define' && IDENTIFIER.test(tokens[2])) {
+                macros.add(tokens[2]);
+            }
+            continue;
+        }
+        for (let i = 0; i < tokens.length; i++) {
+            const token = tokens[i];
+            if (token === '{') {
+                depth++;
+            } else if (token === '}') {
+                depth = Math.max(0, depth - 1);
+            } else if (depth === 0 && token === '(' && i >= 2 && IDENTIFIER.test(tokens[i - 1])
+                && !NON_DECLARATION_KEYWORDS.has(tokens[i - 1])
+                && (IDENTIFIER.test(tokens[i - 2]) || tokens[i - 2] === '*')) {
+                functions.add(tokens[i - 1]);
+            }
+        }
+    }
+
+    const digest = crypto.createHash('sha256');
+    for (const part of [includes, [...functions].sort(), [...macros].sort()]) {
+        digest.update(part.join('\0'));
+        digest.update('\x01');
+    }
+    return { includes, functions, macros, digest: digest.digest('hex') };
+}
+
+/**
+ * 在原始内容中查找 #include 的头文件名（不区分注释中的内容，用于计算缓存键）
+ */
+export function scanIncludes(content: string): string[] {
+    const names: string[] = [];
+    RAW_INCLUDE.lastIndex = 0;
+    let match: RegExpExecArray | null;
+    while ((match = RAW_INCLUDE.exec(content)) !== null) {
+        names.push(match[1]);
+    }
+    return names;
+}
+
+export class IncludeGraph {
+    private summaries: Map<string, { stamp: string, summary: HeaderSummary }> = new Map();
+    private closures: Map<string, IncludeClosure> = new Map();
+    // 反向边：头文件路径 -> 直接包含它的头文件和源文件
+    private dependents: Map<string, Set<string>> = new Map();
+
+    constructor(private includeDirs: string[] = []) {}
+
+    public resolve(name: string, fromDir: string): string | undefined {
+        for (const directory of [fromDir, ...this.includeDirs]) {
+            const candidate = path.normalize(path.join(directory, name));
+            try {
+                if (fs.statSync(candidate).isFile()) {
+                    return candidate;
+                }
+            } catch (error) {
+                // 不存在，继续查找下一个目录
+            }
+        }
+        return undefined;
+    }
+
+    /**
+     * 头文件本身的摘要，文件变化后重新解析；文件不存在或无法读取时返回 undefined
+     */
+    public summary(headerPath: string): HeaderSummary | undefined {
+        let stamp: string;
+        let content: string;
+        const cached = this.summaries.get(headerPath);
+        try {
+            const stat = fs.statSync(headerPath);
+            stamp = `${stat.mtimeMs}:${stat.size}`;
+            if (cached && cached.stamp === stamp) {
+                return cached.summary;
+            }
+            content = fs.readFileSync(headerPath, 'utf8');
+        } catch (error) {
+            this.invalidate(headerPath);
+            return undefined;
+        }
+        const summary = summarizeHeader(content);
+        if (cached && cached.summary.digest !== summary.digest) {
+            this.invalidate(headerPath);
+        }
+        this.summaries.set(headerPath, { stamp, summary });
+        return summary;
+    }
+
+    /**
+     * 一个源文件（或编辑器中的内容）的 #include 经由工作区头文件提供的内容，
+     * 同时记录该文件对这些头文件的依赖，供 dependentsOf 查询
+     */
+    public fileClosure(filePath: string, includeNames: string[]): IncludeClosure {
+        if (!filePath) {
+            return emptyClosure();
+        }
+        const absolutePath = path.resolve(filePath);
+        let closure = this.merge(absolutePath, includeNames, new Set());
+        // 缓存中的闭包可能已过期：依赖的头文件有变化时重新计算
+        let changed = false;
+        for (const dependency of closure.dependencies) {
+            const cached = this.summaries.get(dependency);
+            if (!cached || this.summary(dependency) !== cached.summary) {
+                changed = true;
+            }
+        }
+        if (changed) {
+            closure = this.merge(absolutePath, includeNames, new Set());
+        }
+        return closure;
+    }
+
+    /**
+     * 直接或间接包含该头文件的所有文件
+     */
+    public dependentsOf(headerPath: string): Set<string> {
+        const result: Set<string> = new Set();
+        const pending = [path.resolve(headerPath)];
+        while (pending.length > 0) {
+            for (const dependent of this.dependents.get(pending.pop()!) || []) {
+                if (!result.has(dependent)) {
+                    result.add(dependent);
+                    pending.push(dependent);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * 丢弃头文件的摘要和依赖它的闭包，返回需要重新分析的文件
+     */
+    public invalidate(headerPath: string): Set<string> {
+        const absolutePath = path.resolve(headerPath);
+        const dependents = this.dependentsOf(absolutePath);
+        this.summaries.delete(absolutePath);
+        this.closures.delete(absolutePath);
+        for (const dependent of dependents) {
+            this.closures.delete(dependent);
+        }
+        return dependents;
+    }
+
+    private buildClosure(headerPath: string, visiting: Set<string>): IncludeClosure {
+        const summary = this.summary(headerPath);
+        if (!summary) {
+            return emptyClosure();
+        }
+        visiting.add(headerPath);
+        const merged = this.merge(headerPath, summary.includes, visiting);
+        visiting.delete(headerPath);
+        for (const name of summary.functions) {
+            merged.functions.add(name);
+        }
+        for (const name of summary.macros) {
+            merged.macros.add(name);
+        }
+        merged.dependencies.add(headerPath);
+        merged.digest = crypto.createHash('sha256').update(summary.digest + merged.digest).digest('hex');
+        this.closures.set(headerPath, merged);
+        return merged;
+    }
+
+    /**
+     * 合并一组头文件名的闭包；正在建立闭包的头文件（循环包含）跳过
+     */
+    private merge(includingPath: string, includeNames: string[], visiting: Set<string>): IncludeClosure {
+        const fromDir = path.dirname(includingPath);
+        const result = emptyClosure();
+        const digest = crypto.createHash('sha256');
+        for (const name of includeNames) {
+            const headerPath = this.resolve(name, fromDir);
+            if (headerPath === undefined) {
+                result.headers.add(name);
+                continue;
+            }
+            let dependents = this.dependents.get(headerPath);
+            if (!dependents) {
+                dependents = new Set();
+                this.dependents.set(headerPath, dependents);
+            }
+            dependents.add(includingPath);
+            if (visiting.has(headerPath)) {
+                result.expansions.set(name, new Set());
+                continue;
+            }
+            const closure = this.closures.get(headerPath) || this.buildClosure(headerPath, visiting);
+            result.expansions.set(name, closure.headers);
+            for (const header of closure.headers) {
+                result.headers.add(header);
+            }
+            for (const name of closure.functions) {
+                result.functions.add(name);
+            }
+            for (const name of closure.macros) {
+                result.macros.add(name);
+            }
+            for (const dependency of closure.dependencies) {
+                result.dependencies.add(dependency);
+            }
+            digest.update(closure.digest);
+        }
+        result.digest = result.expansions.size > 0 ? digest.digest('hex') : '';
+        return result;
+    }
+}
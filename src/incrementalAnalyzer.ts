@@ -0,0 +1,256 @@
+import * as vscode from 'vscode';
+import { AnalysisResult, CDetector, DETECTOR_MODULES, RegionFacts, createRegionFacts, markPartial } from './cDetector';
+import { Region, scanLine, splitRegions } from './cLexer';
+import { PhaseRecorder } from './instrumentation';
+import { computeLineFeatures } from './lineFeatures';
+
+interface LineState {
+    id: number;
+    text: string;
+    // 行首、行尾是否处于块注释中
+    startsInBlockComment: boolean;
+    endsInBlockComment: boolean;
+    braceDelta: number;
+    // 行特征位图，只在行文本变化时重新计算
+    features: number;
+    // 自上次分析以来文本是否发生变化
+    dirty: boolean;
+}
+
+interface CachedRegion {
+    endId: number;
+    length: number;
+    facts: RegionFacts;
+}
+
+interface DocumentModel {
+    lines: LineState[];
+    // 以区域首行的 id 为键缓存各区域的检测结果
+    regions: Map<number, CachedRegion>;
+}
+
+/**
+ * 基于编辑器内存缓冲区的增量分析
+ *
+ * 每个文档维护一份按行的模型：编辑事件只替换变化的行并重新扫描这些行
+ * （以及块注释状态因此改变的后续行），再按花括号把文件划分为区域，
+ * 只有包含变化行的区域才重新运行检测模块，其余区域复用上次的结果。
+ */
+export class IncrementalAnalyzer {
+    private documents: Map<string, DocumentModel> = new Map();
+    private nextLineId = 0;
+
+    constructor(private detector: CDetector) {}
+
+    public analyzeDocument(document: vscode.TextDocument, timeBudgetMs = 0): AnalysisResult {
+        const model = this.loadDocument(document);
+        return this.analyzeModel(document.fileName, model, timeBudgetMs);
+    }
+
+    /**
+     * timeBudgetMs 大于0时限制本次分析的时间，超时后未完成的模块的报告标记为部分结果
+     */
+    public applyChanges(event: vscode.TextDocumentChangeEvent, timeBudgetMs = 0): AnalysisResult {
+        this.recordChanges(event);
+        return this.analyzePending(event.document, timeBudgetMs);
+    }
+
+    /**
+     * 把编辑事件应用到文档模型（只更新行，不运行检测），必须在每个事件到达时立即调用；
+     * 无法应用时丢弃模型，下次分析时重新载入整个文档
+     */
+    public recordChanges(event: vscode.TextDocumentChangeEvent): void {
+        const key = event.document.uri.toString();
+        const model = this.documents.get(key);
+        if (!model) {
+            return;
+        }
+
+        for (const change of event.contentChanges) {
+            if (!this.applyChange(model, change)) {
+                this.documents.delete(key);
+                return;
+            }
+        }
+    }
+
+    /**
+     * 分析自上次分析以来记录的所有编辑，连续多次编辑只检测一次
+     */
+    public analyzePending(document: vscode.TextDocument, timeBudgetMs = 0): AnalysisResult {
+        const model = this.documents.get(document.uri.toString());
+
+        // 没有模型或与缓冲区行数不一致（模型已失步）时重新载入整个文档
+        if (!model || model.lines.length !== document.lineCount) {
+            return this.analyzeDocument(document, timeBudgetMs);
+        }
+
+        return this.analyzeModel(document.fileName, model, timeBudgetMs);
+    }
+
+    public closeDocument(document: vscode.TextDocument): void {
+        this.documents.delete(document.uri.toString());
+    }
+
+    public clear(): void {
+        this.documents.clear();
+    }
+
+    private loadDocument(document: vscode.TextDocument): DocumentModel {
+        const lines: LineState[] = [];
+        for (let i = 0; i < document.lineCount; i++) {
+            lines.push(this.createLine(document.lineAt(i).text));
+        }
+
+        const model: DocumentModel = { lines, regions: new Map() };
+        this.documents.set(document.uri.toString(), model);
+        return model;
+    }
+
+    private createLine(text: string): LineState {
+        return {
+            id: this.nextLineId++,
+            text,
+            startsInBlockComment: false,
+            endsInBlockComment: false,
+            braceDelta: 0,
+            features: 0,
+            dirty: true
+        };
+    }
+
+    private applyChange(model: DocumentModel, change: vscode.TextDocumentContentChangeEvent): boolean {
+        const start = change.range.start;
+        const end = change.range.end;
+        if (end.line >= model.lines.length) {
+            return false;
+        }
+
+        const prefix = model.lines[start.line].text.substring(0, start.character);
+        const suffix = model.lines[end.line].text.substring(end.character);
+        const newLines = (prefix + change.text + suffix).split(/\r?\n/).map(text => this.createLine(text));
+
+        model.lines.splice(start.line, end.line - start.line + 1, ...newLines);
+        return true;
+    }
+
+    private analyzeModel(filePath: string, model: DocumentModel, timeBudgetMs: number): AnalysisResult {
+        try {
+            const deadline = timeBudgetMs > 0 ? Date.now() + timeBudgetMs : Infinity;
+            const recorder = new PhaseRecorder();
+            recorder.begin();
+            const lines = model.lines;
+            const texts: string[] = new Array(lines.length);
+            const braceDeltas: number[] = new Array(lines.length);
+            const features: number[] = new Array(lines.length);
+            const dirtyLines: number[] = [];
+
+            // 只重新扫描变化的行，以及行首块注释状态改变的行
+            let inBlockComment = false;
+            for (let i = 0; i < lines.length; i++) {
+                const line = lines[i];
+                if (line.dirty || line.startsInBlockComment !== inBlockComment) {
+                    const scan = scanLine(line.text, inBlockComment);
+                    line.startsInBlockComment = inBlockComment;
+                    line.endsInBlockComment = scan.inBlockComment;
+                    line.braceDelta = scan.braceDelta;
+                }
+                if (line.dirty) {
+                    line.features = computeLineFeatures(line.text);
+                    dirtyLines.push(i);
+                    line.dirty = false;
+                }
+                inBlockComment = line.endsInBlockComment;
+                texts[i] = line.text;
+                braceDeltas[i] = line.braceDelta;
+                features[i] = line.features;
+            }
+
+            const regions = splitRegions(braceDeltas);
+            recorder.end('scan');
+
+            const facts: RegionFacts[] = [];
+            const cache: Map<number, CachedRegion> = new Map();
+            const changed: { region: Region, startId: number, facts: RegionFacts }[] = [];
+            let nextDirty = 0;
+
+            for (const region of regions) {
+                // 区域首尾行和行数都未变、且其中没有修改过的行时复用缓存结果
+                // 函数头单独占一行时位于前一个区域，前一行修改过也需要重新检测
+                let hasDirty = nextDirty > 0 && dirtyLines[nextDirty - 1] === region.start - 1;
+                while (nextDirty < dirtyLines.length && dirtyLines[nextDirty] < region.end) {
+                    hasDirty = hasDirty || dirtyLines[nextDirty] >= region.start;
+                    nextDirty++;
+                }
+
+                const startId = lines[region.start].id;
+                const endId = lines[region.end - 1].id;
+                const length = region.end - region.start;
+                const previous = model.regions.get(startId);
+                let cached: CachedRegion;
+                if (!hasDirty && previous && previous.endId === endId && previous.length === length) {
+                    cached = previous;
+                } else {
+                    cached = { endId, length, facts: createRegionFacts() };
+                    changed.push({ region, startId, facts: cached.facts });
+                }
+
+                cache.set(startId, cached);
+                facts.push(cached.facts);
+            }
+
+            // 只对变化的区域运行检测模块，按模块分别计时
+            const incomplete: string[] = [];
+            for (const moduleName of DETECTOR_MODULES) {
+                if (Date.now() > deadline) {
+                    incomplete.push(moduleName);
+                    continue;
+                }
+                recorder.begin();
+                for (const entry of changed) {
+                    if (Date.now() > deadline) {
+                        incomplete.push(moduleName);
+                        break;
+                    }
+                    this.detector.analyzeRegionModule(moduleName, texts, entry.region, entry.facts, features);
+                }
+                recorder.end(moduleName);
+            }
+
+            // 未完整分析的区域不缓存，下次分析时重新运行
+            if (incomplete.length > 0) {
+                for (const entry of changed) {
+                    cache.delete(entry.startId);
+                }
+            }
+            model.regions = cache;
+            if (!incomplete.includes('memory_safety')) {
+                recorder.time('summaries', () => this.detector.updateFunctionSummaries(filePath, facts));
+            }
+            // 头文件摘要按修改时间缓存，未变化时这里只检查文件状态
+            const closure = recorder.time('includes', () => this.detector.resolveIncludes(filePath, facts));
+            const reports = recorder.time('merge', () => this.detector.mergeRegions(regions, facts, closure));
+            const result: AnalysisResult = {
+                file_path: filePath,
+                reports: markPartial(reports, incomplete),
+                success: true,
+                stats: recorder.finish()
+            };
+            if (closure.dependencies.size > 0) {
+                result.dependencies = [...closure.dependencies];
+            }
+            if (incomplete.length > 0) {
+                result.partial = true;
+                result.incomplete_modules = incomplete;
+            }
+            return result;
+        } catch (error) {
+            return {
+                file_path: filePath,
+                reports: [],
+                success: false,
+                error: `分析失败: ${error}`
+            };
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * 分析统计：记录一次分析中各阶段的耗时和堆内存变化
+ *
+ * 与Python后端 --format json 输出中的 stats 对象格式相同；
+ * Python后端的阶段带 allocated_blocks（存活内存块数的变化），TypeScript检测器的阶段带 heap_bytes
+ * （V8堆已用字节数的变化，期间发生垃圾回收时可能为负）。
+ */
+
+export interface PhaseStats {
+    name: string;
+    seconds: number;
+    heap_bytes?: number;
+    allocated_blocks?: number;
+}
+
+export interface AnalysisStats {
+    phases: PhaseStats[];
+    total_seconds: number;
+    cached: boolean;
+}
+
+export class PhaseRecorder {
+    private phases: Map<string, PhaseStats> = new Map();
+    private start = 0n;
+    private heapStart = 0;
+
+    /**
+     * 开始一个阶段，到下一次 begin 或 end 时结束
+     */
+    public begin(): void {
+        this.heapStart = process.memoryUsage().heapUsed;
+        this.start = process.hrtime.bigint();
+    }
+
+    public end(name: string): void {
+        const seconds = Number(process.hrtime.bigint() - this.start) / 1e9;
+        this.add(name, seconds, process.memoryUsage().heapUsed - this.heapStart);
+    }
+
+    public time<T>(name: string, action: () => T): T {
+        this.begin();
+        try {
+            return action();
+        } finally {
+            this.end(name);
+        }
+    }
+
+    /**
+     * 同名阶段多次记录时累加，阶段按第一次出现的顺序输出
+     */
+    public add(name: string, seconds: number, heapBytes: number): void {
+        const phase = this.phases.get(name);
+        if (phase) {
+            phase.seconds += seconds;
+            phase.heap_bytes = (phase.heap_bytes || 0) + heapBytes;
+        } else {
+            this.phases.set(name, { name, seconds, heap_bytes: heapBytes });
+        }
+    }
+
+    public finish(cached = false): AnalysisStats {
+        const phases = [...this.phases.values()];
+        return {
+            phases,
+            total_seconds: phases.reduce((sum, phase) => sum + phase.seconds, 0),
+            cached
+        };
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * 行特征位图（与后端 utils/line_features.py 相同）
+ *
+ * 用子串检查记录一行中出现的关键字和运算符，检测模块据此跳过不可能匹配的正则表达式。
+ * 位图只会多报（注释、字符串或更长的标识符中的子串也算出现），不会漏报：
+ * 某个模式要求的特征不全时，该模式在这一行上一定不匹配。
+ */
+
+export enum LineFeature {
+    // malloc/calloc/realloc
+    Alloc = 1 << 0,
+    Free = 1 << 1,
+    Scanf = 1 << 2,
+    Printf = 1 << 3,
+    While = 1 << 4,
+    For = 1 << 5,
+    Do = 1 << 6,
+    Include = 1 << 7,
+    Star = 1 << 8,
+    // =（包括 ==、<= 等）
+    Assign = 1 << 9,
+    Paren = 1 << 10,
+    Brace = 1 << 11,
+    Semicolon = 1 << 12,
+    // 基本类型关键字 int/char/float/double/long/short/signed/void（unsigned 含 signed）
+    Type = 1 << 13,
+    Struct = 1 << 14,
+    Null = 1 << 15,
+    // /* 或 */，行中可能改变块注释状态
+    Comment = 1 << 16
+}
+
+const SUBSTRINGS: [string, LineFeature][] = [
+    ['alloc', LineFeature.Alloc], ['free', LineFeature.Free], ['scanf', LineFeature.Scanf],
+    ['printf', LineFeature.Printf], ['while', LineFeature.While], ['for', LineFeature.For],
+    ['do', LineFeature.Do], ['#include', LineFeature.Include], ['*', LineFeature.Star],
+    ['=', LineFeature.Assign], ['(', LineFeature.Paren], ['{', LineFeature.Brace],
+    [';', LineFeature.Semicolon], ['struct', LineFeature.Struct], ['NULL', LineFeature.Null],
+    ['/*', LineFeature.Comment], ['*/', LineFeature.Comment]
+];
+
+const TYPE_KEYWORDS = ['int', 'char', 'float', 'double', 'long', 'short', 'signed', 'void'];
+
+// 缓存的行数上限，超过时清空重新开始
+const MAX_CACHED_LINES = 1 << 16;
+
+export function computeLineFeatures(line: string): number {
+    let features = 0;
+    for (const [substring, bit] of SUBSTRINGS) {
+        if (line.includes(substring)) {
+            features |= bit;
+        }
+    }
+    for (const keyword of TYPE_KEYWORDS) {
+        if (line.includes(keyword)) {
+            features |= LineFeature.Type;
+            break;
+        }
+    }
+    return features;
+}
+
+/**
+ * 位图中是否包含 required 的所有特征
+ */
+export function hasAll(features: number, required: number): boolean {
+    return (features & required) === required;
+}
+
+/**
+ * 按行文本缓存的特征位图：重复的行和再次分析时未修改的行只计算一次
+ */
+export class LineFeatureCache {
+    private cache: Map<string, number> = new Map();
+
+    public get(line: string): number {
+        let features = this.cache.get(line);
+        if (features === undefined) {
+            features = computeLineFeatures(line);
+            if (this.cache.size >= MAX_CACHED_LINES) {
+                this.cache.clear();
+            }
+            this.cache.set(line, features);
+        }
+        return features;
+    }
+
+    /**
+     * 所有行的位图，下标与 lines 相同
+     */
+    public forLines(lines: string[]): number[] {
+        const features: number[] = new Array(lines.length);
+        for (let i = 0; i < lines.length; i++) {
+            features[i] = this.get(lines[i]);
+        }
+        return features;
+    }
+}
@@ -0,0 +1,73 @@
+import * as crypto from 'crypto';
+import * as fs from 'fs';
+import * as path from 'path';
+import { BugReport } from './cDetector';
+
+/**
+ * 以文件内容哈希为键的持久化检测结果缓存
+ *
+ * 缓存键由文件内容、启用的模块集合、检测器版本和包含的工作区头文件的摘要共同决定，
+ * 每个条目单独存成一个JSON文件，写入时先写临时文件再重命名。
+ */
+export class ResultCache {
+    private hits = 0;
+    private misses = 0;
+
+    constructor(private cacheDir: string, private detectorVersion: string) {}
+
+    public makeKey(content: Buffer, enabledModules: string[], dependencies: string = ''): string {
+        const hash = crypto.createHash('sha256');
+        hash.update(this.detectorVersion);
+        hash.update('\0');
+        hash.update([...enabledModules].sort().join(','));
+        hash.update('\0');
+        hash.update(content);
+        if (dependencies) {
+            // 没有工作区头文件时的键与之前相同，已有的缓存条目仍然有效
+            hash.update('\0');
+            hash.update(dependencies);
+        }
+        return hash.digest('hex');
+    }
+
+    public get(key: string): BugReport[] | undefined {
+        try {
+            const data = JSON.parse(fs.readFileSync(this.entryPath(key), 'utf8'));
+            if (!Array.isArray(data.reports)) {
+                this.misses++;
+                return undefined;
+            }
+            this.hits++;
+            return data.reports as BugReport[];
+        } catch {
+            this.misses++;
+            return undefined;
+        }
+    }
+
+    public set(key: string, reports: BugReport[]): void {
+        const entryPath = this.entryPath(key);
+        const tmpPath = `${entryPath}.${process.pid}.tmp`;
+        try {
+            fs.mkdirSync(path.dirname(entryPath), { recursive: true });
+            fs.writeFileSync(tmpPath, JSON.stringify({ version: this.detectorVersion, reports }), 'utf8');
+            fs.renameSync(tmpPath, entryPath);
+        } catch (error) {
+            // 缓存写入失败不影响检测结果
+            try {
+                fs.unlinkSync(tmpPath);
+            } catch {
+                // 临时文件可能尚未创建
+            }
+        }
+    }
+
+    public getStats(): { hits: number, misses: number } {
+        return { hits: this.hits, misses: this.misses };
+    }
+
+    private entryPath(key: string): string {
+        // 按键的前两位分目录存放，避免单目录文件过多
+        return path.join(this.cacheDir, key.substring(0, 2), `${key}.json`);
+    }
+}
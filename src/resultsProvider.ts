@@ -1,13 +1,51 @@
 import * as vscode from 'vscode';
 import { BugReport, AnalysisResult } from './backend';
 
+// 诊断信息和树视图的刷新间隔（约一帧），期间到达的结果合并为一次刷新
+const FLUSH_INTERVAL_MS = 16;
+
+// 问题超过这么多的文件展开后按页分组，每组展开时才创建其中的问题节点
+const PAGE_SIZE = 200;
+
+const SEVERITY_LABELS: { [severity: string]: string } = {
+    Error: '错误',
+    Warning: '警告',
+    Info: '提示'
+};
+
+// 文件节点显示的按严重程度和模块的问题数，结果变化时只重新统计该文件
+interface FileSummary {
+    total: number;
+    severities: Map<string, number>;
+    modules: Map<string, number>;
+}
+
+function summarize(result: AnalysisResult): FileSummary {
+    const summary: FileSummary = { total: 0, severities: new Map(), modules: new Map() };
+    if (result.success) {
+        for (const report of result.reports) {
+            summary.total++;
+            summary.severities.set(report.severity, (summary.severities.get(report.severity) || 0) + 1);
+            summary.modules.set(report.module_name, (summary.modules.get(report.module_name) || 0) + 1);
+        }
+    }
+    return summary;
+}
+
 export class ResultsProvider implements vscode.TreeDataProvider<BugItem>, vscode.Disposable {
     private _onDidChangeTreeData: vscode.EventEmitter<BugItem | undefined | null | void> = new vscode.EventEmitter<BugItem | undefined | null | void>();
     readonly onDidChangeTreeData: vscode.Event<BugItem | undefined | null | void> = this._onDidChangeTreeData.event;
 
     private results: Map<string, AnalysisResult> = new Map();
+    private summaries: Map<string, FileSummary> = new Map();
     private diagnosticCollection?: vscode.DiagnosticCollection;
 
+    // 等待刷新的文件，以及树视图中已创建的文件节点
+    private changedFiles: Set<string> = new Set();
+    private fileItems: Map<string, BugItem> = new Map();
+    private rootChanged = false;
+    private flushTimer?: NodeJS.Timeout;
+
     constructor() {
         // 设置上下文
         vscode.commands.executeCommand('setContext', 'c-bug-detector.hasResults', false);
@@ -17,27 +55,50 @@ export class ResultsProvider implements vscode.TreeDataProvider<BugItem>, vscode
         this.diagnosticCollection = collection;
     }
 
+    /**
+     * 当前所有文件的结果；某个文件的结果变化时替换为新对象，可按引用判断是否变化
+     */
+    public getResults(): ReadonlyMap<string, AnalysisResult> {
+        return this.results;
+    }
+
     public updateResults(results: AnalysisResult[]): void {
-        this.results.clear();
-        
+        this.clearResults();
+        this.addResults(results);
+    }
+
+    public addResult(result: AnalysisResult): void {
+        this.addResults([result]);
+    }
+
+    /**
+     * 添加结果，短时间内连续到达的结果合并为一次刷新
+     */
+    public addResults(results: AnalysisResult[]): void {
         for (const result of results) {
+            if (!this.results.has(result.file_path)) {
+                this.rootChanged = true;
+            }
             this.results.set(result.file_path, result);
+            this.summaries.set(result.file_path, summarize(result));
+            this.changedFiles.add(result.file_path);
         }
 
-        this.updateDiagnostics();
-        this.updateContext();
-        this._onDidChangeTreeData.fire();
-    }
-
-    public addResult(result: AnalysisResult): void {
-        this.results.set(result.file_path, result);
-        this.updateDiagnostics();
-        this.updateContext();
-        this._onDidChangeTreeData.fire();
+        if (!this.flushTimer && this.changedFiles.size > 0) {
+            this.flushTimer = setTimeout(() => this.flush(), FLUSH_INTERVAL_MS);
+        }
     }
 
     public clearResults(): void {
+        if (this.flushTimer) {
+            clearTimeout(this.flushTimer);
+            this.flushTimer = undefined;
+        }
         this.results.clear();
+        this.summaries.clear();
+        this.changedFiles.clear();
+        this.fileItems.clear();
+        this.rootChanged = false;
         if (this.diagnosticCollection) {
             this.diagnosticCollection.clear();
         }
@@ -45,50 +106,86 @@ export class ResultsProvider implements vscode.TreeDataProvider<BugItem>, vscode
         this._onDidChangeTreeData.fire();
     }
 
-    private updateDiagnostics(): void {
+    /**
+     * 只更新发生变化的文件：重新设置这些文件的诊断信息，并只刷新对应的树节点
+     */
+    private flush(): void {
+        this.flushTimer = undefined;
+        const changedFiles = [...this.changedFiles];
+        this.changedFiles.clear();
+
+        for (const filePath of changedFiles) {
+            this.updateDiagnostics(filePath);
+        }
+
+        if (this.rootChanged) {
+            this.rootChanged = false;
+            this.updateContext();
+            this._onDidChangeTreeData.fire();
+            return;
+        }
+
+        for (const filePath of changedFiles) {
+            const fileItem = this.fileItems.get(filePath);
+            if (fileItem) {
+                this.describeFileItem(fileItem, this.results.get(filePath)!);
+                // 刷新文件节点时，已展开的分组和问题节点按新结果重新创建
+                this._onDidChangeTreeData.fire(fileItem);
+            }
+        }
+    }
+
+    private updateDiagnostics(filePath: string): void {
         if (!this.diagnosticCollection) {
             return;
         }
 
-        this.diagnosticCollection.clear();
+        const uri = vscode.Uri.file(filePath);
+        const result = this.results.get(filePath);
+        if (!result || !result.success || result.reports.length === 0) {
+            this.diagnosticCollection.delete(uri);
+            return;
+        }
 
-        for (const [filePath, result] of this.results) {
-            if (!result.success || result.reports.length === 0) {
-                continue;
-            }
+        const diagnostics: vscode.Diagnostic[] = [];
 
-            const uri = vscode.Uri.file(filePath);
-            const diagnostics: vscode.Diagnostic[] = [];
-
-            for (const report of result.reports) {
-                const range = new vscode.Range(
-                    report.line_number - 1, 0,
-                    report.line_number - 1, Number.MAX_VALUE
-                );
-
-                const severity = this.getDiagnosticSeverity(report.severity);
-                const diagnostic = new vscode.Diagnostic(
-                    range,
-                    `${report.module_name}: ${report.message}`,
-                    severity
-                );
-
-                diagnostic.source = 'C Bug Detector';
-                diagnostic.code = report.error_type;
-                diagnostic.relatedInformation = [
-                    new vscode.DiagnosticRelatedInformation(
-                        new vscode.Location(uri, range),
-                        `建议: ${report.suggestion}`
-                    )
-                ];
-
-                diagnostics.push(diagnostic);
-            }
+        for (const report of result.reports) {
+            const range = new vscode.Range(
+                report.line_number - 1, 0,
+                report.line_number - 1, Number.MAX_VALUE
+            );
 
-            if (diagnostics.length > 0) {
-                this.diagnosticCollection.set(uri, diagnostics);
+            const severity = this.getDiagnosticSeverity(report.severity);
+            const diagnostic = new vscode.Diagnostic(
+                range,
+                `${report.module_name}: ${report.message}${report.partial ? '（部分结果）' : ''}`,
+                severity
+            );
+
+            diagnostic.source = 'C Bug Detector';
+            diagnostic.code = report.error_type;
+            diagnostic.relatedInformation = [
+                new vscode.DiagnosticRelatedInformation(
+                    new vscode.Location(uri, range),
+                    `建议: ${report.suggestion}`
+                )
+            ];
+            // 合并的报告在其余出现位置附上关联信息
+            if (report.locations) {
+                for (const location of report.locations) {
+                    if (location !== report.line_number) {
+                        diagnostic.relatedInformation.push(new vscode.DiagnosticRelatedInformation(
+                            new vscode.Location(uri, new vscode.Range(location - 1, 0, location - 1, Number.MAX_VALUE)),
+                            `同一问题: 第${location}行`
+                        ));
+                    }
+                }
             }
+
+            diagnostics.push(diagnostic);
         }
+
+        this.diagnosticCollection.set(uri, diagnostics);
     }
 
     private getDiagnosticSeverity(severity: string): vscode.DiagnosticSeverity {
@@ -104,6 +201,24 @@ export class ResultsProvider implements vscode.TreeDataProvider<BugItem>, vscode
         }
     }
 
+    private describeFileItem(fileItem: BugItem, result: AnalysisResult): void {
+        const summary = this.summaries.get(fileItem.filePath!)!;
+        if (!result.success) {
+            fileItem.description = '检测失败';
+            fileItem.tooltip = `${fileItem.filePath}\n${result.error || ''}`;
+            return;
+        }
+
+        const severities = Object.keys(SEVERITY_LABELS)
+            .filter(severity => summary.severities.has(severity))
+            .map(severity => `${summary.severities.get(severity)} ${SEVERITY_LABELS[severity]}`);
+        fileItem.description = severities.length > 0
+            ? `${summary.total} 个问题（${severities.join('，')}）`
+            : '0 个问题';
+        const modules = [...summary.modules].map(([moduleName, count]) => `${moduleName}: ${count}`);
+        fileItem.tooltip = [fileItem.filePath!, ...modules].join('\n');
+    }
+
     private updateContext(): void {
         const hasResults = this.results.size > 0;
         vscode.commands.executeCommand('setContext', 'c-bug-detector.hasResults', hasResults);
@@ -114,6 +229,9 @@ export class ResultsProvider implements vscode.TreeDataProvider<BugItem>, vscode
     }
 
     public dispose(): void {
+        if (this.flushTimer) {
+            clearTimeout(this.flushTimer);
+        }
         this._onDidChangeTreeData.dispose();
     }
 
@@ -123,81 +241,107 @@ export class ResultsProvider implements vscode.TreeDataProvider<BugItem>, vscode
             const fileItems: BugItem[] = [];
             
             for (const [filePath, result] of this.results) {
-                const fileName = filePath.split(/[\\/]/).pop() || filePath;
-                const bugCount = result.success ? result.reports.length : 0;
-                
-                const fileItem = new BugItem(
-                    fileName,
-                    vscode.TreeItemCollapsibleState.Collapsed,
-                    'file',
-                    filePath
-                );
-                
-                fileItem.description = `${bugCount} 个问题`;
-                fileItem.tooltip = filePath;
-                
+                // 复用已创建的节点，以便结果变化时只刷新该节点
+                let fileItem = this.fileItems.get(filePath);
+                if (!fileItem) {
+                    const fileName = filePath.split(/[\\/]/).pop() || filePath;
+                    fileItem = new BugItem(
+                        fileName,
+                        vscode.TreeItemCollapsibleState.Collapsed,
+                        'file',
+                        filePath
+                    );
+                    this.fileItems.set(filePath, fileItem);
+                }
+
+                this.describeFileItem(fileItem, result);
                 fileItems.push(fileItem);
             }
             
             return Promise.resolve(fileItems);
-        } else if (element.type === 'file') {
-            // 文件级别：显示问题
+        } else if (element.type === 'file' || element.type === 'page') {
+            // 文件级别：问题较少时直接显示问题，否则显示分页的分组；分组展开时才创建其中的问题节点
             const result = this.results.get(element.filePath!);
             if (!result || !result.success) {
                 return Promise.resolve([]);
             }
 
-            const bugItems: BugItem[] = [];
-            
-            for (const report of result.reports) {
-                const bugItem = new BugItem(
-                    `第${report.line_number}行: ${report.message}`,
-                    vscode.TreeItemCollapsibleState.None,
-                    'bug',
-                    element.filePath,
-                    report
-                );
-                
-                bugItem.description = report.module_name;
-                bugItem.tooltip = report.suggestion;
-                
-                // 设置图标
-                switch (report.severity.toLowerCase()) {
-                    case 'error':
-                        bugItem.iconPath = new vscode.ThemeIcon('error');
-                        break;
-                    case 'warning':
-                        bugItem.iconPath = new vscode.ThemeIcon('warning');
-                        break;
-                    case 'info':
-                        bugItem.iconPath = new vscode.ThemeIcon('info');
-                        break;
-                    default:
-                        bugItem.iconPath = new vscode.ThemeIcon('alert');
+            const reports = result.reports;
+            if (element.type === 'file' && reports.length > PAGE_SIZE) {
+                const pageItems: BugItem[] = [];
+                for (let start = 0; start < reports.length; start += PAGE_SIZE) {
+                    const end = Math.min(start + PAGE_SIZE, reports.length);
+                    pageItems.push(new BugItem(
+                        `第 ${start + 1}-${end} 个问题`,
+                        vscode.TreeItemCollapsibleState.Collapsed,
+                        'page',
+                        element.filePath,
+                        undefined,
+                        start
+                    ));
                 }
-                
-                bugItems.push(bugItem);
+                return Promise.resolve(pageItems);
+            }
+
+            const start = element.type === 'page' ? element.pageStart! : 0;
+            const end = element.type === 'page' ? Math.min(start + PAGE_SIZE, reports.length) : reports.length;
+            const bugItems: BugItem[] = [];
+            for (let i = start; i < end; i++) {
+                bugItems.push(this.createBugItem(element.filePath!, reports[i]));
             }
-            
             return Promise.resolve(bugItems);
         }
         
         return Promise.resolve([]);
     }
+
+    private createBugItem(filePath: string, report: BugReport): BugItem {
+        const bugItem = new BugItem(
+            `第${report.line_number}行: ${report.message}`,
+            vscode.TreeItemCollapsibleState.None,
+            'bug',
+            filePath,
+            report
+        );
+        
+        bugItem.description = report.module_name;
+        bugItem.tooltip = report.suggestion;
+        
+        // 设置图标
+        switch (report.severity.toLowerCase()) {
+            case 'error':
+                bugItem.iconPath = new vscode.ThemeIcon('error');
+                break;
+            case 'warning':
+                bugItem.iconPath = new vscode.ThemeIcon('warning');
+                break;
+            case 'info':
+                bugItem.iconPath = new vscode.ThemeIcon('info');
+                break;
+            default:
+                bugItem.iconPath = new vscode.ThemeIcon('alert');
+        }
+        
+        return bugItem;
+    }
 }
 
 export class BugItem extends vscode.TreeItem {
     constructor(
         public readonly label: string,
         public readonly collapsibleState: vscode.TreeItemCollapsibleState,
-        public readonly type: 'file' | 'bug',
+        public readonly type: 'file' | 'page' | 'bug',
         public readonly filePath?: string,
-        public readonly report?: BugReport
+        public readonly report?: BugReport,
+        // 分页分组中第一个问题的序号
+        public readonly pageStart?: number
     ) {
         super(label, collapsibleState);
         
         if (type === 'file') {
             this.contextValue = 'c-bug-detector-file';
+        } else if (type === 'page') {
+            this.contextValue = 'c-bug-detector-page';
         } else if (type === 'bug') {
             this.contextValue = 'c-bug-detector-bug';
             this.command = {
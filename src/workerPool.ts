@@ -0,0 +1,224 @@
+import * as os from 'os';
+import { Worker } from 'worker_threads';
+import { AnalysisResult } from './cDetector';
+
+// 一个分析任务：未提供 content 时由工作线程读取磁盘上的文件
+export interface AnalysisJob {
+    filePath: string;
+    content?: string;
+    enabledModules: string[];
+    useCache: boolean;
+    // 单个文件的分析时间上限（毫秒），未设置或为0时不限制
+    timeBudgetMs?: number;
+    // 查找工作区头文件的目录（包含文件所在目录之后）
+    includeDirs?: string[];
+}
+
+// 取消信号，vscode.CancellationToken 满足该接口（工作线程中不能引用 vscode 模块）
+export interface CancellationSignal {
+    readonly isCancellationRequested: boolean;
+    onCancellationRequested(listener: () => void): { dispose(): void };
+}
+
+export interface WorkerRequest {
+    id: number;
+    job: AnalysisJob;
+}
+
+export interface WorkerResponse {
+    id: number;
+    result: AnalysisResult;
+}
+
+// 工作线程启动参数
+export interface WorkerOptions {
+    cacheDir?: string;
+}
+
+// 超过时间预算后，再等待这么久仍未返回结果（如正则表达式回溯卡住）时终止工作线程
+const HARD_TIMEOUT_GRACE_MS = 2000;
+
+interface PendingJob {
+    id: number;
+    job: AnalysisJob;
+    resolve: (result: AnalysisResult) => void;
+    cancellation?: { dispose(): void };
+    timer?: NodeJS.Timeout;
+}
+
+/**
+ * CDetector 工作线程池
+ *
+ * 线程按需创建，数量不超过 size；每个线程同时只处理一个任务，
+ * 任务完成后立即返回结果，主线程只负责分发任务和更新诊断信息。
+ *
+ * 任务在工作线程内按时间预算自行中断并返回部分结果；取消的任务或超过预算后仍未返回的任务
+ * 会终止其所在的工作线程，之后按需创建新的线程。
+ */
+export class DetectorWorkerPool {
+    private workers: Worker[] = [];
+    private idle: Worker[] = [];
+    private running: Map<Worker, PendingJob> = new Map();
+    private queue: PendingJob[] = [];
+    private nextId = 0;
+    private disposed = false;
+
+    constructor(
+        private workerScript: string,
+        private options: WorkerOptions = {},
+        private size: number = Math.max(1, os.cpus().length)
+    ) {}
+
+    public run(job: AnalysisJob, token?: CancellationSignal): Promise<AnalysisResult> {
+        if (this.disposed) {
+            return Promise.resolve(this.failure(job, '工作线程池已关闭'));
+        }
+        if (token && token.isCancellationRequested) {
+            return Promise.resolve(this.cancelled(job));
+        }
+
+        return new Promise(resolve => {
+            const pending: PendingJob = { id: this.nextId++, job, resolve };
+            if (token) {
+                pending.cancellation = token.onCancellationRequested(() => this.cancel(pending));
+            }
+            this.queue.push(pending);
+            this.dispatch();
+        });
+    }
+
+    public dispose(): void {
+        this.disposed = true;
+        for (const pending of this.queue) {
+            this.finish(pending, this.failure(pending.job, '工作线程池已关闭'));
+        }
+        this.queue = [];
+        for (const worker of this.workers) {
+            worker.terminate();
+        }
+    }
+
+    private dispatch(): void {
+        while (this.queue.length > 0) {
+            const worker = this.idle.pop() || this.spawn();
+            if (!worker) {
+                return;
+            }
+
+            const pending = this.queue.shift()!;
+            this.running.set(worker, pending);
+            if (pending.job.timeBudgetMs && pending.job.timeBudgetMs > 0) {
+                pending.timer = setTimeout(() => {
+                    this.abort(worker, pending, this.failure(pending.job, `分析超过时间预算 ${pending.job.timeBudgetMs} ms，已终止`));
+                }, pending.job.timeBudgetMs + HARD_TIMEOUT_GRACE_MS);
+            }
+            const request: WorkerRequest = { id: pending.id, job: pending.job };
+            worker.postMessage(request);
+        }
+    }
+
+    /**
+     * 取消任务：排队中的任务直接移除，正在运行的任务终止其工作线程
+     */
+    private cancel(pending: PendingJob): void {
+        const index = this.queue.indexOf(pending);
+        if (index >= 0) {
+            this.queue.splice(index, 1);
+            this.finish(pending, this.cancelled(pending.job));
+            return;
+        }
+        for (const [worker, running] of this.running) {
+            if (running === pending) {
+                this.abort(worker, pending, this.cancelled(pending.job));
+                return;
+            }
+        }
+    }
+
+    /**
+     * 以给定结果结束正在运行的任务并终止工作线程；线程退出后由 remove 从池中移除
+     */
+    private abort(worker: Worker, pending: PendingJob, result: AnalysisResult): void {
+        if (this.running.get(worker) !== pending) {
+            return;
+        }
+        this.running.delete(worker);
+        this.finish(pending, result);
+        worker.terminate();
+    }
+
+    private finish(pending: PendingJob, result: AnalysisResult): void {
+        if (pending.timer) {
+            clearTimeout(pending.timer);
+        }
+        if (pending.cancellation) {
+            pending.cancellation.dispose();
+        }
+        pending.resolve(result);
+    }
+
+    private spawn(): Worker | undefined {
+        if (this.workers.length >= this.size) {
+            return undefined;
+        }
+
+        const worker = new Worker(this.workerScript, { workerData: this.options });
+        worker.on('message', (response: WorkerResponse) => {
+            const pending = this.running.get(worker);
+            if (!pending || pending.id !== response.id) {
+                return;
+            }
+            this.running.delete(worker);
+            this.idle.push(worker);
+            this.finish(pending, response.result);
+            this.dispatch();
+        });
+        worker.on('error', error => {
+            this.remove(worker, `工作线程出错: ${error}`);
+        });
+        worker.on('exit', code => {
+            this.remove(worker, `工作线程异常退出: ${code}`);
+        });
+
+        this.workers.push(worker);
+        return worker;
+    }
+
+    private remove(worker: Worker, message: string): void {
+        const index = this.workers.indexOf(worker);
+        if (index < 0) {
+            return;
+        }
+        this.workers.splice(index, 1);
+        this.idle = this.idle.filter(item => item !== worker);
+
+        // 正在处理的任务返回失败结果，排队中的任务交给其他线程
+        const pending = this.running.get(worker);
+        if (pending) {
+            this.running.delete(worker);
+            this.finish(pending, this.failure(pending.job, message));
+        }
+        if (!this.disposed) {
+            this.dispatch();
+        }
+    }
+
+    private failure(job: AnalysisJob, message: string): AnalysisResult {
+        return {
+            file_path: job.filePath,
+            reports: [],
+            success: false,
+            error: message
+        };
+    }
+
+    private cancelled(job: AnalysisJob): AnalysisResult {
+        return {
+            file_path: job.filePath,
+            reports: [],
+            success: false,
+            cancelled: true,
+            error: '分析已取消'
+        };
+    }
+}